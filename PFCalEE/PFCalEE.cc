@@ -1,6 +1,17 @@
 #include "G4RunManager.hh"
+#ifdef G4MULTITHREADED
+#include "G4MTRunManager.hh"
+#include "ActionInitialization.hh"
+#endif
 #include "G4UImanager.hh"
 
+#include "RVersion.h"
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+#include "TROOT.h"
+#else
+#include "TThread.h"
+#endif
+
 #include "Randomize.hh"
 
 #include "DetectorConstruction.hh"
@@ -9,8 +20,10 @@
 #include "PrimaryGeneratorAction.hh"
 #include "RunAction.hh"
 #include "EventAction.hh"
+#include "StackingAction.hh"
 #include "SteppingAction.hh"
 #include "SteppingVerbose.hh"
+#include "HGCSSGeometryConversion.hh"
 
 #ifdef G4VIS_USE
 #include "G4VisExecutive.hh"
@@ -34,9 +47,6 @@ int main(int argc,char** argv)
   // User Verbose output class
   G4VSteppingVerbose::SetInstance(new SteppingVerbose);
      
-  // Construct the default run manager
-  G4RunManager * runManager = new G4RunManager;
-
   // Set mandatory initialization classes
   //int version=DetectorConstruction::v_HGCAL_2016TB;
   int version=64;
@@ -64,14 +74,57 @@ int main(int argc,char** argv)
   if(argc>7) absThickPb = argv[7];
   if(argc>8) dropLayers = argv[8];
 
-  runManager->SetUserInitialization(new DetectorConstruction(version,model,shape,absThickW,absThickPb,dropLayers));
+  //number of threads: >1 runs the multithreaded mode, only with a G4MULTITHREADED build
+  unsigned nThreads = 1;
+  if(argc>9) nThreads = atoi(argv[9]);
+
+  //layers in their own envelope volume (1, default) or all volumes directly in the world (0)
+  bool nestedLayers = true;
+  if(argc>10) nestedLayers = atoi(argv[10])!=0;
+
+  //cells of the geometry maps from a cache built with userlib/bin/buildCellGeometryCache
+  if(argc>11 && !HGCSSGeometryConversion::openCellGeometryCache(argv[11]))
+    std::cout << "-- Cell geometry cache not used, the maps are built." << std::endl;
+
+  // Construct the default run manager
+  G4RunManager * runManager = 0;
+#ifdef G4MULTITHREADED
+  if (nThreads>1) {
+    std::cout << "-- Running multithreaded with " << nThreads << " threads." << std::endl;
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+    ROOT::EnableThreadSafety();
+#else
+    TThread::Initialize();
+#endif
+    G4MTRunManager * mtRunManager = new G4MTRunManager;
+    mtRunManager->SetNumberOfThreads(nThreads);
+    runManager = mtRunManager;
+  }
+  else runManager = new G4RunManager;
+#else
+  if (nThreads>1) {
+    std::cout << "-- Geant4 was not built with multithreading, ignoring request for " << nThreads << " threads." << std::endl;
+    nThreads = 1;
+  }
+  runManager = new G4RunManager;
+#endif
+
+  runManager->SetUserInitialization(new DetectorConstruction(version,model,shape,absThickW,absThickPb,dropLayers,nestedLayers));
   runManager->SetUserInitialization(new PhysicsList);
 
   // Set user action classes
+#ifdef G4MULTITHREADED
+  if (nThreads>1) runManager->SetUserInitialization(new ActionInitialization(model,eta));
+  else {
+#endif
   runManager->SetUserAction(new PrimaryGeneratorAction(model,eta));
   runManager->SetUserAction(new RunAction);
   runManager->SetUserAction(new EventAction);
+  runManager->SetUserAction(new StackingAction);
   runManager->SetUserAction(new SteppingAction);
+#ifdef G4MULTITHREADED
+  }
+#endif
   
   // Initialize G4 kernel
   runManager->Initialize();
@@ -123,7 +176,10 @@ int main(int argc,char** argv)
 #ifdef G4VIS_USE
   delete visManager;
 #endif
+  //in MT mode, worker threads close their output files when the run manager is deleted
   delete runManager;
 
+  if (nThreads>1 && !EventAction::mergeOutputs(nThreads)) return 1;
+
   return 0;
 }
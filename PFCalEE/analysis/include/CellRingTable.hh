@@ -0,0 +1,78 @@
+#ifndef CellRingTable_hh
+#define CellRingTable_hh
+
+#include <map>
+#include <vector>
+#include <cmath>
+
+//Signal-region ring of a cell around a reference cell, looked up from
+//the integer lattice offset of the two cell centres. The centres of the
+//hexagon and square tilings all lie on a rectangular lattice of pitch
+//(qx,qy): the table gives, per offset, the first of the nested regions
+//containing the cell. Offsets whose distance is within tolerance of a
+//region boundary are flagged Ambiguous, for the caller to test exactly.
+
+class CellRingTable{
+
+public:
+  enum { Ambiguous = 255 };
+
+  CellRingTable();
+  ~CellRingTable(){};
+
+  //cell centres of one tiling and region sizes in increasing order.
+  //square: region i is max(|dx|,|dy|)<=sizes[i], else dr<sizes[i].
+  //False if the centres are not on a rectangular lattice.
+  bool build(const std::map<int,std::pair<double,double> > & centres,
+	     const std::vector<double> & sizes,
+	     const bool square);
+
+  inline bool valid() const{
+    return valid_;
+  };
+
+  inline unsigned nRegions() const{
+    return nRegions_;
+  };
+
+  //lattice coordinates of (x,y), false if not a cell centre
+  inline bool cell(const double x, const double y, int & ix, int & iy) const{
+    ix = iy = 0;
+    if (!valid_) return false;
+    const double fx = (x-x0_)*invQx_;
+    const double fy = (y-y0_)*invQy_;
+    ix = static_cast<int>(floor(fx+0.5));
+    iy = static_cast<int>(floor(fy+0.5));
+    return fabs(fx-ix)*qx_<tolerance_ && fabs(fy-iy)*qy_<tolerance_;
+  };
+
+  //first region containing cell (ix,iy) around cell (rx,ry),
+  //nRegions() if in none, or Ambiguous
+  inline unsigned ring(const int ix, const int iy, const int rx, const int ry) const{
+    const int dx = ix-rx;
+    const int dy = iy-ry;
+    if (dx<-nx_ || dx>nx_ || dy<-ny_ || dy>ny_) return nRegions_;
+    return table_[(dy+ny_)*(2*nx_+1)+dx+nx_];
+  };
+
+private:
+  //lattice pitch from the sorted distinct coordinates
+  bool pitch(std::vector<double> & values, double & start, double & step) const;
+
+  bool valid_;
+  unsigned nRegions_;
+  double tolerance_;
+  double x0_;
+  double y0_;
+  double qx_;
+  double qy_;
+  double invQx_;
+  double invQy_;
+  //offsets covered: [-nx_,nx_] x [-ny_,ny_]
+  int nx_;
+  int ny_;
+  std::vector<unsigned char> table_;
+
+};
+
+#endif
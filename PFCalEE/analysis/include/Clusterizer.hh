@@ -8,6 +8,7 @@
 #include "HGCSSCluster.hh"
 // helpful tools
 #include "KDTreeLinkerAlgoT.h"
+#include "LayerHitIndex.hh"
 #include <unordered_map>
 #include <unordered_set>
 
@@ -132,9 +133,17 @@ private:
   double _moliR;
   unsigned debug_;
 
-  // used for rechit searching 
-  std::vector<KDNode> _cluster_nodes, _hit_nodes, _found;
-  KDTree _cluster_kdtree,_hit_kdtree;
+  // used for cluster searching 
+  std::vector<KDNode> _cluster_nodes, _found;
+  KDTree _cluster_kdtree;
+  // rechits searched per layer, with their z as in the index
+  LayerHitIndex _hit_index;
+  std::vector<float> _hit_z;
+  // scratch buffers of build2DCluster, reused across seeds and events:
+  // neighbours of the current hit, and hits to visit with the energy
+  // of the hit they were found from
+  std::vector<unsigned> _hit_found;
+  std::vector<std::pair<unsigned,double> > _stack;
 
 
 };//end class
@@ -0,0 +1,90 @@
+#ifndef HGCSSEventLoop_hh
+#define HGCSSEventLoop_hh
+
+#include <vector>
+#include <mutex>
+
+class TChain;
+class TDirectory;
+class TH1;
+class TTree;
+
+//Loop over the entries of a sim and a reco chain on several threads.
+//Each thread runs its own Worker, on its own copy of the chains, over a
+//contiguous block of entries: thread 0 gets the first entries, thread 1
+//the next ones, etc. The histograms and trees booked by the workers are
+//added to those of the first worker at the end, trees in entry order,
+//so that only the first worker's output is used after the loop.
+//With one thread, the loop runs on the caller's chains as before.
+class HGCSSEventLoop{
+
+public:
+  class Worker{
+  public:
+    Worker();
+    virtual ~Worker(){};
+
+    //book the output and set the branch addresses of the chains of this
+    //worker (0 if not used). Called on the main thread, in the output
+    //directory, one worker after the other.
+    virtual bool begin(TChain *simTree, TChain *recTree)=0;
+    //entry ievt is read in both chains
+    virtual void process(const unsigned ievt)=0;
+    //on the worker's thread, after its last entry
+    virtual void end(){};
+
+  protected:
+    //output to merge across threads, in the same order in all workers.
+    //The objects of the other workers are deleted after the merge.
+    template <class T> T* book(T *obj){
+      addOutput(obj);
+      return obj;
+    };
+
+  private:
+    friend class HGCSSEventLoop;
+    void addOutput(TH1 *hist);
+    void addOutput(TTree *tree);
+
+    //set by the loop when running on several threads
+    bool parallel_;
+    unsigned thread_;
+    std::vector<TH1*> hists_;
+    std::vector<TTree*> trees_;
+    //where the trees were booked, before being kept in memory
+    std::vector<TDirectory*> treeDirs_;
+  };
+
+  //either chain can be 0. nThreads=0 uses all cores.
+  HGCSSEventLoop(TChain *simTree, TChain *recTree, const unsigned nThreads=1);
+  ~HGCSSEventLoop();
+
+  inline unsigned nThreads() const{
+    return nThreads_;
+  };
+
+  //one worker per thread: process the first nEvts entries and merge
+  //the output into workers[0]
+  bool run(const std::vector<Worker*> & workers, const unsigned nEvts);
+
+private:
+  HGCSSEventLoop(const HGCSSEventLoop &);
+  HGCSSEventLoop & operator=(const HGCSSEventLoop &);
+
+  void processRange(Worker *worker,
+		    TChain *simTree,
+		    TChain *recTree,
+		    const unsigned first,
+		    const unsigned last);
+  bool merge(const std::vector<Worker*> & workers);
+
+  unsigned nThreads_;
+  //per thread, the first ones are the caller's
+  std::vector<TChain*> simTrees_;
+  std::vector<TChain*> recTrees_;
+  //file opening and printout are not thread safe
+  std::mutex mutex_;
+
+};
+
+#endif
@@ -76,7 +76,9 @@ public:
 
   bool fillEnergies();
  
-  double calcGlobalC(const double LimMIP, const double EmipMean, TH1F* spectrum); 
+  //ratio of the FH hits of the current event below LimMIP and below
+  //EmipMean, counted in bins of the spectrum histograms
+  double calcGlobalC(const double LimMIP, const double EmipMean) const;
   
   inline double getGlobalC(const unsigned iLim) { 
       if(iLim < Cglobal_.size()) return Cglobal_[iLim];
@@ -85,6 +87,9 @@ public:
 
 private:
 
+  //cumulative hit counts of fhEnergies_ for calcGlobalC
+  void fillSpectrumCounts();
+
   std::string outputName_;
   TFile *outputFile_;
   TTree *outtree_;
@@ -111,6 +116,11 @@ private:
   double EE_, EFHCAL_, EBHCAL_;
   double EmipMeanFH_;
   unsigned nhitsFH_; 
+  //FH hit energies of the current event, and number of hits below
+  //each bin of spectrumAxis_
+  std::vector<double> fhEnergies_;
+  std::vector<unsigned> spectrumCounts_;
+  TAxis spectrumAxis_;
 
   TH1F *p_spectrum;
   TH1F *p_spectrum_hightail;
@@ -0,0 +1,64 @@
+#ifndef InputBranches_hh
+#define InputBranches_hh
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+#include "TTree.h"
+#include "TStopwatch.h"
+
+//Branches of an input tree or chain used by one analysis stage. The
+//stage declares them with use(), enable() then disables all the other
+//branches and prefetches the used ones with a TTreeCache. getEntry()
+//reads the used branches one by one to count, per branch, the bytes
+//unzipped and the time spent decompressing and streaming them. The
+//branch status stays as set until the next stage enables its own.
+class InputBranches{
+
+public:
+  InputBranches(TTree *tree, const std::string & stage);
+  ~InputBranches(){};
+
+  //address as for TTree::SetBranchAddress. Optional branches missing
+  //from the tree are skipped, false if missing.
+  template <class T> bool use(const std::string & name, T * address, const bool optional=false){
+    if (!tree_->GetBranch(name.c_str())) {
+      if (!optional) std::cout << " -- Error, " << stage_ << ": no branch " << name << " in tree " << tree_->GetName() << std::endl;
+      return false;
+    }
+    tree_->SetBranchAddress(name.c_str(),address);
+    add(name);
+    return true;
+  };
+
+  //after the last use(), cacheSize in bytes
+  void enable(const unsigned cacheSize=30000000);
+
+  //read the used branches of entry ievt, bytes unzipped or <=0 on error
+  int getEntry(const unsigned ievt);
+
+  //bytes and time per branch since enable()
+  void print() const;
+
+private:
+  void add(const std::string & name);
+
+  TTree *tree_;
+  std::string stage_;
+  //current tree of a chain
+  int treeNumber_;
+  std::vector<std::string> names_;
+  std::vector<TBranch*> branches_;
+  std::vector<unsigned> nEntries_;
+  std::vector<double> bytes_;
+  //estimated from the compression factor of the branch in each file
+  std::vector<double> zipBytes_;
+  std::vector<double> zipFraction_;
+  std::vector<TStopwatch> watches_;
+  Long64_t fileBytesStart_;
+  Int_t fileReadCallsStart_;
+
+};
+
+#endif
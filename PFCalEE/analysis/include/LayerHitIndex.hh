@@ -0,0 +1,105 @@
+#ifndef LayerHitIndex_hh
+#define LayerHitIndex_hh
+
+#include <vector>
+
+//Per-layer uniform grid of the hit (x,y) positions, for box searches
+//restricted to one layer. Bins are binSize wide, typically the cell
+//pitch, enlarged for layers spanning more than maxBins bins.
+//add() every hit with its index in the caller's vector, build(), then
+//search(); clear() before adding the hits of the next event.
+//Boxes are inclusive, as in KDTreeLinkerAlgo.
+//Hits of one layer are returned bin by bin: sort the output if the order matters.
+
+class LayerHitIndex{
+
+public:
+  struct Query{
+    unsigned layer;
+    float xmin;
+    float xmax;
+    float ymin;
+    float ymax;
+    Query(){};
+    Query(const unsigned alayer,
+	  const float axmin, const float axmax,
+	  const float aymin, const float aymax):
+      layer(alayer),xmin(axmin),xmax(axmax),ymin(aymin),ymax(aymax)
+    {};
+  };
+
+  LayerHitIndex(const double binSize=10., const unsigned maxBins=256);
+  ~LayerHitIndex(){};
+
+  inline void setBinSize(const double binSize){
+    binSize_ = binSize;
+  };
+
+  //remove all hits, keeping the allocated memory
+  void clear();
+  void reserve(const unsigned nHits);
+
+  void add(const unsigned index, const unsigned layer,
+	   const float x, const float y);
+  void build();
+
+  inline unsigned nLayers() const{
+    return grids_.size();
+  };
+
+  inline unsigned size() const{
+    return index_.size();
+  };
+
+  //append to found the indices of the hits of layer with
+  //xmin<=x<=xmax and ymin<=y<=ymax, return the number appended.
+  unsigned search(const unsigned layer,
+		  const float xmin, const float xmax,
+		  const float ymin, const float ymax,
+		  std::vector<unsigned> & found) const;
+
+  inline unsigned search(const Query & q, std::vector<unsigned> & found) const{
+    return search(q.layer,q.xmin,q.xmax,q.ymin,q.ymax,found);
+  };
+
+  //all boxes at once: found is cleared, and the hits of query i are
+  //found[offsets[i]] to found[offsets[i+1]-1].
+  void search(const std::vector<Query> & queries,
+	      std::vector<unsigned> & found,
+	      std::vector<unsigned> & offsets) const;
+
+private:
+  struct Grid{
+    double x0;
+    double y0;
+    double invBin;
+    unsigned nx;
+    unsigned ny;
+    unsigned firstBin;
+  };
+
+  unsigned binX(const Grid & g, const double x) const;
+  unsigned binY(const Grid & g, const double y) const;
+
+  double binSize_;
+  unsigned maxBins_;
+
+  std::vector<Grid> grids_;
+  //hits of bin b are [binStart_[b],binStart_[b+1])
+  std::vector<unsigned> binStart_;
+
+  //hits, ordered by layer and bin after build()
+  std::vector<unsigned> index_;
+  std::vector<unsigned> layer_;
+  std::vector<float> x_;
+  std::vector<float> y_;
+
+  //scratch for build()
+  std::vector<unsigned> bin_;
+  std::vector<unsigned> tmpIndex_;
+  std::vector<float> tmpX_;
+  std::vector<float> tmpY_;
+
+};
+
+#endif
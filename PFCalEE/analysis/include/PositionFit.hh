@@ -23,6 +23,8 @@
 #include "HGCSSPUenergy.hh"
 #include "HGCSSGeometryConversion.hh"
 #include "HGCSSCalibration.hh"
+#include "LayerHitIndex.hh"
+#include "PositionStore.hh"
 
 #include "Math/Vector3D.h"
 #include "Math/Vector3Dfwd.h"
@@ -145,6 +147,9 @@ public:
 		       HGCSSClusterVec & output);
 
   bool setTruthInfo(std::vector<HGCSSGenParticle> *genvec, const int G4TrackID);
+  //truth of event ievt as found by getInitialPositions, so the fit pass
+  //does not need the gen particles: false if not found
+  bool setTruthInfo(const unsigned ievt);
 
   //bool getTruthPosition(std::vector<HGCSSGenParticle> *genvec,std::vector<ROOT::Math::XYPoint> & truthPos, const int trackID=1);
 
@@ -152,6 +157,9 @@ public:
 
   void getMaximumCell(std::vector<HGCSSRecoHit> *rechitvec,const double & phimax,const double & etamax,const ROOT::Math::XYZPoint & cluspos,std::vector<double> & xmax,std::vector<double> & ymax);
 
+  //index the rechits of the event per layer, for the two methods below
+  void fillHitIndex(std::vector<HGCSSRecoHit> *rechitvec);
+
   void getEnergyWeightedPosition(std::vector<HGCSSRecoHit> *rechitvec,
 				 const unsigned nPU, 
 				 const std::vector<double> & xmax,
@@ -172,6 +180,7 @@ public:
   bool fillMatrixFromFile(const bool old=false);
   void fillCorrelationMatrix();
 
+  //positions of event ievt from the position store
   bool getPositionFromFile(const unsigned ievt,
 			   std::vector<unsigned> & layerId,
 			   std::vector<double> & posx,
@@ -191,6 +200,14 @@ public:
   unsigned performLeastSquareFit(const unsigned ievt,
 				 FitResult & fit,
 				 const std::vector<unsigned> & lToRemove);
+  //fits[r] and status[r] as from performLeastSquareFit removing the
+  //first r layers of lToRemove, for r=0..lToRemove.size(). The error
+  //matrices are factorised once per event, and each removed layer
+  //updates the factors instead of inverting again.
+  void performLeastSquareFits(const unsigned ievt,
+			      const std::vector<unsigned> & lToRemove,
+			      std::vector<FitResult> & fits,
+			      std::vector<unsigned> & status);
   void finaliseFit();
 
   //return 1 if no input file or <3 layers
@@ -265,6 +282,32 @@ public:
 private:
   PositionFit(){};
 
+  //indices of the rechits that may pass the step cut around
+  //(xmax,ymax), in increasing order, into hitFound_
+  void findHitsAroundMaximum(const std::vector<double> & xmax,
+			     const std::vector<double> & ymax);
+
+  //open the position store of outFolder_ if needed
+  bool openStore();
+  //layers of event ievt into the fitLayerId_ and fitPos*_ vectors
+  bool readFitLayers(const unsigned ievt,
+		     const std::vector<unsigned> & lToRemove,
+		     const bool cutOutliers);
+  //Cholesky factors of the x and y error matrices of the fitLayerId_
+  //layers: false if not positive definite
+  bool factoriseErrorMatrices();
+  //remove fitted layer k, updating the factors
+  void removeFitLayer(const unsigned k);
+  //solve L y = b in place, L lower triangular
+  void forwardSubstitute(const std::vector<double> & L,
+			 std::vector<double> & b) const;
+  //fit of the current layers, return codes as fitEvent
+  unsigned fitLayers(const unsigned ievt,
+		     FitResult & fit,
+		     const unsigned nRemoved,
+		     const bool cutOutliers);
+  void countFitStatus(const unsigned ievt, const unsigned fitres);
+
   unsigned nSR_;
   double residualMax_;
   double chi2ndfmax_;
@@ -300,9 +343,33 @@ private:
   Direction truthDir_;
   ROOT::Math::XYZPoint truthVtx_;
 
+  //truth of the events of getInitialPositions
+  struct EventTruth{
+    bool found;
+    Direction dir;
+    ROOT::Math::XYZPoint vtx;
+    double E;
+    EventTruth():found(false),E(0)
+    {};
+  };
+  std::vector<EventTruth> truthCache_;
+
+  //layers of the event being fitted, and Cholesky factors of their
+  //error matrices for x and y, stored row-major nL*nL
+  std::vector<unsigned> fitLayerId_;
+  std::vector<double> fitPosx_;
+  std::vector<double> fitPosy_;
+  std::vector<double> fitPosz_;
+  std::vector<double> fitPosxtruth_;
+  std::vector<double> fitPosytruth_;
+  std::vector<double> fitE_;
+  std::vector<double> chol_[2];
+  bool cholValid_;
+
   unsigned nInvalidFits_;
   unsigned nFailedFitsAfterCut_;
-  std::ofstream fout_;
+  //initial positions and fit results of all events
+  PositionStore store_;
 
   //path for saving data files
   std::string outFolder_;
@@ -333,6 +400,13 @@ private:
   std::vector<std::vector<double> > Exy_;
   std::vector<std::vector<double> > txy_;
 
+  //rechits of the event, and largest step per layer
+  LayerHitIndex hitIndex_;
+  std::vector<double> hitStep_;
+  std::vector<LayerHitIndex::Query> hitQueries_;
+  std::vector<unsigned> hitFound_;
+  std::vector<unsigned> hitOffsets_;
+
   //cluster histos
   TH1F *p_nClusters;
 
@@ -0,0 +1,112 @@
+#ifndef PositionStore_hh
+#define PositionStore_hh
+
+#include <string>
+#include <stdint.h>
+#include <stddef.h>
+
+//per-layer input of the position fit
+struct PositionStoreLayer{
+  double xreco;
+  double yreco;
+  double xtruth;
+  double ytruth;
+  double E;
+};
+
+//result of the position fit, as formerly written in accuratePos.dat
+struct PositionStoreFit{
+  double pos_x;
+  double sigma_pos_x;
+  double tanangle_x;
+  double sigma_tanangle_x;
+  double pos_y;
+  double sigma_pos_y;
+  double tanangle_y;
+  double sigma_tanangle_y;
+  double truth_pos_x;
+  double truth_tanangle_x;
+  double truth_pos_y;
+  double truth_tanangle_y;
+};
+
+//Positions of the PositionFit steps in one memory-mapped binary file
+//with a fixed-size record per event, replacing the initialPos_evt*.dat
+//and accuratePos.dat text files. Layout (native endianness):
+// header | record[nEvents]
+//with record = flags | PositionStoreFit | PositionStoreLayer[nLayers].
+//Events not written have flags 0. Pointers returned by positions() and
+//fit() are invalidated by the next write.
+class PositionStore{
+
+public:
+  PositionStore();
+  ~PositionStore();
+
+  //default file name in a PositionFit output folder
+  static std::string fileName(const std::string & folder);
+
+  //writable: create the file if needed, growing it on writes.
+  //nLayers>0 must match an existing file.
+  bool open(const std::string & filePath,
+	    const unsigned nLayers,
+	    const bool writable=false);
+  void close();
+
+  inline bool isOpen() const{
+    return data_ != 0;
+  };
+
+  inline const std::string & filePath() const{
+    return filePath_;
+  };
+
+  inline unsigned nEvents() const{
+    return nEvents_;
+  };
+
+  inline unsigned nLayers() const{
+    return nLayers_;
+  };
+
+  bool hasPositions(const unsigned ievt) const;
+  bool hasFit(const unsigned ievt) const;
+
+  //nLayers() entries, 0 if not written
+  const PositionStoreLayer * positions(const unsigned ievt) const;
+  const PositionStoreFit * fit(const unsigned ievt) const;
+
+  //new positions also remove the fit of the event
+  bool setPositions(const unsigned ievt, const PositionStoreLayer * layers);
+  bool setFit(const unsigned ievt, const PositionStoreFit & fit);
+  //before fitting all events again
+  void clearFits();
+
+private:
+  //owns the file descriptor and mapping
+  PositionStore(const PositionStore &);
+  PositionStore & operator=(const PositionStore &);
+
+  enum Flags{
+    HasPositions = 1,
+    HasFit = 2
+  };
+
+  uint32_t flags(const unsigned ievt) const;
+  char * record(const unsigned ievt) const;
+  //room for nEvents records, remapping the file if it grows
+  bool reserve(const unsigned nEvents);
+  bool map(const size_t size);
+
+  std::string filePath_;
+  int fd_;
+  bool writable_;
+  char * data_;
+  size_t size_;
+  unsigned nLayers_;
+  unsigned nEvents_;
+  size_t recordSize_;
+
+};
+
+#endif
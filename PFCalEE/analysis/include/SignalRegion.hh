@@ -18,6 +18,7 @@
 #include "HGCSSGeometryConversion.hh"
 #include "HGCSSCalibration.hh"
 #include "PositionFit.hh"
+#include "CellRingTable.hh"
 
 #include "Math/Vector3D.h"
 #include "Math/Vector3Dfwd.h"
@@ -176,6 +177,13 @@ private:
   
   std::vector<FitResult> accurateFit_;
 
+  //SR of a hit from its cell offset to the reference cell, and per
+  //layer sums of the hits by first SR containing them (nSR_ if none)
+  CellRingTable rings_;
+  std::vector<std::vector<double> > ringE_;
+  std::vector<std::vector<double> > ringSubtractedE_;
+  std::vector<std::vector<double> > ringMaxE_;
+
   unsigned nSkipped_;
   bool firstEvent_;
 
@@ -0,0 +1,96 @@
+#include <algorithm>
+
+#include "CellRingTable.hh"
+
+CellRingTable::CellRingTable():
+  valid_(false),
+  nRegions_(0),
+  //mm: well above the rounding of the cell centres, well below the
+  //distance between a cell and a region boundary
+  tolerance_(0.01),
+  x0_(0),
+  y0_(0),
+  qx_(1),
+  qy_(1),
+  invQx_(1),
+  invQy_(1),
+  nx_(0),
+  ny_(0)
+{
+}
+
+bool CellRingTable::pitch(std::vector<double> & values, double & start, double & step) const{
+  std::sort(values.begin(),values.end());
+  start = values[0];
+  const double range = values.back()-start;
+  if (range<tolerance_) {
+    step = 1;
+    return true;
+  }
+  double minGap = range;
+  double last = start;
+  for (unsigned i(1); i<values.size(); ++i){
+    if (values[i]-last<tolerance_) continue;
+    minGap = std::min(minGap,values[i]-last);
+    last = values[i];
+  }
+  //average over the full range for precision
+  step = range/floor(range/minGap+0.5);
+  return step>tolerance_;
+}
+
+bool CellRingTable::build(const std::map<int,std::pair<double,double> > & centres,
+			  const std::vector<double> & sizes,
+			  const bool square){
+  valid_ = false;
+  nRegions_ = sizes.size();
+  table_.clear();
+  if (centres.empty() || nRegions_==0 || nRegions_>=Ambiguous) return false;
+  for (unsigned i(1); i<nRegions_; ++i){
+    if (sizes[i]<sizes[i-1]) return false;
+  }
+
+  std::vector<double> xs, ys;
+  xs.reserve(centres.size());
+  ys.reserve(centres.size());
+  std::map<int,std::pair<double,double> >::const_iterator iter = centres.begin();
+  for (; iter!=centres.end(); ++iter){
+    xs.push_back(iter->second.first);
+    ys.push_back(iter->second.second);
+  }
+  if (!pitch(xs,x0_,qx_) || !pitch(ys,y0_,qy_)) return false;
+  invQx_ = 1./qx_;
+  invQy_ = 1./qy_;
+
+  //all centres must be lattice points
+  valid_ = true;
+  int ix,iy;
+  for (iter = centres.begin(); iter!=centres.end(); ++iter){
+    if (!cell(iter->second.first,iter->second.second,ix,iy)) {
+      valid_ = false;
+      return false;
+    }
+  }
+
+  const double maxSize = sizes.back()+tolerance_;
+  nx_ = static_cast<int>(maxSize*invQx_)+1;
+  ny_ = static_cast<int>(maxSize*invQy_)+1;
+  table_.resize((2*nx_+1)*(2*ny_+1));
+  for (int dy(-ny_); dy<=ny_; ++dy){
+    for (int dx(-nx_); dx<=nx_; ++dx){
+      const double ddx = dx*qx_;
+      const double ddy = dy*qy_;
+      const double d = square ? std::max(fabs(ddx),fabs(ddy)) : sqrt(ddx*ddx+ddy*ddy);
+      unsigned first = nRegions_;
+      for (unsigned i(0); i<nRegions_; ++i){
+	if (fabs(d-sizes[i])<tolerance_) {
+	  first = Ambiguous;
+	  break;
+	}
+	if (first==nRegions_ && (square ? d<=sizes[i] : d<sizes[i])) first = i;
+      }
+      table_[(dy+ny_)*(2*nx_+1)+dx+nx_] = first;
+    }
+  }
+  return true;
+}
@@ -14,10 +14,13 @@ Clusterizer::Clusterizer(unsigned debug){
 
   _moliR = 2.7;//cm
   debug_ = debug;
+  //bins of one search radius: a search reads 3*3 bins
+  _hit_index.setBinSize(_moliR);
 
   // clean initial state for searching
   _cluster_nodes.clear(); _found.clear(); _cluster_kdtree.clear();
-  _hit_nodes.clear(); _hit_kdtree.clear();
+  _hit_index.clear(); _hit_z.clear();
+  _hit_found.clear(); _stack.clear();
 
 }
 
@@ -59,11 +62,17 @@ buildClusters(std::vector<HGCSSRecoHit> *rechitvec,
     }
   }
 
-  // get ready for initial topo clustering
-  KDTreeCube kd_boundingregion = 
-    fill_and_bound_kd_tree(rechits,usable_rechits,_hit_nodes);
-  _hit_kdtree.build(_hit_nodes,kd_boundingregion);
-  _hit_nodes.clear();
+  // get ready for initial topo clustering: hits are only searched
+  // for in their own layer
+  _hit_index.clear();
+  _hit_index.reserve(rechits.size());
+  _hit_z.resize(rechits.size());
+  for( unsigned i = 0; i < rechits.size(); ++i ) {
+    const auto& pos = rechits[i].position();
+    _hit_z[i] = (float)pos.Z();
+    if( usable_rechits[i] ) _hit_index.add(i,rechits[i].layer(),(float)pos.X(),(float)pos.Y());
+  }
+  _hit_index.build();
   // make topo-clusters that require that the energy goes
   // down with respect to the last rechit encountered
   // rechits clustered this way are locked from further use  
@@ -95,7 +104,7 @@ buildClusters(std::vector<HGCSSRecoHit> *rechitvec,
 
   if (debug_) std::cout << " -- Number of clusters per layer: " << clusters_per_layer.size() << std::endl;
 
-  _hit_kdtree.clear();
+  _hit_index.clear();
   
   HGCSSClusterVec z_linked_clusters;
   // use topo clusters to link in z
@@ -124,44 +133,58 @@ build2DCluster(const std::vector<HGCSSRecoHit>  & rechitvec,
 	       std::vector<bool>& usable,
 	       HGCSSCluster & cluster){
 
-  usable[current_index] = false;
-  const HGCSSRecoHit & current_cell = rechitvec[current_index];
+  //flood fill with an explicit stack instead of one recursion per hit.
+  //Neighbours are pushed in reverse order and tested when popped, so
+  //hits are visited in the same order as the depth-first recursion.
+  //Each entry keeps the energy of the hit it was found from.
+  _stack.clear();
+  _stack.push_back(std::pair<unsigned,double>(current_index,rechitvec[current_index].energy()));
+  bool isSeed = true;
 
-  if (debug_>1) std::cout << " -- Current index = " << current_index << " hit energy = " << current_cell.energy() << std::endl;
+  while (!_stack.empty()){
+    const unsigned index = _stack.back().first;
+    const double parentEnergy = _stack.back().second;
+    _stack.pop_back();
+    const HGCSSRecoHit & current_cell = rechitvec[index];
 
-  cluster.addRecHitFraction(std::pair<HGCSSRecoHit*,double>(const_cast<HGCSSRecoHit*>(&current_cell),1.0));
+    // only cluster if not a seed, not used, and energy less than present
+    if (!isSeed){
+      if (debug_>2) std::cout << " Neighbour index: " << index << " usable = " << usable[index] << " seedable " << seedable[index] << " energy " << current_cell.energy() << " rechitmask " << rechitMask[index] << std::endl;
+      if( !usable[index] || seedable[index] ||
+	  current_cell.energy() > parentEnergy || // <= takes care of MIP sea
+	  !rechitMask[index]) continue;
+    }
+    isSeed = false;
 
-  if (debug_>2) std::cout << " Cluster now has : " << cluster.recHitFractions().size() << " rechits associated. Energy of first ele: " << cluster.recHitFractions().begin()->first->energy() << std::endl;
-  
+    usable[index] = false;
 
-  //CAMM: mm??
-  double moliere_radius = _moliR;
-  const ROOT::Math::XYZPoint pos = current_cell.position();
-  
-  auto x_rh = minmax(pos.x()+moliere_radius,pos.x()-moliere_radius);
-  auto y_rh = minmax(pos.y()+moliere_radius,pos.y()-moliere_radius);
-  //CAMM 1um ?? Need to change to 300um :/
-  auto z_rh = minmax(pos.z()+0.03,pos.z()-0.03);
+    if (debug_>1) std::cout << " -- Current index = " << index << " hit energy = " << current_cell.energy() << std::endl;
 
-  KDTreeCube hit_searchcube((float)x_rh.first,(float)x_rh.second,
-			    (float)y_rh.first,(float)y_rh.second,
-			    (float)z_rh.first,(float)z_rh.second);
-  std::vector<KDNode> found;
-  _hit_kdtree.search(hit_searchcube,found);
+    cluster.addRecHitFraction(std::pair<HGCSSRecoHit*,double>(const_cast<HGCSSRecoHit*>(&current_cell),1.0));
 
-  if (debug_>1) std::cout << " -- Number of closest neighbours found: " << found.size() << std::endl; 
+    if (debug_>2) std::cout << " Cluster now has : " << cluster.recHitFractions().size() << " rechits associated. Energy of first ele: " << cluster.recHitFractions().begin()->first->energy() << std::endl;
 
-  for( const KDNode& nbourpoint :found ) {
-    // only cluster if not a seed, not used, and energy less than present
-    if (debug_>2) std::cout << " Neighbour index: " << nbourpoint.data << " usable = " << usable[nbourpoint.data] << " seedable " << seedable[nbourpoint.data] << " energy " << rechitvec[nbourpoint.data].energy() << " rechitmask " << rechitMask[nbourpoint.data] << std::endl;
-    const HGCSSRecoHit& nbour = rechitvec[nbourpoint.data];
-    if( usable[nbourpoint.data] && !seedable[nbourpoint.data] &&
-	nbour.energy() <= current_cell.energy() && // <= takes care of MIP sea
-	rechitMask[nbourpoint.data]) {
-      //std::cout << " search for next neighbours!" << std::endl;
-      build2DCluster(rechitvec,rechitMask,seedable,nbourpoint.data,usable,cluster);
+    //CAMM: mm??
+    double moliere_radius = _moliR;
+    const ROOT::Math::XYZPoint pos = current_cell.position();
+
+    auto x_rh = minmax(pos.x()+moliere_radius,pos.x()-moliere_radius);
+    auto y_rh = minmax(pos.y()+moliere_radius,pos.y()-moliere_radius);
+    //CAMM 1um ?? Need to change to 300um :/
+    auto z_rh = minmax(pos.z()+0.03,pos.z()-0.03);
+
+    _hit_found.clear();
+    _hit_index.search(current_cell.layer(),
+		      (float)x_rh.first,(float)x_rh.second,
+		      (float)y_rh.first,(float)y_rh.second,
+		      _hit_found);
+
+    if (debug_>1) std::cout << " -- Number of closest neighbours found: " << _hit_found.size() << std::endl;
+
+    for (std::vector<unsigned>::const_reverse_iterator nbourpoint = _hit_found.rbegin(); nbourpoint != _hit_found.rend(); ++nbourpoint){
+      if (_hit_z[*nbourpoint] < (float)z_rh.first || _hit_z[*nbourpoint] > (float)z_rh.second) continue;
+      _stack.push_back(std::pair<unsigned,double>(*nbourpoint,current_cell.energy()));
     }
-    //else std::cout << " -- going to next found node." << std::endl;
   }
 }//build2Dcluster
 
@@ -0,0 +1,171 @@
+#include "HGCSSEventLoop.hh"
+#include <iostream>
+#include <thread>
+
+#include "RVersion.h"
+#include "TROOT.h"
+#include "TThread.h"
+#include "TChain.h"
+#include "TDirectory.h"
+#include "TH1.h"
+#include "TTree.h"
+#include "TList.h"
+
+HGCSSEventLoop::Worker::Worker():
+  parallel_(false),
+  thread_(0)
+{
+}
+
+void HGCSSEventLoop::Worker::addOutput(TH1 *hist){
+  if (!hist) return;
+  if (parallel_ && thread_>0) hist->SetDirectory(0);
+  hists_.push_back(hist);
+}
+
+void HGCSSEventLoop::Worker::addOutput(TTree *tree){
+  if (!tree) return;
+  treeDirs_.push_back(tree->GetDirectory());
+  //filled in memory, the first worker's tree is written after the merge
+  if (parallel_) tree->SetDirectory(0);
+  trees_.push_back(tree);
+}
+
+HGCSSEventLoop::HGCSSEventLoop(TChain *simTree, TChain *recTree, const unsigned nThreads):
+  nThreads_(nThreads)
+{
+  if (nThreads_==0) nThreads_ = std::thread::hardware_concurrency();
+  if (nThreads_==0) nThreads_ = 1;
+  simTrees_.resize(nThreads_,0);
+  recTrees_.resize(nThreads_,0);
+  simTrees_[0] = simTree;
+  recTrees_[0] = recTree;
+  //same files, opened separately by each thread
+  for (unsigned iT(1); iT<nThreads_; ++iT){
+    if (simTree) {
+      simTrees_[iT] = new TChain(simTree->GetName());
+      simTrees_[iT]->Add(simTree);
+    }
+    if (recTree) {
+      recTrees_[iT] = new TChain(recTree->GetName());
+      recTrees_[iT]->Add(recTree);
+    }
+  }
+}
+
+HGCSSEventLoop::~HGCSSEventLoop(){
+  for (unsigned iT(1); iT<nThreads_; ++iT){
+    delete simTrees_[iT];
+    delete recTrees_[iT];
+  }
+}
+
+void HGCSSEventLoop::processRange(Worker *worker,
+				  TChain *simTree,
+				  TChain *recTree,
+				  const unsigned first,
+				  const unsigned last){
+  for (unsigned ievt(first); ievt<last; ++ievt){//loop on entries
+    {
+      std::lock_guard<std::mutex> lock(mutex_);
+      if (ievt%100 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
+      //opens the next file when needed
+      if (simTree) simTree->LoadTree(ievt);
+      if (recTree) recTree->LoadTree(ievt);
+    }
+    if (simTree) simTree->GetEntry(ievt);
+    if (recTree) recTree->GetEntry(ievt);
+    worker->process(ievt);
+  }//loop on entries
+  worker->end();
+}
+
+bool HGCSSEventLoop::run(const std::vector<Worker*> & workers, const unsigned nEvts){
+  if (workers.size() != nThreads_) {
+    std::cout << " -- Error, " << workers.size() << " workers for " << nThreads_ << " threads." << std::endl;
+    return false;
+  }
+
+  if (nThreads_==1) {
+    if (!workers[0]->begin(simTrees_[0],recTrees_[0])) return false;
+    processRange(workers[0],simTrees_[0],recTrees_[0],0,nEvts);
+    return true;
+  }
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+  ROOT::EnableThreadSafety();
+#else
+  TThread::Initialize();
+#endif
+
+  //histograms of the other threads are not attached to the output
+  const bool addDirectory = TH1::AddDirectoryStatus();
+  for (unsigned iT(0); iT<nThreads_; ++iT){
+    workers[iT]->parallel_ = true;
+    workers[iT]->thread_ = iT;
+    TH1::AddDirectory(iT==0 && addDirectory);
+    bool ok = workers[iT]->begin(simTrees_[iT],recTrees_[iT]);
+    if (ok && (workers[iT]->hists_.size() != workers[0]->hists_.size() ||
+	       workers[iT]->trees_.size() != workers[0]->trees_.size())) {
+      std::cout << " -- Error, worker " << iT << " did not book the same output as worker 0." << std::endl;
+      ok = false;
+    }
+    if (!ok) {
+      TH1::AddDirectory(addDirectory);
+      return false;
+    }
+  }
+  TH1::AddDirectory(addDirectory);
+
+  std::cout << " -- Processing " << nEvts << " entries on " << nThreads_ << " threads." << std::endl;
+  std::vector<std::thread> lThreads;
+  for (unsigned iT(0); iT<nThreads_; ++iT){
+    const unsigned first = static_cast<unsigned>(static_cast<unsigned long long>(nEvts)*iT/nThreads_);
+    const unsigned last = static_cast<unsigned>(static_cast<unsigned long long>(nEvts)*(iT+1)/nThreads_);
+    lThreads.push_back(std::thread(&HGCSSEventLoop::processRange,this,
+				   workers[iT],simTrees_[iT],recTrees_[iT],first,last));
+  }
+  for (unsigned iT(0); iT<nThreads_; ++iT){
+    lThreads[iT].join();
+  }
+
+  return merge(workers);
+}
+
+bool HGCSSEventLoop::merge(const std::vector<Worker*> & workers){
+  Worker *lMain = workers[0];
+  for (unsigned iH(0); iH<lMain->hists_.size(); ++iH){
+    for (unsigned iT(1); iT<nThreads_; ++iT){
+      lMain->hists_[iH]->Add(workers[iT]->hists_[iH]);
+      delete workers[iT]->hists_[iH];
+    }
+  }
+  for (unsigned iT(1); iT<nThreads_; ++iT){
+    workers[iT]->hists_.clear();
+  }
+
+  bool ok = true;
+  for (unsigned iO(0); iO<lMain->trees_.size(); ++iO){
+    TTree *lTree = lMain->trees_[iO];
+    lTree->SetDirectory(lMain->treeDirs_[iO]);
+    //entries appended in the order of the list, i.e. of the threads
+    TList lList;
+    for (unsigned iT(1); iT<nThreads_; ++iT){
+      lList.Add(workers[iT]->trees_[iO]);
+    }
+    if (lTree->Merge(&lList)<0) {
+      std::cout << " -- Error merging tree " << lTree->GetName() << std::endl;
+      ok = false;
+    }
+    for (unsigned iT(1); iT<nThreads_; ++iT){
+      delete workers[iT]->trees_[iO];
+    }
+  }
+  for (unsigned iT(0); iT<nThreads_; ++iT){
+    workers[iT]->trees_.clear();
+    workers[iT]->treeDirs_.clear();
+    workers[iT]->parallel_ = false;
+  }
+  lMain->hists_.clear();
+  return ok;
+}
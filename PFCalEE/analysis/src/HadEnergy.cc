@@ -26,6 +26,9 @@ HadEnergy::HadEnergy(const std::vector<unsigned> & dropLay, HGCSSDetector & myDe
   outputFile_ = outputFile;
   debug_ = false;
 
+  //binning of p_spectrum
+  spectrumAxis_.Set(1000,0,250);
+
   //bookHist(outputFile_);
 }
 
@@ -76,11 +79,29 @@ void HadEnergy::bookHist(TFile *outputFile){
 
 }
 
+namespace {
+  //truth trajectory and total energy of a processed event
+  struct HadEventTruth{
+    unsigned ievt;
+    double Etotal;
+    ROOT::Math::XYZPoint pos;
+    double tanx;
+    double tany;
+    //consider 1*1 m^2 section
+    bool isFiducial(const HGCSSRecoHit & lHit) const{
+      double posz = lHit.get_z();
+      double truthposx = tanx*(posz-pos.z())+pos.x();
+      double truthposy = tany*(posz-pos.z())+pos.y();
+      return fabs(lHit.get_x()-truthposx) <= 500 &&
+	fabs(lHit.get_y()-truthposy) <= 500;
+    };
+  };
+}
+
 bool HadEnergy::fillEnergies(){
 
   p_spectrum->Reset();
-  std::vector<TH1F*> spectrumCollection;
-  std::vector<double> Etotal;
+  std::vector<HadEventTruth> processed;
   TH1F* p_Etotal = new TH1F("p_Etotal","p_Etotal",1000,0,100000);
   unsigned nSec = nSections_;
   double recSum[nSec];
@@ -102,7 +123,7 @@ bool HadEnergy::fillEnergies(){
      
   std::cout << "- Processing = " << nEvts  << " events out of " << lRecTree_->GetEntries() << std::endl;
   
-  spectrumCollection.resize(nEvts,0);
+  processed.reserve(nEvts);
   std::vector<double> absW;
   bool firstEvent = true;
   for (unsigned ievt(0); ievt<nEvts; ++ievt){// loop on entries
@@ -113,18 +134,19 @@ bool HadEnergy::fillEnergies(){
 
     //get truth info
     bool found = false;
-    double truthTanx = 0;
-    double truthTany = 0;
+    HadEventTruth truth;
+    truth.ievt = ievt;
+    truth.tanx = 0;
+    truth.tany = 0;
     //double truthE = 0;
-    ROOT::Math::XYZPoint truthPos;
     for (unsigned iP(0); iP<(*genvec).size(); ++iP){//loop on gen particles    
       if (debug_>1 && (*genvec).size()!= 1) (*genvec)[iP].Print(std::cout);
       if ((*genvec)[iP].trackID()==1){
 	found = true;
 	//set direction
-	truthPos = ROOT::Math::XYZPoint((*genvec)[iP].x(),(*genvec)[iP].y(),(*genvec)[iP].z());
-	truthTanx = (*genvec)[iP].px()/(*genvec)[iP].pz();
-	truthTany = (*genvec)[iP].py()/(*genvec)[iP].pz();
+	truth.pos = ROOT::Math::XYZPoint((*genvec)[iP].x(),(*genvec)[iP].y(),(*genvec)[iP].z());
+	truth.tanx = (*genvec)[iP].px()/(*genvec)[iP].pz();
+	truth.tany = (*genvec)[iP].py()/(*genvec)[iP].pz();
 	//in GeV
 	//truthE = (*genvec)[iP].E()/1000.;
 	
@@ -170,7 +192,7 @@ bool HadEnergy::fillEnergies(){
 
     EmipMeanFH_ = 0;
     nhitsFH_ = 0;
-    spectrumCollection[ievt] = new TH1F("","",1000,0,250);
+    fhEnergies_.clear();
     energy_.clear();
     wgttotalE_ = 0;
     for(unsigned iS(0); iS < nSec; iS++){
@@ -179,15 +201,8 @@ bool HadEnergy::fillEnergies(){
 
 
     for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop over rechits
-      const HGCSSRecoHit lHit = (*rechitvec)[iH];
-      double posx = lHit.get_x();
-      double posy = lHit.get_y();
-      double posz = lHit.get_z();
-      double truthposx = truthTanx*(posz-truthPos.z())+truthPos.x();
-      double truthposy = truthTany*(posz-truthPos.z())+truthPos.y();
-      //consider 1*1 m^2 section
-      if (fabs(posx-truthposx) <= 500 && 
-	  fabs(posy-truthposy) <= 500){
+      const HGCSSRecoHit & lHit = (*rechitvec)[iH];
+      if (truth.isFiducial(lHit)){
 	 
 	unsigned layer = lHit.layer();
 	if (layer >= nLayers_) {
@@ -208,7 +223,8 @@ bool HadEnergy::fillEnergies(){
 	
 	DetectorEnum type = myDetector_.detType(sec);
 	if(type == DetectorEnum::FHCAL && absW[layer]!= 0){
-	  spectrumCollection[ievt]->Fill(energy);
+	  fhEnergies_.push_back(energy);
+	  p_spectrum->Fill(energy);
 	  EmipMeanFH_ += energy;
 	  nhitsFH_ += 1;
 	}
@@ -234,7 +250,8 @@ bool HadEnergy::fillEnergies(){
     }
 
     wgttotalE_ = (EE_-ECALoffset_)/ECALslope_ + ((EFHCAL_-FHtoEoffset_)/FHtoEslope_ + (EBHCAL_-BHtoEoffset_)/(BHtoEslope_*FHtoBHslope_))/EEtoHslope_;
-    Etotal.push_back(wgttotalE_);
+    truth.Etotal = wgttotalE_;
+    processed.push_back(truth);
     p_Etotal->Fill(wgttotalE_);
     if(nhitsFH_!=0)EmipMeanFH_ = EmipMeanFH_/nhitsFH_; 
 
@@ -242,8 +259,10 @@ bool HadEnergy::fillEnergies(){
   //if(EFHCAL < 0.9*GenE/1.25)p_spectrum_lowtail->Add(p_spectrum);
   //else if(EFHCAL > 1.1*GenE/1.25)p_spectrum_hightail->Add(p_spectrum);
 
+    //hit counts below each bin, for all thresholds at once
+    fillSpectrumCounts();
     for(unsigned iLim(0); iLim < LimMIP_.size(); iLim++){
-      Cglobal_[iLim] = calcGlobalC(LimMIP_[iLim], EmipMeanFH_, spectrumCollection[ievt]);
+      Cglobal_[iLim] = calcGlobalC(LimMIP_[iLim], EmipMeanFH_);
       correctedtotalE_[iLim] = (EE_-ECALoffset_)/ECALslope_ + ((EFHCAL_-FHtoEoffset_)/FHtoEslope_*Cglobal_[iLim] + (EBHCAL_-BHtoEoffset_)/(BHtoEslope_*FHtoBHslope_))/(EEtoHslopePar0_/wgttotalE_+EEtoHslopePar1_);//wgttotalE_*Cglobal_[iLim];
     }
 
@@ -254,14 +273,24 @@ bool HadEnergy::fillEnergies(){
   TF1 *fit = (TF1*)p_Etotal->GetFunction("gaus");
   double EMean = fit?fit->GetParameter(1):p_Etotal->GetMean();
   double ERMS = fit?fit->GetParameter(2):p_Etotal->GetRMS();
-  for (unsigned ievt(0); ievt<nEvts; ++ievt){
-    if (!spectrumCollection[ievt]) continue;
-    p_spectrum->Add(spectrumCollection[ievt]);
-    if(Etotal[ievt] < EMean-ERMS)p_spectrum_lowtail->Add(spectrumCollection[ievt]);
-    else if(Etotal[ievt] > EMean+ERMS)p_spectrum_hightail->Add(spectrumCollection[ievt]);
+  //spectra of the tails: read the rechits of these events again, now
+  //that the mean is known, rather than keeping one spectrum per event
+  for (unsigned iE(0); iE<processed.size(); ++iE){
+    const HadEventTruth & truth = processed[iE];
+    TH1F *lTail = 0;
+    if(truth.Etotal < EMean-ERMS) lTail = p_spectrum_lowtail;
+    else if(truth.Etotal > EMean+ERMS) lTail = p_spectrum_hightail;
+    if (!lTail) continue;
+    lRecTree_->GetEntry(truth.ievt);
+    for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop over rechits
+      const HGCSSRecoHit & lHit = (*rechitvec)[iH];
+      unsigned layer = lHit.layer();
+      if (layer >= nLayers_ || !truth.isFiducial(lHit)) continue;
+      if(myDetector_.detType(myDetector_.getSection(layer)) == DetectorEnum::FHCAL && absW[layer]!= 0)
+	lTail->Fill(lHit.energy());
+    }
   }
  
-  spectrumCollection.clear();
   outtree_->Write();
   p_spectrumByLayer->Write(); 
   p_spectrum->Write(); 
@@ -271,20 +300,26 @@ bool HadEnergy::fillEnergies(){
   return true;
 }
 
-double HadEnergy::calcGlobalC(const double LimMIP, const double EmipMean, TH1F* spectrum){
-  Int_t binLim = spectrum->GetXaxis()->FindBin(LimMIP);
-  Int_t binAve = spectrum->GetXaxis()->FindBin(EmipMean);
-  float countLim(0);
-  for(int iB(0); iB < binLim; iB++){
-     countLim += spectrum->GetBinContent(iB);
+void HadEnergy::fillSpectrumCounts(){
+  //same binning as the spectrum histograms
+  const unsigned nBins = spectrumAxis_.GetNbins()+2;
+  spectrumCounts_.assign(nBins+1,0);
+  for (unsigned iH(0); iH<fhEnergies_.size(); ++iH){
+    spectrumCounts_[spectrumAxis_.FindFixBin(fhEnergies_[iH])+1]++;
   }
-  float countAve(0);
-  for(int iB(0); iB < binAve; iB++){
-     countAve += spectrum->GetBinContent(iB);
+  for (unsigned iB(0); iB<nBins; ++iB){
+    spectrumCounts_[iB+1] += spectrumCounts_[iB];
   }
+}
+
+double HadEnergy::calcGlobalC(const double LimMIP, const double EmipMean) const{
+  //number of hits in the bins below the ones of LimMIP and EmipMean
+  Int_t binLim = spectrumAxis_.FindFixBin(LimMIP);
+  Int_t binAve = spectrumAxis_.FindFixBin(EmipMean);
+  float countLim = spectrumCounts_[binLim];
+  float countAve = spectrumCounts_[binAve];
   double globalC(0);
   if(countAve!=0)globalC = countLim/countAve;
  
   return globalC;
 }
-
@@ -0,0 +1,96 @@
+#include "InputBranches.hh"
+
+#include "TFile.h"
+#include "TBranch.h"
+
+InputBranches::InputBranches(TTree *tree, const std::string & stage):
+  tree_(tree),
+  stage_(stage),
+  treeNumber_(-1),
+  fileBytesStart_(0),
+  fileReadCallsStart_(0)
+{
+}
+
+void InputBranches::add(const std::string & name){
+  for (unsigned iB(0); iB<names_.size(); ++iB){
+    if (names_[iB]==name) return;
+  }
+  names_.push_back(name);
+  branches_.push_back(0);
+  nEntries_.push_back(0);
+  bytes_.push_back(0);
+  zipBytes_.push_back(0);
+  zipFraction_.push_back(1);
+  watches_.push_back(TStopwatch());
+}
+
+void InputBranches::enable(const unsigned cacheSize){
+  tree_->SetBranchStatus("*",0);
+  for (unsigned iB(0); iB<names_.size(); ++iB){
+    //with the sub-branches of split objects
+    tree_->SetBranchStatus((names_[iB]+"*").c_str(),1);
+  }
+  //new cache, without the branches of a previous stage
+  tree_->SetCacheSize(0);
+  tree_->SetCacheSize(cacheSize);
+  treeNumber_ = -1;
+  for (unsigned iB(0); iB<names_.size(); ++iB){
+    nEntries_[iB] = 0;
+    bytes_[iB] = 0;
+    zipBytes_[iB] = 0;
+    watches_[iB].Reset();
+  }
+  fileBytesStart_ = TFile::GetFileBytesRead();
+  fileReadCallsStart_ = TFile::GetFileReadCalls();
+}
+
+int InputBranches::getEntry(const unsigned ievt){
+  const Long64_t lEntry = tree_->LoadTree(ievt);
+  if (lEntry<0) return -1;
+  if (tree_->GetTreeNumber() != treeNumber_) {
+    //next file of a chain: new branches and cache
+    treeNumber_ = tree_->GetTreeNumber();
+    TTree *lTree = tree_->GetTree();
+    for (unsigned iB(0); iB<names_.size(); ++iB){
+      branches_[iB] = lTree->GetBranch(names_[iB].c_str());
+      if (!branches_[iB]) {
+	std::cout << " -- Error, " << stage_ << ": no branch " << names_[iB] << " in tree " << treeNumber_ << std::endl;
+	return -1;
+      }
+      tree_->AddBranchToCache(names_[iB].c_str(),kTRUE);
+      const Long64_t lTotBytes = branches_[iB]->GetTotBytes("*");
+      zipFraction_[iB] = lTotBytes>0 ? branches_[iB]->GetZipBytes("*")*1./lTotBytes : 1;
+    }
+  }
+
+  int nbytes = 0;
+  for (unsigned iB(0); iB<branches_.size(); ++iB){
+    watches_[iB].Start(kFALSE);
+    const int nb = branches_[iB]->GetEntry(lEntry);
+    watches_[iB].Stop();
+    if (nb<0) return nb;
+    nEntries_[iB]++;
+    bytes_[iB] += nb;
+    zipBytes_[iB] += nb*zipFraction_[iB];
+    nbytes += nb;
+  }
+  return nbytes;
+}
+
+void InputBranches::print() const{
+  std::cout << " -- Input of " << stage_ << " from tree " << tree_->GetName() << ":" << std::endl;
+  double lTime = 0;
+  for (unsigned iB(0); iB<names_.size(); ++iB){
+    //RealTime() and CpuTime() would restart the watches
+    TStopwatch lWatch = watches_[iB];
+    lTime += lWatch.CpuTime();
+    std::cout << " ---- " << names_[iB] << ": " << nEntries_[iB] << " entries, "
+	      << bytes_[iB]/1.e6 << " MB unzipped, ~" << zipBytes_[iB]/1.e6 << " MB compressed, "
+	      << lWatch.CpuTime() << " s CPU (" << lWatch.RealTime() << " s real) unzipping and streaming."
+	      << std::endl;
+  }
+  std::cout << " ---- Total " << lTime << " s CPU, "
+	    << (TFile::GetFileBytesRead()-fileBytesStart_)/1.e6 << " MB read from files in "
+	    << TFile::GetFileReadCalls()-fileReadCallsStart_ << " calls." << std::endl;
+}
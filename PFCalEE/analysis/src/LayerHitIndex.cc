@@ -0,0 +1,166 @@
+#include <algorithm>
+
+#include "LayerHitIndex.hh"
+
+LayerHitIndex::LayerHitIndex(const double binSize, const unsigned maxBins){
+  binSize_ = binSize;
+  maxBins_ = maxBins>0 ? maxBins : 1;
+}
+
+void LayerHitIndex::clear(){
+  grids_.clear();
+  binStart_.clear();
+  index_.clear();
+  layer_.clear();
+  x_.clear();
+  y_.clear();
+}
+
+void LayerHitIndex::reserve(const unsigned nHits){
+  index_.reserve(nHits);
+  layer_.reserve(nHits);
+  x_.reserve(nHits);
+  y_.reserve(nHits);
+}
+
+void LayerHitIndex::add(const unsigned index, const unsigned layer,
+			const float x, const float y){
+  index_.push_back(index);
+  layer_.push_back(layer);
+  x_.push_back(x);
+  y_.push_back(y);
+}
+
+unsigned LayerHitIndex::binX(const Grid & g, const double x) const{
+  //monotonic in x, so that a box covers the bins of all its hits
+  double t = (x-g.x0)*g.invBin;
+  if (!(t>0)) return 0;
+  if (t>=g.nx) return g.nx-1;
+  return static_cast<unsigned>(t);
+}
+
+unsigned LayerHitIndex::binY(const Grid & g, const double y) const{
+  double t = (y-g.y0)*g.invBin;
+  if (!(t>0)) return 0;
+  if (t>=g.ny) return g.ny-1;
+  return static_cast<unsigned>(t);
+}
+
+void LayerHitIndex::build(){
+
+  const unsigned nH = index_.size();
+  unsigned nL = 0;
+  for (unsigned iH(0); iH<nH; ++iH){
+    if (layer_[iH]+1>nL) nL = layer_[iH]+1;
+  }
+
+  //bounds of each layer
+  std::vector<unsigned> lCount(nL,0);
+  std::vector<float> lXmin(nL,0), lXmax(nL,0), lYmin(nL,0), lYmax(nL,0);
+  for (unsigned iH(0); iH<nH; ++iH){
+    const unsigned iL = layer_[iH];
+    if (lCount[iL]==0) {
+      lXmin[iL] = lXmax[iL] = x_[iH];
+      lYmin[iL] = lYmax[iL] = y_[iH];
+    } else {
+      lXmin[iL] = std::min(lXmin[iL],x_[iH]);
+      lXmax[iL] = std::max(lXmax[iL],x_[iH]);
+      lYmin[iL] = std::min(lYmin[iL],y_[iH]);
+      lYmax[iL] = std::max(lYmax[iL],y_[iH]);
+    }
+    lCount[iL]++;
+  }
+
+  grids_.resize(nL);
+  unsigned nBins = 0;
+  for (unsigned iL(0); iL<nL; ++iL){
+    Grid & g = grids_[iL];
+    g.x0 = lXmin[iL];
+    g.y0 = lYmin[iL];
+    g.firstBin = nBins;
+    if (lCount[iL]==0) {
+      g.invBin = 1.;
+      g.nx = g.ny = 0;
+      continue;
+    }
+    double dx = lXmax[iL]-g.x0;
+    double dy = lYmax[iL]-g.y0;
+    double bin = binSize_;
+    if (std::max(dx,dy) > bin*maxBins_) bin = std::max(dx,dy)/maxBins_;
+    g.invBin = 1./bin;
+    g.nx = static_cast<unsigned>(dx*g.invBin)+1;
+    g.ny = static_cast<unsigned>(dy*g.invBin)+1;
+    nBins += g.nx*g.ny;
+  }
+
+  //counting sort of the hits by bin, keeping the insertion order
+  //within a bin
+  binStart_.assign(nBins+1,0);
+  bin_.resize(nH);
+  for (unsigned iH(0); iH<nH; ++iH){
+    const Grid & g = grids_[layer_[iH]];
+    bin_[iH] = g.firstBin + binX(g,x_[iH])*g.ny + binY(g,y_[iH]);
+    binStart_[bin_[iH]+1]++;
+  }
+  for (unsigned iB(0); iB<nBins; ++iB){
+    binStart_[iB+1] += binStart_[iB];
+  }
+  tmpIndex_.resize(nH);
+  tmpX_.resize(nH);
+  tmpY_.resize(nH);
+  for (unsigned iH(0); iH<nH; ++iH){
+    unsigned dest = binStart_[bin_[iH]]++;
+    tmpIndex_[dest] = index_[iH];
+    tmpX_[dest] = x_[iH];
+    tmpY_[dest] = y_[iH];
+  }
+  //binStart_[b] now points to the end of bin b
+  for (unsigned iB(nBins); iB>0; --iB){
+    binStart_[iB] = binStart_[iB-1];
+  }
+  binStart_[0] = 0;
+
+  index_.swap(tmpIndex_);
+  x_.swap(tmpX_);
+  y_.swap(tmpY_);
+  //the layer is now given by the bin
+  layer_.clear();
+
+}
+
+unsigned LayerHitIndex::search(const unsigned layer,
+			       const float xmin, const float xmax,
+			       const float ymin, const float ymax,
+			       std::vector<unsigned> & found) const{
+  if (layer>=grids_.size()) return 0;
+  const Grid & g = grids_[layer];
+  if (g.nx==0 || xmax<g.x0 || ymax<g.y0 || xmax<xmin || ymax<ymin) return 0;
+
+  const unsigned ix0 = binX(g,xmin);
+  const unsigned ix1 = binX(g,xmax);
+  const unsigned iy0 = binY(g,ymin);
+  const unsigned iy1 = binY(g,ymax);
+  const unsigned n0 = found.size();
+  for (unsigned ix(ix0); ix<=ix1; ++ix){
+    //bins iy0..iy1 of a column are contiguous
+    const unsigned b = g.firstBin + ix*g.ny;
+    const unsigned kEnd = binStart_[b+iy1+1];
+    for (unsigned k(binStart_[b+iy0]); k<kEnd; ++k){
+      if (x_[k]>=xmin && x_[k]<=xmax &&
+	  y_[k]>=ymin && y_[k]<=ymax) found.push_back(index_[k]);
+    }
+  }
+  return found.size()-n0;
+}
+
+void LayerHitIndex::search(const std::vector<Query> & queries,
+			   std::vector<unsigned> & found,
+			   std::vector<unsigned> & offsets) const{
+  found.clear();
+  offsets.resize(queries.size()+1);
+  offsets[0] = 0;
+  for (unsigned iQ(0); iQ<queries.size(); ++iQ){
+    search(queries[iQ],found);
+    offsets[iQ+1] = found.size();
+  }
+}
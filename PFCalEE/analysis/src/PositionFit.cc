@@ -1,7 +1,9 @@
 #include <iomanip>
+#include <algorithm>
 
 #include "PositionFit.hh"
 #include "Clusterizer.hh"
+#include "InputBranches.hh"
 #include "HGCSSEvent.hh"
 #include "HGCSSInfo.hh"
 #include "HGCSSSamplingSection.hh"
@@ -649,6 +651,14 @@ void PositionFit::initialiseClusterHistograms(){
 
  }
 
+bool PositionFit::setTruthInfo(const unsigned ievt){
+  if (ievt>=truthCache_.size() || !truthCache_[ievt].found) return false;
+  truthDir_ = truthCache_[ievt].dir;
+  truthVtx_ = truthCache_[ievt].vtx;
+  truthE_ = truthCache_[ievt].E;
+  return true;
+}
+
 /*
  bool PositionFit::getTruthPosition(std::vector<HGCSSGenParticle> *genvec,std::vector<ROOT::Math::XYPoint> & truthPos, const int G4TrackID){
 
@@ -748,14 +758,10 @@ void PositionFit::getZpositions(const unsigned versionNumber,
 
 
 
-  HGCSSEvent * event = 0;
-  std::vector<HGCSSSamplingSection> * ssvec = 0;
   std::vector<HGCSSSimHit> * simhitvec = 0;
-  std::vector<HGCSSGenParticle> * genvec = 0;
-  aSimTree->SetBranchAddress("HGCSSEvent",&event);
-  aSimTree->SetBranchAddress("HGCSSSamplingSectionVec",&ssvec);
-  aSimTree->SetBranchAddress("HGCSSSimHitVec",&simhitvec);
-  aSimTree->SetBranchAddress("HGCSSGenParticleVec",&genvec);
+  InputBranches lSimInput(aSimTree,"PositionFit::getZpositions");
+  if (!lSimInput.use("HGCSSSimHitVec",&simhitvec)) exit(1);
+  lSimInput.enable();
 
    std::ofstream fout;
    std::ostringstream foutname;
@@ -776,7 +782,7 @@ void PositionFit::getZpositions(const unsigned versionNumber,
    for (unsigned ievt(0); ievt<nEvts; ++ievt){//loop on entries
      if (debug_) std::cout << "... Processing entry: " << ievt << std::endl;
      else if (ievt%50 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
-     aSimTree->GetEntry(ievt);
+     lSimInput.getEntry(ievt);
      for (unsigned iH(0); iH<(*simhitvec).size(); ++iH){//loop on rechits
        const HGCSSSimHit & lHit = (*simhitvec)[iH];
        unsigned layer = lHit.layer();
@@ -801,6 +807,7 @@ void PositionFit::getZpositions(const unsigned versionNumber,
    }
 
    fout.close();
+   lSimInput.print();
 
  }
 
@@ -817,23 +824,26 @@ void PositionFit::getZpositions(const unsigned versionNumber,
    ///////// Event loop /////////////////////////////
    //////////////////////////////////////////////////
 
-   HGCSSEvent * event = 0;
-   std::vector<HGCSSSamplingSection> * ssvec = 0;
    std::vector<HGCSSSimHit> * simhitvec = 0;
    std::vector<HGCSSRecoHit> * rechitvec = 0;
    std::vector<HGCSSGenParticle> * genvec = 0;
    unsigned nPuVtx = 0;
 
-   aSimTree->SetBranchAddress("HGCSSEvent",&event);
-   aSimTree->SetBranchAddress("HGCSSSamplingSectionVec",&ssvec);
-   aSimTree->SetBranchAddress("HGCSSSimHitVec",&simhitvec);
-   aSimTree->SetBranchAddress("HGCSSGenParticleVec",&genvec);
+   //truth and rechits only, simhits for the debug printout
+   InputBranches lSimInput(aSimTree,"PositionFit::getInitialPositions");
+   if (!lSimInput.use("HGCSSGenParticleVec",&genvec)) exit(1);
+   if (debug_ && !lSimInput.use("HGCSSSimHitVec",&simhitvec)) exit(1);
+   lSimInput.enable();
 
-   aRecTree->SetBranchAddress("HGCSSRecoHitVec",&rechitvec);
-   if (aRecTree->GetBranch("nPuVtx")) aRecTree->SetBranchAddress("nPuVtx",&nPuVtx);
+   InputBranches lRecInput(aRecTree,"PositionFit::getInitialPositions");
+   if (!lRecInput.use("HGCSSRecoHitVec",&rechitvec)) exit(1);
+   lRecInput.use("nPuVtx",&nPuVtx,true);
+   lRecInput.enable();
 
    std::cout << "- Processing = " << nEvts  << " events out of " << aSimTree->GetEntries() << std::endl;
 
+   truthCache_.assign(nEvts,EventTruth());
+
    //bool firstEvent = true;
 
    unsigned nConvertedPhotons = 0;
@@ -846,9 +856,9 @@ void PositionFit::getZpositions(const unsigned versionNumber,
     if (debug_) std::cout << "... Processing entry: " << ievt << std::endl;
     else if (ievt%50 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
     
-    aSimTree->GetEntry(ievt);
+    lSimInput.getEntry(ievt);
 
-    aRecTree->GetEntry(ievt);
+    lRecInput.getEntry(ievt);
 
     if (debug_) std::cout << " nPuVtx = " << nPuVtx << std::endl;
 
@@ -870,6 +880,10 @@ void PositionFit::getZpositions(const unsigned versionNumber,
       nConvertedPhotons++;
       continue;
     }
+    truthCache_[ievt].found = true;
+    truthCache_[ievt].dir = truthDir_;
+    truthCache_[ievt].vtx = truthVtx_;
+    truthCache_[ievt].E = truthE_;
     if (saveEtree_) {
       for (unsigned iL(0);iL<nLayers_;++iL){
 	truthPosX_[iL] = truthPos(iL).X();
@@ -904,6 +918,8 @@ void PositionFit::getZpositions(const unsigned versionNumber,
   std::cout << " -- Number of converted photons: " << nConvertedPhotons << std::endl;
   std::cout << " -- Number of events with no cluster : " << nNoCluster << std::endl;
   std::cout << " -- Number of events with closest cluster away from truth within dR " << maxdR_ << " : " << nTooFar << std::endl;
+  lSimInput.print();
+  lRecInput.print();
   
  }
 
@@ -1009,6 +1025,9 @@ bool PositionFit::getInitialPosition(const unsigned ievt,
   //getMaximumCellFromGeom(pcaPhi_,pcaEta_,lCluster.position(),xmax,ymax);
   getMaximumCell(rechitvec,pcaPhi_,pcaEta_,lCluster.position(),xmax,ymax);
   p_yvsx_max->Fill(xmax[10],ymax[10]);
+
+  //the random cones and the signal region search the same hits
+  fillHitIndex(rechitvec);
   
   //get PU contrib from elsewhere in the event
   //loop over phi with same pcaEta_
@@ -1061,24 +1080,25 @@ bool PositionFit::getInitialPosition(const unsigned ievt,
   //get energy-weighted position and energy around maximum
   getEnergyWeightedPosition(rechitvec,nPuVtx,xmax,ymax,recoPos,recoE,nHits,puE);
   
-  std::ofstream fout;
-  std::ostringstream foutname;
-  foutname << outFolder_ << "/initialPos_evt" << ievt << ".dat";
-  fout.open(foutname.str());
-  if (!fout.is_open()){
-    std::cout << " Cannot open outfile " << foutname.str() << " for writing ! Exiting..." << std::endl;
+  if (!openStore()){
+    std::cout << " Cannot open position store in " << outFolder_ << " for writing ! Exiting..." << std::endl;
     exit(1);
   }
   
+  std::vector<PositionStoreLayer> storePos(nLayers_);
   if (debug_) std::cout << " Summary of reco and truth positions:" << std::endl;
   for (unsigned iL(0);iL<nLayers_;++iL){//loop on layers
     if (debug_) std::cout << iL << " nHits=" << nHits[iL] << " Max=(" << xmax[iL] << "," << ymax[iL] << ")\t Reco=(" << recoPos[iL].X() << "," << recoPos[iL].Y() << ")\t Truth=(" << truthPos(iL).X() << "," << truthPos(iL).Y() << ")" << std::endl;
-    fout << iL << " " << recoPos[iL].X() << " " << recoPos[iL].Y() << " " << truthPos(iL).X() << " " << truthPos(iL).Y() ;
-    if (!doMatrix_) fout << " " << recoE[iL];
-    fout << std::endl;
+    storePos[iL].xreco = recoPos[iL].X();
+    storePos[iL].yreco = recoPos[iL].Y();
+    storePos[iL].xtruth = truthPos(iL).X();
+    storePos[iL].ytruth = truthPos(iL).Y();
+    storePos[iL].E = recoE[iL];
+  }
+  if (!store_.setPositions(ievt,&storePos[0])){
+    std::cout << " Cannot write positions of event " << ievt << " to " << store_.filePath() << " ! Exiting..." << std::endl;
+    exit(1);
   }
-
-  fout.close();
 
   if (doMatrix_) fillErrorMatrix(recoPos,nHits);
 
@@ -1168,6 +1188,42 @@ void PositionFit::getMaximumCell(std::vector<HGCSSRecoHit> *rechitvec,const doub
   }
 }
 
+void PositionFit::fillHitIndex(std::vector<HGCSSRecoHit> *rechitvec){
+  hitIndex_.clear();
+  hitIndex_.setBinSize(geomConv_.cellSize());
+  hitIndex_.reserve((*rechitvec).size());
+  hitStep_.assign(nLayers_,0);
+  for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop on rechits
+    const HGCSSRecoHit & lHit = (*rechitvec)[iH];
+    unsigned layer = lHit.layer();
+    if (layer >= nLayers_) continue;
+    double posx = lHit.get_x();
+    if (fixForPuMixBug_) posx-=1.25;
+    double posy = lHit.get_y();
+    if (fixForPuMixBug_) posy-=1.25;
+    double lR = sqrt(pow(posx,2)+pow(posy,2));
+    double step = geomConv_.cellSize(layer,lR)*nSR_/2.+0.1;
+    if (step>hitStep_[layer]) hitStep_[layer] = step;
+    hitIndex_.add(iH,layer,posx,posy);
+  }
+  hitIndex_.build();
+}
+
+void PositionFit::findHitsAroundMaximum(const std::vector<double> & xmax,
+					const std::vector<double> & ymax){
+  hitQueries_.clear();
+  for (unsigned iL(0);iL<nLayers_;++iL){
+    if (hitStep_[iL]<=0) continue;
+    //+0.1 as the index stores float positions
+    double step = hitStep_[iL]+0.1;
+    hitQueries_.push_back(LayerHitIndex::Query(iL,xmax[iL]-step,xmax[iL]+step,
+					       ymax[iL]-step,ymax[iL]+step));
+  }
+  hitIndex_.search(hitQueries_,hitFound_,hitOffsets_);
+  //sum the energies in the same order as a loop on all rechits
+  std::sort(hitFound_.begin(),hitFound_.end());
+}
+
 void PositionFit::getEnergyWeightedPosition(std::vector<HGCSSRecoHit> *rechitvec,
 					    const unsigned nPU, 
 					    const std::vector<double> & xmax,
@@ -1188,7 +1244,9 @@ void PositionFit::getEnergyWeightedPosition(std::vector<HGCSSRecoHit> *rechitvec
       txy_[iL][idx] = 0;
     }
   }
-  for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop on rechits
+  findHitsAroundMaximum(xmax,ymax);
+  for (unsigned iF(0); iF<hitFound_.size(); ++iF){//loop on rechits
+    const unsigned iH = hitFound_[iF];
     const HGCSSRecoHit & lHit = (*rechitvec)[iH];
     double energy = lHit.energy();//in MIP already...
     unsigned layer = lHit.layer();
@@ -1361,7 +1419,9 @@ void PositionFit::getPuContribution(std::vector<HGCSSRecoHit> *rechitvec, const
 
   //double step = geomConv_.cellSize()*nSR_/2.+0.1;
 
-  for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop on rechits
+  findHitsAroundMaximum(xmax,ymax);
+  for (unsigned iF(0); iF<hitFound_.size(); ++iF){//loop on rechits
+    const unsigned iH = hitFound_[iF];
     const HGCSSRecoHit & lHit = (*rechitvec)[iH];
     double energy = lHit.energy();//in MIP already...
     unsigned layer = lHit.layer();
@@ -1575,16 +1635,15 @@ bool PositionFit::initialiseLeastSquareFit(){
   std::cout << " -- Performing chi2 fit for each event" << std::endl;
 
   nInvalidFits_=0;
+  cholValid_=false;
   nFailedFitsAfterCut_=0;
 
-  //open new file to save accurate positions
-  std::ostringstream foutname;
-  foutname << outFolder_ << "/accuratePos.dat";
-  fout_.open(foutname.str());
-  if (!fout_.is_open()){
-    std::cout << " Cannot open outfile " << foutname.str() << " for writing ! Exiting..." << std::endl;
+  //accurate positions saved with the initial ones
+  if (!openStore()){
+    std::cout << " Cannot open position store in " << outFolder_ << " for writing ! Exiting..." << std::endl;
     exit(1);
   }
+  store_.clearFits();
 
   return true;
 
@@ -1596,27 +1655,12 @@ unsigned PositionFit::performLeastSquareFit(const unsigned ievt,
 
     //cut outliers
   unsigned fitres = fitEvent(ievt,fit,lToRemove,true);
-    if (fitres==1){
-      // std::cout << " -- Number of genparticles: " << (*genvec).size() << std::endl;
-      // for (unsigned iP(0); iP<(*genvec).size(); ++iP){//loop on gen particles 
-      // 	std::cout << " --- particle " << iP << std::endl;
-      // 	(*genvec)[iP].Print(std::cout);
-      // }
-      std::cout << " -- Event " << ievt << " skipped." << std::endl;
-    }
-    if (fitres>1) {
-      //std::cout << " ---- Fit failed ! Reprocess event " << ievt << " cutting outliers" << std::endl;
-      //nFailedFits++;
-      //if (fitEvent(ievt,fit,true)>1)
-      std::cout << " -- Event " << ievt << " failed fit." << std::endl;
-      nFailedFitsAfterCut_++;
-    }
-  
-    return fitres;
+  countFitStatus(ievt,fitres);
+  return fitres;
 }
 
 void PositionFit::finaliseFit(){
-  fout_.close();    
+  store_.close();
   outputFile_->Flush();
   std::cout << " -- Number of invalid fits: " << nInvalidFits_ << std::endl;
   std::cout << " -- Number of fits failed after cutting outliers: " << nFailedFitsAfterCut_ << std::endl;
@@ -1628,29 +1672,156 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
 			       const std::vector<unsigned> & lToRemove,
 			       const bool cutOutliers){
 
-  std::vector<unsigned> layerId;
-  std::vector<double> posx;
-  std::vector<double> posy;
-  std::vector<double> posz;
-  std::vector<double> posxtruth;
-  std::vector<double> posytruth;
-  std::vector<double> Ereco;
-  layerId.reserve(nLayers_);
-  posx.reserve(nLayers_);
-  posy.reserve(nLayers_);
-  posz.reserve(nLayers_);
-  posxtruth.reserve(nLayers_);
-  posytruth.reserve(nLayers_);
-  Ereco.reserve(nLayers_);
-  if (!getPositionFromFile(ievt,
-			   layerId,posx,posy,posz,
-			   posxtruth,posytruth,
-			   Ereco,lToRemove,
-			   cutOutliers)){
+  if (!readFitLayers(ievt,lToRemove,cutOutliers)){
     nInvalidFits_++;
     return 1;
   }
+  cholValid_ = factoriseErrorMatrices();
+  return fitLayers(ievt,fit,lToRemove.size(),cutOutliers);
+}
+
+void PositionFit::performLeastSquareFits(const unsigned ievt,
+					 const std::vector<unsigned> & lToRemove,
+					 std::vector<FitResult> & fits,
+					 std::vector<unsigned> & status){
+
+  const unsigned nFits = lToRemove.size()+1;
+  fits.assign(nFits,FitResult());
+  status.assign(nFits,1);
+
+  //positions read once, with all layers
+  if (!readFitLayers(ievt,std::vector<unsigned>(),true)){
+    for (unsigned r(0); r<nFits; ++r){
+      nInvalidFits_++;
+      countFitStatus(ievt,status[r]);
+    }
+    return;
+  }
+  cholValid_ = factoriseErrorMatrices();
+
+  for (unsigned r(0); r<nFits; ++r){
+    if (r>0){
+      for (unsigned k(0); k<fitLayerId_.size(); ++k){
+	if (fitLayerId_[k]==lToRemove[r-1]) {
+	  removeFitLayer(k);
+	  break;
+	}
+      }
+    }
+    status[r] = fitLayers(ievt,fits[r],r,true);
+    countFitStatus(ievt,status[r]);
+  }
+
+}
+
+bool PositionFit::readFitLayers(const unsigned ievt,
+				const std::vector<unsigned> & lToRemove,
+				const bool cutOutliers){
+  fitLayerId_.clear();
+  fitPosx_.clear();
+  fitPosy_.clear();
+  fitPosz_.clear();
+  fitPosxtruth_.clear();
+  fitPosytruth_.clear();
+  fitE_.clear();
+  return getPositionFromFile(ievt,
+			     fitLayerId_,fitPosx_,fitPosy_,fitPosz_,
+			     fitPosxtruth_,fitPosytruth_,
+			     fitE_,lToRemove,
+			     cutOutliers);
+}
+
+bool PositionFit::factoriseErrorMatrices(){
+  const unsigned nL = fitLayerId_.size();
+  for (unsigned xy(0); xy<2; ++xy){
+    std::vector<double> & L = chol_[xy];
+    L.assign(nL*nL,0);
+    for (unsigned i(0); i<nL; ++i){
+      for (unsigned j(0); j<=i; ++j){
+	double sum = matrix_[xy](fitLayerId_[i],fitLayerId_[j]);
+	for (unsigned k(0); k<j; ++k) sum -= L[i*nL+k]*L[j*nL+k];
+	if (i==j) {
+	  if (!(sum>0)) return false;
+	  L[i*nL+i] = sqrt(sum);
+	}
+	else L[i*nL+j] = sum/L[j*nL+j];
+      }
+    }
+  }
+  return true;
+}
+
+void PositionFit::removeFitLayer(const unsigned k){
+  const unsigned nL = fitLayerId_.size();
+  if (cholValid_){
+    for (unsigned xy(0); xy<2; ++xy){
+      std::vector<double> & L = chol_[xy];
+      //rows below k: the trailing block T must become the factor of
+      //T T^T + l l^T, l being column k, done with Givens rotations.
+      //Column k is used as scratch for l.
+      for (unsigned j(k+1); j<nL; ++j){
+	const double ljj = L[j*nL+j];
+	const double lk = L[j*nL+k];
+	const double r = sqrt(ljj*ljj+lk*lk);
+	const double c = r/ljj;
+	const double s = lk/ljj;
+	L[j*nL+j] = r;
+	for (unsigned i(j+1); i<nL; ++i){
+	  L[i*nL+j] = (L[i*nL+j]+s*L[i*nL+k])/c;
+	  L[i*nL+k] = c*L[i*nL+k]-s*L[i*nL+j];
+	}
+      }
+      //drop row and column k
+      unsigned idx = 0;
+      for (unsigned i(0); i<nL; ++i){
+	if (i==k) continue;
+	for (unsigned j(0); j<nL; ++j){
+	  if (j==k) continue;
+	  L[idx++] = L[i*nL+j];
+	}
+      }
+      L.resize((nL-1)*(nL-1));
+    }
+  }
+  fitLayerId_.erase(fitLayerId_.begin()+k);
+  fitPosx_.erase(fitPosx_.begin()+k);
+  fitPosy_.erase(fitPosy_.begin()+k);
+  fitPosz_.erase(fitPosz_.begin()+k);
+  fitPosxtruth_.erase(fitPosxtruth_.begin()+k);
+  fitPosytruth_.erase(fitPosytruth_.begin()+k);
+}
+
+void PositionFit::forwardSubstitute(const std::vector<double> & L,
+				    std::vector<double> & b) const{
+  const unsigned n = b.size();
+  for (unsigned i(0); i<n; ++i){
+    double sum = b[i];
+    for (unsigned k(0); k<i; ++k) sum -= L[i*n+k]*b[k];
+    b[i] = sum/L[i*n+i];
+  }
+}
+
+void PositionFit::countFitStatus(const unsigned ievt, const unsigned fitres){
+  if (fitres==1){
+    std::cout << " -- Event " << ievt << " skipped." << std::endl;
+  }
+  if (fitres>1) {
+    std::cout << " -- Event " << ievt << " failed fit." << std::endl;
+    nFailedFitsAfterCut_++;
+  }
+}
 
+unsigned PositionFit::fitLayers(const unsigned ievt,
+				FitResult & fit,
+				const unsigned nRemoved,
+				const bool cutOutliers){
+
+  const std::vector<unsigned> & layerId = fitLayerId_;
+  const std::vector<double> & posx = fitPosx_;
+  const std::vector<double> & posy = fitPosy_;
+  const std::vector<double> & posz = fitPosz_;
+  const std::vector<double> & posxtruth = fitPosxtruth_;
+  const std::vector<double> & posytruth = fitPosytruth_;
   const unsigned nL = layerId.size();
   
   
@@ -1674,43 +1845,35 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
     nInvalidFits_++;
     return 1;
   }
+
+  //factorise again if a previous layer set failed
+  if (!cholValid_) cholValid_ = factoriseErrorMatrices();
+  if (!cholValid_){
+    std::cout << " ---- Error matrix not positive definite for event " << ievt << std::endl;
+    nInvalidFits_++;
+    return 1;
+  }
   
   //number of points: x and y per layer minus number of parameters: 2 for x + 2 for y.
   double ndf = 2*nL-4;
   
-  //Get error matrix removing lines with zero hits
-  TMatrixDSym ex(nL);
-  TMatrixDSym ey(nL);
-  //TMatrixDSym exy(nL);
-
-  TVectorD u(nL),z(nL),x(nL),y(nL);
-  
-  for(unsigned i(0);i<nL;++i) {
-    u(i)=1.0;
-    z(i)=posz[i];
-    //std::cout << "fit() z(" << i << ") = " << z(i) << std::endl;
-    
-    for(unsigned j(i);j<nL;++j) {
-      ex(i,j)=matrix_[0](layerId[i],layerId[j]);
-      ex(j,i)=matrix_[0](layerId[j],layerId[i]);
-      ey(i,j)=matrix_[1](layerId[i],layerId[j]);
-      ey(j,i)=matrix_[1](layerId[j],layerId[i]);
-      //exy(i,j)=0.5*matrix_[0](layerId[i],layerId[j])+0.5*matrix_[1](layerId[i],layerId[j]);
-      //exy(j,i)=0.5*matrix_[0](layerId[j],layerId[i])+0.5*matrix_[1](layerId[j],layerId[i]);
-
-     }
+  //With E = L L^T the error matrix of the layers, u'E^-1x = a.c with
+  //a = L^-1 u, c = L^-1 x: all products are taken between vectors
+  //solved against the Cholesky factor.
+  std::vector<double> lu[2], lz[2];
+  std::vector<double> lx(nL);
+  for(unsigned xy(0);xy<2;xy++) {
+    lu[xy].assign(nL,1.0);
+    lz[xy] = posz;
+    forwardSubstitute(chol_[xy],lu[xy]);
+    forwardSubstitute(chol_[xy],lz[xy]);
   }
-  
-  //if (doMatrix_) {
-  ex.Invert();
-  ey.Invert();
-    //}
-    //else ey.Invert();
 
   //do fit for reco and truth
   double positionFF[2][2];
   double position14[2][2];
   double TanAngle[2][2];
+  PositionStoreFit storeFit;
  
   for (unsigned rt(0); rt<2;++rt){
     if (debug_) {
@@ -1738,23 +1901,29 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
 	std::cout << std::endl;
       }
       for(unsigned i(0);i<nL;i++) {
-	x(i)= rt==0 ? ((xy==0) ? posx[i] : posy[i]) : ((xy==0) ? posxtruth[i] : posytruth[i]);
-	//std::cout << "fit() x(" << i << ") = " << x(i) << std::endl;
+	lx[i]= rt==0 ? ((xy==0) ? posx[i] : posy[i]) : ((xy==0) ? posxtruth[i] : posytruth[i]);
+	//std::cout << "fit() x(" << i << ") = " << lx[i] << std::endl;
       }
-      
-      //TMatrixDSym e = doMatrix_? ((xy==0) ? ex : ey) : ey;
-      TMatrixDSym e = (xy==0) ? ex : ey;
+      forwardSubstitute(chol_[xy],lx);
+      const std::vector<double> & u = lu[xy];
+      const std::vector<double> & z = lz[xy];
 
       TMatrixD w(2,2);
       TVectorD v(2),p(2);
       
-      w(0,0)=u*(e*u);
-      w(0,1)=u*(e*z);
-      w(1,0)=z*(e*u);
-      w(1,1)=z*(e*z);
-      
-      v(0)=u*(e*x);
-      v(1)=z*(e*x);
+      w(0,0)=0;
+      w(0,1)=0;
+      w(1,1)=0;
+      v(0)=0;
+      v(1)=0;
+      for(unsigned i(0);i<nL;i++) {
+	w(0,0)+=u[i]*u[i];
+	w(0,1)+=u[i]*z[i];
+	w(1,1)+=z[i]*z[i];
+	v(0)+=u[i]*lx[i];
+	v(1)+=z[i]*lx[i];
+      }
+      w(1,0)=w(0,1);
       
       w.Invert();
       
@@ -1780,12 +1949,11 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
       if (w(1,1)==w(1,1)) fitMatrix[2*xy+1][2*xy+1]=fabs(w(1,1));
       
       
-      TVectorD dp(nL);
+      //dp'E^-1dp = |L^-1 dp|^2
       for(unsigned i(0);i<nL;i++) {
-	dp(i)=x(i)-p(0)-p(1)*z(i);
+	double dp = lx[i]-p(0)*u[i]-p(1)*z[i];
+	chiSq+=dp*dp;
       }
-      
-      chiSq+=dp*(e*dp);
     }//loop on x or y
     
     //chi2 test
@@ -1816,16 +1984,14 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
       p_positionReso->Fill(sqrt(fitMatrix[0][0]));
       p_angularReso->Fill(sqrt(fitMatrix[1][1]));
       
-      fout_ << ievt << " " 
-	   << position[0] << " " 
-	   << sqrt(fitMatrix[0][0]) << " " 
-	   << TanAngle[0][0] << " " 
-	   << sqrt(fitMatrix[1][1]) << " "
-	   << position[1] << " " 
-	   << sqrt(fitMatrix[2][2]) << " "
-	   << TanAngle[0][1] << " "
-	    << sqrt(fitMatrix[3][3]);
-      //<< std::endl;
+      storeFit.pos_x = position[0];
+      storeFit.sigma_pos_x = sqrt(fitMatrix[0][0]);
+      storeFit.tanangle_x = TanAngle[0][0];
+      storeFit.sigma_tanangle_x = sqrt(fitMatrix[1][1]);
+      storeFit.pos_y = position[1];
+      storeFit.sigma_pos_y = sqrt(fitMatrix[2][2]);
+      storeFit.tanangle_y = TanAngle[0][1];
+      storeFit.sigma_tanangle_y = sqrt(fitMatrix[3][3]);
 
       for (unsigned iL(0); iL<nL;++iL){
 	double x = position[0]+TanAngle[0][0]*posz[iL];
@@ -1843,11 +2009,11 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
       fit.tanangle_y = TanAngle[0][1];
     }//reco
     else {
-      fout_ << " " << position[0]
-	    << " " << TanAngle[1][0]
-	    << " " << position[1]
-	    << " " << TanAngle[1][1]
-	    << std::endl;
+      storeFit.truth_pos_x = position[0];
+      storeFit.truth_tanangle_x = TanAngle[1][0];
+      storeFit.truth_pos_y = position[1];
+      storeFit.truth_tanangle_y = TanAngle[1][1];
+      store_.setFit(ievt,storeFit);
     }//truth
 
   }//reco or truth
@@ -1877,7 +2043,7 @@ unsigned PositionFit::fitEvent(const unsigned ievt,
   recoPhi_ = recoDir_.phi();
   showerX14_ = position14[0][0];
   showerY14_ = position14[0][1];
-  nRemove_ = lToRemove.size();
+  nRemove_ = nRemoved;
 
   truthEta_ = truthDir.eta();
   truthPhi_ = truthDir.phi();
@@ -1904,46 +2070,40 @@ bool PositionFit::getPositionFromFile(const unsigned ievt,
 				      bool print){
 
 
-  std::ifstream fin;
-  std::ostringstream finname;
-  finname << outFolder_ << "/initialPos_evt" << ievt << ".dat";
-  fin.open(finname.str());
-  if (!fin.is_open()){
-    if (print) std::cout << " Cannot open input file " << finname.str() << "!" << std::endl;
-      return false;
+  const PositionStoreLayer * lPos = openStore() ? store_.positions(ievt) : 0;
+  if (!lPos){
+    if (print) std::cout << " Cannot find positions of event " << ievt << " in " << PositionStore::fileName(outFolder_) << "!" << std::endl;
+    return false;
   }
   
-  while (!fin.eof()){
-    unsigned l=nLayers_;
-    double xr=0,yr=0,xt=0,yt=0,e=0;
-    fin>>l>>xr>>yr>>xt>>yt;
-    if (!doMatrix_) fin>>e;
-    if (l<nLayers_){
-      //bool l7to22 = true;//l>6 && l<23;
-      bool pass = fabs(xr-xt)<residualMax_ && fabs(yr-yt)<residualMax_;
-      bool keep = true;
-      for (unsigned ir(0); ir<lToRemove.size();++ir){
-	if (l==lToRemove[ir]) {
-	  keep = false;
-	  break;
-	}
-      }
-      //unsigned posmm = static_cast<unsigned>(fabs(yt)+5);
-      //bool isEdge = true;//posmm%10 <= 2 || posmm%10 >= 8;
-      if (keep && (!cutOutliers || (cutOutliers && pass))){
-	layerId.push_back(l);
-	posx.push_back(xr);
-	posy.push_back(yr);
-	posz.push_back(avgZ_[l]);
-	posxtruth.push_back(xt);
-	posytruth.push_back(yt);
+  for (unsigned l(0); l<nLayers_; ++l){
+    const double xr = lPos[l].xreco;
+    const double yr = lPos[l].yreco;
+    const double xt = lPos[l].xtruth;
+    const double yt = lPos[l].ytruth;
+    //bool l7to22 = true;//l>6 && l<23;
+    bool pass = fabs(xr-xt)<residualMax_ && fabs(yr-yt)<residualMax_;
+    bool keep = true;
+    for (unsigned ir(0); ir<lToRemove.size();++ir){
+      if (l==lToRemove[ir]) {
+	keep = false;
+	break;
       }
-      //use all for energy estimate
-      if (!doMatrix_) E.push_back(e);
     }
+    //unsigned posmm = static_cast<unsigned>(fabs(yt)+5);
+    //bool isEdge = true;//posmm%10 <= 2 || posmm%10 >= 8;
+    if (keep && (!cutOutliers || (cutOutliers && pass))){
+      layerId.push_back(l);
+      posx.push_back(xr);
+      posy.push_back(yr);
+      posz.push_back(avgZ_[l]);
+      posxtruth.push_back(xt);
+      posytruth.push_back(yt);
+    }
+    //use all for energy estimate
+    if (!doMatrix_) E.push_back(lPos[l].E);
   }
   
-  fin.close();
   /*
   //@TODO to use something else than truth info :/
   if (cutOutliers){
@@ -1971,6 +2131,11 @@ bool PositionFit::getPositionFromFile(const unsigned ievt,
   return true;
 }
 
+bool PositionFit::openStore(){
+  if (store_.isOpen()) return true;
+  return store_.open(PositionStore::fileName(outFolder_),nLayers_,true);
+}
+
 
 
 
@@ -0,0 +1,226 @@
+#include "PositionStore.hh"
+#include <iostream>
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+namespace {
+  const char storeMagic[8] = {'H','G','C','P','O','S','S','T'};
+  const uint32_t storeVersion = 1;
+
+  struct PositionStoreHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nLayers;
+    uint64_t nEvents;
+  };
+
+  struct PositionStoreRecord {
+    uint32_t flags;
+    uint32_t nLayers;
+    PositionStoreFit fit;
+  };
+}
+
+PositionStore::PositionStore():
+  fd_(-1),
+  writable_(false),
+  data_(0),
+  size_(0),
+  nLayers_(0),
+  nEvents_(0),
+  recordSize_(0)
+{
+}
+
+PositionStore::~PositionStore(){
+  close();
+}
+
+std::string PositionStore::fileName(const std::string & folder){
+  return folder+"/positions.bin";
+}
+
+bool PositionStore::open(const std::string & filePath,
+			 const unsigned nLayers,
+			 const bool writable){
+  close();
+  int fd = ::open(filePath.c_str(),writable ? O_RDWR|O_CREAT : O_RDONLY,0644);
+  if (fd<0) {
+    std::cout << " -- Error, cannot open position store " << filePath << std::endl;
+    return false;
+  }
+  struct stat lStat;
+  if (fstat(fd,&lStat)!=0) {
+    std::cout << " -- Error, cannot stat position store " << filePath << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  PositionStoreHeader lHeader;
+  if (lStat.st_size==0 && writable){
+    if (nLayers==0) {
+      std::cout << " -- Error, number of layers needed to create position store " << filePath << std::endl;
+      ::close(fd);
+      return false;
+    }
+    memcpy(lHeader.magic,storeMagic,8);
+    lHeader.version = storeVersion;
+    lHeader.nLayers = nLayers;
+    lHeader.nEvents = 0;
+    if (pwrite(fd,&lHeader,sizeof(PositionStoreHeader),0)!=sizeof(PositionStoreHeader)) {
+      std::cout << " -- Error writing position store " << filePath << std::endl;
+      ::close(fd);
+      return false;
+    }
+  }
+  else if (static_cast<size_t>(lStat.st_size) < sizeof(PositionStoreHeader) ||
+	   pread(fd,&lHeader,sizeof(PositionStoreHeader),0)!=sizeof(PositionStoreHeader) ||
+	   memcmp(lHeader.magic,storeMagic,8)!=0 || lHeader.version != storeVersion) {
+    std::cout << " -- Error, " << filePath << " is not a valid position store." << std::endl;
+    ::close(fd);
+    return false;
+  }
+  if (nLayers>0 && lHeader.nLayers != nLayers) {
+    std::cout << " -- Error, position store " << filePath << " has " << lHeader.nLayers
+	      << " layers, expected " << nLayers << "." << std::endl;
+    ::close(fd);
+    return false;
+  }
+
+  fd_ = fd;
+  writable_ = writable;
+  filePath_ = filePath;
+  nLayers_ = lHeader.nLayers;
+  nEvents_ = lHeader.nEvents;
+  recordSize_ = sizeof(PositionStoreRecord)+nLayers_*sizeof(PositionStoreLayer);
+
+  size_t lSize = sizeof(PositionStoreHeader)+nEvents_*recordSize_;
+  if (!writable_ && static_cast<size_t>(lStat.st_size) < lSize) {
+    std::cout << " -- Error, position store " << filePath << " is truncated." << std::endl;
+    close();
+    return false;
+  }
+  if (writable_ && static_cast<size_t>(lStat.st_size) != lSize && ftruncate(fd_,lSize)!=0) {
+    std::cout << " -- Error, cannot resize position store " << filePath << std::endl;
+    close();
+    return false;
+  }
+  if (!map(lSize)) {
+    close();
+    return false;
+  }
+  std::cout << " -- Position store " << filePath << ": " << nEvents_ << " events, "
+	    << nLayers_ << " layers." << std::endl;
+  return true;
+}
+
+bool PositionStore::map(const size_t size){
+  if (data_) munmap(data_,size_);
+  data_ = 0;
+  size_ = 0;
+  void *lData = mmap(0,size,writable_ ? PROT_READ|PROT_WRITE : PROT_READ,MAP_SHARED,fd_,0);
+  if (lData == MAP_FAILED) {
+    std::cout << " -- Error, cannot map position store " << filePath_ << std::endl;
+    return false;
+  }
+  data_ = (char*)lData;
+  size_ = size;
+  return true;
+}
+
+void PositionStore::close(){
+  if (data_) munmap(data_,size_);
+  //drop the room reserved for growing
+  if (fd_>=0 && writable_) {
+    if (ftruncate(fd_,sizeof(PositionStoreHeader)+nEvents_*recordSize_)!=0)
+      std::cout << " -- Error, cannot resize position store " << filePath_ << std::endl;
+  }
+  if (fd_>=0) ::close(fd_);
+  fd_ = -1;
+  writable_ = false;
+  data_ = 0;
+  size_ = 0;
+  nLayers_ = 0;
+  nEvents_ = 0;
+  recordSize_ = 0;
+}
+
+bool PositionStore::reserve(const unsigned nEvents){
+  size_t lSize = sizeof(PositionStoreHeader)+nEvents*recordSize_;
+  if (lSize<=size_) return true;
+  //double the capacity, new records are zero-filled
+  size_t lCapacity = (size_-sizeof(PositionStoreHeader))/recordSize_;
+  lCapacity = std::max<size_t>(std::max<size_t>(2*lCapacity,1024),nEvents);
+  lSize = sizeof(PositionStoreHeader)+lCapacity*recordSize_;
+  if (ftruncate(fd_,lSize)!=0) {
+    std::cout << " -- Error, cannot resize position store " << filePath_ << std::endl;
+    return false;
+  }
+  return map(lSize);
+}
+
+char * PositionStore::record(const unsigned ievt) const{
+  return data_+sizeof(PositionStoreHeader)+ievt*recordSize_;
+}
+
+uint32_t PositionStore::flags(const unsigned ievt) const{
+  if (!data_ || ievt>=nEvents_) return 0;
+  return ((const PositionStoreRecord*)record(ievt))->flags;
+}
+
+bool PositionStore::hasPositions(const unsigned ievt) const{
+  return flags(ievt) & HasPositions;
+}
+
+bool PositionStore::hasFit(const unsigned ievt) const{
+  return flags(ievt) & HasFit;
+}
+
+const PositionStoreLayer * PositionStore::positions(const unsigned ievt) const{
+  if (!hasPositions(ievt)) return 0;
+  return (const PositionStoreLayer*)(record(ievt)+sizeof(PositionStoreRecord));
+}
+
+const PositionStoreFit * PositionStore::fit(const unsigned ievt) const{
+  if (!hasFit(ievt)) return 0;
+  return &((const PositionStoreRecord*)record(ievt))->fit;
+}
+
+bool PositionStore::setPositions(const unsigned ievt, const PositionStoreLayer * layers){
+  if (!data_ || !writable_ || !reserve(ievt+1)) return false;
+  PositionStoreRecord *lRec = (PositionStoreRecord*)record(ievt);
+  memcpy(record(ievt)+sizeof(PositionStoreRecord),layers,nLayers_*sizeof(PositionStoreLayer));
+  lRec->nLayers = nLayers_;
+  //a fit of older positions is obsolete
+  lRec->flags = HasPositions;
+  if (ievt+1>nEvents_) {
+    nEvents_ = ievt+1;
+    ((PositionStoreHeader*)data_)->nEvents = nEvents_;
+  }
+  return true;
+}
+
+bool PositionStore::setFit(const unsigned ievt, const PositionStoreFit & fit){
+  if (!data_ || !writable_ || !reserve(ievt+1)) return false;
+  PositionStoreRecord *lRec = (PositionStoreRecord*)record(ievt);
+  lRec->fit = fit;
+  lRec->nLayers = nLayers_;
+  lRec->flags |= HasFit;
+  if (ievt+1>nEvents_) {
+    nEvents_ = ievt+1;
+    ((PositionStoreHeader*)data_)->nEvents = nEvents_;
+  }
+  return true;
+}
+
+void PositionStore::clearFits(){
+  if (!data_ || !writable_) return;
+  for (unsigned ievt(0); ievt<nEvents_; ++ievt){
+    ((PositionStoreRecord*)record(ievt))->flags &= ~HasFit;
+  }
+}
@@ -5,6 +5,9 @@
 #include "HGCSSRecoHit.hh"
 #include "HGCSSGenParticle.hh"
 #include "utilities.h"
+#include "PositionStore.hh"
+
+#include <algorithm>
 
 SignalRegion::SignalRegion(const std::string inputFolder,
 			   const unsigned nLayers,
@@ -47,6 +50,20 @@ SignalRegion::SignalRegion(const std::string inputFolder,
   nSkipped_ = 0;
 
   zPos_ = zpos;
+
+  //SR sizes, as tested in fillEnergies
+  std::vector<double> srSizes;
+  double halfCelly = 0.5*sqrt(3.)*6.496345;
+  for (unsigned isr(0); isr<nSR_;++isr){
+    if (!doHexa_) srSizes.push_back((isr+1)*halfCelly);
+    else if (nSR_<=6) srSizes.push_back(radius_[isr]);
+  }
+  if (!rings_.build(doHexa_ ? geomConv_.hexaGeom : geomConv_.squareGeom,srSizes,!doHexa_))
+    std::cout << " -- Warning, no cell ring table for this geometry, SR taken from hit distances." << std::endl;
+  std::vector<double> emptyRings(nSR_+1,0);
+  ringE_.resize(nLayers_,emptyRings);
+  ringSubtractedE_.resize(nLayers_,emptyRings);
+  ringMaxE_.resize(nLayers_,emptyRings);
 }
 
 SignalRegion::~SignalRegion(){
@@ -54,16 +71,14 @@ SignalRegion::~SignalRegion(){
 
 bool SignalRegion::initialiseFitPositions(){
 
-  std::ifstream fxypos;
-  std::ostringstream finname;
-  finname << inputFolder_ << "/accuratePos.dat";
-  fxypos.open(finname.str());
-  if (!fxypos.is_open()){
-    std::cout << " Cannot open input file " << finname.str() << "! Exiting..." << std::endl;
+  PositionStore fxypos;
+  std::string finname = PositionStore::fileName(inputFolder_);
+  if (!fxypos.open(finname,nLayers_)){
+    std::cout << " Cannot open input file " << finname << "! Exiting..." << std::endl;
     return false;
   }
 
-  std::cout << " -- Accurate positions found in file " << finname.str() << std::endl;
+  std::cout << " -- Accurate positions found in file " << finname << std::endl;
   
   //all events did not pass the chi2 fit: fill only those found.
   //keep failed ones to emptyvec so they are ignored afterwards
@@ -73,32 +88,32 @@ bool SignalRegion::initialiseFitPositions(){
 
   unsigned nfound = 0;
 
-  while (!fxypos.eof()){
-    unsigned eventIndex = nevt_;
-    double xpos(0),ypos(0),xangle(0),yangle(0);
-    double fitMatrix[4] = {0,0,0,0};
-    double xpost(0),ypost(0),xanglet(0),yanglet(0);
-    fxypos >> eventIndex >> xpos >> fitMatrix[0] >> xangle >> fitMatrix[1] >> ypos >> fitMatrix[2] >> yangle >> fitMatrix[3] >> xpost >> xanglet >> ypost >> yanglet;
+  const unsigned nStored = std::min(nevt_,fxypos.nEvents());
+  for (unsigned eventIndex(0); eventIndex<nStored; ++eventIndex){
+    const PositionStoreFit * lFit = fxypos.fit(eventIndex);
+    if (!lFit) continue;
+    const double xpos = lFit->pos_x;
+    const double ypos = lFit->pos_y;
+    const double xangle = lFit->tanangle_x;
+    const double yangle = lFit->tanangle_y;
+    const double fitMatrix[4] = {lFit->sigma_pos_x,lFit->sigma_tanangle_x,lFit->sigma_pos_y,lFit->sigma_tanangle_y};
     //testing for nan
-    if ( eventIndex != eventIndex || xpos != xpos || fitMatrix[0]!=fitMatrix[0] || xangle!=xangle || fitMatrix[1]!=fitMatrix[1] || ypos!=ypos || fitMatrix[2]!=fitMatrix[2] || yangle!=yangle || fitMatrix[3]!=fitMatrix[3]){
+    if ( xpos != xpos || fitMatrix[0]!=fitMatrix[0] || xangle!=xangle || fitMatrix[1]!=fitMatrix[1] || ypos!=ypos || fitMatrix[2]!=fitMatrix[2] || yangle!=yangle || fitMatrix[3]!=fitMatrix[3]){
       std::cout << " Found nan ! Fix code !" << std::endl;
       std::cout << eventIndex << " " << xpos << " " << fitMatrix[0] << " " << xangle << " " << fitMatrix[1] << " " << ypos << " " << fitMatrix[2] << " " << yangle << " " << fitMatrix[3]<< std::endl;
       exit(1);
     }
-    if (eventIndex<nevt_) {
-      accurateFit_[eventIndex].pos_x = xpos;
-      accurateFit_[eventIndex].pos_y = ypos;
-      accurateFit_[eventIndex].pos_z = 0;
-      accurateFit_[eventIndex].tanangle_x = xangle;
-      accurateFit_[eventIndex].tanangle_y = yangle;
-      accurateFit_[eventIndex].found=true;
-      nfound++;
-    }
-    else break;
+    accurateFit_[eventIndex].pos_x = xpos;
+    accurateFit_[eventIndex].pos_y = ypos;
+    accurateFit_[eventIndex].pos_z = 0;
+    accurateFit_[eventIndex].tanangle_x = xangle;
+    accurateFit_[eventIndex].tanangle_y = yangle;
+    accurateFit_[eventIndex].found=true;
+    nfound++;
   }
   //if not all events found
   if (nfound < nevt_) {
-    std::cout << " Warning, file " << finname.str() << " contains only " << nfound 
+    std::cout << " Warning, file " << finname << " contains only " << nfound 
 	      << " events, program running on " << nevt_ 
 	      << "." << std::endl;
     if (nfound*1./nevt_ < 0.5) return false;
@@ -300,13 +315,22 @@ bool SignalRegion::fillEnergies(const unsigned ievt,
     }
   }
   double refx[nLayers_],refy[nLayers_];
+  //lattice coordinates of the reference cells, for the ring table
+  int refix[nLayers_],refiy[nLayers_];
+  bool refCell[nLayers_];
 
   for (unsigned iL(0); iL<nLayers_;++iL){
     int refid = 0;
-    if (doHexa_) refid = geomConv_.hexagonMap()->FindBin(eventPos[iL].X(),eventPos[iL].Y());
-    else refid = geomConv_.squareMap()->FindBin(eventPos[iL].X(),eventPos[iL].Y());
+    if (doHexa_) refid = geomConv_.hexagonIndexer()->findBin(eventPos[iL].X(),eventPos[iL].Y());
+    else refid = geomConv_.squareIndexer()->findBin(eventPos[iL].X(),eventPos[iL].Y());
     refx[iL] = doHexa_ ? geomConv_.hexaGeom[refid].first : geomConv_.squareGeom[refid].first;
     refy[iL] = doHexa_ ? geomConv_.hexaGeom[refid].second : geomConv_.squareGeom[refid].second;
+    refCell[iL] = rings_.cell(refx[iL],refy[iL],refix[iL],refiy[iL]);
+    for (unsigned isr(0); isr<=nSR_;++isr){
+      ringE_[iL][isr] = 0;
+      ringSubtractedE_[iL][isr] = 0;
+      ringMaxE_[iL][isr] = 0;
+    }
   }
 
   //std::cout << " -- Accurate direction for evt " << ievt << ": " << std::endl;
@@ -376,13 +400,6 @@ bool SignalRegion::fillEnergies(const unsigned ievt,
     double posy = lHit.get_y();
     if (fixForPuMixBug_) posy-=1.25;
     double energy = lHit.energy();
-    //bool notNoiseOnly = fabs(lHit.noiseFraction()-1)>0.001;
-    //double etacor = fabs(1./tanh(leta));
-
-    //if (energy>maxE[layer]) {
-    //maxE[layer] = energy;
-    //maxH[layer] = iH;
-    //}
 
     totalE_ += energy;
     wgttotalE_ += energy*absweight_[layer];    
@@ -390,65 +407,79 @@ bool SignalRegion::fillEnergies(const unsigned ievt,
     double lradius = sqrt(pow(posx,2)+pow(posy,2));
     double puE = puDensity_.getDensity(leta,layer,geomConv_.cellSizeInCm(layer,lradius),nPuVtx);
     double subtractedenergy = std::max(0.,energy - puE);
-    //double halfCell = 0.5*geomConv_.cellSize(layer,lradius);
     //hexagons are side up....
     double distance = sqrt(3.)*6.496345;//geomConv_.cellSize(layer,lradius);
     double halfCelly = 0.5*distance;
-    //double halfCellx = doHexa_?geomConv_.cellSize(layer,lradius):geomConv_.cellSize(layer,lradius)/2.;
     double halfCellx = doHexa_?6.496345:5;
-    //std::cout << " halfcell = " << halfCell << std::endl;
-    //SR0-4
-    for (unsigned isr(0); isr<nSR_;++isr){
-      //double dx = isr%2==0? posx-refx[layer] : posx-eventPos[layer].x();
-      //double dy = isr%2==0? posy-refy[layer] : posy-eventPos[layer].y();
-      double dx = posx-refx[layer];
-      double dy = posy-refy[layer];
+    double dx = posx-refx[layer];
+    double dy = posy-refy[layer];
+
+    //first SR containing the hit, the larger ones all contain it
+    unsigned firstSR = CellRingTable::Ambiguous;
+    int cellx = 0, celly = 0;
+    if (refCell[layer] && rings_.cell(posx,posy,cellx,celly))
+      firstSR = rings_.ring(cellx,celly,refix[layer],refiy[layer]);
+    if (firstSR == CellRingTable::Ambiguous) {
+      firstSR = nSR_;
       double dr = sqrt(dx*dx+dy*dy);
-      /*if (isr==nSR_-1 && dr<50. ){
-	energySR_[layer][isr] += energy;
-	subtractedenergySR_[layer][isr] += subtractedenergy;
+      for (unsigned isr(0); isr<nSR_;++isr){
+	if ((doHexa_ && nSR_<=6 && dr<radius_[isr]) || 
+	    (!doHexa_ && (fabs(dx) <= ((isr+1)*halfCelly)) && (fabs(dy) <= ((isr+1)*halfCelly))) ){
+	  firstSR = isr;
+	  break;
 	}
-	else if ( (doHexa_ && ((isr%2==0 && dr<(isr*halfCellx+0.1)) || (isr%2==1 && dr <= ((isr+1)*halfCelly) && (fabs(dx) <= ((isr+1)*halfCellx)) && (fabs(dy) <= ((isr+1)*halfCelly))))) || 
-	(!doHexa_ && (fabs(dx) <= ((isr+1)*halfCelly)) && (fabs(dy) <= ((isr+1)*halfCelly))) )*/
-      if ((doHexa_ && nSR_<=6 && dr<radius_[isr]) || 
-	(!doHexa_ && (fabs(dx) <= ((isr+1)*halfCelly)) && (fabs(dy) <= ((isr+1)*halfCelly))) )
-	{
-	  energySR_[layer][isr] += energy;//*absweight_[layer]*etacor;
-	  subtractedenergySR_[layer][isr] += subtractedenergy;//*absweight_[layer];//*etacor;
-	//save energy in 1+6 cells
-	  if (isr== (doHexa_?0:2) ){
-	  int ix = doHexa_ ? dx/halfCellx : dx/(2*halfCelly);
-	  int iy = doHexa_ ? dy/(1.5*halfCelly) : dy/(2*halfCelly);
-	  unsigned idx = 0;
-	  if (((doHexa_ && (ix > 2 || ix < -2)) || (!doHexa_ && (ix > 1 || ix < -1))) || (iy>1 || iy<-1)) {
-	    std::cout << " error, isr = " << isr << " check ix=" << ix << " iy=" << iy << " posx,y-max=" << dx << " " << dy << " step " ;
-	    if (!doHexa_) std::cout << (isr+1)*halfCelly;
-	    else std::cout << isr*halfCelly+0.1;
-	    std::cout << std::endl;
-	    continue;
-	  }
-	  else {
-	    if (!doHexa_) idx = 3*(iy+1)+(ix+1);	    
-	    else {
-	      if (ix==-1 && iy==-1) idx=0;
-	      else if (ix==1 && iy==-1) idx = 1;
-	      else if (ix==-2 && iy==0) idx = 2;
-	      else if (ix==0 && iy==0) idx = 3;
-	      else if (ix==2 && iy==0) idx = 4;
-	      else if (ix==-1 && iy==1) idx = 5;
-	      else if (ix==1 && iy==1) idx = 6;
-	    }
-	  }
-	  Exy_[layer][idx] = energy;	  
-	}
-
+      }
+    }
+    ringE_[layer][firstSR] += energy;//*absweight_[layer]*etacor;
+    ringSubtractedE_[layer][firstSR] += subtractedenergy;//*absweight_[layer];//*etacor;
+    if (energy>ringMaxE_[layer][firstSR]) ringMaxE_[layer][firstSR] = energy;
+
+    //save energy in 1+6 cells
+    const unsigned isr = doHexa_?0:2;
+    if (isr<nSR_ && firstSR<=isr){
+      int ix = doHexa_ ? dx/halfCellx : dx/(2*halfCelly);
+      int iy = doHexa_ ? dy/(1.5*halfCelly) : dy/(2*halfCelly);
+      unsigned idx = 0;
+      if (((doHexa_ && (ix > 2 || ix < -2)) || (!doHexa_ && (ix > 1 || ix < -1))) || (iy>1 || iy<-1)) {
+	std::cout << " error, isr = " << isr << " check ix=" << ix << " iy=" << iy << " posx,y-max=" << dx << " " << dy << " step " ;
+	if (!doHexa_) std::cout << (isr+1)*halfCelly;
+	else std::cout << isr*halfCelly+0.1;
+	std::cout << std::endl;
+	continue;
       }
       else {
-	if (energy>maxhitEoutside_[layer][isr]) maxhitEoutside_[layer][isr] = energy;
+	if (!doHexa_) idx = 3*(iy+1)+(ix+1);	    
+	else {
+	  if (ix==-1 && iy==-1) idx=0;
+	  else if (ix==1 && iy==-1) idx = 1;
+	  else if (ix==-2 && iy==0) idx = 2;
+	  else if (ix==0 && iy==0) idx = 3;
+	  else if (ix==2 && iy==0) idx = 4;
+	  else if (ix==-1 && iy==1) idx = 5;
+	  else if (ix==1 && iy==1) idx = 6;
+	}
       }
-    }//loop on SR
+      Exy_[layer][idx] = energy;	  
+    }
   }//loop on hits
 
+  //SR isr sums the rings up to isr, the hits outside are in the rings above
+  for (unsigned iL(0); iL<nLayers_;++iL){
+    double sumE = 0;
+    double sumSubtractedE = 0;
+    for (unsigned isr(0); isr<nSR_;++isr){
+      sumE += ringE_[iL][isr];
+      sumSubtractedE += ringSubtractedE_[iL][isr];
+      energySR_[iL][isr] = sumE;
+      subtractedenergySR_[iL][isr] = sumSubtractedE;
+    }
+    double maxE = 0;
+    for (unsigned isr(nSR_); isr>0;--isr){
+      maxE = std::max(maxE,ringMaxE_[iL][isr]);
+      maxhitEoutside_[iL][isr-1] = maxE;
+    }
+  }
+
   /*for (unsigned iL(0);iL<nLayers_;++iL){
     const HGCSSRecoHit & lmaxHit = rechitvec[maxH[iL]];
     std::cout << "max hit layer " << iL << " x=" 
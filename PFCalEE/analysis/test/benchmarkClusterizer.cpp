@@ -0,0 +1,105 @@
+#include<string>
+#include<iostream>
+#include<sstream>
+#include<vector>
+#include<stdlib.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TStopwatch.h"
+
+#include "HGCSSRecoHit.hh"
+#include "HGCSSCluster.hh"
+#include "HGCSSHitColumns.hh"
+
+#include "Clusterizer.hh"
+
+//Time Clusterizer::buildClusters on the recorded RecoTree events,
+//with the seeds of PositionFit::getClusters (E > seed threshold).
+
+int main(int argc, char** argv){//main
+
+  if (argc < 2) {
+    std::cout << " Usage: "
+	      << argv[0] << " <full path to Digi file> "
+	      << "<optional: nEvts (default 0=all)> "
+	      << "<optional: seed threshold in MIPs (default 10)> "
+	      << "<optional: number of passes per event (default 1)> "
+	      << std::endl;
+    return 1;
+  }
+
+  std::string inFilePath = argv[1];
+  unsigned pNevts = 0;
+  double seedThreshold = 10;
+  unsigned nPasses = 1;
+  if (argc>2) std::istringstream(argv[2])>>pNevts;
+  if (argc>3) std::istringstream(argv[3])>>seedThreshold;
+  if (argc>4) std::istringstream(argv[4])>>nPasses;
+  if (nPasses<1) nPasses = 1;
+
+  TFile *inputFile = TFile::Open(inFilePath.c_str());
+  if (!inputFile) {
+    std::cout << " -- Error, input file " << inFilePath << " cannot be opened. Exiting..." << std::endl;
+    return 1;
+  }
+  TTree *lRecTree = (TTree*)inputFile->Get("RecoTree");
+  if (!lRecTree) {
+    std::cout << " -- Error, tree RecoTree cannot be opened. Exiting..." << std::endl;
+    return 1;
+  }
+
+  std::vector<HGCSSRecoHit> * rechitvec = 0;
+  HGCSSRecoHitColumns rechitcols;
+  lRecTree->SetBranchStatus("*",0);
+  if (!rechitcols.attach(lRecTree,"HGCSSRecoHitVec",rechitvec,"energy,layer,xpos,ypos,zpos")) return 1;
+
+  const unsigned nEvts = ((pNevts > lRecTree->GetEntries() || pNevts==0) ? static_cast<unsigned>(lRecTree->GetEntries()) : pNevts) ;
+  std::cout << " -- Processing " << nEvts << " events out of " << lRecTree->GetEntries()
+	    << ", " << nPasses << " passes per event, seed threshold " << seedThreshold << " MIPs." << std::endl;
+
+  //one clusterizer for all events: scratch buffers are reused
+  Clusterizer lClusterizer(0);
+  TStopwatch lWatch;
+  double tTot = 0;
+  unsigned long nHitsTot = 0;
+  unsigned long nClustersTot = 0;
+  unsigned long nClusterHitsTot = 0;
+
+  for (unsigned ievt(0); ievt<nEvts; ++ievt){//loop on entries
+    lRecTree->GetEntry(ievt);
+    rechitcols.update();
+
+    const unsigned nHits = (*rechitvec).size();
+    std::vector<bool> rechitMask(nHits,true);
+    std::vector<bool> seedable(nHits,false);
+    for (unsigned iH(0); iH<nHits; ++iH){
+      if ((*rechitvec)[iH].energy()>seedThreshold) seedable[iH] = true;
+    }
+
+    for (unsigned iP(0); iP<nPasses; ++iP){
+      HGCSSClusterVec lClusters;
+      lWatch.Start();
+      lClusterizer.buildClusters(rechitvec,rechitMask,seedable,lClusters);
+      lWatch.Stop();
+      tTot += lWatch.RealTime();
+      if (iP==0) {
+	nClustersTot += lClusters.size();
+	for (unsigned iC(0); iC<lClusters.size(); ++iC){
+	  nClusterHitsTot += lClusters[iC].nRecHits();
+	}
+      }
+    }
+    nHitsTot += nHits;
+    if (ievt%50 == 0) std::cout << "... Processed entry: " << ievt << ", " << nHits << " rechits." << std::endl;
+  }
+
+  if (nEvts==0) return 0;
+  std::cout << " -- Average number of rechits per event: " << 1.*nHitsTot/nEvts << std::endl
+	    << " -- Total number of clusters: " << nClustersTot << " with " << nClusterHitsTot << " rechits" << std::endl
+	    << " -- buildClusters time: " << tTot << " s, " << 1000.*tTot/(nEvts*nPasses) << " ms per event." << std::endl;
+
+  inputFile->Close();
+  return 0;
+
+}//main
@@ -0,0 +1,98 @@
+#include<string>
+#include<iostream>
+#include<fstream>
+#include<sstream>
+#include<vector>
+#include<stdlib.h>
+
+#include "PositionStore.hh"
+
+//Convert the initialPos_evt<ievt>.dat and accuratePos.dat text files
+//of a PositionFit output folder into its position store.
+
+int main(int argc, char** argv){//main
+
+  if (argc < 4) {
+    std::cout << " Usage: "
+	      << argv[0] << " <PositionFit output folder> "
+	      << "<number of events> "
+	      << "<number of layers> "
+	      << std::endl;
+    return 1;
+  }
+
+  std::string folder = argv[1];
+  unsigned nEvts = 0;
+  unsigned nLayers = 0;
+  std::istringstream(argv[2])>>nEvts;
+  std::istringstream(argv[3])>>nLayers;
+  if (nLayers==0) {
+    std::cout << " -- Error, number of layers should be >0. Exiting..." << std::endl;
+    return 1;
+  }
+
+  PositionStore lStore;
+  if (!lStore.open(PositionStore::fileName(folder),nLayers,true)) return 1;
+
+  //initial positions: one line per layer, energy only without error matrix
+  unsigned nPos = 0;
+  std::vector<PositionStoreLayer> lPos(nLayers);
+  for (unsigned ievt(0); ievt<nEvts; ++ievt){
+    std::ostringstream finname;
+    finname << folder << "/initialPos_evt" << ievt << ".dat";
+    std::ifstream fin(finname.str().c_str());
+    if (!fin.is_open()) continue;
+    for (unsigned iL(0); iL<nLayers; ++iL){
+      lPos[iL].xreco = 0;
+      lPos[iL].yreco = 0;
+      lPos[iL].xtruth = 0;
+      lPos[iL].ytruth = 0;
+      lPos[iL].E = 0;
+    }
+    std::string line;
+    while (std::getline(fin,line)){
+      std::istringstream lLine(line);
+      unsigned l = nLayers;
+      double xr=0,yr=0,xt=0,yt=0,e=0;
+      lLine>>l>>xr>>yr>>xt>>yt;
+      if (!lLine || l>=nLayers) continue;
+      if (!(lLine>>e)) e = 0;
+      lPos[l].xreco = xr;
+      lPos[l].yreco = yr;
+      lPos[l].xtruth = xt;
+      lPos[l].ytruth = yt;
+      lPos[l].E = e;
+    }
+    if (!lStore.setPositions(ievt,&lPos[0])) return 1;
+    nPos++;
+  }
+  std::cout << " -- Converted initial positions of " << nPos << " events." << std::endl;
+
+  //fit results: the last line of an event wins, as when read back
+  unsigned nFits = 0;
+  std::ifstream fxypos((folder+"/accuratePos.dat").c_str());
+  if (!fxypos.is_open()) {
+    std::cout << " -- Info, no accuratePos.dat file in " << folder << ", fits not converted." << std::endl;
+  }
+  else {
+    std::string line;
+    while (std::getline(fxypos,line)){
+      std::istringstream lLine(line);
+      unsigned eventIndex = nEvts;
+      PositionStoreFit lFit;
+      lLine >> eventIndex
+	    >> lFit.pos_x >> lFit.sigma_pos_x >> lFit.tanangle_x >> lFit.sigma_tanangle_x
+	    >> lFit.pos_y >> lFit.sigma_pos_y >> lFit.tanangle_y >> lFit.sigma_tanangle_y
+	    >> lFit.truth_pos_x >> lFit.truth_tanangle_x >> lFit.truth_pos_y >> lFit.truth_tanangle_y;
+      //incomplete lines are fits that failed for the truth positions
+      if (!lLine || eventIndex>=nEvts) continue;
+      if (!lStore.setFit(eventIndex,lFit)) return 1;
+      nFits++;
+    }
+  }
+  std::cout << " -- Converted " << nFits << " fit results." << std::endl;
+
+  lStore.close();
+  return 0;
+
+}//main
@@ -38,6 +38,7 @@
 
 #include "PositionFit.hh"
 #include "SignalRegion.hh"
+#include "InputBranches.hh"
 
 #include "Math/Vector3D.h"
 #include "Math/Vector3Dfwd.h"
@@ -81,6 +82,8 @@ int main(int argc, char** argv){//main
   unsigned redoStep;
   unsigned debug;
   bool applyPuMixFix;
+  //fit and fill energies in one run, reading the sim tree only once
+  bool pipeline;
 
   po::options_description preconfig("Configuration"); 
   preconfig.add_options()("cfg,c",po::value<std::string>(&cfg)->required());
@@ -104,6 +107,7 @@ int main(int argc, char** argv){//main
     ("redoStep",       po::value<unsigned>(&redoStep)->default_value(0))
     ("debug,d",        po::value<unsigned>(&debug)->default_value(0))
     ("applyPuMixFix",  po::value<bool>(&applyPuMixFix)->default_value(false))
+    ("pipeline",       po::value<bool>(&pipeline)->default_value(false))
     ;
 
   // ("output_name,o",            po::value<std::string>(&outputname)->default_value("tmp.root"))
@@ -129,6 +133,7 @@ int main(int argc, char** argv){//main
 	    << " -- Number cells in signal region for fit: " << nSR << " cells" << std::endl
 	    << " -- Residual max considered for filling matrix and fitting: " << residualMax << " mm" << std::endl
 	    << " -- Apply PUMix fix? " << applyPuMixFix << std::endl
+	    << " -- Pipeline mode? " << pipeline << std::endl
 	    << " -- Processing ";
   if (pNevts == 0) std::cout << "all events." << std::endl;
   else std::cout << pNevts << " events." << std::endl;
@@ -296,46 +301,68 @@ int main(int argc, char** argv){//main
   }
   
   //loop on events
-  HGCSSEvent * event = 0;
   std::vector<HGCSSSamplingSection> * ssvec = 0;
-  std::vector<HGCSSSimHit> * simhitvec = 0;
   std::vector<HGCSSRecoHit> * rechitvec = 0;
   std::vector<HGCSSGenParticle> * genvec = 0;
   unsigned nPuVtx = 0;
 
-  lSimTree->SetBranchAddress("HGCSSEvent",&event);
-  lSimTree->SetBranchAddress("HGCSSSamplingSectionVec",&ssvec);
-  lSimTree->SetBranchAddress("HGCSSSimHitVec",&simhitvec);
-  lSimTree->SetBranchAddress("HGCSSGenParticleVec",&genvec);
+  //pipeline: truth and positions are kept by getInitialPositions, only
+  //the sampling sections of the first event are read from the sim tree.
+  //The energies do not use the simhits.
+  const bool fromCache = pipeline && dofit;
+  const std::vector<HGCSSSimHit> noSimHits;
+  InputBranches lSimInput(lSimTree,"egammaResolution");
+  if (!lSimInput.use("HGCSSSamplingSectionVec",&ssvec)) return 1;
+  if (dofit && !fromCache && !lSimInput.use("HGCSSGenParticleVec",&genvec)) return 1;
+  lSimInput.enable();
+
+  InputBranches lRecInput(lRecTree,"egammaResolution");
+  if (!lRecInput.use("HGCSSRecoHitVec",&rechitvec)) return 1;
+  lRecInput.use("nPuVtx",&nPuVtx,true);
+  lRecInput.enable();
 
-  lRecTree->SetBranchAddress("HGCSSRecoHitVec",&rechitvec);
-  if (lRecTree->GetBranch("nPuVtx")) lRecTree->SetBranchAddress("nPuVtx",&nPuVtx);
   const unsigned nRemove = 12;
-  std::vector<unsigned> lToRemove;
   unsigned list[nRemove] = {25,27,15,1,10,3,18,5,12,7,23,20};
+  std::vector<unsigned> lToRemove(list,list+nRemove);
+  std::vector<FitResult> fits;
+  std::vector<unsigned> fitStatus;
 
   for (unsigned ievt(0); ievt<nEvts; ++ievt){//loop on entries
     if (debug) std::cout << "... Processing entry: " << ievt << std::endl;
     else if (ievt%50 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
 
-    lSimTree->GetEntry(ievt);
-    lRecTree->GetEntry(ievt);
+    if (fromCache) {
+      if (ievt==0) lSimInput.getEntry(ievt);
+      lRecInput.getEntry(ievt);
+      FitResult fit;
+      if (lChi2Fit.setTruthInfo(ievt)) {
+	lChi2Fit.performLeastSquareFits(ievt,lToRemove,fits,fitStatus);
+	//the fit kept on disk is the last successful one
+	for (unsigned r(0); r<nRemove+1;++r){
+	  if ( fitStatus[r]==0 ) fit = fits[r];
+	  else std::cout << " -- remove " << r << " Fit failed." << std::endl;
+	}
+      }
+      SignalEnergy.fillEnergies(ievt,(*ssvec),noSimHits,(*rechitvec),nPuVtx,fit);
+      continue;
+    }
+
+    lSimInput.getEntry(ievt);
+    lRecInput.getEntry(ievt);
     if (dofit) {
       bool found = lChi2Fit.setTruthInfo(genvec,1);
       if (!found) continue;
-      //mask layers in turn
-      lToRemove.clear();
+      //mask layers in turn: fit r has the first r layers of the list removed
+      lChi2Fit.performLeastSquareFits(ievt,lToRemove,fits,fitStatus);
       for (unsigned r(0); r<nRemove+1;++r){
-	FitResult fit;
-	if ( lChi2Fit.performLeastSquareFit(ievt,fit,lToRemove)==0 ){
-	  //SignalEnergy.fillEnergies(ievt,(*ssvec),(*simhitvec),(*rechitvec),nPuVtx,fit);
+	if ( fitStatus[r]==0 ){
+	  //SignalEnergy.fillEnergies(ievt,(*ssvec),noSimHits,(*rechitvec),nPuVtx,fits[r]);
 	}
 	else std::cout << " -- remove " << r << " Fit failed." << std::endl;
-	if (r<nRemove) lToRemove.push_back(list[r]);
       }
 
     }
-    else SignalEnergy.fillEnergies(ievt,(*ssvec),(*simhitvec),(*rechitvec),nPuVtx);
+    else SignalEnergy.fillEnergies(ievt,(*ssvec),noSimHits,(*rechitvec),nPuVtx);
 
   }//loop on entries
 
@@ -343,6 +370,8 @@ int main(int argc, char** argv){//main
 
   if (dofit) lChi2Fit.finaliseFit();
   SignalEnergy.finalise();
+  lSimInput.print();
+  lRecInput.print();
 
   outputFile->Write();
   //outputFile->Close();
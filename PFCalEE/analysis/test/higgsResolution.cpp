@@ -117,6 +117,7 @@ int main(int argc, char** argv){//main
   bool applyPuMixFix;
   std::string singleGammaPath;
   unsigned nVtx;
+  std::string cellGeometryCache;
 
   po::options_description preconfig("Configuration"); 
   preconfig.add_options()("cfg,c",po::value<std::string>(&cfg)->required());
@@ -141,6 +142,7 @@ int main(int argc, char** argv){//main
     ("applyPuMixFix",  po::value<bool>(&applyPuMixFix)->default_value(false))
     ("singleGammaPath",     po::value<std::string>(&singleGammaPath)->required())
     ("nVtx",        po::value<unsigned>(&nVtx)->default_value(0))
+    ("cellGeometryCache", po::value<std::string>(&cellGeometryCache)->default_value(""))
     ;
 
   // ("output_name,o",            po::value<std::string>(&outputname)->default_value("tmp.root"))
@@ -275,6 +277,8 @@ int main(int argc, char** argv){//main
 	    << " -- N sections = " << nSections << std::endl;
 
 
+  if (cellGeometryCache.size()>0 && !HGCSSGeometryConversion::openCellGeometryCache(cellGeometryCache))
+    std::cout << " -- Cell geometry cache not used, the maps are built." << std::endl;
   HGCSSGeometryConversion geomConv(model,cellSize,false,2);
   //set granularity to get cellsize for PU subtraction
   std::vector<unsigned> granularity;
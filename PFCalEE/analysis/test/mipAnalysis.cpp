@@ -37,6 +37,7 @@
 #include "HGCSSGeometryConversion.hh"
 #include "HGCSSPUenergy.hh"
 #include "HGCSSMipHit.hh"
+#include "HGCSSHitColumns.hh"
 
 #include "PositionFit.hh"
 #include "SignalRegion.hh"
@@ -265,13 +266,16 @@ int main(int argc, char** argv){//main
   unsigned nPuVtx = 0;
 
   lTree->SetBranchAddress("HGCSSEvent",&event);
-  lTree->SetBranchAddress("HGCSSRecoHitVec",&rechitvec);
+  //only the fields used below if the hits are stored as columns
+  HGCSSRecoHitColumns rechitcols;
+  if (!rechitcols.attach(lTree,"HGCSSRecoHitVec",rechitvec,"energy,layer,xpos,ypos,zpos,noiseFrac")) return 1;
   if (lTree->GetBranch("nPuVtx")) lTree->SetBranchAddress("nPuVtx",&nPuVtx);
 
   for (unsigned ievt(0); ievt<nEvts; ++ievt){//loop on entries
     if (debug) std::cout << "... Processing entry: " << ievt << std::endl;
     else if (ievt%50 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
     lTree->GetEntry(ievt);
+    rechitcols.update();
 
 
     //add noise only contributions: need to be done consistently for the event... i.e. same cell can be neighbour to several hits....
@@ -319,7 +323,7 @@ int main(int argc, char** argv){//main
       unsigned nTotCheck = 0;
       unsigned nAddedCheck = 0;
       for (unsigned iL(0); iL<myDetector.nLayers(); ++iL){//loop on layers
-	std::map<unsigned,MergeCells> & histE = geomConv.get2DHist(iL);
+	HGCSSCellMap & histE = geomConv.get2DHist(iL);
 	//std::cout << " Check layer " << iL << " nHits = " << histE.size() << std::endl;
 	nTotCheck += histE.size();
 	const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(iL);
@@ -344,7 +348,7 @@ int main(int argc, char** argv){//main
 	  MergeCells tmpCell;
 	  tmpCell.energy = 0;
 	  tmpCell.time = 0;
-	  std::pair<std::map<unsigned,MergeCells>::iterator,bool> isInserted = histE.insert(std::pair<unsigned,MergeCells>(iB,tmpCell));
+	  std::pair<HGCSSCellMap::iterator,bool> isInserted = histE.insert(std::pair<unsigned,MergeCells>(iB,tmpCell));
 	  if (isInserted.second==true){
 	    HGCSSRecoHit lRecHit;
 	    lRecHit.layer(iL);
@@ -10,7 +10,7 @@
 #include "boost/function.hpp"
 
 // helpful tools
-#include "KDTreeLinkerAlgoT.h"
+#include "LayerHitIndex.hh"
 #include <unordered_map>
 #include <unordered_set>
 
@@ -63,26 +63,23 @@ struct MyHit{
   };
 };
 
-void fillKDTree(KDTree & _hit_kdtree,
-		std::vector<KDNode> & _hit_nodes,
-		const std::vector<MyHit> & rechits){
+void fillHitIndex(LayerHitIndex & _hit_index,
+		  const std::vector<MyHit> & rechits){
 
-
-  _hit_kdtree.clear();
-  std::vector<bool> usable_rechits(rechits.size(),true);
-
-  _hit_nodes.reserve(rechits.size());
-
-  KDTreeCube kd_boundingregion = 
-    fill_and_bound_kd_tree(rechits,usable_rechits,_hit_nodes);
-  _hit_kdtree.build(_hit_nodes,kd_boundingregion);
-  _hit_nodes.clear();
+  _hit_index.clear();
+  _hit_index.reserve(rechits.size());
+  for (unsigned iH(0); iH<rechits.size(); ++iH){
+    const ROOT::Math::XYZPoint pos = rechits[iH].position();
+    _hit_index.add(iH,rechits[iH].layer,(float)pos.X(),(float)pos.Y());
+  }
+  _hit_index.build();
 };
 
 void findNeighbours(const double & cell_size_mm,
-		    KDTree & _hit_kdtree,
+		    const unsigned nLayers,
+		    const LayerHitIndex & _hit_index,
 		    const MyHit & current_cell, 
-		    std::vector<KDNode> & found, 
+		    std::vector<unsigned> & found, 
 		    const unsigned layerRange=1){
   const ROOT::Math::XYZPoint pos = current_cell.position();
 
@@ -91,22 +88,23 @@ void findNeighbours(const double & cell_size_mm,
   unsigned layer = current_cell.layer;
 
   //std::cout << " -- x,y,z,l = " << pos.X() << " " << pos.Y() << " " << pos.Z() << " " << layer << std::endl;
-  //std::cout << " -- kdtree size: " << _hit_kdtree.size() << std::endl;
 
   auto x_rh = minmax(pos.x()+cell_size,pos.x()-cell_size);
   auto y_rh = minmax(pos.y()+cell_size,pos.y()-cell_size);
-  auto z_rh = minmax(zPos(layer-layerRange)/10.,zPos(layer+layerRange)/10.);//in cm!!!
-
-  KDTreeCube hit_searchcube((float)x_rh.first,(float)x_rh.second,
-			    (float)y_rh.first,(float)y_rh.second,
-			    (float)z_rh.first,(float)z_rh.second);
+  //layers layer-layerRange to layer+layerRange, within the detector
+  unsigned lmin = layer>layerRange ? layer-layerRange : 0;
+  unsigned lmax = std::min(layer+layerRange,nLayers-1);
 
   //std::cout << " -- min and max X = " << (float)x_rh.first << " " << (float)x_rh.second << std::endl
   //<< " -- min and max Y = " << (float)y_rh.first << " " <<(float)y_rh.second  << std::endl
-  //<< " -- min and max Z = " << (float)z_rh.first << " " << (float)z_rh.second << std::endl;
-
+  //<< " -- layers " << lmin << " to " << lmax << std::endl;
 
-  _hit_kdtree.search(hit_searchcube,found);
+  for (unsigned iL(lmin); iL<=lmax; ++iL){
+    _hit_index.search(iL,
+		      (float)x_rh.first,(float)x_rh.second,
+		      (float)y_rh.first,(float)y_rh.second,
+		      found);
+  }
 
   //std::cout << " -- Found " << found.size() << " nodes." << std::endl;
 
@@ -340,8 +338,8 @@ int main(int argc, char** argv){//main
 
   std::cout << " -- Tree contains: " << tree->GetEntries() << " events." << std::endl;
 
-  std::vector<KDNode> _hit_nodes;
-  KDTree _hit_kdtree;
+  //hits of each layer, in bins of one cell
+  LayerHitIndex _hit_index(cell_size/10.);
 
   for (unsigned ievt(0); ievt<pNevts; ++ievt){//loop on entries
     if (ievt%10 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
@@ -378,9 +376,8 @@ int main(int argc, char** argv){//main
 	  nHits[ie][in][iL] = 0;
 	}
 
-	fillKDTree(_hit_kdtree,
-		   _hit_nodes,
-		   lHitVec[ie][in]);
+	fillHitIndex(_hit_index,
+		     lHitVec[ie][in]);
 	
 	if (debug) std::cout << " ----- Number of hits in vector : " << lHitVec[ie][in].size() << std::endl;
 	//unsigned nMaxNeigh = 0;
@@ -388,8 +385,8 @@ int main(int argc, char** argv){//main
 	  const MyHit& current = lHitVec[ie][in][iH];
 	  unsigned iL = current.layer;
 
-	  std::vector<KDNode> neighbours;
-	  findNeighbours(cell_size,_hit_kdtree,current,neighbours,layerRange+1);
+	  std::vector<unsigned> neighbours;
+	  findNeighbours(cell_size,nLayers,_hit_index,current,neighbours,layerRange+1);
 	  
 	  if (debug>1) std::cout << " -- Number of closest neighbours found: " << neighbours.size() << std::endl; 
 	  //if (neighbours.size()>nMaxNeigh) nMaxNeigh=neighbours.size();
@@ -401,8 +398,7 @@ int main(int argc, char** argv){//main
 	  std::vector<unsigned> idx2Before;
 	  std::vector<unsigned> idx2After;
 	  //clean neighbours
-	  for( const KDNode& nbourpoint :neighbours ) {
-	    unsigned index = nbourpoint.data;
+	  for( const unsigned index :neighbours ) {
 	    if (index == iH) {
 	      //neighbours.erase(neighbours.begin()+iH);
 	      continue;
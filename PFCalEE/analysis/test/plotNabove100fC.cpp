@@ -39,11 +39,80 @@
 #include "HGCSSGeometryConversion.hh"
 #include "HGCSSPUenergy.hh"
 
+#include "HGCSSEventLoop.hh"
 #include "utilities.h"
 
 using boost::lexical_cast;
 namespace po=boost::program_options;
 
+//one per thread, the output of the first one is kept
+class NAboveWorker : public HGCSSEventLoop::Worker{
+public:
+  NAboveWorker(const double mipCut,
+	       HGCSSDetector & myDetector,
+	       const HGCSSGeometryConversion & geomConv):
+    mipCut_(mipCut),
+    myDetector_(myDetector),
+    geomConv_(geomConv),
+    outtree(0),
+    nAbove(0),
+    nTot(0),
+    rechitvec(0),
+    nover(0),
+    ntot(0)
+  {};
+
+  bool begin(TChain *, TChain *lRecTree){
+    outtree = book(new TTree("outtree","Output tree with cells above 26 mips"));
+    outtree->Branch("nover",&nover);
+    outtree->Branch("ntot",&ntot);
+    nAbove = book(new TH1F("nAbove",";n_{cells}(E>26 MIPs);Probability",20,0,20));
+    nTot = book(new TH1F("nTot",";n_{cells};events",200,0,1000));
+    lRecTree->SetBranchAddress("HGCSSRecoHitVec",&rechitvec);
+    return true;
+  };
+
+  void process(const unsigned){
+    nover = 0;
+    ntot = 0;
+
+    for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop on hits
+      const HGCSSRecoHit & lHit = (*rechitvec)[iH];
+      double energy = lHit.energy();
+      //double leta = lHit.eta();
+      //if (leta>2.1 || leta < 1.9) continue;
+      unsigned layer = lHit.layer();
+      const HGCSSSubDetector & subdet = myDetector_.subDetectorByLayer(layer);
+      if (subdet.type == DetectorEnum::BHCAL1 || subdet.type == DetectorEnum::BHCAL2) continue;
+      double lRadius = sqrt(pow(lHit.get_x(),2)+pow(lHit.get_y(),2));
+      double cutVal = mipCut_*2./geomConv_.getNumberOfSiLayers(subdet.type,lRadius);
+      if (energy>cutVal){
+	nover++;
+      }
+      ntot++;
+    }//loop on hits
+    nAbove->Fill(nover);
+    nTot->Fill(ntot);
+
+    outtree->Fill();
+  };
+
+private:
+  double mipCut_;
+  HGCSSDetector & myDetector_;
+  const HGCSSGeometryConversion & geomConv_;
+
+public:
+  TTree *outtree;
+  TH1F *nAbove;
+  TH1F *nTot;
+
+private:
+  std::vector<HGCSSRecoHit> * rechitvec;
+  unsigned nover;
+  unsigned ntot;
+};
+
 int main(int argc, char** argv){//main
 
   if (argc<8){
@@ -56,6 +125,7 @@ int main(int argc, char** argv){//main
 	      << " <eta>"<< std::endl
 	      << " <nRuns>" << std::endl
 	      << " <nEvts to process (0=all)>"<< std::endl
+	      << " <optional: nThreads (default=1, 0=all cores)>"<< std::endl
 	      << std::endl;
     return 1;
   }
@@ -70,6 +140,8 @@ int main(int argc, char** argv){//main
   unsigned nRuns = 0;
   std::istringstream(argv[6])>>nRuns;
   const unsigned pNevts = atoi(argv[7]);
+  unsigned nThreads = 1;
+  if (argc>8) std::istringstream(argv[8])>>nThreads;
 
   std::ostringstream inFilePath;
   inFilePath << eosPath << "HGcal__version" << version << "_model2_BOFF_et" << pt << "_eta" << eta;
@@ -88,13 +160,6 @@ int main(int argc, char** argv){//main
 
   TFile *fout = TFile::Open(output.str().c_str(),"RECREATE");
   fout->cd();
-  TTree *outtree = new TTree("outtree","Output tree with cells above 26 mips");
-  unsigned nover = 0;
-  unsigned ntot = 0;
-  outtree->Branch("nover",&nover);
-  outtree->Branch("ntot",&ntot);
-  TH1F *nAbove = new TH1F("nAbove",";n_{cells}(E>26 MIPs);Probability",20,0,20);
-  TH1F *nTot = new TH1F("nTot",";n_{cells};events",200,0,1000);
   TH2D *hxy = new TH2D("hxy",";x (mm);y (mm);cells E>26 MIPs",339,-1695,1695,339,-1695,1695);
 
 
@@ -160,39 +225,18 @@ int main(int argc, char** argv){//main
 
 
 
-  std::vector<HGCSSRecoHit> * rechitvec = 0;
-  lRecTree->SetBranchAddress("HGCSSRecoHitVec",&rechitvec);
-
-  for (unsigned ievt(0); ievt<nEvts; ++ievt){//loop on entries
-    if (ievt%100 == 0) std::cout << "... Processing entry: " << ievt << std::endl;
-    
-    lRecTree->GetEntry(ievt);
-
-    nover = 0;
-    ntot = 0;
-
-    for (unsigned iH(0); iH<(*rechitvec).size(); ++iH){//loop on hits
-      const HGCSSRecoHit & lHit = (*rechitvec)[iH];
-      double energy = lHit.energy();
-      double leta = lHit.eta();
-      //if (leta>2.1 || leta < 1.9) continue;
-      unsigned layer = lHit.layer();
-      const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(layer);
-      if (subdet.type == DetectorEnum::BHCAL1 || subdet.type == DetectorEnum::BHCAL2) continue;
-      double lRadius = sqrt(pow(lHit.get_x(),2)+pow(lHit.get_y(),2));
-      double cutVal = mipCut*2./geomConv.getNumberOfSiLayers(subdet.type,lRadius);
-      if (energy>cutVal){
-	nover++;
-      }
-      ntot++;
-    }//loop on hits
-    nAbove->Fill(nover);
-    nTot->Fill(ntot);
-
-    outtree->Fill();
+  fout->cd();
+  HGCSSEventLoop lLoop(0,lRecTree,nThreads);
+  std::vector<HGCSSEventLoop::Worker*> lWorkers;
+  for (unsigned iT(0); iT<lLoop.nThreads(); ++iT){
+    lWorkers.push_back(new NAboveWorker(mipCut,myDetector,geomConv));
+  }
+  if (!lLoop.run(lWorkers,nEvts)) {
+    for (unsigned iT(0); iT<lWorkers.size(); ++iT) delete lWorkers[iT];
+    return 1;
+  }
+  TH1F *nAbove = static_cast<NAboveWorker*>(lWorkers[0])->nAbove;
 
-  }//loop on entries
-  
   nAbove->Scale(1./nEvts);
   myc2->cd();
   //gPad->SetGridx(1);
@@ -214,6 +258,8 @@ int main(int argc, char** argv){//main
   myc2->Print(lsave.str().c_str());
 
   fout->Write();
+  //the output objects belong to the file, not to the workers
+  for (unsigned iT(0); iT<lWorkers.size(); ++iT) delete lWorkers[iT];
   return 0;
 
 }//main
@@ -37,6 +37,7 @@
 #include "HGCSSDetector.hh"
 #include "HGCSSGeometryConversion.hh"
 #include "HGCSSPUenergy.hh"
+#include "HGCSSHitColumns.hh"
 //#include "HGCSSSimpleHit.hh"
 
 #include "PositionFit.hh"
@@ -523,12 +524,14 @@ int main(int argc, char** argv){//main
 
   lSimTree->SetBranchAddress("HGCSSEvent",&event);
   lSimTree->SetBranchAddress("HGCSSSamplingSectionVec",&ssvec);
-  lSimTree->SetBranchAddress("HGCSSSimHitVec",&simhitvec);
+  HGCSSSimHitColumns simhitcols;
+  if (!simhitcols.attach(lSimTree,"HGCSSSimHitVec",simhitvec)) return 1;
   //  lSimTree->SetBranchAddress("HGCSSAluSimHitVec",&alusimhitvec);
   lSimTree->SetBranchAddress("HGCSSGenParticleVec",&genvec);
 
   lRecTree->SetBranchAddress("HGCSSEvent",&eventRec);
-  lRecTree->SetBranchAddress("HGCSSRecoHitVec",&rechitvec);
+  HGCSSRecoHitColumns rechitcols;
+  if (!rechitcols.attach(lRecTree,"HGCSSRecoHitVec",rechitvec)) return 1;
   if (lRecTree->GetBranch("nPuVtx")) lRecTree->SetBranchAddress("nPuVtx",&nPuVtx);
 
 
@@ -568,6 +571,8 @@ int main(int argc, char** argv){//main
 
     lSimTree->GetEntry(ievt);
     lRecTree->GetEntry(ievtRec);
+    simhitcols.update();
+    rechitcols.update();
     if (nPuVtx>0 && eventRec->eventNumber()==0 && event->eventNumber()!=0) {
       std::cout << " skip !" << ievt << " " << ievtRec << std::endl;
       nSkipped++;
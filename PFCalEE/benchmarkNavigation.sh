@@ -0,0 +1,20 @@
+#!/bin/bash
+#navigation steps/s with the flat and nested layer layouts, per detector version
+#usage: ./benchmarkNavigation.sh [versions, comma separated] [model] [number of rays]
+versions=${1:-"60,63,64"}
+model=${2:-2}
+nrays=${3:-10000}
+wthick="1.75,1.75,1.75,1.75,1.75,2.8,2.8,2.8,2.8,2.8,4.2,4.2,4.2,4.2,4.2"
+pbthick="1,1,1,1,1,2.1,2.1,2.1,2.1,2.1,4.4,4.4,4.4,4.4"
+
+macro=benchmarkNavigation.mac
+echo "/control/verbose 0" > $macro
+echo "/run/verbose 0" >> $macro
+echo "/N03/det/benchmarkNavigation $nrays" >> $macro
+
+for version in ${versions//,/ }; do
+    for nested in 0 1; do
+	PFCalEE $macro $version $model 0 4 $wthick $pbthick "" 1 $nested | grep "Navigation benchmark"
+    done
+done
+rm -f $macro
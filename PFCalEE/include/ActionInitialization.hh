@@ -0,0 +1,32 @@
+#ifndef ActionInitialization_h
+#define ActionInitialization_h 1
+
+//only available with a multithreaded Geant4 (>= 10.0) build.
+#ifdef G4MULTITHREADED
+
+#include "G4VUserActionInitialization.hh"
+#include "globals.hh"
+
+/**
+   @class ActionInitialization
+   @short instantiates the user actions for the master and for each worker thread
+ */
+class ActionInitialization : public G4VUserActionInitialization
+{
+public:
+  ActionInitialization(G4int model, G4double eta);
+  virtual ~ActionInitialization();
+
+  virtual void BuildForMaster() const;
+  virtual void Build() const;
+  virtual G4VSteppingVerbose* InitializeSteppingVerbose() const;
+
+private:
+  G4int model_;
+  G4double eta_;
+
+};
+
+#endif
+
+#endif
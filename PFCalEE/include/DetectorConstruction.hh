@@ -17,6 +17,8 @@ class G4Material;
 class G4UniformMagField;
 class DetectorMessenger;
 class G4Colour;
+class G4Region;
+class FrozenShowerModel;
 
 /**
    @class DetectorConstruction
@@ -96,7 +98,8 @@ public:
 		       G4int shape=1,
 		       std::string absThickW="1.75,1.75,1.75,1.75,1.75,2.8,2.8,2.8,2.8,2.8,4.2,4.2,4.2,4.2,4.2",
 		       std::string absThickPb="1,1,1,1,1,2.1,2.1,2.1,2.1,2.1,4.4,4.4,4.4,4.4",
-		       std::string dropLayer="");
+		       std::string dropLayer="",
+		       bool nestedLayers=true);
 
   void buildHGCALFHE(const unsigned aVersion);
   void buildHGCALBHE(const unsigned aVersion);
@@ -114,6 +117,26 @@ public:
 
 
 
+  /**
+     @short position of a physical volume in the calorimeter structure, 0 if not part of it
+   */
+  inline const SamplingVolume* getSamplingVolume(const G4VPhysicalVolume* aVol) const {
+    SamplingVolumeMap::const_iterator lIter = m_volumeMap.find(aVol);
+    if (lIter == m_volumeMap.end()) return 0;
+    return &(lIter->second);
+  }
+  G4VPhysicalVolume* getWorldVolume() const { return m_physWorld; }
+
+  /**
+     @short layers placed in their own envelope volume, false for all volumes directly in the world
+   */
+  bool nestedLayers() const { return nestedLayers_ && m_nSectors==1; }
+
+  /**
+     @short number of EE layers: the leading layers with a W, WCu or Pb absorber
+   */
+  unsigned getNEELayers() const { return m_nEELayers; }
+
   const std::vector<G4LogicalVolume*>  & getSiLogVol() {return m_logicSi; }
   const std::vector<G4LogicalVolume*>  & getAlLogVol() {return m_logicAl; }
   const std::vector<G4LogicalVolume*>  & getAbsLogVol() {return m_logicAbs; }
@@ -143,6 +166,23 @@ public:
   void SetPbThick(std::string thick);
   void SetDropLayers(std::string layers);
 
+  /**
+     @short parametrised EM showers in the EE (EMShowerModel) above the minimum energy
+     parFile: shower parameters, "default" for the built-in values
+   */
+  void SetFastShower(std::string parFile);
+  void SetFastShowerMinEnergy(G4double energy) { fastShowerMinE_ = energy; }
+
+  /**
+     @short frozen showers in the EE (FrozenShowerModel) between the minimum and maximum energies
+     from a library, or recorded for a library if recordFile is given
+   */
+  void SetFrozenShowers(std::string libFile, std::string recordFile);
+  void SetFrozenShowerMinEnergy(G4double energy) { frozenShowerMinE_ = energy; }
+  void SetFrozenShowerMaxEnergy(G4double energy) { frozenShowerMaxE_ = energy; }
+  //model of this thread, 0 if none
+  FrozenShowerModel* getFrozenShowerModel() const;
+
   /**
      @short DTOR
    */
@@ -166,6 +206,11 @@ public:
 
   G4VPhysicalVolume* Construct();
 
+  /**
+     @short per thread part of the construction (Geant4 >= 10): fast simulation models
+   */
+  void ConstructSDandField();
+
 private:
 
   //detector version
@@ -179,6 +224,7 @@ private:
   bool addPrePCB_;
 
   bool doHF_;
+  bool nestedLayers_;
   unsigned firstHFlayer_;
   unsigned firstMixedlayer_;
   unsigned firstScintlayer_;
@@ -204,6 +250,9 @@ private:
    */
   G4VPhysicalVolume* ConstructCalorimeter();     
 
+  void buildFastShowerModel();
+  void buildFrozenShowerModel();
+
   void buildSectorStack(const unsigned sectorNum,
 			const G4double & minL, 
 			const G4double & width);
@@ -219,6 +268,10 @@ private:
   G4VSolid *constructSolid (std::string baseName, G4double thick, G4double zpos,const G4double & minL, const G4double & width, const double & etamin, const double & etamax);
 
   G4VSolid *constructSupportCone (std::string baseName, G4double thick, G4double zpos,const G4double & minL, const G4double & width, const double & etamin, const double & etamax);
+
+  //envelope of a layer: the union of its element solids
+  G4VSolid *constructLayerEnvelope (const unsigned layer, std::string baseName, G4double zpos,const G4double & minL, const G4double & width, const bool isHF=false);
+  double getRadiusFromEtaZ(const double & eta, const double & zpos);
   G4VSolid *constructSupportCone (std::string baseName, G4double thick, G4double zpos,const G4double & minL, const G4double & width);
 
   std::vector<G4Material* > m_SensitiveMaterial;
@@ -242,6 +295,17 @@ private:
   std::vector<G4LogicalVolume*>   m_logicAl;    //pointer to the logical Si volumes
   std::vector<G4LogicalVolume*>   m_logicAbs;    //pointer to the logical absorber volumes situated just before the si
 
+  SamplingVolumeMap m_volumeMap;  //physical volume -> (section,element) of the calorimeter structure
+
+  unsigned m_nEELayers;
+  G4Region* m_eeRegion;  //envelope of the EE fast simulation: EE volumes except Si
+  std::string fastShowerFile_;
+  G4double fastShowerMinE_;
+  std::string frozenShowerLib_;
+  std::string frozenShowerRecord_;
+  G4double frozenShowerMinE_;
+  G4double frozenShowerMaxE_;
+
   DetectorMessenger* m_detectorMessenger;  //pointer to the Messenger
 };
 
@@ -61,6 +61,13 @@ class DetectorMessenger: public G4UImessenger
     G4UIdirectory*             detDir;
     G4UIcmdWithADoubleAndUnit* MagFieldCmd;
     G4UIcmdWithAnInteger* SetModelCmd;
+    G4UIcmdWithAString*        FastShowerCmd;
+    G4UIcmdWithADoubleAndUnit* FastShowerMinECmd;
+    G4UIcmdWithAString*        FrozenShowerLibCmd;
+    G4UIcmdWithAString*        FrozenShowerRecordCmd;
+    G4UIcmdWithADoubleAndUnit* FrozenShowerMinECmd;
+    G4UIcmdWithADoubleAndUnit* FrozenShowerMaxECmd;
+    G4UIcmdWithAnInteger*      BenchmarkNavCmd;
 
 };
 
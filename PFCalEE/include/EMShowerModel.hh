@@ -0,0 +1,73 @@
+#ifndef EMShowerModel_h
+#define EMShowerModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <string>
+#include <vector>
+
+#include "HGCSSShowerParameters.hh"
+#include "ShowerDeposit.hh"
+
+class DetectorConstruction;
+class G4Region;
+
+/**
+   @class EMShowerModel
+   @short parametrised e+/e-/gamma showers (GFlash-like profiles, see HGCSSShowerParameters)
+
+   Triggered in the EE envelope above a minimum energy: the particle is
+   killed and its shower deposited element by element along its
+   direction. The energy of an element is the integral of the sampled
+   longitudinal profile over its X0, shared with the mip-like dE/dx of
+   the layer materials. It is spread over lateral spots, deposited with
+   ShowerDeposit as the steps are.
+ */
+class EMShowerModel : public G4VFastSimulationModel
+{
+public:
+  //parFile: shower parameters, "default" for the homogeneous values of the EE materials
+  EMShowerModel(G4Region* envelope, DetectorConstruction* detector,
+		const std::string & parFile, const G4double & minEnergy);
+  virtual ~EMShowerModel();
+
+  virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+  virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+  virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+  const HGCSSShowerParameters & parameters() const { return pars_; }
+
+private:
+  //radiation length of the elements of ShowerDeposit
+  struct Slab {
+    G4double X0;
+    //deposited energy per unit of shower energy
+    G4double weight;
+  };
+
+  void buildSlabs();
+  void depositShower(const G4Track* track, const G4double & energy);
+
+  DetectorConstruction *detector_;
+  ShowerDeposit deposit_;
+  HGCSSShowerParameters pars_;
+  G4double minEnergy_;
+  G4double moliereRadius_;
+  std::vector<Slab> slabs_;
+  //number of sensitive elements per section
+  std::vector<unsigned> nSens_;
+
+  //per shower
+  struct Segment {
+    unsigned slab;
+    G4double sFront,sBack;
+    G4double tFront,tBack;
+    G4double energy;
+  };
+  std::vector<Segment> segments_;
+  std::vector<G4double> sectionE_;
+};
+
+#endif
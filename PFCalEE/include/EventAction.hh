@@ -17,6 +17,7 @@
 #include "HGCSSSimHit.hh"
 #include "HGCSSGenParticle.hh"
 #include "HGCSSGeometryConversion.hh"
+#include "HGCSSHitColumns.hh"
 
 #include <vector>
 #include <map>
@@ -34,24 +35,43 @@ public:
   void EndOfEventAction(const G4Event*);
 
   void Detect(G4double edep, G4double stepl,G4double globalTime, G4int pdgId, 
-	      G4VPhysicalVolume *volume, const G4ThreeVector & position,
+	      const SamplingVolume *volume, const G4ThreeVector & position,
 	      G4int trackID, G4int parentID,
 	      const HGCSSGenParticle & genPart);
   
   //void Detect(G4double edep, G4double stepl,G4double globalTime, G4int pdgId, G4VPhysicalVolume *volume,int iyiz);
 
   void SetPrintModulo(G4int    val)  {printModulo = val;};
-  void Add( std::vector<SamplingSection> *newDetector ) { detector_=newDetector; }
+  //sum steps into cell simhits during stepping instead of storing every G4SiHit
+  void SetAggregateHits(G4bool val)  {aggregateHits_ = val;};
+  //write the simhits as one branch per field instead of object vectors
+  void SetColumnarOutput(G4bool val)  {columnarOutput_ = val;};
+  //in worker threads, the sampling sections are copied to have thread-local accumulators
+  void Add( std::vector<SamplingSection> *newDetector );
   //Float_t GetCellSize() { return cellSize_; }
 
   //std::ofstream & fout() {return fout_;}
 
-  bool isFirstVolume(const std::string volname) const;
+  bool isFirstVolume(const G4VPhysicalVolume* volume) const;
+
+  //output file name: PFcal.root, or one file per worker thread in MT mode
+  static std::string outputFileName(const G4int threadId=-1);
+  //merge the worker thread files into PFcal.root
+  static bool mergeOutputs(const unsigned nThreads);
 
 private:
+  //cell indexer used for the simhits of a given layer
+  const HGCSSCellIndexer* cellIndexer(const unsigned layer);
+  //simhit branches, booked at the first event once the format is known
+  void bookHitBranches();
+
   RunAction*  runAct;
   std::vector<SamplingSection> *detector_;
+  std::vector<SamplingSection> localDetector_;
   G4int     evtNb_,printModulo;
+  G4bool    aggregateHits_;
+  G4bool    columnarOutput_;
+  bool      hitBranchesBooked_;
 
   HGCSSGeometryConversion* geomConv_;
 
@@ -61,6 +81,8 @@ private:
   HGCSSSamplingSectionVec ssvec_;
   HGCSSSimHitVec hitvec_;
   HGCSSSimHitVec alhitvec_;
+  HGCSSSimHitColumns hitcols_;
+  HGCSSSimHitColumns alhitcols_;
   HGCSSGenParticleVec genvec_;
   EventActionMessenger*  eventMessenger;
   //std::ofstream fout_;
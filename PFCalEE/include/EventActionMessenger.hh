@@ -40,6 +40,7 @@
 class EventAction;
 class G4UIdirectory;
 class G4UIcmdWithAnInteger;
+class G4UIcmdWithABool;
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -55,6 +56,8 @@ private:
   EventAction*          eventAction;
   G4UIdirectory*        eventDir;   
   G4UIcmdWithAnInteger* PrintCmd;    
+  G4UIcmdWithABool*     AggregateCmd;
+  G4UIcmdWithABool*     ColumnarCmd;
 };
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,98 @@
+#ifndef FrozenShowerModel_h
+#define FrozenShowerModel_h 1
+
+#include "G4VFastSimulationModel.hh"
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <string>
+#include <vector>
+#include <map>
+#include <unordered_map>
+#include <fstream>
+
+#include "HGCSSShowerLibrary.hh"
+#include "ShowerDeposit.hh"
+
+class DetectorConstruction;
+class G4Region;
+class SamplingVolume;
+
+/**
+   @class FrozenShowerModel
+   @short frozen showers of low energy e+/e-/gamma (see HGCSSShowerLibrary)
+
+   With a library: e+/e-/gamma between the minimum and maximum energies
+   are killed, and the spots of a shower of their bin, drawn at random,
+   are deposited with ShowerDeposit. The spots are placed in the same
+   elements relative to the starting one, turned to the azimuth of the
+   particle and mirrored at random.
+   With a record file: nothing is killed, the deposits of the particles
+   starting in the envelope and of their descendants are summed in spots
+   and written at the end of each event, to be packed with
+   userlib/bin/buildShowerLibrary.
+ */
+class FrozenShowerModel : public G4VFastSimulationModel
+{
+public:
+  //libFile: library to use, or recordFile: showers to record
+  FrozenShowerModel(G4Region* envelope, DetectorConstruction* detector,
+		    const std::string & libFile, const std::string & recordFile,
+		    const G4double & minEnergy, const G4double & maxEnergy);
+  virtual ~FrozenShowerModel();
+
+  virtual G4bool IsApplicable(const G4ParticleDefinition& particle);
+  virtual G4bool ModelTrigger(const G4FastTrack& fastTrack);
+  virtual void DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep);
+
+  bool isRecording() const { return recordOut_.is_open(); }
+
+  //deposit of a step, called by the stepping action in record mode
+  void recordStep(const G4double & edep, const SamplingVolume* volume,
+		  const G4ThreeVector & position, const G4int trackID, const G4int parentID);
+
+  //record mode: write the showers of the event
+  void endOfEvent();
+
+private:
+  //azimuth of the direction, 0 if along z
+  static void transverseDirection(const G4ThreeVector & dir, G4double & cosPhi, G4double & sinPhi);
+
+  void stampShower(const G4Track* track, const unsigned libBin, const unsigned startElement);
+
+  DetectorConstruction *detector_;
+  ShowerDeposit deposit_;
+  G4double minEnergy_;
+  G4double maxEnergy_;
+
+  HGCSSShowerLibrary library_;
+  //library material of each element, -1 if none
+  std::vector<G4int> libMaterial_;
+  //bin and starting element found by ModelTrigger
+  G4int triggerBin_;
+  G4int triggerElement_;
+
+  //record mode
+  struct SpotSum {
+    G4double energy;
+    G4double x;
+    G4double y;
+    G4double depth;
+  };
+  struct Recording {
+    unsigned particle;
+    unsigned startElement;
+    G4double energy;
+    G4double cosTheta;
+    G4double depth;
+    G4ThreeVector origin;
+    G4double cosPhi,sinPhi;
+    std::map<uint64_t,SpotSum> spots;
+  };
+  std::ofstream recordOut_;
+  std::vector<Recording> recordings_;
+  //track -> recording of its ancestor
+  std::unordered_map<G4int,unsigned> trackRecording_;
+};
+
+#endif
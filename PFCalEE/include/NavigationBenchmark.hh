@@ -0,0 +1,29 @@
+#ifndef NavigationBenchmark_h
+#define NavigationBenchmark_h 1
+
+#include "globals.hh"
+
+class DetectorConstruction;
+
+/**
+   @class NavigationBenchmark
+   @short geometry navigation speed: straight rays through the calorimeter
+   with a G4Navigator, without physics (/N03/det/benchmarkNavigation).
+   Full section: rays from the origin in the eta acceptance,
+   other models: rays along z over the front face.
+ */
+class NavigationBenchmark
+{
+public:
+  NavigationBenchmark(DetectorConstruction* detector);
+  ~NavigationBenchmark(){};
+
+  //prints the number of steps per second
+  void run(const unsigned nRays, const unsigned seed=1234);
+
+private:
+  DetectorConstruction *detector_;
+
+};
+
+#endif
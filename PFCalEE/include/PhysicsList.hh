@@ -52,6 +52,8 @@ public:
   // Construct particle and physics
   //void ConstructParticle();
   //void ConstructProcess();
+  //adds the fast simulation process
+  void ConstructProcess();
  
   void SetCuts();
    
@@ -8,8 +8,38 @@
 
 #include <iomanip>
 #include <vector>
+#include <unordered_map>
 
 #include "G4SiHit.hh"
+#include "HGCSSSimHit.hh"
+
+//position of a physical volume in the calorimeter structure,
+//filled once at construction so that steps are routed
+//to their sampling section without any string comparison.
+class SamplingVolume{
+public:
+  SamplingVolume():
+    section(0),
+    element(0),
+    sensIdx(0),
+    isSensitive(false),
+    isScint(false),
+    isSupportCone(false)
+  {};
+  ~SamplingVolume(){};
+
+  unsigned section;
+  unsigned element;
+  unsigned sensIdx;
+  bool isSensitive;
+  bool isScint;
+  bool isSupportCone;
+};
+
+typedef std::unordered_map<const G4VPhysicalVolume*,SamplingVolume> SamplingVolumeMap;
+
+//simhits of one sensitive layer, keyed on cellid
+typedef std::unordered_map<unsigned,HGCSSSimHit> SimHitCellMap;
 
 class SamplingSection
 {
@@ -31,6 +61,7 @@ public:
     ele_X0.clear();
     ele_L0.clear();
     ele_vol.clear();
+    ele_zpos.clear();
     hasScintillator = false;
     for (unsigned ie(0);  ie<aThicknessVec.size(); ++ie){
       //consider only material with some non-0 width...
@@ -42,6 +73,7 @@ public:
 	ele_dEdx.push_back(0);
 	ele_L0.push_back(0);
 	ele_vol.push_back(0);
+	ele_zpos.push_back(0);
 	Total_thick+=aThicknessVec[ie];
 	++n_elements;
 	//the following method check the total size...
@@ -49,6 +81,8 @@ public:
 	if (isSensitiveElement(n_elements-1)) {
 	  G4SiHitVec lVec;
 	  sens_HitVec.push_back(lVec);
+	  SimHitCellMap lMap;
+	  sens_CellHitMap.push_back(lMap);
 	  ++n_sens_elements;
 	}
       }
@@ -72,13 +106,14 @@ public:
     }
   };
 
-  //
-  void add(G4double den, G4double dl, 
+  //if cellIndexer is given, sensitive steps are summed directly
+  //into simhits per cell instead of being stored as G4SiHits.
+  void add(const SamplingVolume & aVol,
+	   G4double den, G4double dl, 
 	   G4double globalTime,G4int pdgId,
-	   G4VPhysicalVolume* vol, 
 	   const G4ThreeVector & position,
 	   G4int trackID, G4int parentID,
-	   G4int layerId);
+	   const HGCSSCellIndexer* cellIndexer=0);
   
   inline bool isSensitiveElement(const unsigned & aEle){
     if (aEle < n_elements &&
@@ -136,6 +171,7 @@ public:
     sens_muFlux.resize(n_sens_elements,0);
     sens_neutronFlux.resize(n_sens_elements,0);
     sens_hadFlux.resize(n_sens_elements,0);
+    sens_nHits.resize(n_sens_elements,0);
     //reserve some space based on first event....
     for (unsigned idx(0); idx<n_sens_elements; ++idx){
       sens_time[idx]=0;
@@ -144,6 +180,8 @@ public:
       sens_muFlux[idx]=0;
       sens_neutronFlux[idx]=0;
       sens_hadFlux[idx]=0;
+      sens_nHits[idx]=0;
+      sens_CellHitMap[idx].clear();
       if (sens_HitVec[idx].size() > sens_HitVec_size_max) {
 	sens_HitVec_size_max = 2*sens_HitVec[idx].size();
 	G4cout << "-- SamplingSection::resetCounters(), space reserved for HitVec vector increased to " << sens_HitVec_size_max << G4endl;
@@ -177,6 +215,7 @@ public:
   G4double getTotalSensE();
 
   const G4SiHitVec & getSiHitVec(const unsigned & idx) const;
+  const SimHitCellMap & getCellHitMap(const unsigned & idx) const;
   const G4SiHitVec & getAlHitVec() const;
   void trackParticleHistory(const unsigned & idx,const G4SiHitVec & incoming);
 
@@ -195,11 +234,15 @@ public:
   std::vector<G4double>           ele_den;
   std::vector<G4double>           ele_dl;
   std::vector<G4VPhysicalVolume*> ele_vol;
+  //z of the element centre in the calorimeter world volume: ele_vol may be placed in a layer envelope
+  std::vector<G4double>           ele_zpos;
   G4VPhysicalVolume* supportcone_vol;
   G4VPhysicalVolume* dummylayer_vol;
   std::vector<G4double>           sens_gFlux, sens_eFlux, sens_muFlux, sens_neutronFlux, sens_hadFlux, sens_time;
   G4double Total_thick;
   std::vector<G4SiHitVec> sens_HitVec;
+  std::vector<SimHitCellMap> sens_CellHitMap;
+  std::vector<unsigned> sens_nHits;
   G4SiHitVec supportcone_HitVec;
   unsigned sens_HitVec_size_max;
   unsigned sc_HitVec_size_max;
@@ -0,0 +1,66 @@
+#ifndef ShowerDeposit_h
+#define ShowerDeposit_h 1
+
+#include "G4ThreeVector.hh"
+#include "globals.hh"
+
+#include <vector>
+
+#include "HGCSSGenParticle.hh"
+
+class DetectorConstruction;
+class EventAction;
+class G4Navigator;
+class G4Track;
+class SamplingVolume;
+
+/**
+   @class ShowerDeposit
+   @short energy spots of the fast simulation models (EMShowerModel, FrozenShowerModel)
+
+   Elements of the calorimeter structure along z, and deposit of energy
+   spots in them through EventAction::Detect as the steps do, so that the
+   sampling sections, G4SiHits and simhits are filled as in the full
+   simulation.
+ */
+class ShowerDeposit
+{
+public:
+  //one element of the calorimeter structure, sector 0, global z
+  struct Element {
+    G4double zFront;
+    G4double zBack;
+    unsigned section;
+    unsigned element;
+    bool isSensitive;
+  };
+
+  ShowerDeposit(DetectorConstruction* detector);
+  ~ShowerDeposit();
+
+  //mixed and scintillator layers are placed again at the same z: the
+  //depth is only followed through the first stack of sections.
+  const std::vector<Element> & elements() const { return elements_; }
+
+  //index in elements() of a part of the calorimeter structure, -1 if not followed
+  G4int elementIndex(const SamplingVolume* volume) const;
+  G4int elementIndex(const unsigned section, const unsigned element) const;
+
+  //deposit a spot if it falls in element iE: false if lost in a crack,
+  //dead material or outside of the acceptance
+  bool deposit(const unsigned iE, const G4double & energy,
+	       const G4ThreeVector & position, const G4double & time,
+	       const G4Track* track);
+
+private:
+  DetectorConstruction *detector_;
+  EventAction *eventAction_;
+  G4Navigator *navigator_;
+  std::vector<Element> elements_;
+  //first element of each section, -1 if not followed
+  std::vector<G4int> firstElement_;
+  //no truth particle is recorded for the spots
+  const HGCSSGenParticle genPart_;
+};
+
+#endif
@@ -0,0 +1,90 @@
+#ifndef StackingAction_h
+#define StackingAction_h 1
+
+#include "G4UserStackingAction.hh"
+#include "globals.hh"
+
+#include <vector>
+
+class DetectorConstruction;
+class StackingActionMessenger;
+class G4Region;
+class G4Step;
+
+/**
+   @class StackingAction
+   @short track kill policies, all disabled by default (/N03/stack/ commands)
+
+   - time window: tracks beyond a global time are killed, when stacked and
+     while stepping;
+   - slow neutrons: neutrons below an energy created in an absorber are killed;
+   - backward: tracks upstream of the calorimeter front face and moving
+     away from it are killed, when stacked and when leaving (not for use
+     with a magnetic field);
+   - waiting regions: tracks created in these regions are postponed to the
+     waiting stage, which can be dropped.
+   Killed tracks are counted per policy, with an estimate of the CPU time
+   saved (number of tracks killed times the mean CPU time per tracked
+   track, secondaries of the killed tracks not included), reported at the
+   end of the run for all threads.
+ */
+class StackingAction : public G4UserStackingAction
+{
+public:
+  enum Policy {
+    TimeWindow=0,
+    SlowNeutrons=1,
+    Backward=2,
+    WaitingDropped=3,
+    nPolicies=4
+  };
+
+  StackingAction();
+  virtual ~StackingAction();
+
+  virtual G4ClassificationOfNewTrack ClassifyNewTrack(const G4Track* aTrack);
+  virtual void NewStage();
+  virtual void PrepareNewEvent();
+
+  //0 to disable
+  void SetTimeWindow(G4double time) { timeWindow_ = time; }
+  void SetNeutronMinEnergy(G4double energy) { neutronMinE_ = energy; }
+  void SetKillBackward(G4bool kill) { killBackward_ = kill; }
+  void AddWaitingRegion(G4String name);
+  void SetDropWaiting(G4bool drop) { dropWaiting_ = drop; }
+
+  //time window and backward policies for tracks already stacked:
+  //true if the track was killed in this step
+  bool killInStep(const G4Step* aStep);
+
+  void beginOfRun();
+  //add the counters of this thread to the run totals
+  void endOfRun();
+  //print the run totals and reset them
+  static void report();
+
+private:
+  static const char* policyName(const unsigned aPolicy);
+
+  DetectorConstruction *detector_;
+  StackingActionMessenger *messenger_;
+
+  G4double timeWindow_;
+  G4double neutronMinE_;
+  G4bool killBackward_;
+  G4bool dropWaiting_;
+  std::vector<G4String> waitingNames_;
+  std::vector<const G4Region*> waitingRegions_;
+  //global z of the calorimeter front face
+  G4double frontZ_;
+
+  //this thread, current run
+  unsigned nKilled_[nPolicies];
+  unsigned nTracked_;
+  unsigned nWaiting_;
+  //CPU time of this thread at the start of the run, s
+  double cpuStart_;
+
+};
+
+#endif
@@ -0,0 +1,35 @@
+#ifndef StackingActionMessenger_h
+#define StackingActionMessenger_h 1
+
+#include "globals.hh"
+#include "G4UImessenger.hh"
+
+class StackingAction;
+class G4UIdirectory;
+class G4UIcmdWithAString;
+class G4UIcmdWithABool;
+class G4UIcmdWithADoubleAndUnit;
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+class StackingActionMessenger: public G4UImessenger
+{
+public:
+  StackingActionMessenger(StackingAction*);
+  virtual ~StackingActionMessenger();
+
+  void SetNewValue(G4UIcommand*, G4String);
+
+private:
+  StackingAction*            stackingAction;
+  G4UIdirectory*             stackDir;
+  G4UIcmdWithADoubleAndUnit* TimeWindowCmd;
+  G4UIcmdWithADoubleAndUnit* NeutronMinECmd;
+  G4UIcmdWithABool*          BackwardCmd;
+  G4UIcmdWithAString*        WaitingRegionCmd;
+  G4UIcmdWithABool*          DropWaitingCmd;
+};
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+#endif
@@ -5,6 +5,8 @@
 #include "G4EmSaturation.hh"
 
 class EventAction;
+class DetectorConstruction;
+class StackingAction;
 
 class SteppingAction : public G4UserSteppingAction
 {
@@ -16,6 +18,8 @@ public:
     
 private:
   EventAction *eventAction_;  
+  DetectorConstruction *detector_;
+  StackingAction *stackingAction_;
   //to correct the energy in the scintillator
   G4EmSaturation* saturationEngine;
   G4double timeLimit_;
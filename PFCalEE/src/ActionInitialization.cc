@@ -0,0 +1,46 @@
+#ifdef G4MULTITHREADED
+
+#include "ActionInitialization.hh"
+
+#include "PrimaryGeneratorAction.hh"
+#include "RunAction.hh"
+#include "EventAction.hh"
+#include "StackingAction.hh"
+#include "SteppingAction.hh"
+#include "SteppingVerbose.hh"
+
+//
+ActionInitialization::ActionInitialization(G4int model, G4double eta):
+  G4VUserActionInitialization(),
+  model_(model),
+  eta_(eta)
+{}
+
+//
+ActionInitialization::~ActionInitialization()
+{}
+
+//
+void ActionInitialization::BuildForMaster() const
+{
+  SetUserAction(new RunAction);
+}
+
+//
+void ActionInitialization::Build() const
+{
+  SetUserAction(new PrimaryGeneratorAction(model_,eta_));
+  SetUserAction(new RunAction);
+  //event and stacking actions first: the stepping action retrieves them from the run manager.
+  SetUserAction(new EventAction);
+  SetUserAction(new StackingAction);
+  SetUserAction(new SteppingAction);
+}
+
+//
+G4VSteppingVerbose* ActionInitialization::InitializeSteppingVerbose() const
+{
+  return new SteppingVerbose;
+}
+
+#endif
@@ -1,9 +1,12 @@
 #include "DetectorConstruction.hh"
 #include "DetectorMessenger.hh"
+#include "EMShowerModel.hh"
+#include "FrozenShowerModel.hh"
 
 #include "HGCSSSimHit.hh"
 
 #include <boost/algorithm/string.hpp>
+#include <algorithm>
 
 #include "G4Material.hh"
 #include "G4NistManager.hh"
@@ -11,6 +14,7 @@
 #include "G4Box.hh"
 #include "G4Tubs.hh"
 #include "G4Polyhedra.hh"
+#include "G4Polycone.hh"
 #include "G4LogicalVolume.hh"
 #include "G4PVPlacement.hh"
 #include "G4PVReplica.hh"
@@ -26,17 +30,35 @@
 #include "G4FieldManager.hh"
 #include "G4TransportationManager.hh"
 #include "G4PhysicalConstants.hh"
+#include "G4Region.hh"
+#include "G4RunManager.hh"
 
 using namespace std;
 
+namespace {
+  //fast simulation models are per thread
+#ifdef G4MULTITHREADED
+  G4ThreadLocal EMShowerModel *emShowerModel = 0;
+  G4ThreadLocal FrozenShowerModel *frozenShowerModel = 0;
+#else
+  EMShowerModel *emShowerModel = 0;
+  FrozenShowerModel *frozenShowerModel = 0;
+#endif
+}
+
 //
 DetectorConstruction::DetectorConstruction(G4int ver, G4int mod,
 					   G4int shape,
 					   std::string absThickW,
 					   std::string absThickPb,
-					   std::string dropLayer) : 
-  version_(ver), model_(mod), shape_(shape), addPrePCB_(false)
+					   std::string dropLayer,
+					   bool nestedLayers) : 
+  version_(ver), model_(mod), shape_(shape), addPrePCB_(false), nestedLayers_(nestedLayers)
 {
+  m_eeRegion = 0;
+  fastShowerMinE_ = 1*GeV;
+  frozenShowerMinE_ = 10*MeV;
+  frozenShowerMaxE_ = 1*GeV;
 
   doHF_ = false;
   doUPS_ = false;
@@ -712,6 +734,14 @@ DetectorConstruction::DetectorConstruction(G4int ver, G4int mod,
       }
 
     }
+
+  m_nEELayers = 0;
+  for (; m_nEELayers<m_caloStruct.size(); ++m_nEELayers){
+    const std::vector<std::string> & lNames = m_caloStruct[m_nEELayers].ele_name;
+    if (std::find(lNames.begin(),lNames.end(),"W")==lNames.end() &&
+	std::find(lNames.begin(),lNames.end(),"WCu")==lNames.end() &&
+	std::find(lNames.begin(),lNames.end(),"Pb")==lNames.end()) break;
+  }
   
   DefineMaterials();
   SetMagField(0);
@@ -1322,6 +1352,7 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   G4PhysicalVolumeStore::GetInstance()->Clean();
   G4LogicalVolumeStore::GetInstance()->Clean();
   G4SolidStore::GetInstance()->Clean();
+  m_volumeMap.clear();
 
   //world
   G4double expHall_z = model_ == DetectorConstruction::m_2016TB? 0.5*m : 14*m;
@@ -1361,6 +1392,9 @@ G4VPhysicalVolume* DetectorConstruction::Construct()
   m_logicWorld = new G4LogicalVolume(m_solidWorld, m_materials["Air"], "Wlog");
   m_physWorld = new G4PVPlacement(0, G4ThreeVector(pos_x,pos_y,pos_z), m_logicWorld, "Wphys", experimentalHall_log, false, 0);
 
+  //filled by buildSectorStack, default cuts
+  m_eeRegion = new G4Region("EEShowerReg");
+
   for (unsigned iS(0); iS<m_nSectors; ++iS){
     G4double minL = m_sectorWidth*iS;
     buildSectorStack(iS,minL,m_sectorWidth-m_interSectorWidth);
@@ -1415,6 +1449,21 @@ void DetectorConstruction::buildSectorStack(const unsigned sectorNum,
       //index for counting Si sensitive layers
       unsigned idx = 0;
       double totalThicknessLayer = 0;
+
+      //elements of a layer in an envelope, to keep few daughters per volume for the navigation
+      G4double xpvpos = -m_CalorSizeXY/2.+minL+width/2+crackOffset;
+      if (model_ == DetectorConstruction::m_FULLSECTION) xpvpos=0;
+      G4LogicalVolume *mother = m_logicWorld;
+      G4ThreeVector motherPos(0,0,0);
+      if (nestedLayers()) {
+	sprintf(nameBuf,"Layer%d",int(i+1));
+	std::string envName(nameBuf);
+	G4VSolid *envelope = constructLayerEnvelope(i,envName,zOffset+zOverburden,angOffset+minL,width,i>=firstHFlayer_);
+	mother = new G4LogicalVolume(envelope, m_materials["Air"], envName+"log");
+	mother->SetVisAttributes(G4VisAttributes::Invisible);
+	motherPos = G4ThreeVector(xpvpos,0.,zOffset+zOverburden+m_caloStruct[i].Total_thick/2);
+	new G4PVPlacement(0, motherPos, mother, envName+"phys", m_logicWorld, false, 0);
+      }
       for (unsigned ie(0); ie<nEle;++ie){
 	std::string eleName = m_caloStruct[i].ele_name[ie];
 	if (m_nSectors==1) sprintf(nameBuf,"%s%d",eleName.c_str(),int(i+1));
@@ -1469,16 +1518,22 @@ void DetectorConstruction::buildSectorStack(const unsigned sectorNum,
 	    //if (i==m_caloStruct.size()-1 && version_ == v_HGCALHF) m_logicSi.push_back(logi);
 	  }
 	  
-	  G4double xpvpos = -m_CalorSizeXY/2.+minL+width/2+crackOffset;
-	  if (model_ == DetectorConstruction::m_FULLSECTION) xpvpos=0;
 #if 0
 	  cout << "m_caloStruct[i].ele_vol[nEle*sectorNum+ie]=new G4PVPlacement(0, G4ThreeVector(xpvpos="<<xpvpos
 	       << ",0.,zOffset+zOverburden+thick/2="<<zOffset+zOverburden+thick/2
 	       << "), logi,"
 	       << baseName+"phys, m_logicWorld, false, 0);" << endl;
 #endif
+	  m_caloStruct[i].ele_zpos[ie] = zOffset+zOverburden+thick/2;
 	  m_caloStruct[i].ele_vol[nEle*sectorNum+ie]=
-	    new G4PVPlacement(0, G4ThreeVector(xpvpos,0.,zOffset+zOverburden+thick/2), logi, baseName+"phys", m_logicWorld, false, 0);
+	    new G4PVPlacement(0, G4ThreeVector(xpvpos,0.,zOffset+zOverburden+thick/2)-motherPos, logi, baseName+"phys", mother, false, 0);
+	  SamplingVolume lVol;
+	  lVol.section = i;
+	  lVol.element = ie;
+	  lVol.isSensitive = m_caloStruct[i].isSensitiveElement(ie);
+	  if (lVol.isSensitive) lVol.sensIdx = m_caloStruct[i].getSensitiveLayerIndex(baseName+"phys");
+	  lVol.isScint = eleName=="Scintillator";
+	  m_volumeMap[m_caloStruct[i].ele_vol[nEle*sectorNum+ie]] = lVol;
 	  //std::cout << " **** positionning layer " <<  m_caloStruct[i].ele_vol[nEle*sectorNum+ie]->GetName() << " at " << xpvpos << " 0 " << zOffset+zOverburden+thick/2 << std::endl;
  
 	  G4VisAttributes *simpleBoxVisAtt= new G4VisAttributes(m_caloStruct[i].g4Colour(ie));
@@ -1494,6 +1549,7 @@ void DetectorConstruction::buildSectorStack(const unsigned sectorNum,
 	    m_logicSi[nlogicsi-1]->SetRegion(aRegion);
 	    aRegion->AddRootLogicalVolume(m_logicSi[nlogicsi-1]);
 	  }
+	  else if (i<m_nEELayers) m_eeRegion->AddRootLogicalVolume(logi);
 	}
 
       }//loop on elements
@@ -1521,10 +1577,12 @@ void DetectorConstruction::buildSectorStack(const unsigned sectorNum,
 	supportcone = constructSupportCone(baseName,totalThicknessLayer,zOffset+zOverburden-totalThicknessLayer,angOffset+minL,width+extraWidth);
 	G4LogicalVolume *logi = new G4LogicalVolume(supportcone, m_materials["Al"], baseName+"log");
 	m_logicAl.push_back(logi);
-	G4double xpvpos = -m_CalorSizeXY/2.+minL+width/2+crackOffset;
-	if (model_ == DetectorConstruction::m_FULLSECTION) xpvpos=0;
 	m_caloStruct[i].supportcone_vol=
 	new G4PVPlacement(0, G4ThreeVector(xpvpos,0.,zOffset+zOverburden-totalThicknessLayer/2), logi, baseName+"phys", m_logicWorld, false, 0);
+	SamplingVolume lVol;
+	lVol.section = i;
+	lVol.isSupportCone = true;
+	m_volumeMap[m_caloStruct[i].supportcone_vol] = lVol;
 	G4VisAttributes *simpleBoxVisAtt= new G4VisAttributes(G4Colour::Red());
 	simpleBoxVisAtt->SetVisibility(true);
 	logi->SetVisAttributes(simpleBoxVisAtt);
@@ -1647,6 +1705,50 @@ void DetectorConstruction::SetMagField(G4double fieldValue)
   fieldMgr->SetDetectorField(m_magField);  
 }
 
+void DetectorConstruction::SetFastShower(std::string parFile)
+{
+  fastShowerFile_ = parFile;
+#ifdef G4MULTITHREADED
+  //the workers build their model in ConstructSDandField
+  if (G4RunManager::GetRunManager()->GetRunManagerType() == G4RunManager::masterRM) return;
+#endif
+  buildFastShowerModel();
+}
+
+void DetectorConstruction::SetFrozenShowers(std::string libFile, std::string recordFile)
+{
+  frozenShowerLib_ = libFile;
+  frozenShowerRecord_ = recordFile;
+#ifdef G4MULTITHREADED
+  if (G4RunManager::GetRunManager()->GetRunManagerType() == G4RunManager::masterRM) return;
+#endif
+  buildFrozenShowerModel();
+}
+
+FrozenShowerModel* DetectorConstruction::getFrozenShowerModel() const
+{
+  return frozenShowerModel;
+}
+
+void DetectorConstruction::ConstructSDandField()
+{
+  if (fastShowerFile_.size()>0) buildFastShowerModel();
+  if (frozenShowerLib_.size()>0 || frozenShowerRecord_.size()>0) buildFrozenShowerModel();
+}
+
+void DetectorConstruction::buildFastShowerModel()
+{
+  if (emShowerModel || !m_eeRegion) return;
+  std::cout << " -- Parametrised EM showers in the EE above " << fastShowerMinE_/GeV << " GeV, parameters: " << fastShowerFile_ << std::endl;
+  emShowerModel = new EMShowerModel(m_eeRegion,this,fastShowerFile_,fastShowerMinE_);
+}
+
+void DetectorConstruction::buildFrozenShowerModel()
+{
+  if (frozenShowerModel || !m_eeRegion) return;
+  frozenShowerModel = new FrozenShowerModel(m_eeRegion,this,frozenShowerLib_,frozenShowerRecord_,frozenShowerMinE_,frozenShowerMaxE_);
+}
+
 void DetectorConstruction::SetDetModel(G4int model)
 {
   if (model <= 0) return;
@@ -1725,14 +1827,40 @@ G4VSolid *DetectorConstruction::constructSolid (std::string baseName, G4double t
   
   G4VSolid *solid=0;
   if (model_ == DetectorConstruction::m_FULLSECTION){
-    double minR = tan(2*atan(exp(-etamax)))*(zpos+m_z0pos+m_CalorSizeZ/2);
-    double maxR = tan(2*atan(exp(-etamin)))*(zpos+m_z0pos+m_CalorSizeZ/2);
+    double minR = getRadiusFromEtaZ(etamax,zpos);
+    double maxR = getRadiusFromEtaZ(etamin,zpos);
     //std::cout << " zpos = " << zpos+m_z0pos+m_CalorSizeZ/2 << " radius range " << minR << " " << maxR << std::endl;
     solid = new G4Tubs(baseName+"box",minR,maxR,thick/2,minL,width); 
   }
   return solid;
 }
 
+G4VSolid *DetectorConstruction::constructLayerEnvelope (const unsigned layer, std::string baseName, G4double zpos,const G4double & minL, const G4double & width, const bool isHF){
+
+  SamplingSection & lSec = m_caloStruct[layer];
+  if (model_ != DetectorConstruction::m_FULLSECTION) return constructSolid(layer,baseName,lSec.Total_thick,zpos,minL,width,isHF);
+
+  //the radii of each element follow the eta range at its front face:
+  //one step of a polycone per element, with the same radii as constructSolid
+  const double etamin = isHF ? m_minEtaHF : m_minEta[layer];
+  const double etamax = isHF ? m_maxEtaHF : m_maxEta[layer];
+  const unsigned nPlanes = 2*lSec.n_elements;
+  std::vector<G4double> zPlane(nPlanes,0), rInner(nPlanes,0), rOuter(nPlanes,0);
+  G4double zEle = zpos;
+  for (unsigned ie(0); ie<lSec.n_elements; ++ie){
+    zPlane[2*ie] = zEle-zpos-lSec.Total_thick/2;
+    zPlane[2*ie+1] = zPlane[2*ie]+lSec.ele_thick[ie];
+    rInner[2*ie] = rInner[2*ie+1] = getRadiusFromEtaZ(etamax,zEle);
+    rOuter[2*ie] = rOuter[2*ie+1] = getRadiusFromEtaZ(etamin,zEle);
+    zEle += lSec.ele_thick[ie];
+  }
+  return new G4Polycone(baseName+"cone",minL,width,nPlanes,&zPlane[0],&rInner[0],&rOuter[0]);
+}
+
+double DetectorConstruction::getRadiusFromEtaZ(const double & eta, const double & zpos){
+  return tan(2*atan(exp(-eta)))*(zpos+m_z0pos+m_CalorSizeZ/2);
+}
+
 G4VSolid *DetectorConstruction::constructSupportCone (std::string baseName, G4double thick, G4double zpos,const G4double & minL, const G4double & width){
 
  return constructSupportCone(baseName,thick,zpos,minL,width,3.00,3.05);
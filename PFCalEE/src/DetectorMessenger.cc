@@ -34,6 +34,7 @@
 #include "DetectorMessenger.hh"
 
 #include "DetectorConstruction.hh"
+#include "NavigationBenchmark.hh"
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAString.hh"
 #include "G4UIcmdWithAnInteger.hh"
@@ -65,6 +66,55 @@ DetectorMessenger::DetectorMessenger(
   SetModelCmd->SetDefaultValue(0);
   SetModelCmd->AvailableForStates(G4State_PreInit,G4State_Idle);  
 
+  FastShowerCmd = new G4UIcmdWithAString("/N03/det/fastShower",this);
+  FastShowerCmd->SetGuidance("Parametrised EM showers in the EE: shower parameter file, or default.");
+  FastShowerCmd->SetGuidance("Before the first run, after fastShowerMinEnergy.");
+  FastShowerCmd->SetParameterName("ParFile",true);
+  FastShowerCmd->SetDefaultValue("default");
+  FastShowerCmd->AvailableForStates(G4State_Idle);
+
+  FastShowerMinECmd = new G4UIcmdWithADoubleAndUnit("/N03/det/fastShowerMinEnergy",this);
+  FastShowerMinECmd->SetGuidance("Minimum energy of the parametrised EM showers.");
+  FastShowerMinECmd->SetParameterName("Emin",false);
+  FastShowerMinECmd->SetUnitCategory("Energy");
+  FastShowerMinECmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FrozenShowerLibCmd = new G4UIcmdWithAString("/N03/det/frozenShowerLibrary",this);
+  FrozenShowerLibCmd->SetGuidance("Frozen showers in the EE for low energy e+/e-/gamma: library file (.shlib).");
+  FrozenShowerLibCmd->SetGuidance("Before the first run, after the frozenShower energies.");
+  FrozenShowerLibCmd->SetParameterName("LibFile",false);
+  FrozenShowerLibCmd->AvailableForStates(G4State_Idle);
+
+  FrozenShowerRecordCmd = new G4UIcmdWithAString("/N03/det/frozenShowerRecord",this);
+  FrozenShowerRecordCmd->SetGuidance("Record the showers of low energy e+/e-/gamma in the EE for a frozen shower library.");
+  FrozenShowerRecordCmd->SetGuidance("Before the first run, after the frozenShower energies.");
+  FrozenShowerRecordCmd->SetParameterName("RecordFile",false);
+  FrozenShowerRecordCmd->AvailableForStates(G4State_Idle);
+
+  FrozenShowerMinECmd = new G4UIcmdWithADoubleAndUnit("/N03/det/frozenShowerMinEnergy",this);
+  FrozenShowerMinECmd->SetGuidance("Minimum energy of the frozen showers.");
+  FrozenShowerMinECmd->SetParameterName("Emin",false);
+  FrozenShowerMinECmd->SetUnitCategory("Energy");
+  FrozenShowerMinECmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  FrozenShowerMaxECmd = new G4UIcmdWithADoubleAndUnit("/N03/det/frozenShowerMaxEnergy",this);
+  FrozenShowerMaxECmd->SetGuidance("Maximum energy of the frozen showers.");
+  FrozenShowerMaxECmd->SetParameterName("Emax",false);
+  FrozenShowerMaxECmd->SetUnitCategory("Energy");
+  FrozenShowerMaxECmd->AvailableForStates(G4State_PreInit,G4State_Idle);
+
+  BenchmarkNavCmd = new G4UIcmdWithAnInteger("/N03/det/benchmarkNavigation",this);
+  BenchmarkNavCmd->SetGuidance("Navigation steps/s for straight rays through the geometry, without physics.");
+  BenchmarkNavCmd->SetGuidance("The layer layout (nested or flat) is the 10th argument of PFCalEE.");
+  BenchmarkNavCmd->SetParameterName("NRays",true);
+  BenchmarkNavCmd->SetDefaultValue(10000);
+  BenchmarkNavCmd->SetRange("NRays>0");
+  BenchmarkNavCmd->AvailableForStates(G4State_Idle);
+#ifdef G4MULTITHREADED
+  //on the master geometry only
+  BenchmarkNavCmd->SetToBeBroadcasted(false);
+#endif
+
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -73,6 +123,13 @@ DetectorMessenger::~DetectorMessenger()
 {
   delete MagFieldCmd;
   delete SetModelCmd;
+  delete FastShowerCmd;
+  delete FastShowerMinECmd;
+  delete FrozenShowerLibCmd;
+  delete FrozenShowerRecordCmd;
+  delete FrozenShowerMinECmd;
+  delete FrozenShowerMaxECmd;
+  delete BenchmarkNavCmd;
   delete detDir;
   delete N03Dir;  
 }
@@ -85,6 +142,20 @@ void DetectorMessenger::SetNewValue(G4UIcommand* command,G4String newValue)
    { Detector->SetMagField(MagFieldCmd->GetNewDoubleValue(newValue));}
   if (command == SetModelCmd )
     { Detector->SetDetModel(SetModelCmd->GetNewIntValue(newValue));}
+  if (command == FastShowerCmd )
+    { Detector->SetFastShower(newValue);}
+  if (command == FastShowerMinECmd )
+    { Detector->SetFastShowerMinEnergy(FastShowerMinECmd->GetNewDoubleValue(newValue));}
+  if (command == FrozenShowerLibCmd )
+    { Detector->SetFrozenShowers(newValue,"");}
+  if (command == FrozenShowerRecordCmd )
+    { Detector->SetFrozenShowers("",newValue);}
+  if (command == FrozenShowerMinECmd )
+    { Detector->SetFrozenShowerMinEnergy(FrozenShowerMinECmd->GetNewDoubleValue(newValue));}
+  if (command == FrozenShowerMaxECmd )
+    { Detector->SetFrozenShowerMaxEnergy(FrozenShowerMaxECmd->GetNewDoubleValue(newValue));}
+  if (command == BenchmarkNavCmd )
+    { NavigationBenchmark lBench(Detector); lBench.run(BenchmarkNavCmd->GetNewIntValue(newValue));}
 
 }
 
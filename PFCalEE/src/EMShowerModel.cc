@@ -0,0 +1,235 @@
+#include "EMShowerModel.hh"
+
+#include "DetectorConstruction.hh"
+
+#include "G4Track.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4Material.hh"
+#include "G4Element.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+
+#include <cmath>
+#include <algorithm>
+
+namespace {
+  //only showers going downstream
+  const G4double minCosTheta = 0.5;
+  //lateral spots further than this many Moliere radii are resampled
+  const G4double maxRadius = 10.;
+  //fewer spots in the absorbers, only their total energy is recorded
+  const G4double absorberSpotFraction = 0.1;
+}
+
+//
+EMShowerModel::EMShowerModel(G4Region* envelope, DetectorConstruction* detector,
+			     const std::string & parFile, const G4double & minEnergy):
+  G4VFastSimulationModel("EMShowerModel",envelope),
+  detector_(detector),
+  deposit_(detector),
+  minEnergy_(minEnergy),
+  moliereRadius_(0)
+{
+  buildSlabs();
+  if (parFile != "default" && !pars_.read(parFile)) {
+    G4cout << " -- ERROR in EMShowerModel: cannot read shower parameters from " << parFile << ". Exiting..." << G4endl;
+    exit(1);
+  }
+  if (pars_.get(HGCSSShowerParameters::moliereRadius)>0) moliereRadius_ = pars_.get(HGCSSShowerParameters::moliereRadius)*mm;
+  G4cout << " -- EMShowerModel: EE showers above " << minEnergy_/GeV << " GeV, Moliere radius " << moliereRadius_/mm << " mm" << G4endl;
+  pars_.Print(G4cout);
+}
+
+//
+EMShowerModel::~EMShowerModel()
+{
+}
+
+//
+void EMShowerModel::buildSlabs()
+{
+  std::vector<SamplingSection> & lStruct = *(detector_->getStructure());
+  const std::vector<ShowerDeposit::Element> & lElements = deposit_.elements();
+  const unsigned nEE = detector_->getNEELayers();
+
+  //effective EE quantities, thickness weighted: X0, critical
+  //energy (Ec/X0 averaged), Moliere radius (1/RM averaged), and
+  //mass weighted Z
+  G4double sumThick = 0, sumX0 = 0, sumEcX0 = 0, sumInvRM = 0, sumMass = 0, sumZMass = 0;
+
+  //mip-like energy per X0 in each section
+  std::vector<G4double> dEdxPerX0(lStruct.size(),0);
+  nSens_.assign(lStruct.size(),0);
+  for (unsigned i(0); i<lStruct.size(); ++i){
+    SamplingSection & lSec = lStruct[i];
+    G4double dEdxSum = 0, X0Sum = 0;
+    for (unsigned ie(0); ie<lSec.n_elements; ++ie){
+      dEdxSum += lSec.ele_thick[ie]*lSec.ele_dEdx[ie];
+      X0Sum += lSec.ele_thick[ie]/lSec.ele_X0[ie];
+      if (lSec.isSensitiveElement(ie)) ++nSens_[i];
+    }
+    if (X0Sum>0) dEdxPerX0[i] = dEdxSum/X0Sum;
+  }
+
+  slabs_.clear();
+  for (unsigned iS(0); iS<lElements.size(); ++iS){
+    const unsigned i = lElements[iS].section;
+    const unsigned ie = lElements[iS].element;
+    SamplingSection & lSec = lStruct[i];
+    Slab lSlab;
+    lSlab.X0 = lSec.ele_X0[ie];
+    lSlab.weight = dEdxPerX0[i]>0 ? lSec.ele_X0[ie]*lSec.ele_dEdx[ie]/dEdxPerX0[i] : 0;
+    slabs_.push_back(lSlab);
+
+    if (i>=nEE) continue;
+    const G4Material *lMat = detector_->m_materials[lSec.ele_name[ie]];
+    const G4double *lFrac = lMat->GetFractionVector();
+    G4double lZ = 0;
+    for (unsigned iEl(0); iEl<lMat->GetNumberOfElements(); ++iEl){
+      lZ += lFrac[iEl]*(*lMat->GetElementVector())[iEl]->GetZ();
+    }
+    const G4double lEc = 610*MeV/(lZ+1.24);
+    const G4double lThick = lSec.ele_thick[ie];
+    sumThick += lThick;
+    sumX0 += lThick/lMat->GetRadlen();
+    sumEcX0 += lThick*lEc/lMat->GetRadlen();
+    sumInvRM += lThick*lEc/(21.2*MeV*lMat->GetRadlen());
+    sumMass += lThick*lMat->GetDensity();
+    sumZMass += lThick*lMat->GetDensity()*lZ;
+  }
+
+  if (sumThick<=0) {
+    G4cout << " -- ERROR in EMShowerModel: no EE layer found. Exiting..." << G4endl;
+    exit(1);
+  }
+  const G4double lX0 = sumThick/sumX0;
+  const G4double lEc = lX0*sumEcX0/sumThick;
+  const G4double lZ = sumZMass/sumMass;
+  moliereRadius_ = sumThick/sumInvRM;
+  G4cout << " -- EMShowerModel: EE effective X0=" << lX0/mm << " mm Ec=" << lEc/MeV << " MeV Z=" << lZ
+	 << " RM=" << moliereRadius_/mm << " mm, depth followed through " << slabs_.size() << " elements" << G4endl;
+  pars_.setDefaults(lZ,lEc/MeV);
+}
+
+//
+G4bool EMShowerModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4Electron::ElectronDefinition() ||
+    &particle == G4Positron::PositronDefinition() ||
+    &particle == G4Gamma::GammaDefinition();
+}
+
+//
+G4bool EMShowerModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  const G4Track *lTrack = fastTrack.GetPrimaryTrack();
+  return lTrack->GetKineticEnergy() > minEnergy_ &&
+    lTrack->GetMomentumDirection().z() > minCosTheta;
+}
+
+//
+void EMShowerModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  const G4Track *lTrack = fastTrack.GetPrimaryTrack();
+  G4double energy = lTrack->GetKineticEnergy();
+  if (lTrack->GetDefinition() == G4Positron::PositronDefinition()) energy += 2*electron_mass_c2;
+
+  //the energy goes through the event action spot by spot: not proposed
+  //as energy of this step, which the stepping action would record too.
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+
+  depositShower(lTrack,energy);
+}
+
+//
+void EMShowerModel::depositShower(const G4Track* track, const G4double & energy)
+{
+  const G4ThreeVector & origin = track->GetPosition();
+  const G4ThreeVector & axis = track->GetMomentumDirection();
+  const G4double lnE = log(energy/GeV);
+
+  //shower maximum T and shape alpha, correlated fluctuations
+  const G4double g1 = G4RandGauss::shoot();
+  const G4double g2 = G4RandGauss::shoot();
+  const G4double rho = pars_.correlation(lnE);
+  const G4double T = exp(pars_.meanLnT(lnE)+pars_.sigmaLnT(lnE)*g1);
+  const G4double alpha = std::max(exp(pars_.meanLnAlpha(lnE)+pars_.sigmaLnAlpha(lnE)*(rho*g1+sqrt(1-rho*rho)*g2)),1.1);
+  const G4double beta = (alpha-1)/T;
+
+  //shower energy of each element crossed by the axis
+  segments_.clear();
+  sectionE_.assign(nSens_.size(),0);
+  G4double t = 0, lastCDF = 0;
+  const std::vector<ShowerDeposit::Element> & lElements = deposit_.elements();
+  for (unsigned iS(0); iS<slabs_.size(); ++iS){
+    const Slab & lSlab = slabs_[iS];
+    const G4double sBack = (lElements[iS].zBack-origin.z())/axis.z();
+    if (sBack<=0) continue;
+    Segment lSeg;
+    lSeg.slab = iS;
+    lSeg.sFront = std::max((lElements[iS].zFront-origin.z())/axis.z(),0.);
+    lSeg.sBack = sBack;
+    lSeg.tFront = t;
+    t += (lSeg.sBack-lSeg.sFront)/lSlab.X0;
+    lSeg.tBack = t;
+    const G4double lCDF = HGCSSShowerParameters::gammaCDF(alpha,beta*t);
+    lSeg.energy = energy*(lCDF-lastCDF);
+    lastCDF = lCDF;
+    segments_.push_back(lSeg);
+    sectionE_[lElements[iS].section] += lSeg.energy;
+    if (lastCDF > 1-1e-7) break;
+  }
+
+  //lateral plane
+  const G4ThreeVector e1 = axis.orthogonal().unit();
+  const G4ThreeVector e2 = axis.cross(e1);
+  const G4double nSpotsShower = pars_.nSpots(energy/GeV);
+  const G4double sampling = pars_.get(HGCSSShowerParameters::samplingTerm);
+  const G4double sensScale = pars_.get(HGCSSShowerParameters::sensitiveScale);
+
+  const G4double time0 = track->GetGlobalTime();
+
+  for (unsigned iSeg(0); iSeg<segments_.size(); ++iSeg){
+    const Segment & lSeg = segments_[iSeg];
+    const ShowerDeposit::Element & lEle = lElements[lSeg.slab];
+    G4double edep = lSeg.energy*slabs_[lSeg.slab].weight;
+    if (edep<=0) continue;
+    const G4double secE = sectionE_[lEle.section];
+    G4double nSpots = nSpotsShower*secE/energy;
+    if (lEle.isSensitive) {
+      //sampling fluctuations: stochastic term over the sensitive
+      //elements of the section, gamma distributed to stay positive
+      edep *= sensScale;
+      const G4double relSigma = sampling*sqrt(nSens_[lEle.section]*GeV/secE);
+      const G4double k = 1./(relSigma*relSigma);
+      edep *= CLHEP::RandGamma::shoot(k,1.)/k;
+      if (edep<=0) continue;
+    }
+    else nSpots *= absorberSpotFraction;
+    const unsigned nSp = std::max(static_cast<unsigned>(nSpots+0.5),1U);
+    const G4double spotE = edep/nSp;
+
+    for (unsigned iSp(0); iSp<nSp; ++iSp){
+      const G4double u = G4UniformRand();
+      const G4double s = lSeg.sFront+u*(lSeg.sBack-lSeg.sFront);
+      const G4double tau = (lSeg.tFront+u*(lSeg.tBack-lSeg.tFront))/T;
+      const G4double R = G4UniformRand() < pars_.coreFraction(lnE,tau) ?
+	pars_.coreRadius(lnE,tau) : pars_.tailRadius(lnE,tau);
+      G4double r = maxRadius+1;
+      while (r>maxRadius) {
+	const G4double v = G4UniformRand();
+	r = R*sqrt(v/(1-v));
+      }
+      const G4double phi = twopi*G4UniformRand();
+      const G4ThreeVector lat = r*moliereRadius_*(cos(phi)*e1+sin(phi)*e2);
+      //in the plane of the element
+      const G4ThreeVector position = origin+s*axis+lat-(lat.z()/axis.z())*axis;
+      //cracks, dead material and outside of the acceptance: lost
+      deposit_.deposit(lSeg.slab,spotE,position,time0+s/c_light,track);
+    }
+  }
+}
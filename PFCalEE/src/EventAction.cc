@@ -3,6 +3,7 @@
 #include "RunAction.hh"
 #include "EventActionMessenger.hh"
 #include "DetectorConstruction.hh"
+#include "FrozenShowerModel.hh"
 
 #include "HGCSSInfo.hh"
 
@@ -12,6 +13,22 @@
 
 #include "Randomize.hh"
 #include <iomanip>
+#include <algorithm>
+#include <cstdio>
+#include <sstream>
+
+#include "TChain.h"
+
+#ifdef G4MULTITHREADED
+#include "G4Threading.hh"
+#include "G4AutoLock.hh"
+//the TH2Poly cell maps of HGCSSGeometryConversion are static:
+//fill them once for all worker threads.
+namespace {
+  G4Mutex geomMapMutex = G4MUTEX_INITIALIZER;
+  bool geomMapsInitialised = false;
+}
+#endif
 
 //
 EventAction::EventAction()
@@ -19,7 +36,16 @@ EventAction::EventAction()
   runAct = (RunAction*)G4RunManager::GetRunManager()->GetUserRunAction();
   eventMessenger = new EventActionMessenger(this);
   printModulo = 10;
-  outF_=TFile::Open("PFcal.root","RECREATE");
+  aggregateHits_ = false;
+  columnarOutput_ = false;
+  hitBranchesBooked_ = false;
+  detector_ = 0;
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsWorkerThread()) outF_=TFile::Open(outputFileName(G4Threading::G4GetThreadId()).c_str(),"RECREATE");
+  else outF_=TFile::Open(outputFileName().c_str(),"RECREATE");
+#else
+  outF_=TFile::Open(outputFileName().c_str(),"RECREATE");
+#endif
   outF_->cd();
 
   double xysize = ((DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction())->GetCalorSizeXY();
@@ -41,6 +67,10 @@ EventAction::EventAction()
 
   //honeycomb or diamond or triangles
   geomConv_ = new HGCSSGeometryConversion(info->model(),CELL_SIZE_X);
+#ifdef G4MULTITHREADED
+  G4AutoLock lock(&geomMapMutex);
+  if (!geomMapsInitialised) {
+#endif
   if (shape_==2) geomConv_->initialiseDiamondMap(xysize,10.);
   else if (shape_==3) geomConv_->initialiseTriangleMap(xysize,10.*sqrt(2.));
   else if (shape_==1) geomConv_->initialiseHoneyComb(xysize,CELL_SIZE_X);
@@ -50,13 +80,16 @@ EventAction::EventAction()
   double etamax = ((DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction())->GetMaxEta();
   geomConv_->initialiseSquareMap1(etamin,etamax,-1.*TMath::Pi(),TMath::Pi(),0.01745);//eta phi segmentation
   geomConv_->initialiseSquareMap2(etamin,etamax,-1.*TMath::Pi(),TMath::Pi(),0.02182);//eta phi segmentation
+#ifdef G4MULTITHREADED
+  geomMapsInitialised = true;
+  }
+  lock.unlock();
+#endif
   
 
   tree_=new TTree("HGCSSTree","HGC Standalone simulation tree");
   tree_->Branch("HGCSSEvent","HGCSSEvent",&event_);
   tree_->Branch("HGCSSSamplingSectionVec","std::vector<HGCSSSamplingSection>",&ssvec_);
-  tree_->Branch("HGCSSSimHitVec","std::vector<HGCSSSimHit>",&hitvec_);
-  tree_->Branch("HGCSSAluSimHitVec","std::vector<HGCSSSimHit>",&alhitvec_);
   tree_->Branch("HGCSSGenParticleVec","std::vector<HGCSSGenParticle>",&genvec_);
 
   //fout_.open("ProcessDepAbove5MeV.dat");
@@ -70,12 +103,85 @@ EventAction::EventAction()
 EventAction::~EventAction()
 {
   outF_->cd();
+  if (!hitBranchesBooked_) bookHitBranches();
   tree_->Write();
   outF_->Close();
   //fout_.close();
   delete eventMessenger;
 }
 
+//
+void EventAction::bookHitBranches()
+{
+  if (columnarOutput_) {
+    hitcols_.branch(tree_,"HGCSSSimHitVec");
+    alhitcols_.branch(tree_,"HGCSSAluSimHitVec");
+  }
+  else {
+    tree_->Branch("HGCSSSimHitVec","std::vector<HGCSSSimHit>",&hitvec_);
+    tree_->Branch("HGCSSAluSimHitVec","std::vector<HGCSSSimHit>",&alhitvec_);
+  }
+  hitBranchesBooked_ = true;
+}
+
+//
+void EventAction::Add( std::vector<SamplingSection> *newDetector )
+{
+#ifdef G4MULTITHREADED
+  if (G4Threading::IsWorkerThread()) {
+    localDetector_ = *newDetector;
+    detector_ = &localDetector_;
+    return;
+  }
+#endif
+  detector_ = newDetector;
+}
+
+//
+std::string EventAction::outputFileName(const G4int threadId)
+{
+  if (threadId<0) return "PFcal.root";
+  std::ostringstream lName;
+  lName << "PFcal_thread" << threadId << ".root";
+  return lName.str();
+}
+
+//
+bool EventAction::mergeOutputs(const unsigned nThreads)
+{
+  TChain lChain("HGCSSTree");
+  HGCSSInfo *info = 0;
+  for (unsigned iT(0); iT<nThreads; ++iT){
+    std::string lName = outputFileName(iT);
+    if (!info) {
+      TFile *lFile = TFile::Open(lName.c_str());
+      if (lFile) {
+	HGCSSInfo *lInfo = (HGCSSInfo*)lFile->GetObjectChecked("Info","HGCSSInfo");
+	if (lInfo) info = new HGCSSInfo(*lInfo);
+	lFile->Close();
+      }
+    }
+    lChain.Add(lName.c_str());
+  }
+  if (!info) {
+    std::cout << " -- ERROR in EventAction::mergeOutputs: could not read thread output files. Keeping them." << std::endl;
+    return false;
+  }
+  std::cout << " -- Merging " << nThreads << " thread output files into " << outputFileName() << ": " << lChain.GetEntries() << " events." << std::endl;
+  if (lChain.Merge(outputFileName().c_str(),"fast") < 0) {
+    std::cout << " -- ERROR in EventAction::mergeOutputs: merging failed. Keeping thread output files." << std::endl;
+    return false;
+  }
+  TFile *outF = TFile::Open(outputFileName().c_str(),"UPDATE");
+  outF->WriteObjectAny(info,"HGCSSInfo","Info");
+  outF->Close();
+  delete info;
+  for (unsigned iT(0); iT<nThreads; ++iT){
+    remove(outputFileName(iT).c_str());
+  }
+  return true;
+}
+
 //
 void EventAction::BeginOfEventAction(const G4Event* evt)
 {  
@@ -90,24 +196,38 @@ void EventAction::BeginOfEventAction(const G4Event* evt)
 
 //
 void EventAction::Detect(G4double edep, G4double stepl,G4double globalTime, 
-			 G4int pdgId, G4VPhysicalVolume *volume, const G4ThreeVector & position, 
+			 G4int pdgId, const SamplingVolume *volume, const G4ThreeVector & position, 
 			 G4int trackID, G4int parentID,
 			 const HGCSSGenParticle & genPart)
 {
-  for(size_t i=0; i<detector_->size(); i++) (*detector_)[i].add(edep,stepl,globalTime,pdgId,volume,position,trackID,parentID,i);
+  if (volume) (*detector_)[volume->section].add(*volume,edep,stepl,globalTime,pdgId,position,trackID,parentID,
+						 (aggregateHits_ && volume->isSensitive) ? cellIndexer(volume->section) : 0);
   if (genPart.isIncoming()) genvec_.push_back(genPart);
 }
 
-bool EventAction::isFirstVolume(const std::string volname) const{
+const HGCSSCellIndexer* EventAction::cellIndexer(const unsigned layer)
+{
+  if ((*detector_)[layer].hasScintillator) return layer<57 ? geomConv_->squareIndexer1() : geomConv_->squareIndexer2();
+  if (shape_==4) return geomConv_->squareIndexer();
+  if (shape_==2) return geomConv_->diamondIndexer();
+  if (shape_==3) return geomConv_->triangleIndexer();
+  return geomConv_->hexagonIndexer();
+}
+
+namespace {
+  bool lowerCellId(const HGCSSSimHit & a, const HGCSSSimHit & b){
+    return a.cellid() < b.cellid();
+  }
+}
+
+bool EventAction::isFirstVolume(const G4VPhysicalVolume* volume) const{
   if (detector_->size()>0 && (*detector_)[0].n_elements>0){
-    bool found = false;
     //for (unsigned iS(0); iS<(*detector_)[0].n_sectors;++iS){
       //if ((((*detector_)[0].ele_vol[(*detector_)[0].n_elements*iS])->GetName())==volname.c_str() || (*detector_)[0].supportcone_vol->GetName()==volname.c_str()) found = true;
       //}
-    if ((*detector_)[0].dummylayer_vol->GetName()==volname.c_str()) found = true;
-    return found;
+    return volume!=0 && (*detector_)[0].dummylayer_vol==volume;
   }
-  return "";
+  return true;
 }
 
 //
@@ -159,6 +279,18 @@ void EventAction::EndOfEventAction(const G4Event* g4evt)
       //std::cout << " n_sens_ele = " << (*detector_)[i].n_sens_elements << std::endl;
       bool is_scint = (*detector_)[i].hasScintillator;
       for (unsigned idx(0); idx<(*detector_)[i].n_sens_elements; ++idx){
+	if (aggregateHits_){
+	  //already summed per cell during stepping, keep the cellid ordering of the std::map below.
+	  const SimHitCellMap & lCellMap = (*detector_)[i].getCellHitMap(idx);
+	  unsigned first = hitvec_.size();
+	  hitvec_.reserve(first+lCellMap.size());
+	  for (SimHitCellMap::const_iterator lIter = lCellMap.begin(); lIter != lCellMap.end(); ++lIter){
+	    hitvec_.push_back(lIter->second);
+	    hitvec_.back().calculateTime();
+	  }
+	  std::sort(hitvec_.begin()+first,hitvec_.end(),lowerCellId);
+	  continue;
+	}
 	std::map<unsigned,HGCSSSimHit> lHitMap;
 	std::pair<std::map<unsigned,HGCSSSimHit>::iterator,bool> isInserted;
 	
@@ -168,7 +300,7 @@ void EventAction::EndOfEventAction(const G4Event* g4evt)
 
 	for (unsigned iSiHit(0); iSiHit<(*detector_)[i].getSiHitVec(idx).size();++iSiHit){
 	  G4SiHit lSiHit = (*detector_)[i].getSiHitVec(idx)[iSiHit];
-	  HGCSSSimHit lHit(lSiHit,idx,is_scint? (i<57?geomConv_->squareMap1():geomConv_->squareMap2()): (shape_==4 ?geomConv_->squareMap() : shape_==2?geomConv_->diamondMap():shape_==3?geomConv_->triangleMap():geomConv_->hexagonMap()),CELL_SIZE_X,is_scint?true:false);
+	  HGCSSSimHit lHit(lSiHit,idx,*cellIndexer(i),is_scint?true:false);
 	  
 	  isInserted = lHitMap.insert(std::pair<unsigned,HGCSSSimHit>(lHit.cellid(),lHit));
 	  if (!isInserted.second) isInserted.first->second.Add(lSiHit);
@@ -187,7 +319,10 @@ void EventAction::EndOfEventAction(const G4Event* g4evt)
       std::pair<std::map<unsigned,HGCSSSimHit>::iterator,bool> isInserted;
       for (unsigned iAlHit(0); iAlHit<(*detector_)[i].getAlHitVec().size();++iAlHit){
 	G4SiHit lAlHit = (*detector_)[i].getAlHitVec()[iAlHit];
-	HGCSSSimHit lHit(lAlHit,0,geomConv_->squareMap());
+	//the square map is empty if its cells come from the cache: same cellid with the indexer
+	HGCSSSimHit lHit = geomConv_->squareIndexer()->tiling() != HGCSSCellIndexer::NoTiling ?
+	  HGCSSSimHit(lAlHit,0,*geomConv_->squareIndexer()) :
+	  HGCSSSimHit(lAlHit,0,geomConv_->squareMap());
 	isInserted = lHitMap.insert(std::pair<unsigned,HGCSSSimHit>(0,lHit));
 	if (!isInserted.second) isInserted.first->second.Add(lAlHit);
       }
@@ -213,8 +348,16 @@ void EventAction::EndOfEventAction(const G4Event* g4evt)
     
   }
 
+  if (!hitBranchesBooked_) bookHitBranches();
+  if (columnarOutput_) {
+    hitcols_.fill(hitvec_);
+    alhitcols_.fill(alhitvec_);
+  }
   tree_->Fill();
   
+  FrozenShowerModel *frozenShowers = ((DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction())->getFrozenShowerModel();
+  if (frozenShowers) frozenShowers->endOfEvent();
+
   //reset vectors
   genvec_.clear();
   hitvec_.clear();
@@ -36,6 +36,7 @@
 #include "EventAction.hh"
 #include "G4UIdirectory.hh"
 #include "G4UIcmdWithAnInteger.hh"
+#include "G4UIcmdWithABool.hh"
 #include "globals.hh"
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -50,6 +51,16 @@ EventActionMessenger::EventActionMessenger(EventAction* EvAct)
   PrintCmd->SetGuidance("Print events modulo n");
   PrintCmd->SetParameterName("EventNb",false);
   PrintCmd->SetRange("EventNb>0");
+
+  AggregateCmd = new G4UIcmdWithABool("/N03/event/aggregateHits",this);
+  AggregateCmd->SetGuidance("Sum steps into cell simhits during stepping, without storing every G4SiHit");
+  AggregateCmd->SetParameterName("Aggregate",true);
+  AggregateCmd->SetDefaultValue(true);
+
+  ColumnarCmd = new G4UIcmdWithABool("/N03/event/columnarOutput",this);
+  ColumnarCmd->SetGuidance("Write the simhits as one branch per field (HGCSSSimHit_energy,...) instead of HGCSSSimHitVec");
+  ColumnarCmd->SetParameterName("Columnar",true);
+  ColumnarCmd->SetDefaultValue(true);
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -57,6 +68,8 @@ EventActionMessenger::EventActionMessenger(EventAction* EvAct)
 EventActionMessenger::~EventActionMessenger()
 {
   delete PrintCmd;
+  delete AggregateCmd;
+  delete ColumnarCmd;
   delete eventDir;   
 }
 
@@ -67,6 +80,10 @@ void EventActionMessenger::SetNewValue(
 { 
   if(command == PrintCmd)
     {eventAction->SetPrintModulo(PrintCmd->GetNewIntValue(newValue));}
+  if(command == AggregateCmd)
+    {eventAction->SetAggregateHits(AggregateCmd->GetNewBoolValue(newValue));}
+  if(command == ColumnarCmd)
+    {eventAction->SetColumnarOutput(ColumnarCmd->GetNewBoolValue(newValue));}
 }
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
@@ -0,0 +1,262 @@
+#include "FrozenShowerModel.hh"
+
+#include "DetectorConstruction.hh"
+
+#include "G4Track.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "Randomize.hh"
+#ifdef G4MULTITHREADED
+#include "G4Threading.hh"
+#endif
+
+#include <cmath>
+#include <sstream>
+#include <algorithm>
+
+namespace {
+  //lateral size of the recorded spots: fine in the sensitive elements
+  //to keep the cell sharing, coarse elsewhere where only the energy
+  //of the element is used
+  const G4double sensitiveGrid = 1*mm;
+  const G4double absorberGrid = 5*mm;
+
+  uint64_t spotKey(const G4int element, const G4int ix, const G4int iy){
+    return ((uint64_t)(element+32768)<<40) |
+      ((uint64_t)((ix+(1<<19))&0xFFFFF)<<20) |
+      (uint64_t)((iy+(1<<19))&0xFFFFF);
+  }
+}
+
+//
+FrozenShowerModel::FrozenShowerModel(G4Region* envelope, DetectorConstruction* detector,
+				     const std::string & libFile, const std::string & recordFile,
+				     const G4double & minEnergy, const G4double & maxEnergy):
+  G4VFastSimulationModel("FrozenShowerModel",envelope),
+  detector_(detector),
+  deposit_(detector),
+  minEnergy_(minEnergy),
+  maxEnergy_(maxEnergy),
+  triggerBin_(-1),
+  triggerElement_(-1)
+{
+  const std::vector<ShowerDeposit::Element> & lElements = deposit_.elements();
+  std::vector<SamplingSection> & lStruct = *(detector_->getStructure());
+
+  if (recordFile.size()>0) {
+    std::string lName = recordFile;
+#ifdef G4MULTITHREADED
+    //one file per worker thread, as the root outputs
+    if (G4Threading::IsWorkerThread()) {
+      std::ostringstream lSuffix;
+      lSuffix << "_thread" << G4Threading::G4GetThreadId();
+      size_t lDot = lName.rfind('.');
+      if (lDot == lName.npos) lName += lSuffix.str();
+      else lName.insert(lDot,lSuffix.str());
+    }
+#endif
+    recordOut_.open(lName.c_str(),std::ios::binary);
+    if (!recordOut_.is_open() || !HGCSSShowerLibrary::writeRecordHeader(recordOut_)) {
+      G4cout << " -- ERROR in FrozenShowerModel: cannot write frozen showers to " << lName << ". Exiting..." << G4endl;
+      exit(1);
+    }
+    G4cout << " -- FrozenShowerModel: recording showers between " << minEnergy_/MeV << " and "
+	   << maxEnergy_/MeV << " MeV to " << lName << G4endl;
+    return;
+  }
+
+  if (!library_.open(libFile)) {
+    G4cout << " -- ERROR in FrozenShowerModel: cannot open frozen shower library " << libFile << ". Exiting..." << G4endl;
+    exit(1);
+  }
+  library_.Print(G4cout);
+  //outside of the library range, the full simulation goes on
+  minEnergy_ = std::max(minEnergy_,library_.minEnergy()*MeV);
+  maxEnergy_ = std::min(maxEnergy_,library_.maxEnergy()*MeV);
+  libMaterial_.resize(lElements.size(),-1);
+  for (unsigned iE(0); iE<lElements.size(); ++iE){
+    libMaterial_[iE] = library_.material(lStruct[lElements[iE].section].ele_name[lElements[iE].element]);
+  }
+  G4cout << " -- FrozenShowerModel: frozen showers between " << minEnergy_/MeV << " and "
+	 << maxEnergy_/MeV << " MeV from " << libFile << G4endl;
+}
+
+//
+FrozenShowerModel::~FrozenShowerModel()
+{
+  if (recordOut_.is_open()) recordOut_.close();
+}
+
+//
+G4bool FrozenShowerModel::IsApplicable(const G4ParticleDefinition& particle)
+{
+  return &particle == G4Electron::ElectronDefinition() ||
+    &particle == G4Positron::PositronDefinition() ||
+    &particle == G4Gamma::GammaDefinition();
+}
+
+//
+void FrozenShowerModel::transverseDirection(const G4ThreeVector & dir, G4double & cosPhi, G4double & sinPhi)
+{
+  const G4double lPerp = dir.perp();
+  if (lPerp < 1e-3) {
+    cosPhi = 1;
+    sinPhi = 0;
+    return;
+  }
+  cosPhi = dir.x()/lPerp;
+  sinPhi = dir.y()/lPerp;
+}
+
+//
+G4bool FrozenShowerModel::ModelTrigger(const G4FastTrack& fastTrack)
+{
+  const G4Track *lTrack = fastTrack.GetPrimaryTrack();
+  const G4double energy = lTrack->GetKineticEnergy();
+  if (energy < minEnergy_ || energy >= maxEnergy_) return false;
+
+  //descendants of a recorded particle belong to its shower
+  if (isRecording() &&
+      (trackRecording_.find(lTrack->GetTrackID()) != trackRecording_.end() ||
+       trackRecording_.find(lTrack->GetParentID()) != trackRecording_.end())) return false;
+
+  const G4int iE = deposit_.elementIndex(detector_->getSamplingVolume(lTrack->GetVolume()));
+  if (iE<0) return false;
+  const ShowerDeposit::Element & lEle = deposit_.elements()[iE];
+  const G4double depth = (lTrack->GetPosition().z()-lEle.zFront)/(lEle.zBack-lEle.zFront);
+  const G4ThreeVector & dir = lTrack->GetMomentumDirection();
+  const int particle = HGCSSShowerLibrary::particle(lTrack->GetDefinition()->GetPDGEncoding());
+
+  if (isRecording()) {
+    Recording lRec;
+    lRec.particle = particle;
+    lRec.startElement = iE;
+    lRec.energy = energy;
+    lRec.cosTheta = dir.z();
+    lRec.depth = std::min(std::max(depth,0.),1.);
+    lRec.origin = lTrack->GetPosition();
+    transverseDirection(dir,lRec.cosPhi,lRec.sinPhi);
+    trackRecording_[lTrack->GetTrackID()] = recordings_.size();
+    recordings_.push_back(lRec);
+    return false;
+  }
+
+  if (libMaterial_[iE]<0) return false;
+  triggerBin_ = library_.bin(particle,libMaterial_[iE],energy/MeV,dir.z(),depth);
+  triggerElement_ = iE;
+  return triggerBin_>=0 && library_.nTemplates(triggerBin_)>0;
+}
+
+//
+void FrozenShowerModel::DoIt(const G4FastTrack& fastTrack, G4FastStep& fastStep)
+{
+  //as for EMShowerModel, the energy goes through the event action spot
+  //by spot and is not proposed as energy of this step.
+  fastStep.KillPrimaryTrack();
+  fastStep.ProposePrimaryTrackPathLength(0.0);
+
+  stampShower(fastTrack.GetPrimaryTrack(),triggerBin_,triggerElement_);
+}
+
+//
+void FrozenShowerModel::stampShower(const G4Track* track, const unsigned libBin, const unsigned startElement)
+{
+  const std::vector<ShowerDeposit::Element> & lElements = deposit_.elements();
+  const HGCSSShowerTemplate & lTemp = library_.getTemplate(libBin,static_cast<unsigned>(G4UniformRand()*library_.nTemplates(libBin)));
+  const HGCSSShowerSpot *lSpots = library_.spots(lTemp);
+
+  const G4double energy = track->GetKineticEnergy();
+  const G4ThreeVector & origin = track->GetPosition();
+  const G4double time0 = track->GetGlobalTime();
+  G4double cosPhi, sinPhi;
+  transverseDirection(track->GetMomentumDirection(),cosPhi,sinPhi);
+  //along z the azimuth is free
+  if (track->GetMomentumDirection().perp() < 1e-3) {
+    const G4double phi = twopi*G4UniformRand();
+    cosPhi = cos(phi);
+    sinPhi = sin(phi);
+  }
+  const G4double mirror = G4UniformRand()<0.5 ? -1 : 1;
+
+  for (unsigned iS(0); iS<lTemp.nSpots; ++iS){
+    const HGCSSShowerSpot & lSpot = lSpots[iS];
+    const G4int iE = static_cast<G4int>(startElement)+lSpot.element;
+    if (iE<0 || iE>=static_cast<G4int>(lElements.size())) continue;
+    const ShowerDeposit::Element & lEle = lElements[iE];
+    const G4double x = lSpot.x*mm;
+    const G4double y = mirror*lSpot.y*mm;
+    const G4ThreeVector position(origin.x()+x*cosPhi-y*sinPhi,
+				 origin.y()+x*sinPhi+y*cosPhi,
+				 lEle.zFront+lSpot.depth/65535.*(lEle.zBack-lEle.zFront));
+    //cracks, dead material and outside of the acceptance: lost
+    deposit_.deposit(iE,lSpot.energy*energy,position,time0+(position-origin).mag()/c_light,track);
+  }
+}
+
+//
+void FrozenShowerModel::recordStep(const G4double & edep, const SamplingVolume* volume,
+				   const G4ThreeVector & position, const G4int trackID, const G4int parentID)
+{
+  std::unordered_map<G4int,unsigned>::const_iterator lIter = trackRecording_.find(trackID);
+  if (lIter == trackRecording_.end()) {
+    lIter = trackRecording_.find(parentID);
+    if (lIter == trackRecording_.end()) return;
+    lIter = trackRecording_.insert(std::pair<G4int,unsigned>(trackID,lIter->second)).first;
+  }
+  if (edep<=0) return;
+  const G4int iE = deposit_.elementIndex(volume);
+  if (iE<0) return;
+
+  Recording & lRec = recordings_[lIter->second];
+  const ShowerDeposit::Element & lEle = deposit_.elements()[iE];
+  const G4double dx = position.x()-lRec.origin.x();
+  const G4double dy = position.y()-lRec.origin.y();
+  const G4double x = dx*lRec.cosPhi+dy*lRec.sinPhi;
+  const G4double y = -dx*lRec.sinPhi+dy*lRec.cosPhi;
+  const G4double depth = std::min(std::max((position.z()-lEle.zFront)/(lEle.zBack-lEle.zFront),0.),1.);
+  const G4double grid = lEle.isSensitive ? sensitiveGrid : absorberGrid;
+  const G4int element = iE-static_cast<G4int>(lRec.startElement);
+  if (element < -32768 || element > 32767) return;
+
+  SpotSum & lSum = lRec.spots[spotKey(element,static_cast<G4int>(floor(x/grid)),static_cast<G4int>(floor(y/grid)))];
+  lSum.energy += edep;
+  lSum.x += edep*x;
+  lSum.y += edep*y;
+  lSum.depth += edep*depth;
+}
+
+//
+void FrozenShowerModel::endOfEvent()
+{
+  if (!isRecording()) return;
+  std::vector<SamplingSection> & lStruct = *(detector_->getStructure());
+  std::vector<HGCSSShowerSpot> lSpots;
+  for (unsigned iR(0); iR<recordings_.size(); ++iR){
+    const Recording & lRec = recordings_[iR];
+    lSpots.clear();
+    lSpots.reserve(lRec.spots.size());
+    for (std::map<uint64_t,SpotSum>::const_iterator lIter = lRec.spots.begin(); lIter != lRec.spots.end(); ++lIter){
+      const SpotSum & lSum = lIter->second;
+      HGCSSShowerSpot lSpot;
+      lSpot.element = static_cast<G4int>(lIter->first>>40)-32768;
+      lSpot.depth = static_cast<uint16_t>(lSum.depth/lSum.energy*65535+0.5);
+      lSpot.x = lSum.x/lSum.energy/mm;
+      lSpot.y = lSum.y/lSum.energy/mm;
+      lSpot.energy = lSum.energy/lRec.energy;
+      lSpots.push_back(lSpot);
+    }
+    const ShowerDeposit::Element & lEle = deposit_.elements()[lRec.startElement];
+    HGCSSShowerLibrary::writeRecord(recordOut_,lRec.particle,lStruct[lEle.section].ele_name[lEle.element],
+				    lRec.energy/MeV,lRec.cosTheta,lRec.depth,lSpots);
+  }
+  recordOut_.flush();
+  if (!recordOut_.good()) {
+    G4cout << " -- ERROR in FrozenShowerModel: writing the recorded showers failed. Exiting..." << G4endl;
+    exit(1);
+  }
+  recordings_.clear();
+  trackRecording_.clear();
+}
@@ -38,6 +38,18 @@
 #include <iostream>
 #include <fstream>
 
+#ifdef G4MULTITHREADED
+#include <memory>
+#include "G4AutoLock.hh"
+//in MT mode all worker threads read their events from a single shared stream,
+//so that each HepMC event is simulated exactly once.
+namespace {
+  G4Mutex asciiInputMutex = G4MUTEX_INITIALIZER;
+  std::unique_ptr<HepMC::IO_GenEvent> sharedAsciiInput;
+  G4String sharedFilename = "";
+}
+#endif
+
 ////////////////////////////////////////
 HepMCG4AsciiReader::HepMCG4AsciiReader()
   :  filename("xxx.dat"), verbose(0)
@@ -60,16 +72,31 @@ HepMCG4AsciiReader::~HepMCG4AsciiReader()
 void HepMCG4AsciiReader::Initialize()
 /////////////////////////////////////
 {
+#ifdef G4MULTITHREADED
+  G4AutoLock lock(&asciiInputMutex);
+  if (!sharedAsciiInput || sharedFilename != filename) {
+    sharedAsciiInput.reset(new HepMC::IO_GenEvent(filename.c_str(), std::ios::in));
+    sharedFilename= filename;
+  }
+#else
   delete asciiInput;
 
   asciiInput= new HepMC::IO_GenEvent(filename.c_str(), std::ios::in);
+#endif
 }
 
 /////////////////////////////////////////////////////////
 HepMC::GenEvent* HepMCG4AsciiReader::GenerateHepMCEvent()
 /////////////////////////////////////////////////////////
 {
+#ifdef G4MULTITHREADED
+  G4AutoLock lock(&asciiInputMutex);
+  if(!sharedAsciiInput) return 0;
+  HepMC::GenEvent* evt= sharedAsciiInput-> read_next_event();
+  lock.unlock();
+#else
   HepMC::GenEvent* evt= asciiInput-> read_next_event();
+#endif
   if(!evt) return 0; // no more event
 
   if(verbose>0) evt-> print();
@@ -0,0 +1,84 @@
+#include "NavigationBenchmark.hh"
+
+#include "DetectorConstruction.hh"
+
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4Timer.hh"
+#include "G4PhysicalConstants.hh"
+#include "G4SystemOfUnits.hh"
+#include "geomdefs.hh"
+#include "CLHEP/Random/JamesRandom.h"
+
+#include <cmath>
+
+namespace {
+  //safety against rays stuck on a surface
+  const unsigned maxStepsPerRay = 100000;
+}
+
+//
+NavigationBenchmark::NavigationBenchmark(DetectorConstruction* detector):
+  detector_(detector)
+{}
+
+//
+void NavigationBenchmark::run(const unsigned nRays, const unsigned seed)
+{
+  G4VPhysicalVolume *lWorld = G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume();
+  if (!lWorld || !detector_->getWorldVolume()) {
+    G4cout << " -- ERROR in NavigationBenchmark: no geometry, run /run/initialize first." << G4endl;
+    return;
+  }
+  //own engine: the random sequence of the simulation is untouched
+  CLHEP::HepJamesRandom lEngine(seed);
+  G4Navigator lNav;
+  lNav.SetWorldVolume(lWorld);
+
+  const bool isFullSection = detector_->getModel() == DetectorConstruction::m_FULLSECTION;
+  const G4double worldZ = detector_->getWorldVolume()->GetTranslation().z();
+  const G4double frontZ = worldZ-detector_->GetCalorSizeZ()/2-10*mm;
+  const G4double halfXY = 0.45*detector_->GetCalorSizeXY();
+
+  unsigned long nSteps = 0;
+  G4Timer lTimer;
+  lTimer.Start();
+  for (unsigned iR(0); iR<nRays; ++iR){
+    G4ThreeVector pos, dir;
+    if (isFullSection) {
+      const G4double eta = detector_->GetMinEta()+(detector_->GetMaxEta()-detector_->GetMinEta())*lEngine.flat();
+      const G4double phi = twopi*lEngine.flat();
+      const G4double theta = 2*atan(exp(-eta));
+      dir.set(sin(theta)*cos(phi),sin(theta)*sin(phi),cos(theta));
+    }
+    else {
+      pos.set(halfXY*(2*lEngine.flat()-1),halfXY*(2*lEngine.flat()-1),frontZ);
+      //up to 0.1 rad, to also cross the layers at an angle
+      const G4double theta = 0.1*lEngine.flat();
+      const G4double phi = twopi*lEngine.flat();
+      dir.set(sin(theta)*cos(phi),sin(theta)*sin(phi),cos(theta));
+    }
+    G4VPhysicalVolume *lVol = lNav.LocateGlobalPointAndSetup(pos,&dir,false,false);
+    unsigned nRaySteps = 0;
+    while (lVol && nRaySteps<maxStepsPerRay) {
+      G4double safety = 0;
+      const G4double step = lNav.ComputeStep(pos,dir,kInfinity,safety);
+      if (step >= kInfinity) break;
+      pos += step*dir;
+      lNav.SetGeometricallyLimitedStep();
+      lVol = lNav.LocateGlobalPointAndSetup(pos,&dir,true);
+      ++nRaySteps;
+    }
+    nSteps += nRaySteps;
+  }
+  lTimer.Stop();
+
+  const G4double lTime = lTimer.GetUserElapsed()+lTimer.GetSystemElapsed();
+  G4cout << " -- Navigation benchmark, version " << detector_->getVersion()
+	 << " model " << detector_->getModel()
+	 << (detector_->nestedLayers() ? " nested" : " flat") << " layers: "
+	 << nRays << " rays, " << nSteps << " steps in " << lTime << " s CPU";
+  if (lTime>0) G4cout << ", " << nSteps/lTime << " steps/s";
+  G4cout << G4endl;
+}
@@ -36,6 +36,10 @@
 #include "G4RunManager.hh"
 
 #include "G4ProcessManager.hh"
+#include "G4FastSimulationManagerProcess.hh"
+#include "G4Electron.hh"
+#include "G4Positron.hh"
+#include "G4Gamma.hh"
 
 // #include "G4BosonConstructor.hh"
 // #include "G4LeptonConstructor.hh"
@@ -62,6 +66,20 @@ PhysicsList::~PhysicsList()
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
+void PhysicsList::ConstructProcess()
+{
+  QGSP_BERT::ConstructProcess();
+
+  //fast simulation of e+/e-/gamma: only acts in the regions with a
+  //model, see DetectorConstruction::SetFastShower
+  G4FastSimulationManagerProcess* fastSimProcess = new G4FastSimulationManagerProcess();
+  G4Electron::ElectronDefinition()->GetProcessManager()->AddDiscreteProcess(fastSimProcess);
+  G4Positron::PositronDefinition()->GetProcessManager()->AddDiscreteProcess(fastSimProcess);
+  G4Gamma::GammaDefinition()->GetProcessManager()->AddDiscreteProcess(fastSimProcess);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
 // void PhysicsList::ConstructParticle()
 // {
 //   // In this method, static member functions should be called
@@ -30,10 +30,14 @@
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
 #include "RunAction.hh"
+#include "StackingAction.hh"
 
 #include "G4Run.hh"
 #include "G4RunManager.hh"
 #include "G4UnitsTable.hh"
+#ifdef G4MULTITHREADED
+#include "G4Threading.hh"
+#endif
 
 //....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
 
@@ -53,6 +57,10 @@ void RunAction::BeginOfRunAction(const G4Run* aRun)
 
   //inform the runManager to save random number seed
   G4RunManager::GetRunManager()->SetRandomNumberStore(true);
+
+  //none on the master in MT mode
+  StackingAction *stackingAction = (StackingAction*)G4RunManager::GetRunManager()->GetUserStackingAction();
+  if (stackingAction) stackingAction->beginOfRun();
     
   //initialize cumulative quantities
   //
@@ -79,12 +87,22 @@ void RunAction::fillPerEvent(G4double EAbs, G4double EGap,
 void RunAction::EndOfRunAction(const G4Run* aRun)
 {
   G4int NbOfEvents = aRun->GetNumberOfEvent();
+
+  //kill policy counters: the workers add theirs before the master reports
+  StackingAction *stackingAction = (StackingAction*)G4RunManager::GetRunManager()->GetUserStackingAction();
+  if (stackingAction) stackingAction->endOfRun();
+  bool reportStacking = true;
+#ifdef G4MULTITHREADED
+  reportStacking = !G4Threading::IsWorkerThread();
+#endif
+
   if (NbOfEvents == 0) return;
   
   G4cout
      << "\n--------------------End of Run------------------------------\n"
      << " -- Number of events processed = " << NbOfEvents << "\n"
      << G4endl;
+  if (reportStacking) StackingAction::report();
 
   // //compute statistics: mean and rms
   // //
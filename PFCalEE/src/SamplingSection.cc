@@ -3,56 +3,17 @@
 #include "SamplingSection.hh"
 
 //
-void SamplingSection::add(G4double den, G4double dl, 
+void SamplingSection::add(const SamplingVolume & aVol,
+			  G4double den, G4double dl, 
 			  G4double globalTime, G4int pdgId, 
-			  G4VPhysicalVolume* vol, 
 			  const G4ThreeVector & position,
 			  G4int trackID, G4int parentID,
-			  G4int layerId)
-{
-  std::string lstr = vol->GetName();
-  for (unsigned ie(0); ie<n_elements*n_sectors;++ie){
-    if(ele_vol[ie] && lstr==ele_vol[ie]->GetName()){ 
-      unsigned eleidx = ie%n_elements;
-      ele_den[eleidx]+=den;
-      ele_dl[eleidx]+=dl; 
-      //if (lstr.find("CFMix") != lstr.npos) continue;
-      if (isSensitiveElement(eleidx)) {//if Si || sci
-	unsigned idx = getSensitiveLayerIndex(lstr);
-	//std::cout << "sens layer " << idx << " " << lstr << std::endl;
-	sens_time[idx]+=den*globalTime;
-	
-	//discriminate further by particle type
-	if(abs(pdgId)==22)      sens_gFlux[idx] += den;
-	else if(abs(pdgId)==11) sens_eFlux[idx] += den;
-	else if(abs(pdgId)==13) sens_muFlux[idx] += den;
-	else if (abs(pdgId)==2112) sens_neutronFlux[idx] += den;
-	else {
-	  sens_hadFlux[idx] += den;
-	}
-	
-	//add hit
-	G4SiHit lHit;
-	lHit.energy = den;
-	lHit.time = globalTime;
-	lHit.pdgId = pdgId;
-	lHit.layer = layerId;
-	lHit.hit_x = position.x();
-	lHit.hit_y = position.y();
-	lHit.hit_z = position.z();
-	lHit.trackId = trackID;
-	lHit.parentId = parentID;
-	sens_HitVec[idx].push_back(lHit);
-
-      }//if Si
-    }//if in right material
-    
-  }//loop on available materials
-  
+			  const HGCSSCellIndexer* cellIndexer)
+{
+  G4int layerId = aVol.section;
+
   //support cone
-  char nameBuf[100];
-  sprintf(nameBuf,"%s%d","SupportCone",int(layerId+1));
-  if (lstr.find(nameBuf)!=lstr.npos){
+  if (aVol.isSupportCone){
     //add hit
     G4SiHit lHit;
     lHit.energy = den;
@@ -65,8 +26,50 @@ void SamplingSection::add(G4double den, G4double dl,
     lHit.trackId = trackID;
     lHit.parentId = parentID;
     supportcone_HitVec.push_back(lHit);
+    return;
+  }
+
+  unsigned eleidx = aVol.element;
+  ele_den[eleidx]+=den;
+  ele_dl[eleidx]+=dl; 
+  if (!aVol.isSensitive) return;
+
+  //if Si || sci
+  unsigned idx = aVol.sensIdx;
+  sens_time[idx]+=den*globalTime;
+	
+  //discriminate further by particle type
+  if(abs(pdgId)==22)      sens_gFlux[idx] += den;
+  else if(abs(pdgId)==11) sens_eFlux[idx] += den;
+  else if(abs(pdgId)==13) sens_muFlux[idx] += den;
+  else if (abs(pdgId)==2112) sens_neutronFlux[idx] += den;
+  else {
+    sens_hadFlux[idx] += den;
+  }
+	
+  //add hit
+  G4SiHit lHit;
+  lHit.energy = den;
+  lHit.time = globalTime;
+  lHit.pdgId = pdgId;
+  lHit.layer = layerId;
+  lHit.hit_x = position.x();
+  lHit.hit_y = position.y();
+  lHit.hit_z = position.z();
+  lHit.trackId = trackID;
+  lHit.parentId = parentID;
+  ++sens_nHits[idx];
+
+  if (!cellIndexer) {
+    sens_HitVec[idx].push_back(lHit);
+    return;
   }
 
+  //sum into the cell simhit
+  HGCSSSimHit lSimHit(lHit,idx,*cellIndexer,hasScintillator);
+  std::pair<SimHitCellMap::iterator,bool> isInserted = sens_CellHitMap[idx].insert(std::pair<unsigned,HGCSSSimHit>(lSimHit.cellid(),lSimHit));
+  if (!isInserted.second) isInserted.first->second.Add(lHit);
+
 }
 
 //
@@ -84,7 +87,7 @@ G4int SamplingSection::getTotalSensHits()
 {
   G4int tot=0;
   for (unsigned ie(0); ie<n_sens_elements;++ie){
-    tot += sens_HitVec[ie].size();
+    tot += sens_nHits[ie];
   }
   return tot;
 }
@@ -228,6 +231,11 @@ const G4SiHitVec & SamplingSection::getSiHitVec(const unsigned & idx) const
   return sens_HitVec[idx];
 }
 
+const SimHitCellMap & SamplingSection::getCellHitMap(const unsigned & idx) const
+{
+  return sens_CellHitMap[idx];
+}
+
 const G4SiHitVec & SamplingSection::getAlHitVec() const
 {
   return supportcone_HitVec;
@@ -0,0 +1,82 @@
+#include "ShowerDeposit.hh"
+
+#include "DetectorConstruction.hh"
+#include "EventAction.hh"
+
+#include "G4RunManager.hh"
+#include "G4Track.hh"
+#include "G4Navigator.hh"
+#include "G4TransportationManager.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4SystemOfUnits.hh"
+
+//
+ShowerDeposit::ShowerDeposit(DetectorConstruction* detector):
+  detector_(detector),
+  eventAction_(0),
+  navigator_(0)
+{
+  std::vector<SamplingSection> & lStruct = *(detector_->getStructure());
+  const G4double worldZ = detector_->getWorldVolume()->GetTranslation().z();
+
+  firstElement_.assign(lStruct.size(),-1);
+  G4double lastZ = -1e12;
+  for (unsigned i(0); i<lStruct.size(); ++i){
+    SamplingSection & lSec = lStruct[i];
+    const G4double zFront = worldZ+lSec.ele_zpos[0]-lSec.ele_thick[0]/2;
+    if (zFront < lastZ-0.001*mm) break;
+    firstElement_[i] = elements_.size();
+    for (unsigned ie(0); ie<lSec.n_elements; ++ie){
+      Element lEle;
+      lEle.zFront = worldZ+lSec.ele_zpos[ie]-lSec.ele_thick[ie]/2;
+      lEle.zBack = lEle.zFront+lSec.ele_thick[ie];
+      lEle.section = i;
+      lEle.element = ie;
+      lEle.isSensitive = lSec.isSensitiveElement(ie);
+      elements_.push_back(lEle);
+      lastZ = lEle.zBack;
+    }
+  }
+}
+
+//
+ShowerDeposit::~ShowerDeposit()
+{
+  delete navigator_;
+}
+
+//
+G4int ShowerDeposit::elementIndex(const SamplingVolume* volume) const
+{
+  if (!volume || volume->isSupportCone) return -1;
+  return elementIndex(volume->section,volume->element);
+}
+
+//
+G4int ShowerDeposit::elementIndex(const unsigned section, const unsigned element) const
+{
+  if (section>=firstElement_.size() || firstElement_[section]<0) return -1;
+  const unsigned iE = firstElement_[section]+element;
+  if (iE>=elements_.size() || elements_[iE].section != section) return -1;
+  return iE;
+}
+
+//
+bool ShowerDeposit::deposit(const unsigned iE, const G4double & energy,
+			    const G4ThreeVector & position, const G4double & time,
+			    const G4Track* track)
+{
+  if (!eventAction_) eventAction_ = (EventAction*)G4RunManager::GetRunManager()->GetUserEventAction();
+  if (!navigator_) {
+    navigator_ = new G4Navigator();
+    navigator_->SetWorldVolume(G4TransportationManager::GetTransportationManager()->GetNavigatorForTracking()->GetWorldVolume());
+  }
+  G4VPhysicalVolume *lVol = navigator_->LocateGlobalPointAndSetup(position,0,false,true);
+  const SamplingVolume *samplingVol = detector_->getSamplingVolume(lVol);
+  if (!samplingVol || samplingVol->isSupportCone ||
+      samplingVol->section != elements_[iE].section ||
+      samplingVol->element != elements_[iE].element) return false;
+  eventAction_->Detect(energy,0,time,track->GetDefinition()->GetPDGEncoding(),
+		       samplingVol,position,track->GetTrackID(),track->GetParentID(),genPart_);
+  return true;
+}
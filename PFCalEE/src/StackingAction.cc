@@ -0,0 +1,216 @@
+#include "StackingAction.hh"
+
+#include "StackingActionMessenger.hh"
+#include "DetectorConstruction.hh"
+
+#include "G4RunManager.hh"
+#include "G4Track.hh"
+#include "G4Step.hh"
+#include "G4Neutron.hh"
+#include "G4Region.hh"
+#include "G4RegionStore.hh"
+#include "G4LogicalVolume.hh"
+#include "G4VPhysicalVolume.hh"
+#include "G4StackManager.hh"
+#include "G4SystemOfUnits.hh"
+
+#include <algorithm>
+#include <iomanip>
+#include <time.h>
+
+#ifdef G4MULTITHREADED
+#include "G4AutoLock.hh"
+#endif
+
+//run totals over all threads, printed by the master run action
+namespace {
+#ifdef G4MULTITHREADED
+  G4Mutex stackingTotalsMutex = G4MUTEX_INITIALIZER;
+#endif
+  double totalKilled[StackingAction::nPolicies] = {0,0,0,0};
+  double totalSaved[StackingAction::nPolicies] = {0,0,0,0};
+  double totalTracked = 0;
+  double totalWaiting = 0;
+  double totalCPU = 0;
+
+  //CPU time of the calling thread only: G4Timer uses times(), which
+  //counts all the threads of the process
+  double threadCPU(){
+    struct timespec lTime;
+    if (clock_gettime(CLOCK_THREAD_CPUTIME_ID,&lTime)!=0) return 0;
+    return lTime.tv_sec+lTime.tv_nsec*1e-9;
+  }
+}
+
+//
+StackingAction::StackingAction():
+  timeWindow_(0),
+  neutronMinE_(0),
+  killBackward_(false),
+  dropWaiting_(false),
+  frontZ_(0),
+  nTracked_(0),
+  nWaiting_(0),
+  cpuStart_(0)
+{
+  detector_ = (DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction();
+  messenger_ = new StackingActionMessenger(this);
+  for (unsigned iP(0); iP<nPolicies; ++iP) nKilled_[iP] = 0;
+}
+
+//
+StackingAction::~StackingAction()
+{
+  delete messenger_;
+}
+
+//
+const char* StackingAction::policyName(const unsigned aPolicy)
+{
+  static const char* lNames[nPolicies] = {"time window","slow neutrons","backward","waiting dropped"};
+  return aPolicy<nPolicies ? lNames[aPolicy] : "unknown";
+}
+
+//
+void StackingAction::AddWaitingRegion(G4String name)
+{
+  if (std::find(waitingNames_.begin(),waitingNames_.end(),name) == waitingNames_.end()) waitingNames_.push_back(name);
+}
+
+//
+void StackingAction::beginOfRun()
+{
+  //the geometry exists only from the run initialisation
+  std::vector<SamplingSection> & lStruct = *(detector_->getStructure());
+  const G4double worldZ = detector_->getWorldVolume()->GetTranslation().z();
+  frontZ_ = 1e12;
+  for (unsigned i(0); i<lStruct.size(); ++i){
+    SamplingSection & lSec = lStruct[i];
+    for (unsigned ie(0); ie<lSec.n_elements; ++ie){
+      if (!lSec.ele_vol[ie]) continue;
+      frontZ_ = std::min(frontZ_,worldZ+lSec.ele_zpos[ie]-lSec.ele_thick[ie]/2);
+    }
+  }
+
+  waitingRegions_.clear();
+  for (unsigned iR(0); iR<waitingNames_.size(); ++iR){
+    const G4Region *lRegion = G4RegionStore::GetInstance()->GetRegion(waitingNames_[iR],false);
+    if (!lRegion) {
+      G4cout << " -- WARNING in StackingAction: no region " << waitingNames_[iR] << ", ignored." << G4endl;
+      continue;
+    }
+    waitingRegions_.push_back(lRegion);
+  }
+
+  for (unsigned iP(0); iP<nPolicies; ++iP) nKilled_[iP] = 0;
+  nTracked_ = 0;
+  nWaiting_ = 0;
+  cpuStart_ = threadCPU();
+}
+
+//
+void StackingAction::PrepareNewEvent()
+{}
+
+//
+G4ClassificationOfNewTrack StackingAction::ClassifyNewTrack(const G4Track* aTrack)
+{
+  unsigned lPolicy = nPolicies;
+  const G4VPhysicalVolume *lVol = aTrack->GetVolume();
+  if (aTrack->GetParentID()>0) {
+    if (timeWindow_>0 && aTrack->GetGlobalTime()>timeWindow_) lPolicy = TimeWindow;
+    else if (neutronMinE_>0 || killBackward_) {
+      //secondaries are in the volume of their parent
+      const SamplingVolume *samplingVol = lVol ? detector_->getSamplingVolume(lVol) : 0;
+      if (neutronMinE_>0 && samplingVol && !samplingVol->isSensitive && !samplingVol->isSupportCone &&
+	  aTrack->GetDefinition() == G4Neutron::Definition() &&
+	  aTrack->GetKineticEnergy()<neutronMinE_) lPolicy = SlowNeutrons;
+      else if (killBackward_ && !samplingVol &&
+	       aTrack->GetPosition().z()<frontZ_ &&
+	       aTrack->GetMomentumDirection().z()<0) lPolicy = Backward;
+    }
+  }
+  if (lPolicy != nPolicies) {
+    nKilled_[lPolicy]++;
+    return fKill;
+  }
+
+  nTracked_++;
+  if (waitingRegions_.size()>0 && lVol &&
+      std::find(waitingRegions_.begin(),waitingRegions_.end(),lVol->GetLogicalVolume()->GetRegion()) != waitingRegions_.end()) {
+    nWaiting_++;
+    return fWaiting;
+  }
+  return fUrgent;
+}
+
+//
+void StackingAction::NewStage()
+{
+  if (!dropWaiting_) return;
+  //the waiting tracks have just been moved to the urgent stack
+  const unsigned nDropped = stackManager->GetNUrgentTrack();
+  stackManager->clear();
+  nKilled_[WaitingDropped] += nDropped;
+  nTracked_ -= std::min(nTracked_,nDropped);
+}
+
+//
+bool StackingAction::killInStep(const G4Step* aStep)
+{
+  G4Track *lTrack = aStep->GetTrack();
+  if (lTrack->GetTrackStatus() != fAlive) return false;
+  unsigned lPolicy = nPolicies;
+  if (timeWindow_>0 && lTrack->GetGlobalTime()>timeWindow_) lPolicy = TimeWindow;
+  else if (killBackward_ && lTrack->GetMomentumDirection().z()<0) {
+    const G4StepPoint *thePostStepPoint = aStep->GetPostStepPoint();
+    if (thePostStepPoint->GetPosition().z()<frontZ_ &&
+	!detector_->getSamplingVolume(thePostStepPoint->GetPhysicalVolume())) lPolicy = Backward;
+  }
+  if (lPolicy == nPolicies) return false;
+  lTrack->SetTrackStatus(fStopAndKill);
+  nKilled_[lPolicy]++;
+  return true;
+}
+
+//
+void StackingAction::endOfRun()
+{
+  const double lCPU = threadCPU()-cpuStart_;
+  const double lPerTrack = nTracked_>0 ? lCPU/nTracked_ : 0;
+#ifdef G4MULTITHREADED
+  G4AutoLock lock(&stackingTotalsMutex);
+#endif
+  for (unsigned iP(0); iP<nPolicies; ++iP){
+    totalKilled[iP] += nKilled_[iP];
+    totalSaved[iP] += nKilled_[iP]*lPerTrack;
+  }
+  totalTracked += nTracked_;
+  totalWaiting += nWaiting_;
+  totalCPU += lCPU;
+}
+
+//
+void StackingAction::report()
+{
+#ifdef G4MULTITHREADED
+  G4AutoLock lock(&stackingTotalsMutex);
+#endif
+  G4cout << " -- Stacking: " << totalTracked << " tracks simulated ("
+	 << totalWaiting << " postponed), " << totalCPU << " s CPU" << G4endl;
+  double lKilled = 0, lSaved = 0;
+  for (unsigned iP(0); iP<nPolicies; ++iP){
+    lKilled += totalKilled[iP];
+    lSaved += totalSaved[iP];
+    G4cout << "    " << std::setw(16) << policyName(iP) << ": " << std::setw(10) << totalKilled[iP]
+	   << " tracks killed, ~" << totalSaved[iP] << " s CPU saved" << G4endl;
+    totalKilled[iP] = 0;
+    totalSaved[iP] = 0;
+  }
+  G4cout << "    " << std::setw(16) << "total" << ": " << std::setw(10) << lKilled
+	 << " tracks killed, ~" << lSaved << " s CPU saved"
+	 << " (estimate: mean CPU per simulated track, secondaries of the killed tracks not included)" << G4endl;
+  totalTracked = 0;
+  totalWaiting = 0;
+  totalCPU = 0;
+}
@@ -0,0 +1,73 @@
+#include "StackingActionMessenger.hh"
+
+#include "StackingAction.hh"
+#include "G4UIdirectory.hh"
+#include "G4UIcmdWithAString.hh"
+#include "G4UIcmdWithABool.hh"
+#include "G4UIcmdWithADoubleAndUnit.hh"
+#include "globals.hh"
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StackingActionMessenger::StackingActionMessenger(StackingAction* StAct)
+:stackingAction(StAct)
+{
+  stackDir = new G4UIdirectory("/N03/stack/");
+  stackDir->SetGuidance("track kill policies and staging");
+
+  TimeWindowCmd = new G4UIcmdWithADoubleAndUnit("/N03/stack/timeWindow",this);
+  TimeWindowCmd->SetGuidance("Kill tracks beyond this global time, 0 to disable");
+  TimeWindowCmd->SetParameterName("Time",false);
+  TimeWindowCmd->SetRange("Time>=0.");
+  TimeWindowCmd->SetUnitCategory("Time");
+
+  NeutronMinECmd = new G4UIcmdWithADoubleAndUnit("/N03/stack/neutronMinEnergy",this);
+  NeutronMinECmd->SetGuidance("Kill neutrons created in an absorber below this kinetic energy, 0 to disable");
+  NeutronMinECmd->SetParameterName("Energy",false);
+  NeutronMinECmd->SetRange("Energy>=0.");
+  NeutronMinECmd->SetUnitCategory("Energy");
+
+  BackwardCmd = new G4UIcmdWithABool("/N03/stack/killBackward",this);
+  BackwardCmd->SetGuidance("Kill tracks leaving the calorimeter through its front face (no magnetic field)");
+  BackwardCmd->SetParameterName("Kill",true);
+  BackwardCmd->SetDefaultValue(true);
+
+  WaitingRegionCmd = new G4UIcmdWithAString("/N03/stack/waitingRegion",this);
+  WaitingRegionCmd->SetGuidance("Postpone the tracks created in this region to the waiting stage");
+  WaitingRegionCmd->SetParameterName("Region",false);
+
+  DropWaitingCmd = new G4UIcmdWithABool("/N03/stack/dropWaiting",this);
+  DropWaitingCmd->SetGuidance("Kill the postponed tracks instead of simulating them");
+  DropWaitingCmd->SetParameterName("Drop",true);
+  DropWaitingCmd->SetDefaultValue(true);
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+StackingActionMessenger::~StackingActionMessenger()
+{
+  delete TimeWindowCmd;
+  delete NeutronMinECmd;
+  delete BackwardCmd;
+  delete WaitingRegionCmd;
+  delete DropWaitingCmd;
+  delete stackDir;
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
+
+void StackingActionMessenger::SetNewValue(G4UIcommand* command,G4String newValue)
+{
+  if(command == TimeWindowCmd)
+    {stackingAction->SetTimeWindow(TimeWindowCmd->GetNewDoubleValue(newValue));}
+  if(command == NeutronMinECmd)
+    {stackingAction->SetNeutronMinEnergy(NeutronMinECmd->GetNewDoubleValue(newValue));}
+  if(command == BackwardCmd)
+    {stackingAction->SetKillBackward(BackwardCmd->GetNewBoolValue(newValue));}
+  if(command == WaitingRegionCmd)
+    {stackingAction->AddWaitingRegion(newValue);}
+  if(command == DropWaitingCmd)
+    {stackingAction->SetDropWaiting(DropWaitingCmd->GetNewBoolValue(newValue));}
+}
+
+//....oooOO0OOooo........oooOO0OOooo........oooOO0OOooo........oooOO0OOooo......
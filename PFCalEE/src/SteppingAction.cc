@@ -2,6 +2,8 @@
 
 #include "DetectorConstruction.hh"
 #include "EventAction.hh"
+#include "FrozenShowerModel.hh"
+#include "StackingAction.hh"
 
 #include "G4Step.hh"
 #include "G4RunManager.hh"
@@ -12,7 +14,9 @@
 SteppingAction::SteppingAction()                                         
 {
   eventAction_ = (EventAction*)G4RunManager::GetRunManager()->GetUserEventAction();               
-  eventAction_->Add(  ((DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction())->getStructure() );
+  detector_ = (DetectorConstruction*)G4RunManager::GetRunManager()->GetUserDetectorConstruction();
+  stackingAction_ = (StackingAction*)G4RunManager::GetRunManager()->GetUserStackingAction();
+  eventAction_->Add( detector_->getStructure() );
   saturationEngine = new G4EmSaturation();
   timeLimit_ = 100;//ns
 }
@@ -34,22 +38,14 @@ void SteppingAction::UserSteppingAction(const G4Step* aStep)
   G4int parentID = lTrack->GetParentID();
 
   G4VPhysicalVolume* volume = thePreStepPoint->GetPhysicalVolume();
-  std::string thePrePVname("null");
-  if(volume==0) {
-  } else {
-    thePrePVname=volume->GetName();
-  }
   G4VPhysicalVolume* postvolume = thePostStepPoint->GetPhysicalVolume();
-  std::string thePostPVname("null");
-  if(postvolume==0) {
-  } else {
-    thePostPVname=postvolume->GetName();
-  }
+  //null if not part of the calorimeter structure
+  const SamplingVolume* samplingVol = detector_->getSamplingVolume(volume);
 
   G4double edep = aStep->GetTotalEnergyDeposit();
 
   //correct with Birk's law for scintillator material
-  if (volume->GetName().find("Scint")!=volume->GetName().npos) {
+  if (samplingVol && samplingVol->isScint) {
     G4double attEdep = saturationEngine->VisibleEnergyDeposition(lTrack->GetDefinition(), lTrack->GetMaterialCutsCouple(), aStep->GetStepLength(), edep, 0.);  // this is the attenuated visible energy
     //std::cout << " -- Correcting energy for scintillator: " << edep << " " << attEdep;
     edep = attEdep;
@@ -144,8 +140,8 @@ void SteppingAction::UserSteppingAction(const G4Step* aStep)
   //(thePrePVname=="Si18_1phys" && thePostPVname=="Si18_0phys"))
 //)
   if (globalTime < timeLimit_ && 
-      (thePrePVname=="Wphys"
-	&& eventAction_->isFirstVolume(thePostPVname))
+      (volume==detector_->getWorldVolume()
+	&& eventAction_->isFirstVolume(postvolume))
       )
     {
     //if (pdgId == 2112) 
@@ -169,7 +165,14 @@ void SteppingAction::UserSteppingAction(const G4Step* aStep)
     //if (pdgId == 2112) genPart.Print(G4cout);
   }
 
+  //deposits of the showers recorded for a frozen shower library
+  FrozenShowerModel *frozenShowers = detector_->getFrozenShowerModel();
+  if (frozenShowers && frozenShowers->isRecording()) frozenShowers->recordStep(edep,samplingVol,position,trackID,parentID);
+
   //if (globalTime < 10) //timeLimit_) 
-  eventAction_->Detect(edep,stepl,globalTime,pdgId,volume,position,trackID,parentID,genPart);
+  eventAction_->Detect(edep,stepl,globalTime,pdgId,samplingVol,position,trackID,parentID,genPart);
+
+  //time window and backward kill policies, after the deposit of this step
+  if (stackingAction_) stackingAction_->killInStep(aStep);
   //eventAction_->Detect(edep,stepl,globalTime,pdgId,volume,iyiz);
 }
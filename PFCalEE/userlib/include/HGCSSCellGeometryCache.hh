@@ -0,0 +1,160 @@
+#ifndef HGCSSCellGeometryCache_h
+#define HGCSSCellGeometryCache_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+class TH2Poly;
+
+//one cell of a map, in the coordinates of the map (mm, or eta-phi
+//for the scintillator maps)
+struct HGCSSCellGeometry {
+  double x;//centre of the bin bounding box, as HGCSSGeometryConversion::fillXY
+  double y;
+  double eta;//xy maps: at the reference z of the cache
+  double phi;
+  double area;
+  uint32_t firstVertex;
+  uint32_t nVertices;
+  uint32_t firstNeighbour;
+  uint32_t nNeighbours;
+};
+
+struct HGCSSCellVertex {
+  double x;
+  double y;
+};
+
+//one map of the cache
+struct HGCSSCellMapHeader {
+  uint32_t type;//HGCSSCellGeometryCache::MapType
+  uint32_t nParams;
+  double params[6];//arguments of the HGCSSGeometryConversion::initialise* function
+  uint64_t checksum;
+  double xmin;//axis range of the TH2Poly
+  double xmax;
+  double ymin;
+  double ymax;
+  uint32_t nCells;
+  uint32_t nVertices;
+  uint32_t nNeighbours;
+  uint32_t unused;
+  uint64_t cellStart;//bytes from the start of the file
+  uint64_t vertexStart;
+  uint64_t neighbourStart;
+};
+
+//Precomputed cell geometry of the maps of HGCSSGeometryConversion
+//(centre, eta, phi, area, polygon and neighbours = cells sharing a
+//corner), written once by buildCellGeometryCache and memory-mapped by
+//the simulation, the digitizer and the analysis instead of filling the
+//TH2Poly maps. Each map carries a checksum of the cache version, map type
+//and tiling parameters: a map built with other parameters is not used.
+//Layout (native endianness):
+// header | HGCSSCellMapHeader[nMaps] | per map: HGCSSCellGeometry[nCells]
+// | HGCSSCellVertex[nVertices] | uint32 neighbours[nNeighbours]
+//Cell ids are the TH2Poly bin numbers, from 1.
+class HGCSSCellGeometryCache{
+
+public:
+  enum MapType {
+    Hexagon=0,
+    Diamond=1,
+    Triangle=2,
+    Square=3,
+    Square1=4,
+    Square2=5,
+    nMapTypes=6
+  };
+
+  struct Source {
+    unsigned type;
+    std::vector<double> params;
+    TH2Poly *map;
+  };
+
+  HGCSSCellGeometryCache();
+  ~HGCSSCellGeometryCache();
+
+  static const char* mapName(const unsigned aType);
+
+  //-1 if unknown
+  static int mapType(const std::string & aName);
+
+  //number of parameters of the initialise* function of the map
+  static unsigned nParams(const unsigned aType);
+
+  static uint64_t checksum(const unsigned aType, const std::vector<double> & params);
+
+  //"name:p1,p2,...", parameters at full precision ("pi" accepted when parsing)
+  static std::string spec(const unsigned aType, const std::vector<double> & params);
+  static bool parseSpec(const std::string & aSpec, unsigned & aType, std::vector<double> & params);
+
+  //eta-phi maps: the scintillator squareMap1/2
+  static inline bool isEtaPhi(const unsigned aType){
+    return aType == Square1 || aType == Square2;
+  };
+
+  static bool isCache(const std::string & filePath);
+
+  static bool write(const std::string & filePath,
+		    const std::vector<Source> & maps,
+		    const double refZ);
+
+  bool open(const std::string & filePath);
+  void close();
+
+  inline bool isOpen() const{
+    return data_ != 0;
+  };
+
+  inline const std::string & filePath() const{
+    return filePath_;
+  };
+
+  inline double refZ() const{
+    return refZ_;
+  };
+
+  inline unsigned nMaps() const{
+    return nMaps_;
+  };
+
+  inline const HGCSSCellMapHeader & mapHeader(const unsigned iMap) const{
+    return maps_[iMap];
+  };
+
+  //-1 if the map is not in the cache, or was built with other parameters
+  int findMap(const unsigned aType, const std::vector<double> & params) const;
+
+  //cellid from 1
+  inline const HGCSSCellGeometry & cell(const unsigned iMap, const unsigned cellid) const{
+    return ((const HGCSSCellGeometry*)(data_+maps_[iMap].cellStart))[cellid-1];
+  };
+
+  inline const HGCSSCellVertex * vertices(const unsigned iMap, const HGCSSCellGeometry & aCell) const{
+    return (const HGCSSCellVertex*)(data_+maps_[iMap].vertexStart)+aCell.firstVertex;
+  };
+
+  inline const uint32_t * neighbours(const unsigned iMap, const HGCSSCellGeometry & aCell) const{
+    return (const uint32_t*)(data_+maps_[iMap].neighbourStart)+aCell.firstNeighbour;
+  };
+
+  //eta of a cell of an xy map at another z
+  static double eta(const HGCSSCellGeometry & aCell, const double & z);
+
+  void Print(std::ostream & aOs) const;
+
+private:
+  const char * data_;
+  size_t size_;
+  std::string filePath_;
+  double refZ_;
+  unsigned nMaps_;
+  const HGCSSCellMapHeader * maps_;
+
+};
+
+#endif
@@ -0,0 +1,126 @@
+#ifndef HGCSSCellIndexer_h
+#define HGCSSCellIndexer_h
+
+
+#include <iostream>
+#include <vector>
+#include "TH2Poly.h"
+
+//Closed-form cell lookup for the regular tilings built by
+//HGCSSGeometryConversion. findBin returns the same number as
+//TH2Poly::FindBin on the corresponding map, including the
+//overflow (-1..-9) and sea (-5) codes: only the few candidate
+//cells around the point are tested, with the vertices recomputed
+//exactly as when the bins were added.
+
+class HGCSSCellIndexer{
+
+public:
+  enum Tiling {
+    NoTiling=0,
+    HexagonTiling=1,
+    DiamondTiling=2,
+    TriangleTiling=3,
+    SquareTiling=4
+  };
+
+  HGCSSCellIndexer();
+
+  ~HGCSSCellIndexer(){};
+
+  //bins added column by column from (x0,y0), nx columns of ny cells
+  void setSquare(TH2Poly *map,
+		 const double x0, const double y0,
+		 const double side,
+		 const unsigned nx, const unsigned ny);
+
+  void setDiamond(TH2Poly *map,
+		  const double xymin,
+		  const double dx, const double dy,
+		  const unsigned nx, const unsigned ny);
+
+  void setTriangle(TH2Poly *map,
+		   const double xymin, const double side,
+		   const double dx, const double dy,
+		   const unsigned nx, const unsigned ny);
+
+  //same arguments as HGCSSGeometryConversion::myHoneycomb
+  void setHoneyComb(TH2Poly *map,
+		    const double xstart, const double ystart,
+		    const double a,
+		    const int k, const int s);
+
+  //axis range and number of bins of a map which is not filled
+  //(cells from HGCSSCellGeometryCache): to call after set*(0,...)
+  void setAxisRange(const double xmin, const double xmax,
+		    const double ymin, const double ymax,
+		    const unsigned nMapBins);
+
+  inline Tiling tiling() const{
+    return tiling_;
+  };
+
+  inline TH2Poly *map() const{
+    return map_;
+  };
+
+  inline unsigned nBins() const{
+    return nBins_;
+  };
+
+  int findBin(const double x, const double y) const;
+
+private:
+
+  void setAxisRange(TH2Poly *map);
+
+  //TH2Poly overflow code, -5 if inside the axis range
+  inline int overflowBin(const double x, const double y) const{
+    int overflow = 0;
+    if (y > ymax_) overflow += -1;
+    else if (y > ymin_) overflow += -4;
+    else overflow += -7;
+    if (x > xmax_) overflow += -2;
+    else if (x > xmin_) overflow += -1;
+    return overflow;
+  };
+
+  //conservative range of cells [lo,hi] whose extent [start+i*step+lowOff,
+  //start+i*step+highOff] may contain val, clamped to [0,n-1]
+  static bool candidates(const double val, const double start,
+			 const double step, const double lowOff, const double highOff,
+			 const int n, int & lo, int & hi);
+
+  int findSquare(const double x, const double y) const;
+  int findDiamond(const double x, const double y) const;
+  int findTriangle(const double x, const double y) const;
+  int findHexagon(const double x, const double y) const;
+
+  Tiling tiling_;
+  TH2Poly *map_;
+  unsigned nBins_;
+  double xmin_;
+  double xmax_;
+  double ymin_;
+  double ymax_;
+
+  unsigned nx_;
+  unsigned ny_;
+  double dx_;
+  double dy_;
+  double side_;
+  //accumulated column and row origins, as when adding the bins
+  std::vector<double> xEdges_;
+  std::vector<double> yEdges_;
+  //triangles: row origins of even and odd columns
+  std::vector<double> yEdgesOdd_;
+  //hexagons: row origins per distinct column start, index per column
+  std::vector<std::vector<double> > yColumns_;
+  std::vector<unsigned> yColumnIdx_;
+  std::vector<unsigned> binOffset_;
+  std::vector<unsigned> nInColumn_;
+
+};
+
+
+#endif
@@ -6,9 +6,10 @@
 #include <string>
 #include <vector>
 #include <map>
-#include "TRandom3.h"
+#include "TH1.h"
 #include "TH2D.h"
 #include "HGCSSDetector.hh"
+#include "HGCSSRandomStream.hh"
 
 class HGCSSDigitisation {
 
@@ -20,9 +21,10 @@ public:
     crossTalk_(0.25),
     ipXtalk_(0.025),
     nTotal_(1156),
-    sigmaPix_(3)
+    sigmaPix_(3),
+    layersValid_(false)
   {
-    rndm_.SetSeed(seed_);
+    rndm_.setSeed(seed_);
     //noise_[DetectorEnum::ECAL] = 0.12;
     //noise_[DetectorEnum::FHCAL] = 0.12;
     //noise_[DetectorEnum::BHCAL] = 0.12;
@@ -59,6 +61,7 @@ public:
   ~HGCSSDigitisation(){};
 
   inline void setIntercalibrationFactor(const unsigned icFactor){
+    layersValid_ = false;
     gainSmearing_[DetectorEnum::FECAL] = icFactor/100.;
     gainSmearing_[DetectorEnum::MECAL] = icFactor/100.;
     gainSmearing_[DetectorEnum::BECAL] = icFactor/100.;
@@ -69,7 +72,13 @@ public:
 
   inline void setRandomSeed(const unsigned aSeed){
     seed_ = aSeed;
-    rndm_.SetSeed(seed_);
+    rndm_.setSeed(seed_);
+  };
+
+  //random numbers drawn from now on: stream (seed, event, stream),
+  //e.g. one per layer, independent of what was drawn before
+  inline void setRandomStream(const unsigned ievt, const unsigned stream){
+    rndm_.setStream(ievt,stream);
   };
 
   inline void setNpe(const unsigned aNpe){
@@ -93,14 +102,17 @@ public:
   };
 
   inline void setNoise(const unsigned & alay, const double & aNoise){
+    layersValid_ = false;
     noise_[alay] = aNoise;
   };
 
   inline void setMipToADC(DetectorEnum adet, const double & aMipToADC){
+    layersValid_ = false;
     mipToADC_[adet] = aMipToADC;
   };
 
   inline void setMaxADC(DetectorEnum adet, const double & aMaxADC){
+    layersValid_ = false;
     maxADC_[adet] = aMaxADC;
   };
 
@@ -109,6 +121,7 @@ public:
   };
 
   inline void setGainSmearing(DetectorEnum adet, const double & aVal){
+    layersValid_ = false;
     gainSmearing_[adet] = aVal;
   };
 
@@ -137,12 +150,43 @@ public:
 
   double ipXtalk(const std::vector<double> & aSimEvec);
 
-  void addNoise(double & aDigiE, const unsigned & alay, TH1F * & hist);
+  void addNoise(double & aDigiE, const unsigned & alay, TH1 * hist);
+
+  //sparse noise: probability for a noise-only cell to reach aThreshMip,
+  //number of such cells out of nCells, and their noise drawn from the
+  //gaussian tail above aThreshMip.
+  double noiseTailProbability(const double & aThreshMip, const unsigned & alay);
+
+  inline unsigned nNoiseCells(const unsigned nCells, const double & aProb){
+    return rndm_.Binomial(nCells,aProb);
+  };
+
+  inline unsigned randomInteger(const unsigned n){
+    return rndm_.Integer(n);
+  };
+
+  double tailNoise(const double & aThreshMip, const unsigned & alay, TH1 * hist);
   
   unsigned adcConverter(double eMIP, DetectorEnum adet);
 
   double adcToMIP(const unsigned acdCounts, DetectorEnum adet, const bool smear=true);
 
+  //all the cells of layer alay at once: addNoise then, for Si layers,
+  //adcConverter and adcToMIP. The layer parameters come from a table
+  //resolved once from the current settings and the gaussian numbers are
+  //drawn in blocks: same distributions as the per-cell path, different
+  //random sequence. aE: energies in MIPs, replaced by the digitised ones.
+  //adc: 0 outside Si. noiseDone: 0, or non-zero for the cells which
+  //already have their noise (sparse noise tail). noisyE: 0, or the
+  //energies with noise before the adc conversion.
+  void digitiseLayer(const unsigned alay,
+		     const unsigned nCells,
+		     double * aE,
+		     unsigned * adc,
+		     const unsigned char * noiseDone,
+		     TH1 * hist,
+		     double * noisyE=0);
+
   double MIPtoGeV(const HGCSSSubDetector & adet, 
 		  const double & aMipE);
 
@@ -158,13 +202,30 @@ private:
   double ipXtalk_;
   unsigned nTotal_;
   unsigned sigmaPix_;
-  TRandom3 rndm_;
+  HGCSSRandomStream rndm_;
   std::map<DetectorEnum,unsigned> mipToADC_;
   std::map<DetectorEnum,unsigned> maxADC_;
   std::map<DetectorEnum,double> timeCut_;
   std::map<DetectorEnum,double> gainSmearing_;
   std::map<unsigned,double> noise_;
 
+  //parameters of a layer for digitiseLayer
+  struct LayerDigi{
+    double noise;
+    double mipToADC;
+    double maxADC;
+    double gainSmearing;
+    bool isSi;
+  };
+  void fillLayerTable();
+  //n standard gaussian numbers in gaus_, Box-Muller on uniform blocks
+  void gausBlock(const unsigned n);
+
+  bool layersValid_;
+  std::vector<LayerDigi> layers_;
+  std::vector<double> uniforms_;
+  std::vector<double> gaus_;
+
 };
 
 #endif
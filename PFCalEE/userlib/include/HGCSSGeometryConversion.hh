@@ -5,11 +5,14 @@
 #include <iostream>
 #include <string>
 #include <vector>
+#include <map>
 #include <cmath>
 #include "TH2D.h"
 #include "TH2Poly.h"
 #include "TMath.h"
 #include "HGCSSDetector.hh"
+#include "HGCSSCellIndexer.hh"
+#include "HGCSSCellGeometryCache.hh"
 
 struct MergeCells {
   double energy;
@@ -17,6 +20,70 @@ struct MergeCells {
   //double z;
 };
 
+//Cells of one layer: entries stored contiguously, with a dense
+//index on cellid, so that lookups are O(1) and clear() only
+//touches the filled cells. Same interface as the
+//std::map<unsigned,MergeCells> it replaces: begin() iterates in
+//increasing cellid order. Iterators are invalidated by insertions.
+class HGCSSCellMap{
+
+public:
+  typedef std::pair<unsigned,MergeCells> value_type;
+  typedef std::vector<value_type>::iterator iterator;
+
+  HGCSSCellMap():
+    sorted_(true)
+  {};
+
+  ~HGCSSCellMap(){};
+
+  std::pair<iterator,bool> insert(const value_type & aCell);
+
+  //zero-initialised cell if not present
+  MergeCells & operator[](const unsigned cellid);
+
+  inline iterator find(const unsigned cellid){
+    int pos = position(cellid);
+    return pos<0 ? entries_.end() : entries_.begin()+pos;
+  };
+
+  iterator begin();
+
+  inline iterator end(){
+    return entries_.end();
+  };
+
+  inline unsigned size() const{
+    return entries_.size();
+  };
+
+  inline bool empty() const{
+    return entries_.empty();
+  };
+
+  void clear();
+
+private:
+
+  inline int position(const unsigned cellid) const{
+    if (cellid < index_.size()) return index_[cellid];
+    if (cellid < maxDenseId_) return -1;
+    std::map<unsigned,int>::const_iterator lIter = farIndex_.find(cellid);
+    return lIter == farIndex_.end() ? -1 : lIter->second;
+  };
+
+  void setPosition(const unsigned cellid, const int pos);
+
+  //ids above (eg. TH2Poly overflow codes) go to farIndex_
+  static const unsigned maxDenseId_ = 1<<22;
+
+  std::vector<value_type> entries_;
+  std::vector<int> index_;
+  std::map<unsigned,int> farIndex_;
+  bool sorted_;
+
+};
+
 
 class HGCSSGeometryConversion{
   
@@ -62,6 +129,48 @@ public:
     return &hsq2;
   };
 
+  //closed-form equivalents of FindBin on the maps above,
+  //set up by the corresponding initialise* function
+  inline HGCSSCellIndexer *hexagonIndexer(){
+    static HGCSSCellIndexer hc;
+    return &hc;
+  };
+
+  inline HGCSSCellIndexer *diamondIndexer(){
+    static HGCSSCellIndexer hc;
+    return &hc;
+  };
+
+  inline HGCSSCellIndexer *triangleIndexer(){
+    static HGCSSCellIndexer hc;
+    return &hc;
+  };
+
+  inline HGCSSCellIndexer *squareIndexer(){
+    static HGCSSCellIndexer hsq;
+    return &hsq;
+  };
+
+  inline HGCSSCellIndexer *squareIndexer1(){
+    static HGCSSCellIndexer hsq1;
+    return &hsq1;
+  };
+
+  inline HGCSSCellIndexer *squareIndexer2(){
+    static HGCSSCellIndexer hsq2;
+    return &hsq2;
+  };
+
+  //if open, the initialise* functions take the cells of the maps found
+  //in the cache and leave the TH2Poly maps empty: use the indexers
+  //instead of FindBin. Maps not found in the cache are built as usual.
+  inline static HGCSSCellGeometryCache & cellGeometryCache(){
+    static HGCSSCellGeometryCache lCache;
+    return lCache;
+  };
+
+  static bool openCellGeometryCache(const std::string & filePath);
+
   inline TH2Poly *hexagonMap(TH2Poly & hc){
     return &hc;
   };
@@ -121,20 +230,21 @@ public:
   void initialiseSquareMap1(const double xmin, const double xmax, const double ymin, const double ymax, const double side);
   void initialiseSquareMap2(const double xmin, const double xmax, const double ymin, const double ymax, const double side);
 
-  void initialiseSquareMap(TH2Poly *map, const double xymin, const double side, bool print);
-  void initialiseSquareMap(TH2Poly *map, const double xmin, const double xmax, const double ymin, const double ymax, const double side, bool print);
+  //map can be 0 to only set up the indexer
+  void initialiseSquareMap(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer=0);
+  void initialiseSquareMap(TH2Poly *map, const double xmin, const double xmax, const double ymin, const double ymax, const double side, bool print, HGCSSCellIndexer *indexer=0);
 
   void initialiseDiamondMap(const double xymin, const double side);
 
-  void initialiseDiamondMap(TH2Poly *map, const double xymin, const double side, bool print);
+  void initialiseDiamondMap(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer=0);
 
   void initialiseTriangleMap(const double xymin, const double side);
 
-  void initialiseTriangleMap(TH2Poly *map, const double xymin, const double side, bool print);
+  void initialiseTriangleMap(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer=0);
 
   void initialiseHoneyComb(const double xymin, const double side);
 
-  void initialiseHoneyComb(TH2Poly *map, const double xymin, const double side, bool print);
+  void initialiseHoneyComb(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer=0);
 
   void fillXY(TH2Poly* hist, std::map<int,std::pair<double,double> > & geom);
 
@@ -228,17 +338,23 @@ public:
   */
 
   //with maps of MergeCells struct
-  double sumBins(const std::map<unsigned,MergeCells> & aHistVec,
+  double sumBins(const HGCSSCellMap & aHistVec,
 		 const double & aMipThresh=0.);
 
-  void resetVector(std::map<unsigned,MergeCells> & aVec);
+  void resetVector(HGCSSCellMap & aVec);
 
-  void deleteHistos(std::map<unsigned,MergeCells> & aVec);
+  void deleteHistos(HGCSSCellMap & aVec);
 
-  std::map<unsigned,MergeCells> & get2DHist(const unsigned layer);
+  HGCSSCellMap & get2DHist(const unsigned layer);
 
 private:
 
+  //index of the map in the cell geometry cache, -1 if not there
+  int cachedMap(const unsigned aType, const double p0, const double p1,
+		const double p2=0, const double p3=0, const double p4=0);
+
+  void fillFromCache(const unsigned iMap, HGCSSCellIndexer *indexer, std::map<int,std::pair<double,double> > & geom);
+
   void myHoneycomb(TH2Poly* map,
 		   Double_t xstart,
 		   Double_t ystart,
@@ -259,9 +375,9 @@ private:
   //std::map<DetectorEnum,std::vector<TH2Poly *> > HistMapZ_;
   //std::map<DetectorEnum,std::vector<double> > avgMapZ_;
   //std::map<DetectorEnum,std::vector<double> > avgMapE_;
-  std::map<unsigned,std::map<unsigned,MergeCells> > HistMap_;
-  std::map<unsigned,double> avgMapZ_;
-  std::map<unsigned,double> avgMapE_;
+  std::vector<HGCSSCellMap> HistMap_;
+  std::vector<double> avgMapZ_;
+  std::vector<double> avgMapE_;
 
 
 };
@@ -0,0 +1,107 @@
+#ifndef HGCSSHitColumns_h
+#define HGCSSHitColumns_h
+
+#include <string>
+#include <vector>
+#include "TTree.h"
+
+#include "HGCSSSimHit.hh"
+#include "HGCSSRecoHit.hh"
+
+//Columnar (structure of arrays) storage of the hit vectors: one
+//std::vector branch per field, named <prefix>_<field>, with prefix the
+//object branch name without "Vec" (e.g. HGCSSSimHit_energy), so that
+//only the needed columns are read.
+//
+//Writing: branch(tree,"HGCSSSimHitVec") once, fill(hits) before each
+//tree->Fill().
+//Reading: attach(tree,"HGCSSSimHitVec",hitvec,"energy,cellid") sets
+//hitvec to the object branch if the tree has it, else to a vector
+//rebuilt by update() after each GetEntry from the listed columns
+//(empty list for all). Fields of columns not read are 0.
+
+class HGCSSSimHitColumns{
+
+public:
+  HGCSSSimHitColumns();
+  ~HGCSSSimHitColumns(){};
+
+  //field names, in the order of the columns
+  static const std::vector<std::string> & fields();
+
+  //true if the tree has the columns of objBranch
+  static bool isColumnar(TTree *tree, const std::string & objBranch);
+
+  void branch(TTree *tree, const std::string & objBranch="HGCSSSimHitVec");
+  void fill(const HGCSSSimHitVec & hits);
+
+  bool attach(TTree *tree, const std::string & objBranch,
+	      HGCSSSimHitVec *& hits, const std::string & columns="");
+  void update();
+
+private:
+  std::vector<double> energy_;
+  std::vector<double> time_;
+  std::vector<double> zpos_;
+  std::vector<unsigned> layer_;
+  std::vector<unsigned> cellid_;
+  std::vector<unsigned> nGammas_;
+  std::vector<unsigned> nElectrons_;
+  std::vector<unsigned> nMuons_;
+  std::vector<unsigned> nNeutrons_;
+  std::vector<unsigned> nProtons_;
+  std::vector<unsigned> nHadrons_;
+  std::vector<int> trackIDMainParent_;
+  std::vector<double> energyMainParent_;
+
+  //ROOT needs the address of a pointer to each column
+  std::vector<void*> ptrs_;
+  std::vector<bool> active_;
+  bool columnar_;
+  HGCSSSimHitVec hits_;
+
+  //ptrs_ point to the members: not copyable
+  HGCSSSimHitColumns(const HGCSSSimHitColumns &);
+  HGCSSSimHitColumns & operator=(const HGCSSSimHitColumns &);
+
+};
+
+class HGCSSRecoHitColumns{
+
+public:
+  HGCSSRecoHitColumns();
+  ~HGCSSRecoHitColumns(){};
+
+  static const std::vector<std::string> & fields();
+
+  static bool isColumnar(TTree *tree, const std::string & objBranch);
+
+  void branch(TTree *tree, const std::string & objBranch="HGCSSRecoHitVec");
+  void fill(const HGCSSRecoHitVec & hits);
+
+  bool attach(TTree *tree, const std::string & objBranch,
+	      HGCSSRecoHitVec *& hits, const std::string & columns="");
+  void update();
+
+private:
+  std::vector<double> energy_;
+  std::vector<unsigned> adcCounts_;
+  std::vector<double> xpos_;
+  std::vector<double> ypos_;
+  std::vector<double> zpos_;
+  std::vector<unsigned> layer_;
+  std::vector<double> noiseFrac_;
+  std::vector<double> time_;
+
+  std::vector<void*> ptrs_;
+  std::vector<bool> active_;
+  bool columnar_;
+  HGCSSRecoHitVec hits_;
+
+  //ptrs_ point to the members: not copyable
+  HGCSSRecoHitColumns(const HGCSSRecoHitColumns &);
+  HGCSSRecoHitColumns & operator=(const HGCSSRecoHitColumns &);
+
+};
+
+#endif
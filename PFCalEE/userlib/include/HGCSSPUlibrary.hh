@@ -0,0 +1,78 @@
+#ifndef HGCSSPUlibrary_h
+#define HGCSSPUlibrary_h
+
+#include <string>
+#include <vector>
+#include <stdint.h>
+
+//one simhit of a packed minbias event
+struct HGCSSPUhit {
+  uint32_t layer;//3*layer+silayer, as in HGCSSSimHit
+  uint32_t cellid;
+  double energy;
+  double time;
+  double zpos;
+};
+
+//Pileup library: minbias HGCSSSimHitVec packed into a flat binary
+//file, memory-mapped for mixing. Layout (native endianness):
+// header | uint64 hit offsets[nEvents+1] | HGCSSPUhit[nHits] | sources
+//where sources lists the input files with their first event and
+//number of events. Only hits with energy>0 are stored.
+class HGCSSPUlibrary{
+
+public:
+  HGCSSPUlibrary();
+  ~HGCSSPUlibrary();
+
+  //pack the HGCSSTree of the input files, maxEvents=0 for all
+  static bool pack(const std::vector<std::string> & inputFiles,
+		   const std::string & outputFile,
+		   const unsigned maxEvents=0);
+
+  //files in a local directory containing pattern and not veto, sorted
+  static std::vector<std::string> findFiles(const std::string & dirPath,
+					    const std::string & pattern="HGcal",
+					    const std::string & veto="Digi");
+
+  static bool isLibrary(const std::string & filePath);
+
+  bool open(const std::string & filePath);
+  void close();
+
+  inline bool isOpen() const{
+    return data_ != 0;
+  };
+
+  inline unsigned nEvents() const{
+    return nEvents_;
+  };
+
+  inline unsigned nHits(const unsigned ievt) const{
+    return offsets_[ievt+1]-offsets_[ievt];
+  };
+
+  inline const HGCSSPUhit * hits(const unsigned ievt) const{
+    return hits_+offsets_[ievt];
+  };
+
+  inline const std::vector<std::string> & sources() const{
+    return sources_;
+  };
+
+  //range of events from a given input file, false if not packed
+  bool sourceRange(const std::string & inputFile, unsigned & first, unsigned & n) const;
+
+private:
+  const char * data_;
+  size_t size_;
+  unsigned nEvents_;
+  const uint64_t * offsets_;
+  const HGCSSPUhit * hits_;
+  std::vector<std::string> sources_;
+  std::vector<unsigned> sourceFirst_;
+  std::vector<unsigned> sourceN_;
+
+};
+
+#endif
@@ -0,0 +1,59 @@
+#ifndef HGCSSRandomStream_h
+#define HGCSSRandomStream_h
+
+#include <stdint.h>
+#include "RVersion.h"
+#include "TRandom.h"
+
+//Counter-based random numbers (Philox4x32-10, Salmon et al., SC'11):
+//the n-th number of stream (seed, event, stream) is a function of these
+//four integers only. The numbers drawn for an event, e.g. one stream per
+//layer, do not depend on the events processed before, nor on which
+//thread or job processes it. Gaus, Poisson, Binomial, Integer... are
+//those of TRandom, drawing from Rndm().
+class HGCSSRandomStream : public TRandom {
+
+public:
+  //for the draws of an event which are not attached to a layer
+  static const unsigned EventStream = 0xFFFFFFFF;
+
+  HGCSSRandomStream(const unsigned aSeed=0);
+  ~HGCSSRandomStream(){};
+
+  //both restart the stream from its first number
+  void setSeed(const unsigned aSeed);
+  void setStream(const unsigned event, const unsigned stream);
+
+  inline unsigned seed() const{
+    return seed_;
+  };
+
+  //in ]0,1[, 32 random bits
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+  Double_t Rndm();
+#else
+  Double_t Rndm(Int_t i=0);
+#endif
+  void RndmArray(Int_t n, Float_t *array);
+  void RndmArray(Int_t n, Double_t *array);
+
+private:
+  inline double next(){
+    if (used_==4) nextBlock();
+    //(u+0.5)/2^32
+    return (buffer_[used_++]+0.5)*2.3283064365386963e-10;
+  };
+
+  //4 new numbers from the current counter
+  void nextBlock();
+
+  uint32_t seed_;
+  uint32_t event_;
+  uint32_t stream_;
+  uint64_t block_;
+  uint32_t buffer_[4];
+  unsigned used_;
+
+};
+
+#endif
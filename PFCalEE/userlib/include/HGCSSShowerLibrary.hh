@@ -0,0 +1,125 @@
+#ifndef HGCSSShowerLibrary_h
+#define HGCSSShowerLibrary_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+#include <stdint.h>
+
+//one energy spot of a frozen shower
+struct HGCSSShowerSpot {
+  int16_t element;//element of the calorimeter stack, w.r.t. the starting one
+  uint16_t depth;//position in the element, 0=front to 65535=back
+  float x;//mm, w.r.t. the starting point, along the transverse direction of the particle
+  float y;//mm
+  float energy;//fraction of the particle kinetic energy
+};
+
+//one frozen shower of a library bin
+struct HGCSSShowerTemplate {
+  uint64_t firstSpot;
+  uint32_t nSpots;
+  float energy;//MeV, kinetic energy of the recorded particle
+};
+
+//Frozen shower library: energy spots of low energy e+/e-/gamma showers,
+//recorded in the full simulation (/N03/det/frozenShowerRecord) and
+//packed per bin of particle, material of the starting element, kinetic
+//energy, cos(theta) and depth in the starting element, memory-mapped by
+//the simulation (/N03/det/frozenShowerLibrary). Layout (native
+//endianness):
+// header | double energy edges[nE+1] | double cos(theta) edges[nA+1]
+// | uint64 template offsets[nBins+1] | HGCSSShowerTemplate[nTemplates]
+// | HGCSSShowerSpot[nSpots] | material names
+//Record files: header, then per shower particle, material name, energy,
+//cos(theta), depth and spots.
+class HGCSSShowerLibrary{
+
+public:
+  enum Particle {
+    gamma=0,
+    electron=1,
+    positron=2,
+    nParticles=3
+  };
+
+  HGCSSShowerLibrary();
+  ~HGCSSShowerLibrary();
+
+  //-1 if not e+/e-/gamma
+  static int particle(const int pdgId);
+
+  static bool writeRecordHeader(std::ostream & aOs);
+  static bool writeRecord(std::ostream & aOs, const unsigned aParticle,
+			  const std::string & aMaterial, const float aEnergy,
+			  const float aCosTheta, const float aDepth,
+			  const std::vector<HGCSSShowerSpot> & aSpots);
+
+  //pack record files, keeping at most maxTemplates showers per bin
+  //(drawn uniformly among the recorded ones)
+  static bool pack(const std::vector<std::string> & recordFiles,
+		   const std::string & outputFile,
+		   const std::vector<double> & energyEdges,
+		   const std::vector<double> & cosThetaEdges,
+		   const unsigned nDepthBins,
+		   const unsigned maxTemplates);
+
+  static bool isLibrary(const std::string & filePath);
+
+  bool open(const std::string & filePath);
+  void close();
+
+  inline bool isOpen() const{
+    return data_ != 0;
+  };
+
+  inline const std::vector<std::string> & materials() const{
+    return materials_;
+  };
+
+  //-1 if not in the library
+  int material(const std::string & aName) const;
+
+  inline double minEnergy() const{
+    return nEnergyBins_>0 ? energyEdges_[0] : 0;
+  };
+
+  inline double maxEnergy() const{
+    return nEnergyBins_>0 ? energyEdges_[nEnergyBins_] : 0;
+  };
+
+  //-1 if outside of the library bins
+  int bin(const unsigned aParticle, const int aMaterial,
+	  const double & aEnergy, const double & aCosTheta,
+	  const double & aDepth) const;
+
+  inline unsigned nTemplates(const unsigned aBin) const{
+    return offsets_[aBin+1]-offsets_[aBin];
+  };
+
+  inline const HGCSSShowerTemplate & getTemplate(const unsigned aBin, const unsigned idx) const{
+    return templates_[offsets_[aBin]+idx];
+  };
+
+  inline const HGCSSShowerSpot * spots(const HGCSSShowerTemplate & aTemplate) const{
+    return spots_+aTemplate.firstSpot;
+  };
+
+  void Print(std::ostream & aOs) const;
+
+private:
+  const char * data_;
+  size_t size_;
+  unsigned nEnergyBins_;
+  unsigned nAngleBins_;
+  unsigned nDepthBins_;
+  const double * energyEdges_;
+  const double * cosThetaEdges_;
+  const uint64_t * offsets_;
+  const HGCSSShowerTemplate * templates_;
+  const HGCSSShowerSpot * spots_;
+  std::vector<std::string> materials_;
+
+};
+
+#endif
@@ -0,0 +1,92 @@
+#ifndef HGCSSShowerParameters_h
+#define HGCSSShowerParameters_h
+
+#include <string>
+#include <vector>
+#include <iostream>
+
+//Parameters of the GFlash-like EM shower profiles of the fast
+//simulation (Grindhammer et al., NIM A290 (1990) 469), written as
+//functions of lnE, E in GeV:
+// longitudinal: gamma distribution in depth t (X0), with
+//   <lnT> = ln(tMean0+tMean1*lnE),   1/sigma(lnT) = tSigma0+tSigma1*lnE,
+//   <lnA> = ln(aMean0+aMean1*lnE),   1/sigma(lnA) = aSigma0+aSigma1*lnE,
+//   correlation(lnT,lnA) = rho0+rho1*lnE, T the maximum, A=alpha.
+// lateral, tau=t/T, radii in Moliere radii:
+//   core RC = rCore0+rCore1*lnE+rCore2*tau,
+//   tail RT = rTail1*(exp(rTail3*(tau-rTail2))+exp((rTail40+rTail41*lnE)*(tau-rTail2))),
+//   core fraction p = pCore1*exp(x-exp(x)), x=(pCore2-tau)/(pCore30+pCore31*lnE).
+// sampling: stochastic term of the sensitive energy (sqrt(GeV)), scale
+//   of the sensitive energy w.r.t. the mip-like dE/dx sharing, number
+//   of lateral spots spotN0*E^spotN1.
+//The defaults are the homogeneous medium values for the effective Z
+//and critical energy of the stack. Parameter files are "name value"
+//lines, '#' for comments; parameters not listed keep their value.
+class HGCSSShowerParameters{
+
+public:
+
+  enum Parameter {
+    tMean0,tMean1,tSigma0,tSigma1,
+    aMean0,aMean1,aSigma0,aSigma1,
+    rho0,rho1,
+    rCore0,rCore1,rCore2,
+    rTail1,rTail2,rTail3,rTail40,rTail41,
+    pCore1,pCore2,pCore30,pCore31,
+    moliereRadius,//mm, 0: from the materials
+    samplingTerm,
+    sensitiveScale,
+    spotN0,spotN1,
+    nParameters
+  };
+
+  HGCSSShowerParameters();
+  ~HGCSSShowerParameters(){};
+
+  //homogeneous medium values, Z and critical energy (MeV) of the stack
+  void setDefaults(const double & Z, const double & EcMeV);
+
+  static const char * name(const unsigned aPar);
+
+  inline double get(const Parameter aPar) const{
+    return par_[aPar];
+  };
+
+  inline void set(const Parameter aPar, const double & aVal){
+    par_[aPar] = aVal;
+    isSet_[aPar] = true;
+  };
+
+  //true if read from a file or set
+  inline bool isSet(const Parameter aPar) const{
+    return isSet_[aPar];
+  };
+
+  bool read(const std::string & fileName);
+
+  //all parameters, or only those set if onlySet
+  bool write(const std::string & fileName, const bool onlySet=false) const;
+
+  void Print(std::ostream & aOs) const;
+
+  //profile parameters at energy E (lnE=ln(E/GeV))
+  double meanLnT(const double & lnE) const;
+  double sigmaLnT(const double & lnE) const;
+  double meanLnAlpha(const double & lnE) const;
+  double sigmaLnAlpha(const double & lnE) const;
+  double correlation(const double & lnE) const;
+  double coreRadius(const double & lnE, const double & tau) const;
+  double tailRadius(const double & lnE, const double & tau) const;
+  double coreFraction(const double & lnE, const double & tau) const;
+  double nSpots(const double & energyGeV) const;
+
+  //regularised lower incomplete gamma function P(a,x)
+  static double gammaCDF(const double & a, const double & x);
+
+private:
+  std::vector<double> par_;
+  std::vector<bool> isSet_;
+
+};
+
+#endif
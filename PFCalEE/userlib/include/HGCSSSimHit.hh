@@ -23,8 +23,13 @@ static const float CELL_SIZE_X=6.496345; //2.5;//mm
 //static const float CELL_SIZE_X=4.76;//mm
 static const float CELL_SIZE_Y=CELL_SIZE_X;
 
+class HGCSSSimHitColumns;
+
 class HGCSSSimHit{
 
+  //columnar I/O needs all the fields
+  friend class HGCSSSimHitColumns;
+
 public:
   HGCSSSimHit():
     energy_(0),
@@ -44,6 +49,27 @@ public:
     
   };
   HGCSSSimHit(const G4SiHit & aSiHit, const unsigned & asilayer, TH2Poly* map, const float cellSize = CELL_SIZE_X, const bool etaphimap = false);
+  HGCSSSimHit(const G4SiHit & aSiHit, const unsigned & asilayer, const HGCSSCellIndexer & indexer, const bool etaphimap = false);
+  //e.g. from a pileup library record: no particle counts,
+  //alayer is 3*layer+silayer and atime already divided by energy.
+  HGCSSSimHit(const unsigned alayer, const unsigned acellid,
+	      const double aenergy, const double atime, const double azpos):
+    energy_(aenergy),
+    time_(atime),
+    zpos_(azpos),
+    layer_(alayer),
+    cellid_(acellid),
+    nGammas_(0),
+    nElectrons_(0),
+    nMuons_(0),
+    nNeutrons_(0),
+    nProtons_(0),
+    nHadrons_(0),
+    trackIDMainParent_(0),
+    energyMainParent_(0)
+  {
+
+  };
 
   ~HGCSSSimHit(){};
 
@@ -236,6 +262,9 @@ public:
 
 private:
 
+  //all but the cellid
+  void initialise(const G4SiHit & aSiHit, const unsigned & asilayer);
+
   double energy_;
   double time_;
   double zpos_;
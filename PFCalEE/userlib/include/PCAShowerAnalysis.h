@@ -4,7 +4,6 @@
 #include "HGCSSRecoHit.hh"
 #include "HGCSSCluster.hh"
 
-#include "TPrincipal.h"
 #include "Math/Vector3D.h"
 #include "Math/Vector3Dfwd.h"
 #include "Math/Point2D.h"
@@ -12,34 +11,46 @@
 
 #include "TVector3.h"
 
+//Weighted principal component analysis of the cluster hits.
+//Barycenter and covariance are accumulated in one pass over the hits,
+//each hit weighted by the number of rows it used to add to a
+//TPrincipal, and the covariance is normalised and diagonalised as in
+//TPrincipal::MakePrincipals.
 class PCAShowerAnalysis
 {
 
   public:
 
   PCAShowerAnalysis(bool segmented=true, bool logweighting=true, bool debug=false ) ;
-  
+
   void showerParameters( const HGCSSCluster & );
 
+  //all clusters of an event: entry i of each vector is set to the
+  //parameters of cluster i. Vectors are only reallocated when growing.
+  void showerParameters( const HGCSSClusterVec & clusters,
+			 std::vector<ROOT::Math::XYZPoint> & barycenters,
+			 std::vector<ROOT::Math::XYZVector> & axes,
+			 std::vector<ROOT::Math::XYZVector> & eigenValues,
+			 std::vector<ROOT::Math::XYZVector> & sigmas );
+
   ROOT::Math::XYZPoint showerBarycenter;
   ROOT::Math::XYZVector showerAxis;
   ROOT::Math::XYZVector showerEigenValues;
   ROOT::Math::XYZVector showerSigmas;
 
   ~PCAShowerAnalysis();
-  
+
 private:
 
-  TPrincipal *principal_;
-  
+  double weight(const double en) const;
+
   double mip_;
   double entryz_;
-  
+
   bool logweighting_;
   bool segmented_;
-  
-  bool alreadyfilled_;
+
   bool debug_;
-  
+
 };
 #endif
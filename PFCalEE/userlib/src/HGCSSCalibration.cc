@@ -76,9 +76,10 @@ double HGCSSCalibration::correctTime(const double & aTime,
 }
 
 double HGCSSCalibration::MeVToMip(const unsigned layer, const bool absWeight) const{
-  if (layer < theDetector().nLayers())
-    return theDetector().subDetectorByLayer(layer).mipWeight
-      *(absWeight?theDetector().subDetectorByLayer(layer).absWeight : 1.0);
+  if (layer < theDetector().nLayers()) {
+    const HGCSSSubDetector & subdet = theDetector().subDetectorByLayer(layer);
+    return subdet.mipWeight*(absWeight?subdet.absWeight : 1.0);
+  }
   return 1;
 }
 
@@ -95,24 +96,23 @@ double HGCSSCalibration::MeVToMip(const unsigned layer, const bool absWeight) co
   }*/
 
 double HGCSSCalibration::MeVToMip(const unsigned layer, const double aRadius, const bool absWeight) const{
-  double res = 1;
-  if (layer < theDetector().nLayers())
-    res = theDetector().subDetectorByLayer(layer).mipWeight
-      *(absWeight?theDetector().subDetectorByLayer(layer).absWeight : 1.0);
+  //one lookup per hit, exits for a layer out of range
+  const HGCSSSubDetector & subdet = theDetector().subDetectorByLayer(layer);
+  double res = subdet.mipWeight*(absWeight?subdet.absWeight : 1.0);
 
-  if (theDetector().subDetectorByLayer(layer).isSi == false) return res;
+  if (subdet.isSi == false) return res;
 
   if (bypassRadius_) return res*2./nSiLayers_;
 
   double r1 = 1200;
-  double r2 = theDetector().subDetectorByLayer(layer).radiusLim;
-  if (theDetector().subDetectorByLayer(layer).type == DetectorEnum::FHCAL) {
+  double r2 = subdet.radiusLim;
+  if (subdet.type == DetectorEnum::FHCAL) {
     r1 = 1000;
   }
   if (aRadius>r1) return res*2./3.;//300um
   else if (aRadius < r2) return res*2.;//100um
 
-  //std::cout<<"MeVToMip layer "<<layer<<" aRadius "<<aRadius<<" res "<<res<<" si "<<theDetector().subDetectorByLayer(layer).isSi<<std::endl;
+  //std::cout<<"MeVToMip layer "<<layer<<" aRadius "<<aRadius<<" res "<<res<<" si "<<subdet.isSi<<std::endl;
 
   return res;
 }
@@ -0,0 +1,413 @@
+#include "HGCSSCellGeometryCache.hh"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <map>
+#include <algorithm>
+#include <cstring>
+#include <cmath>
+#include <stdlib.h>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "TH2Poly.h"
+#include "TGraph.h"
+#include "TMath.h"
+#include "Math/Point3D.h"
+
+namespace {
+  const char cacheMagic[8] = {'H','G','C','S','C','G','E','O'};
+  //to be increased when a tiling of HGCSSGeometryConversion changes:
+  //all the caches written before are then stale.
+  const uint32_t cacheVersion = 1;
+  const unsigned maxParams = 6;
+
+  struct HGCSSCellCacheHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nMaps;
+    double refZ;
+  };
+
+  //geometry of one map while writing
+  struct MapContent {
+    HGCSSCellMapHeader header;
+    std::vector<HGCSSCellGeometry> cells;
+    std::vector<HGCSSCellVertex> vertices;
+    std::vector<uint32_t> neighbours;
+  };
+
+  inline uint64_t align8(const uint64_t pos){
+    return (pos+7)/8*8;
+  }
+
+  void hashBytes(uint64_t & hash, const void *data, const size_t size){
+    const unsigned char *bytes = (const unsigned char*)data;
+    for (size_t i(0); i<size; ++i){
+      hash ^= bytes[i];
+      hash *= 1099511628211ULL;
+    }
+  }
+
+  //vertices of the polygon of a bin, without the closing point
+  void binVertices(TH2PolyBin *aBin, std::vector<HGCSSCellVertex> & aVertices){
+    aVertices.clear();
+    TGraph *lGraph = (TGraph*)aBin->GetPolygon();
+    if (!lGraph) return;
+    const int n = lGraph->GetN();
+    for (int i(0); i<n; ++i){
+      if (i == n-1 && n>1 && lGraph->GetX()[i] == lGraph->GetX()[0] && lGraph->GetY()[i] == lGraph->GetY()[0]) break;
+      HGCSSCellVertex lVtx;
+      lVtx.x = lGraph->GetX()[i];
+      lVtx.y = lGraph->GetY()[i];
+      aVertices.push_back(lVtx);
+    }
+  }
+
+  double polygonArea(const std::vector<HGCSSCellVertex> & aVertices){
+    double lArea = 0;
+    for (unsigned i(0); i<aVertices.size(); ++i){
+      const HGCSSCellVertex & a = aVertices[i];
+      const HGCSSCellVertex & b = aVertices[(i+1)%aVertices.size()];
+      lArea += a.x*b.y-b.x*a.y;
+    }
+    return fabs(lArea)/2.;
+  }
+
+  bool fillMap(const HGCSSCellGeometryCache::Source & aSource, const double refZ, MapContent & aContent){
+    TH2Poly *lMap = aSource.map;
+    HGCSSCellMapHeader & lHeader = aContent.header;
+    memset(&lHeader,0,sizeof(HGCSSCellMapHeader));
+    lHeader.type = aSource.type;
+    lHeader.nParams = aSource.params.size();
+    for (unsigned iP(0); iP<aSource.params.size(); ++iP) lHeader.params[iP] = aSource.params[iP];
+    lHeader.checksum = HGCSSCellGeometryCache::checksum(aSource.type,aSource.params);
+    lHeader.xmin = lMap->GetXaxis()->GetXmin();
+    lHeader.xmax = lMap->GetXaxis()->GetXmax();
+    lHeader.ymin = lMap->GetYaxis()->GetXmin();
+    lHeader.ymax = lMap->GetYaxis()->GetXmax();
+    const unsigned nCells = lMap->GetNumberOfBins();
+    lHeader.nCells = nCells;
+    const bool isEtaPhi = HGCSSCellGeometryCache::isEtaPhi(aSource.type);
+
+    //polygons, in bin number order
+    std::vector<std::vector<HGCSSCellVertex> > lPolygons(nCells);
+    aContent.cells.resize(nCells);
+    double minSize = 0;
+    TIter next(lMap->GetBins());
+    TObject *obj=0;
+    TH2PolyBin *polyBin = 0;
+    while ((obj=next())){
+      polyBin=(TH2PolyBin*)obj;
+      const int id = polyBin->GetBinNumber();
+      if (id<1 || id>static_cast<int>(nCells)) {
+	std::cout << " -- Error, map " << HGCSSCellGeometryCache::mapName(aSource.type)
+		  << " has bin number " << id << " outside of 1-" << nCells << std::endl;
+	return false;
+      }
+      HGCSSCellGeometry & lCell = aContent.cells[id-1];
+      lCell.x = (polyBin->GetXMax()+polyBin->GetXMin())/2.;
+      lCell.y = (polyBin->GetYMax()+polyBin->GetYMin())/2.;
+      if (isEtaPhi) {
+	lCell.eta = lCell.x;
+	lCell.phi = lCell.y;
+      }
+      else {
+	ROOT::Math::XYZPoint lPos(lCell.x,lCell.y,refZ);
+	lCell.eta = lPos.eta();
+	lCell.phi = lPos.phi();
+      }
+      binVertices(polyBin,lPolygons[id-1]);
+      lCell.area = polygonArea(lPolygons[id-1]);
+      const double lSize = std::min(polyBin->GetXMax()-polyBin->GetXMin(),polyBin->GetYMax()-polyBin->GetYMin());
+      if (lSize>0 && (minSize==0 || lSize<minSize)) minSize = lSize;
+    }
+
+    //corners on a grid much finer than the cells: a shared corner
+    //falls in the same or in an adjacent node
+    const double tolerance = minSize>0 ? 1e-3*minSize : 1e-6;
+    typedef std::pair<long long,long long> Node;
+    std::map<Node,std::vector<uint32_t> > lCorners;
+    for (unsigned iC(0); iC<nCells; ++iC){
+      for (unsigned iV(0); iV<lPolygons[iC].size(); ++iV){
+	const Node lNode(llround(lPolygons[iC][iV].x/tolerance),llround(lPolygons[iC][iV].y/tolerance));
+	lCorners[lNode].push_back(iC+1);
+      }
+    }
+
+    for (unsigned iC(0); iC<nCells; ++iC){
+      HGCSSCellGeometry & lCell = aContent.cells[iC];
+      lCell.firstVertex = aContent.vertices.size();
+      lCell.nVertices = lPolygons[iC].size();
+      aContent.vertices.insert(aContent.vertices.end(),lPolygons[iC].begin(),lPolygons[iC].end());
+
+      std::vector<uint32_t> lNeighbours;
+      for (unsigned iV(0); iV<lPolygons[iC].size(); ++iV){
+	const long long nx = llround(lPolygons[iC][iV].x/tolerance);
+	const long long ny = llround(lPolygons[iC][iV].y/tolerance);
+	for (long long dx(-1); dx<2; ++dx){
+	  for (long long dy(-1); dy<2; ++dy){
+	    std::map<Node,std::vector<uint32_t> >::const_iterator lIter = lCorners.find(Node(nx+dx,ny+dy));
+	    if (lIter == lCorners.end()) continue;
+	    for (unsigned iN(0); iN<lIter->second.size(); ++iN){
+	      if (lIter->second[iN] != iC+1) lNeighbours.push_back(lIter->second[iN]);
+	    }
+	  }
+	}
+      }
+      std::sort(lNeighbours.begin(),lNeighbours.end());
+      lNeighbours.erase(std::unique(lNeighbours.begin(),lNeighbours.end()),lNeighbours.end());
+      lCell.firstNeighbour = aContent.neighbours.size();
+      lCell.nNeighbours = lNeighbours.size();
+      aContent.neighbours.insert(aContent.neighbours.end(),lNeighbours.begin(),lNeighbours.end());
+    }
+    lHeader.nVertices = aContent.vertices.size();
+    lHeader.nNeighbours = aContent.neighbours.size();
+    return true;
+  }
+}
+
+HGCSSCellGeometryCache::HGCSSCellGeometryCache():
+  data_(0),
+  size_(0),
+  refZ_(0),
+  nMaps_(0),
+  maps_(0)
+{
+}
+
+HGCSSCellGeometryCache::~HGCSSCellGeometryCache(){
+  close();
+}
+
+const char* HGCSSCellGeometryCache::mapName(const unsigned aType){
+  static const char* lNames[nMapTypes] = {"hexagon","diamond","triangle","square","square1","square2"};
+  return aType<nMapTypes ? lNames[aType] : "unknown";
+}
+
+int HGCSSCellGeometryCache::mapType(const std::string & aName){
+  for (unsigned iT(0); iT<nMapTypes; ++iT){
+    if (aName == mapName(iT)) return iT;
+  }
+  return -1;
+}
+
+unsigned HGCSSCellGeometryCache::nParams(const unsigned aType){
+  return isEtaPhi(aType) ? 5 : 2;
+}
+
+uint64_t HGCSSCellGeometryCache::checksum(const unsigned aType, const std::vector<double> & params){
+  //FNV-1a
+  uint64_t lHash = 14695981039346656037ULL;
+  const uint32_t lType = aType;
+  const uint32_t lN = params.size();
+  hashBytes(lHash,&cacheVersion,sizeof(uint32_t));
+  hashBytes(lHash,&lType,sizeof(uint32_t));
+  hashBytes(lHash,&lN,sizeof(uint32_t));
+  for (unsigned iP(0); iP<params.size(); ++iP) hashBytes(lHash,&params[iP],sizeof(double));
+  return lHash;
+}
+
+std::string HGCSSCellGeometryCache::spec(const unsigned aType, const std::vector<double> & params){
+  std::ostringstream lSpec;
+  lSpec << mapName(aType) << ":";
+  for (unsigned iP(0); iP<params.size(); ++iP){
+    //shortest text giving back the same double
+    std::ostringstream lVal;
+    lVal << std::setprecision(15) << params[iP];
+    if (atof(lVal.str().c_str()) != params[iP]) {
+      lVal.str("");
+      lVal << std::setprecision(17) << params[iP];
+    }
+    lSpec << (iP>0 ? "," : "") << lVal.str();
+  }
+  return lSpec.str();
+}
+
+bool HGCSSCellGeometryCache::parseSpec(const std::string & aSpec, unsigned & aType, std::vector<double> & params){
+  const size_t lPos = aSpec.find(":");
+  const int lType = mapType(aSpec.substr(0,lPos));
+  if (lPos == aSpec.npos || lType<0) {
+    std::cout << " -- Error, map " << aSpec << " should be <hexagon|diamond|triangle|square|square1|square2>:<parameters>." << std::endl;
+    return false;
+  }
+  aType = lType;
+  params.clear();
+  std::istringstream lList(aSpec.substr(lPos+1));
+  std::string lItem;
+  while (std::getline(lList,lItem,',')){
+    if (lItem == "pi") params.push_back(TMath::Pi());
+    else if (lItem == "-pi") params.push_back(-1.*TMath::Pi());
+    else params.push_back(atof(lItem.c_str()));
+  }
+  if (params.size() != nParams(aType)) {
+    std::cout << " -- Error, map " << aSpec << ": expect " << nParams(aType) << " parameters." << std::endl;
+    return false;
+  }
+  return true;
+}
+
+bool HGCSSCellGeometryCache::isCache(const std::string & filePath){
+  const std::string ext = ".cgeo";
+  return filePath.size() > ext.size() &&
+    filePath.compare(filePath.size()-ext.size(),ext.size(),ext) == 0;
+}
+
+bool HGCSSCellGeometryCache::write(const std::string & filePath,
+				   const std::vector<Source> & maps,
+				   const double refZ){
+  std::vector<MapContent> lContents(maps.size());
+  uint64_t lPos = sizeof(HGCSSCellCacheHeader)+maps.size()*sizeof(HGCSSCellMapHeader);
+  for (unsigned iM(0); iM<maps.size(); ++iM){
+    if (!maps[iM].map || maps[iM].type>=nMapTypes || maps[iM].params.size()>maxParams) {
+      std::cout << " -- Error, invalid map " << iM << " for the cell geometry cache." << std::endl;
+      return false;
+    }
+    if (!fillMap(maps[iM],refZ,lContents[iM])) return false;
+    HGCSSCellMapHeader & lHeader = lContents[iM].header;
+    lHeader.cellStart = lPos;
+    lHeader.vertexStart = lHeader.cellStart+lHeader.nCells*sizeof(HGCSSCellGeometry);
+    lHeader.neighbourStart = lHeader.vertexStart+lHeader.nVertices*sizeof(HGCSSCellVertex);
+    lPos = align8(lHeader.neighbourStart+lHeader.nNeighbours*sizeof(uint32_t));
+    std::cout << " -- Map " << spec(lHeader.type,maps[iM].params) << ": " << lHeader.nCells << " cells, "
+	      << lHeader.nNeighbours << " neighbours." << std::endl;
+  }
+
+  std::ofstream lOut(filePath.c_str(),std::ios::binary);
+  if (!lOut.is_open()) {
+    std::cout << " -- Error, cannot open " << filePath << " for writing." << std::endl;
+    return false;
+  }
+  HGCSSCellCacheHeader lHeader;
+  memset(&lHeader,0,sizeof(HGCSSCellCacheHeader));
+  memcpy(lHeader.magic,cacheMagic,8);
+  lHeader.version = cacheVersion;
+  lHeader.nMaps = maps.size();
+  lHeader.refZ = refZ;
+  lOut.write((const char*)&lHeader,sizeof(HGCSSCellCacheHeader));
+  for (unsigned iM(0); iM<lContents.size(); ++iM){
+    lOut.write((const char*)&lContents[iM].header,sizeof(HGCSSCellMapHeader));
+  }
+  const char lPad[8] = {0,0,0,0,0,0,0,0};
+  for (unsigned iM(0); iM<lContents.size(); ++iM){
+    const MapContent & lContent = lContents[iM];
+    if (lContent.cells.size()) lOut.write((const char*)&lContent.cells[0],lContent.cells.size()*sizeof(HGCSSCellGeometry));
+    if (lContent.vertices.size()) lOut.write((const char*)&lContent.vertices[0],lContent.vertices.size()*sizeof(HGCSSCellVertex));
+    if (lContent.neighbours.size()) lOut.write((const char*)&lContent.neighbours[0],lContent.neighbours.size()*sizeof(uint32_t));
+    const uint64_t lEnd = lContent.header.neighbourStart+lContent.header.nNeighbours*sizeof(uint32_t);
+    lOut.write(lPad,align8(lEnd)-lEnd);
+  }
+  lOut.close();
+  if (lOut.fail()) {
+    std::cout << " -- Error writing " << filePath << std::endl;
+    return false;
+  }
+  std::cout << " -- Wrote " << maps.size() << " maps into " << filePath << std::endl;
+  return true;
+}
+
+bool HGCSSCellGeometryCache::open(const std::string & filePath){
+  close();
+  int fd = ::open(filePath.c_str(),O_RDONLY);
+  if (fd<0) {
+    std::cout << " -- Error, cannot open cell geometry cache " << filePath << std::endl;
+    return false;
+  }
+  struct stat lStat;
+  if (fstat(fd,&lStat)!=0 || static_cast<size_t>(lStat.st_size) < sizeof(HGCSSCellCacheHeader)) {
+    std::cout << " -- Error, cell geometry cache " << filePath << " is too short." << std::endl;
+    ::close(fd);
+    return false;
+  }
+  size_t lSize = lStat.st_size;
+  void *lData = mmap(0,lSize,PROT_READ,MAP_PRIVATE,fd,0);
+  ::close(fd);
+  if (lData == MAP_FAILED) {
+    std::cout << " -- Error, cannot map cell geometry cache " << filePath << std::endl;
+    return false;
+  }
+  data_ = (const char*)lData;
+  size_ = lSize;
+
+  const HGCSSCellCacheHeader *lHeader = (const HGCSSCellCacheHeader*)data_;
+  if (memcmp(lHeader->magic,cacheMagic,8)!=0) {
+    std::cout << " -- Error, " << filePath << " is not a cell geometry cache." << std::endl;
+    close();
+    return false;
+  }
+  if (lHeader->version != cacheVersion) {
+    std::cout << " -- Error, cell geometry cache " << filePath << " has version " << lHeader->version
+	      << ", expected " << cacheVersion << ": stale, to be rebuilt with buildCellGeometryCache." << std::endl;
+    close();
+    return false;
+  }
+  if (sizeof(HGCSSCellCacheHeader)+lHeader->nMaps*sizeof(HGCSSCellMapHeader) > size_) {
+    std::cout << " -- Error, " << filePath << " is truncated." << std::endl;
+    close();
+    return false;
+  }
+  const HGCSSCellMapHeader *lMaps = (const HGCSSCellMapHeader*)(data_+sizeof(HGCSSCellCacheHeader));
+  for (unsigned iM(0); iM<lHeader->nMaps; ++iM){
+    const HGCSSCellMapHeader & lMap = lMaps[iM];
+    if (lMap.type>=nMapTypes || lMap.nParams>maxParams ||
+	lMap.neighbourStart+lMap.nNeighbours*sizeof(uint32_t) > size_) {
+      std::cout << " -- Error, " << filePath << " is truncated." << std::endl;
+      close();
+      return false;
+    }
+  }
+  filePath_ = filePath;
+  refZ_ = lHeader->refZ;
+  nMaps_ = lHeader->nMaps;
+  maps_ = lMaps;
+
+  std::cout << " -- Cell geometry cache " << filePath << ": " << nMaps_ << " maps." << std::endl;
+  return true;
+}
+
+void HGCSSCellGeometryCache::close(){
+  if (data_) munmap((void*)data_,size_);
+  data_ = 0;
+  size_ = 0;
+  filePath_ = "";
+  refZ_ = 0;
+  nMaps_ = 0;
+  maps_ = 0;
+}
+
+int HGCSSCellGeometryCache::findMap(const unsigned aType, const std::vector<double> & params) const{
+  if (!data_) return -1;
+  const uint64_t lChecksum = checksum(aType,params);
+  bool isStale = false;
+  for (unsigned iM(0); iM<nMaps_; ++iM){
+    if (maps_[iM].type != aType) continue;
+    if (maps_[iM].checksum == lChecksum) return iM;
+    isStale = true;
+  }
+  std::cout << " -- Cell geometry cache " << filePath_ << (isStale ? ": stale map " : ": no map ")
+	    << mapName(aType) << " for these parameters, the map is built. To add it: buildCellGeometryCache <output file> "
+	    << refZ_ << " " << spec(aType,params) << " <other maps>" << std::endl;
+  return -1;
+}
+
+double HGCSSCellGeometryCache::eta(const HGCSSCellGeometry & aCell, const double & z){
+  ROOT::Math::XYZPoint lPos(aCell.x,aCell.y,z);
+  return lPos.eta();
+}
+
+void HGCSSCellGeometryCache::Print(std::ostream & aOs) const{
+  if (!data_) return;
+  aOs << "===================================" << std::endl
+      << "=== Cell geometry cache " << filePath_ << ": " << nMaps_ << " maps, eta of xy cells at z = " << refZ_ << " mm" << std::endl;
+  for (unsigned iM(0); iM<nMaps_; ++iM){
+    const HGCSSCellMapHeader & lMap = maps_[iM];
+    std::vector<double> lParams(lMap.params,lMap.params+lMap.nParams);
+    aOs << "  " << spec(lMap.type,lParams) << ": " << lMap.nCells << " cells, "
+	<< (lMap.nCells>0 ? lMap.nNeighbours*1./lMap.nCells : 0) << " neighbours per cell, checksum "
+	<< std::hex << lMap.checksum << std::dec << std::endl;
+  }
+  aOs << "===================================" << std::endl;
+}
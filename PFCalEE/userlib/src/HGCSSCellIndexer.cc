@@ -0,0 +1,292 @@
+#include "HGCSSCellIndexer.hh"
+#include <cmath>
+#include "TMath.h"
+
+HGCSSCellIndexer::HGCSSCellIndexer():
+  tiling_(NoTiling),
+  map_(0),
+  nBins_(0),
+  xmin_(0),
+  xmax_(0),
+  ymin_(0),
+  ymax_(0),
+  nx_(0),
+  ny_(0),
+  dx_(0),
+  dy_(0),
+  side_(0)
+{
+}
+
+void HGCSSCellIndexer::setAxisRange(TH2Poly *map){
+  map_ = map;
+  //no map: range given by setAxisRange(xmin,xmax,ymin,ymax,nMapBins)
+  if (!map) return;
+  xmin_ = map->GetXaxis()->GetXmin();
+  xmax_ = map->GetXaxis()->GetXmax();
+  ymin_ = map->GetYaxis()->GetXmin();
+  ymax_ = map->GetYaxis()->GetXmax();
+  //bins numbered from 1 in AddBin order: only valid if the map
+  //contains exactly the tiling described here.
+  if (static_cast<unsigned>(map->GetNumberOfBins()) != nBins_){
+    std::cout << " -- WARNING! HGCSSCellIndexer: map " << map->GetName()
+	      << " has " << map->GetNumberOfBins() << " bins, expected " << nBins_
+	      << ". Falling back to TH2Poly::FindBin." << std::endl;
+    tiling_ = NoTiling;
+  }
+}
+
+void HGCSSCellIndexer::setAxisRange(const double xmin, const double xmax,
+				    const double ymin, const double ymax,
+				    const unsigned nMapBins){
+  xmin_ = xmin;
+  xmax_ = xmax;
+  ymin_ = ymin;
+  ymax_ = ymax;
+  if (nMapBins != nBins_){
+    std::cout << " -- WARNING! HGCSSCellIndexer: " << nMapBins << " cells, expected " << nBins_
+	      << ". No cell lookup." << std::endl;
+    tiling_ = NoTiling;
+  }
+}
+
+void HGCSSCellIndexer::setSquare(TH2Poly *map,
+				 const double x0, const double y0,
+				 const double side,
+				 const unsigned nx, const unsigned ny){
+  tiling_ = SquareTiling;
+  nx_ = nx;
+  ny_ = ny;
+  side_ = side;
+  nBins_ = nx*ny;
+  xEdges_.resize(nx+1);
+  yEdges_.resize(ny+1);
+  xEdges_[0] = x0;
+  for (unsigned i(0); i<nx; ++i) xEdges_[i+1] = xEdges_[i]+side;
+  yEdges_[0] = y0;
+  for (unsigned j(0); j<ny; ++j) yEdges_[j+1] = yEdges_[j]+side;
+  setAxisRange(map);
+}
+
+void HGCSSCellIndexer::setDiamond(TH2Poly *map,
+				  const double xymin,
+				  const double dx, const double dy,
+				  const unsigned nx, const unsigned ny){
+  tiling_ = DiamondTiling;
+  nx_ = nx;
+  ny_ = ny;
+  dx_ = dx;
+  dy_ = dy;
+  nBins_ = nx*ny;
+  xEdges_.resize(nx+1);
+  yEdges_.resize(ny+1);
+  xEdges_[0] = -1.*xymin;
+  for (unsigned i(0); i<nx; ++i) xEdges_[i+1] = xEdges_[i]+dx;
+  yEdges_[0] = -1.*xymin;
+  for (unsigned j(0); j<ny; ++j) yEdges_[j+1] = yEdges_[j]+dy;
+  setAxisRange(map);
+}
+
+void HGCSSCellIndexer::setTriangle(TH2Poly *map,
+				   const double xymin, const double side,
+				   const double dx, const double dy,
+				   const unsigned nx, const unsigned ny){
+  tiling_ = TriangleTiling;
+  nx_ = nx;
+  ny_ = ny;
+  dx_ = dx;
+  dy_ = dy;
+  side_ = side;
+  nBins_ = 2*nx*ny;
+  xEdges_.resize(nx+1);
+  yEdges_.resize(ny+1);
+  yEdgesOdd_.resize(ny+1);
+  xEdges_[0] = -1.*xymin;
+  for (unsigned i(0); i<nx; ++i) xEdges_[i+1] = xEdges_[i]+dx;
+  unsigned even = 0, odd = 1;
+  yEdges_[0] = -1.*xymin+even*dy;
+  yEdgesOdd_[0] = -1.*xymin+odd*dy;
+  for (unsigned j(0); j<ny; ++j) {
+    yEdges_[j+1] = yEdges_[j]+side;
+    yEdgesOdd_[j+1] = yEdgesOdd_[j]+side;
+  }
+  setAxisRange(map);
+}
+
+void HGCSSCellIndexer::setHoneyComb(TH2Poly *map,
+				    const double xstart, const double ystart,
+				    const double a,
+				    const int k, const int s){
+  tiling_ = HexagonTiling;
+  side_ = a;
+  nx_ = s>0 ? s : 0;
+  ny_ = k>0 ? k : 0;
+  nBins_ = 0;
+  xEdges_.clear();
+  yColumns_.clear();
+  yColumnIdx_.clear();
+  binOffset_.clear();
+  nInColumn_.clear();
+
+  Double_t xloop, yloop;
+  xloop = xstart; yloop = ystart + a*TMath::Sqrt(3)/2.0;
+  for (int sCounter = 0; sCounter < s; sCounter++) {
+    unsigned nHex = sCounter%2 == 0 ? ny_ : (ny_>0 ? ny_-1 : 0);
+    //column starts alternate, keep one row sequence per distinct start
+    unsigned idx = yColumns_.size();
+    for (unsigned m(0); m<yColumns_.size(); ++m){
+      if (yColumns_[m][0] == yloop) {
+	idx = m;
+	break;
+      }
+    }
+    if (idx == yColumns_.size()){
+      std::vector<double> lRows;
+      lRows.reserve(ny_+1);
+      Double_t ytemp = yloop;
+      for (unsigned kCounter(0); kCounter < ny_ || kCounter==0; ++kCounter){
+	lRows.push_back(ytemp);
+	ytemp += a*TMath::Sqrt(3);
+      }
+      yColumns_.push_back(lRows);
+    }
+    xEdges_.push_back(xloop);
+    yColumnIdx_.push_back(idx);
+    binOffset_.push_back(nBins_);
+    nInColumn_.push_back(nHex);
+    nBins_ += nHex;
+
+    if (sCounter%2 == 0) yloop += a*TMath::Sqrt(3)/2.0;
+    else                 yloop -= a*TMath::Sqrt(3)/2.0;
+    xloop += 1.5*a;
+  }
+  setAxisRange(map);
+}
+
+bool HGCSSCellIndexer::candidates(const double val, const double start,
+				  const double step, const double lowOff, const double highOff,
+				  const int n, int & lo, int & hi){
+  //margin in units of step, well above the accumulated rounding
+  //of the cell origins
+  double flo = (val-start-highOff)/step - 1e-6;
+  double fhi = (val-start-lowOff)/step + 1e-6;
+  if (n<=0 || fhi < 0 || flo > n-1) return false;
+  lo = flo < 0 ? 0 : static_cast<int>(std::ceil(flo));
+  hi = fhi > n-1 ? n-1 : static_cast<int>(std::floor(fhi));
+  return lo<=hi;
+}
+
+int HGCSSCellIndexer::findBin(const double x, const double y) const{
+  if (tiling_ == NoTiling) return map_ ? map_->FindBin(x,y) : 0;
+  int overflow = overflowBin(x,y);
+  if (overflow != -5) return overflow;
+  if (tiling_ == SquareTiling) return findSquare(x,y);
+  else if (tiling_ == HexagonTiling) return findHexagon(x,y);
+  else if (tiling_ == DiamondTiling) return findDiamond(x,y);
+  return findTriangle(x,y);
+}
+
+int HGCSSCellIndexer::findSquare(const double x, const double y) const{
+  //rectangles contain (x1,x2]x(y1,y2]: at most one match
+  int lo,hi;
+  int i = -1, j = -1;
+  if (!candidates(x,xEdges_[0],side_,0,side_,nx_,lo,hi)) return -5;
+  for (int ic(lo); ic<=hi; ++ic){
+    if (x > xEdges_[ic] && x <= xEdges_[ic+1]) {
+      i = ic;
+      break;
+    }
+  }
+  if (i<0 || !candidates(y,yEdges_[0],side_,0,side_,ny_,lo,hi)) return -5;
+  for (int jc(lo); jc<=hi; ++jc){
+    if (y > yEdges_[jc] && y <= yEdges_[jc+1]) {
+      j = jc;
+      break;
+    }
+  }
+  if (j<0) return -5;
+  return 1+i*ny_+j;
+}
+
+int HGCSSCellIndexer::findDiamond(const double x, const double y) const{
+  //neighbouring diamonds overlap: first bin in AddBin order wins
+  int ilo,ihi,jlo,jhi;
+  if (!candidates(x,xEdges_[0],dx_,0,2*dx_,nx_,ilo,ihi)) return -5;
+  if (!candidates(y,yEdges_[0],dy_,-dy_,dy_,ny_,jlo,jhi)) return -5;
+  Double_t xv[4],yv[4];
+  for (int i(ilo); i<=ihi; ++i){
+    xv[0] = xEdges_[i];
+    xv[1] = xv[0]+dx_;
+    xv[2] = xv[1]+dx_;
+    xv[3] = xv[0]+dx_;
+    for (int j(jlo); j<=jhi; ++j){
+      yv[0] = yEdges_[j];
+      yv[1] = yv[0]+dy_;
+      yv[2] = yv[0];
+      yv[3] = yv[0]-dy_;
+      if (TMath::IsInside(x,y,4,xv,yv)) return 1+i*ny_+j;
+    }
+  }
+  return -5;
+}
+
+int HGCSSCellIndexer::findTriangle(const double x, const double y) const{
+  int ilo,ihi,jlo,jhi;
+  if (!candidates(x,xEdges_[0],dx_,0,dx_,nx_,ilo,ihi)) return -5;
+  Double_t xv[3],yv[3];
+  for (int i(ilo); i<=ihi; ++i){
+    const std::vector<double> & lRows = i%2==0 ? yEdges_ : yEdgesOdd_;
+    //triangles in one side
+    xv[0] = xEdges_[i];
+    xv[1] = xv[0]+dx_;
+    xv[2] = xv[0]+dx_;
+    if (candidates(y,lRows[0],side_,-dy_,dy_,ny_,jlo,jhi)){
+      for (int j(jlo); j<=jhi; ++j){
+	yv[0] = lRows[j];
+	yv[1] = yv[0]+dy_;
+	yv[2] = yv[0]-dy_;
+	if (TMath::IsInside(x,y,3,xv,yv)) return 1+2*i*ny_+j;
+      }
+    }
+    //triangles reverted
+    xv[1] = xv[0];
+    xv[2] = xv[0]+dx_;
+    if (candidates(y,lRows[0],side_,0,side_,ny_,jlo,jhi)){
+      for (int j(jlo); j<=jhi; ++j){
+	yv[0] = lRows[j];
+	yv[1] = yv[0]+side_;
+	yv[2] = yv[0]+dy_;
+	if (TMath::IsInside(x,y,3,xv,yv)) return 1+2*i*ny_+ny_+j;
+      }
+    }
+  }
+  return -5;
+}
+
+int HGCSSCellIndexer::findHexagon(const double x, const double y) const{
+  const double a = side_;
+  int clo,chi,rlo,rhi;
+  if (!candidates(x,xEdges_[0],1.5*a,0,2*a,nx_,clo,chi)) return -5;
+  Double_t xv[6],yv[6];
+  for (int c(clo); c<=chi; ++c){
+    const std::vector<double> & lRows = yColumns_[yColumnIdx_[c]];
+    if (!candidates(y,lRows[0],a*TMath::Sqrt(3),-a*TMath::Sqrt(3)/2.0,a*TMath::Sqrt(3)/2.0,nInColumn_[c],rlo,rhi)) continue;
+    for (int r(rlo); r<=rhi; ++r){
+      // Go around the hexagon
+      xv[0] = xEdges_[c];
+      yv[0] = lRows[r];
+      xv[1] = xv[0] + a/2.0;
+      yv[1] = yv[0] + a*TMath::Sqrt(3)/2.0;
+      xv[2] = xv[1] + a;
+      yv[2] = yv[1];
+      xv[3] = xv[2] + a/2.0;
+      yv[3] = yv[1] - a*TMath::Sqrt(3)/2.0;
+      xv[4] = xv[2];
+      yv[4] = yv[3] - a*TMath::Sqrt(3)/2.0;
+      xv[5] = xv[1];
+      yv[5] = yv[4];
+      if (TMath::IsInside(x,y,6,xv,yv)) return 1+binOffset_[c]+r;
+    }
+  }
+  return -5;
+}
@@ -2,6 +2,10 @@
 #include <cmath>
 #include <sstream>
 #include <iostream>
+#include <cstdlib>
+#include "Math/ProbFuncMathCore.h"
+#include "Math/QuantFuncMathCore.h"
+#include "TMath.h"
 
 unsigned HGCSSDigitisation::nRandomPhotoElec(const double & aMipE){
   double mean = aMipE*npe_;
@@ -83,7 +87,7 @@ double HGCSSDigitisation::ipXtalk(const std::vector<double> & aSimEvec){
 }
 
 void HGCSSDigitisation::addNoise(double & aDigiE, const unsigned & alay ,
-				 TH1F * & hist){
+				 TH1 * hist){
   bool print = false;
   //if (aDigiE>0) print = true;
   if (print) std::cout << "HGCSSDigitisation::addNoise " << aDigiE << " ";
@@ -94,6 +98,24 @@ void HGCSSDigitisation::addNoise(double & aDigiE, const unsigned & alay ,
   if (print) std::cout << lNoise << " " << aDigiE << std::endl;
 }
 
+double HGCSSDigitisation::noiseTailProbability(const double & aThreshMip, const unsigned & alay){
+  double sigma = noise_[alay];
+  if (sigma<=0) return aThreshMip>0 ? 0 : 1;
+  return ROOT::Math::normal_cdf_c(aThreshMip,sigma);
+}
+
+double HGCSSDigitisation::tailNoise(const double & aThreshMip, const unsigned & alay,
+				    TH1 * hist){
+  double sigma = noise_[alay];
+  if (sigma<=0) return 0;
+  //inverse cdf of the gaussian restricted to [aThreshMip,inf)
+  double pTail = ROOT::Math::normal_cdf_c(aThreshMip,sigma);
+  double lNoise = ROOT::Math::normal_quantile_c(pTail*rndm_.Rndm(),sigma);
+  if (lNoise<aThreshMip) lNoise = aThreshMip;
+  if (hist) hist->Fill(lNoise);
+  return lNoise;
+}
+
 unsigned HGCSSDigitisation::adcConverter(double eMIP, DetectorEnum adet){
   if (eMIP<0) eMIP=0;
   double eADC = static_cast<unsigned>(eMIP*mipToADC_[adet]);
@@ -107,6 +129,89 @@ double HGCSSDigitisation::adcToMIP(const unsigned adcCounts, DetectorEnum adet,
   return rndm_.Gaus(lE,gainSmearing_[adet]*lE);
 }
 
+void HGCSSDigitisation::fillLayerTable(){
+  HGCSSDetector & myDetector = theDetector();
+  const unsigned nLayers = myDetector.nLayers();
+  layers_.resize(nLayers);
+  for (unsigned iL(0); iL<nLayers; ++iL){
+    const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(iL);
+    LayerDigi & lay = layers_[iL];
+    std::map<unsigned,double>::const_iterator lNoise = noise_.find(iL);
+    lay.noise = lNoise!=noise_.end() ? lNoise->second : 0;
+    lay.mipToADC = mipToADC_[subdet.type];
+    lay.maxADC = maxADC_[subdet.type];
+    lay.gainSmearing = gainSmearing_[subdet.type];
+    lay.isSi = subdet.isSi;
+  }
+  layersValid_ = true;
+}
+
+void HGCSSDigitisation::gausBlock(const unsigned n){
+  const unsigned nPairs = (n+1)/2;
+  uniforms_.resize(2*nPairs);
+  gaus_.resize(2*nPairs);
+  if (nPairs==0) return;
+  //in ]0,1[
+  rndm_.RndmArray(2*nPairs,&uniforms_[0]);
+  const double twoPi = TMath::TwoPi();
+  for (unsigned i(0); i<nPairs; ++i){
+    const double r = sqrt(-2.*log(uniforms_[2*i]));
+    const double phi = twoPi*uniforms_[2*i+1];
+    gaus_[2*i] = r*cos(phi);
+    gaus_[2*i+1] = r*sin(phi);
+  }
+}
+
+void HGCSSDigitisation::digitiseLayer(const unsigned alay,
+				      const unsigned nCells,
+				      double * aE,
+				      unsigned * adc,
+				      const unsigned char * noiseDone,
+				      TH1 * hist,
+				      double * noisyE){
+  if (!layersValid_) fillLayerTable();
+  if (alay>=layers_.size()) {
+    std::cout << " -- Error ! HGCSSDigitisation::digitiseLayer: layer " << alay
+	      << " outside of range. nLayers = " << layers_.size() << std::endl;
+    exit(1);
+  }
+  if (nCells==0) return;
+  const LayerDigi & lay = layers_[alay];
+
+  //noise first, then gain smearing for Si
+  gausBlock(lay.isSi ? 2*nCells : nCells);
+  const double * lNoise = &gaus_[0];
+  if (hist) {
+    for (unsigned i(0); i<nCells; ++i){
+      if (!noiseDone || !noiseDone[i]) hist->Fill(lay.noise*lNoise[i]);
+    }
+  }
+  for (unsigned i(0); i<nCells; ++i){
+    const double lE = aE[i] + ((noiseDone && noiseDone[i]) ? 0 : lay.noise*lNoise[i]);
+    aE[i] = lE<0 ? 0 : lE;
+  }
+  if (noisyE) {
+    for (unsigned i(0); i<nCells; ++i){
+      noisyE[i] = aE[i];
+    }
+  }
+
+  if (!lay.isSi) {
+    for (unsigned i(0); i<nCells; ++i){
+      adc[i] = 0;
+    }
+    return;
+  }
+  const double * lGain = &gaus_[nCells];
+  for (unsigned i(0); i<nCells; ++i){
+    double eADC = static_cast<unsigned>(aE[i]*lay.mipToADC);
+    if (eADC > lay.maxADC) eADC = lay.maxADC;
+    adc[i] = eADC;
+    const double lE = adc[i]*1.0/lay.mipToADC;
+    aE[i] = lE + lay.gainSmearing*lE*lGain[i];
+  }
+}
+
 double HGCSSDigitisation::MIPtoGeV(const HGCSSSubDetector & adet, 
 				   const double & aMipE)
 {
@@ -132,7 +237,7 @@ void HGCSSDigitisation::Print(std::ostream & aOs) const{
   aOs << "====================================" << std::endl
       << "=== INIT DIGITISATION PARAMETERS ===" << std::endl
       << "====================================" << std::endl
-      << " = Random seed: " << rndm_.GetSeed() << std::endl
+      << " = Random seed: " << rndm_.seed() << std::endl
       << " = Nphoto-electrons: " << npe_ << std::endl
       << " = cross-talk: " << crossTalk_ << std::endl
       << " = Npixels total: " << nTotal_ << std::endl
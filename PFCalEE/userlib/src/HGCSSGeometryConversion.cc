@@ -2,6 +2,7 @@
 #include <sstream>
 #include <iostream>
 #include <cmath>
+#include <algorithm>
 
 void HGCSSGeometryConversion::convertFromEtaPhi(std::pair<double,double> & xy, const double & z){
   double theta = 2*atan(exp(-1.*xy.first));
@@ -77,10 +78,8 @@ unsigned HGCSSGeometryConversion::getNumberOfSiLayers(const DetectorEnum type,
 
 HGCSSGeometryConversion::~HGCSSGeometryConversion(){
 
-  std::map<unsigned,std::map<unsigned,MergeCells> >::iterator liter =
-    HistMap_.begin();
-  for (; liter !=HistMap_.end();++liter){
-    deleteHistos(liter->second);
+  for (unsigned iL(0); iL<HistMap_.size();++iL){
+    deleteHistos(HistMap_[iL]);
   }
   HistMap_.clear();
 
@@ -114,22 +113,70 @@ HGCSSGeometryConversion::~HGCSSGeometryConversion(){
 
 
 
+bool HGCSSGeometryConversion::openCellGeometryCache(const std::string & filePath){
+  return cellGeometryCache().open(filePath);
+}
+
+int HGCSSGeometryConversion::cachedMap(const unsigned aType, const double p0, const double p1,
+				       const double p2, const double p3, const double p4){
+  if (!cellGeometryCache().isOpen()) return -1;
+  std::vector<double> lParams;
+  lParams.push_back(p0);
+  lParams.push_back(p1);
+  if (HGCSSCellGeometryCache::isEtaPhi(aType)) {
+    lParams.push_back(p2);
+    lParams.push_back(p3);
+    lParams.push_back(p4);
+  }
+  return cellGeometryCache().findMap(aType,lParams);
+}
+
+void HGCSSGeometryConversion::fillFromCache(const unsigned iMap, HGCSSCellIndexer *indexer, std::map<int,std::pair<double,double> > & geom){
+  const HGCSSCellGeometryCache & lCache = cellGeometryCache();
+  const HGCSSCellMapHeader & lMap = lCache.mapHeader(iMap);
+  indexer->setAxisRange(lMap.xmin,lMap.xmax,lMap.ymin,lMap.ymax,lMap.nCells);
+  geom.clear();
+  for (unsigned id(1); id<lMap.nCells+1; ++id){
+    const HGCSSCellGeometry & lCell = lCache.cell(iMap,id);
+    geom.insert(geom.end(),std::pair<int,std::pair<double,double> >(id,std::pair<double,double>(lCell.x,lCell.y)));
+  }
+  std::cout << " -- " << HGCSSCellGeometryCache::mapName(lMap.type) << " map from the cell geometry cache: size = " << geom.size() << std::endl;
+}
+
 void HGCSSGeometryConversion::initialiseSquareMap(const double xymin, const double side){
-  initialiseSquareMap(squareMap(),xymin,side,true);
+  const int iMap = cachedMap(HGCSSCellGeometryCache::Square,xymin,side);
+  if (iMap>=0) {
+    initialiseSquareMap(0,xymin,side,true,squareIndexer());
+    fillFromCache(iMap,squareIndexer(),squareGeom);
+    return;
+  }
+  initialiseSquareMap(squareMap(),xymin,side,true,squareIndexer());
   fillXY(squareMap(),squareGeom);
 }
 
 void HGCSSGeometryConversion::initialiseSquareMap1(const double xmin, const double xmax, const double ymin, const double ymax, const double side){
-  initialiseSquareMap(squareMap1(),xmin,xmax,ymin,ymax,side,true);
+  const int iMap = cachedMap(HGCSSCellGeometryCache::Square1,xmin,xmax,ymin,ymax,side);
+  if (iMap>=0) {
+    initialiseSquareMap(0,xmin,xmax,ymin,ymax,side,true,squareIndexer1());
+    fillFromCache(iMap,squareIndexer1(),squareGeom1);
+    return;
+  }
+  initialiseSquareMap(squareMap1(),xmin,xmax,ymin,ymax,side,true,squareIndexer1());
   fillXY(squareMap1(),squareGeom1);
 }
 
 void HGCSSGeometryConversion::initialiseSquareMap2(const double xmin, const double xmax, const double ymin, const double ymax, const double side){
-  initialiseSquareMap(squareMap2(),xmin,xmax,ymin,ymax,side,true);
+  const int iMap = cachedMap(HGCSSCellGeometryCache::Square2,xmin,xmax,ymin,ymax,side);
+  if (iMap>=0) {
+    initialiseSquareMap(0,xmin,xmax,ymin,ymax,side,true,squareIndexer2());
+    fillFromCache(iMap,squareIndexer2(),squareGeom2);
+    return;
+  }
+  initialiseSquareMap(squareMap2(),xmin,xmax,ymin,ymax,side,true,squareIndexer2());
   fillXY(squareMap2(),squareGeom2);
 }
 
-void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xymin, const double side, bool print){
+void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer){
   unsigned nx=static_cast<unsigned>(xymin*2./side);
   unsigned ny=nx;
   unsigned i,j;
@@ -142,13 +189,14 @@ void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xym
     y1 = -1.*xymin;
     y2 = y1+dy;
     for (j = 0; j<ny; j++) {
-      map->AddBin(x1, y1, x2, y2);
+      if (map) map->AddBin(x1, y1, x2, y2);
       y1 = y2;
       y2 = y1+dy;
     }
     x1 = x2;
     x2 = x1+dx;
   }
+  if (indexer) indexer->setSquare(map,-1.*xymin,-1.*xymin,side,nx,ny);
   
   if (print) {
     std::cout <<  " -- Initialising squareMap with parameters: " << std::endl
@@ -159,7 +207,7 @@ void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xym
   
 }
 
-void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xmin, const double xmax, const double ymin, const double ymax, const double side, bool print){
+void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xmin, const double xmax, const double ymin, const double ymax, const double side, bool print, HGCSSCellIndexer *indexer){
   unsigned nx=static_cast<unsigned>((xmax-xmin)/side);
   unsigned ny=static_cast<unsigned>((ymax-ymin)/side);
   unsigned i,j;
@@ -172,13 +220,14 @@ void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xmi
     y1 = ymin;
     y2 = y1+dy;
     for (j = 0; j<ny; j++) {
-      map->AddBin(x1, y1, x2, y2);
+      if (map) map->AddBin(x1, y1, x2, y2);
       y1 = y2;
       y2 = y1+dy;
     }
     x1 = x2;
     x2 = x1+dx;
   }
+  if (indexer) indexer->setSquare(map,xmin,ymin,side,nx,ny);
   
   if (print) {
     std::cout <<  " -- Initialising eta-phi squareMap with parameters: " << std::endl
@@ -190,11 +239,17 @@ void HGCSSGeometryConversion::initialiseSquareMap(TH2Poly *map, const double xmi
 }
 
 void HGCSSGeometryConversion::initialiseDiamondMap(const double xymin, const double side){
-  initialiseDiamondMap(diamondMap(),xymin,side,true);
+  const int iMap = cachedMap(HGCSSCellGeometryCache::Diamond,xymin,side);
+  if (iMap>=0) {
+    initialiseDiamondMap(0,xymin,side,true,diamondIndexer());
+    fillFromCache(iMap,diamondIndexer(),diamGeom);
+    return;
+  }
+  initialiseDiamondMap(diamondMap(),xymin,side,true,diamondIndexer());
   fillXY(diamondMap(),diamGeom);
 }
 
-void HGCSSGeometryConversion::initialiseDiamondMap(TH2Poly *map, const double xymin, const double side, bool print){
+void HGCSSGeometryConversion::initialiseDiamondMap(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer){
   double h = sqrt(3.)/2.*side;
   unsigned nx=static_cast<unsigned>(xymin*2./h);
   unsigned ny=static_cast<unsigned>(xymin*4./side);
@@ -212,11 +267,12 @@ void HGCSSGeometryConversion::initialiseDiamondMap(TH2Poly *map, const double xy
       y[1] = y[0]+dy;
       y[2] = y[0];
       y[3] = y[0]-dy;
-      map->AddBin(4, x, y);
+      if (map) map->AddBin(4, x, y);
       y[0] = y[1];
     }
     x[0] = x[1];
   }
+  if (indexer) indexer->setDiamond(map,xymin,dx,dy,nx,ny);
     
   if (print) {
     std::cout <<  " -- Initialising diamondMap with parameters: " << std::endl
@@ -228,11 +284,17 @@ void HGCSSGeometryConversion::initialiseDiamondMap(TH2Poly *map, const double xy
 }
 
 void HGCSSGeometryConversion::initialiseTriangleMap(const double xymin, const double side){
-  initialiseTriangleMap(triangleMap(),xymin,side,true);
+  const int iMap = cachedMap(HGCSSCellGeometryCache::Triangle,xymin,side);
+  if (iMap>=0) {
+    initialiseTriangleMap(0,xymin,side,true,triangleIndexer());
+    fillFromCache(iMap,triangleIndexer(),triangleGeom);
+    return;
+  }
+  initialiseTriangleMap(triangleMap(),xymin,side,true,triangleIndexer());
   fillXY(triangleMap(),triangleGeom);
 }
 
-void HGCSSGeometryConversion::initialiseTriangleMap(TH2Poly *map, const double xymin, const double side, bool print){
+void HGCSSGeometryConversion::initialiseTriangleMap(TH2Poly *map, const double xymin, const double side, bool print, HGCSSCellIndexer *indexer){
     
   double h = sqrt(3.)/2.*side;
   unsigned nx=static_cast<unsigned>(xymin*2./h);
@@ -250,7 +312,7 @@ void HGCSSGeometryConversion::initialiseTriangleMap(TH2Poly *map, const double x
     for (j = 0; j<ny; j++) {
       y[1] = y[0]+dy;
       y[2] = y[0]-dy;
-      map->AddBin(3, x, y);
+      if (map) map->AddBin(3, x, y);
       y[0] = y[0]+side;
     }
     //triangles reverted
@@ -260,11 +322,12 @@ void HGCSSGeometryConversion::initialiseTriangleMap(TH2Poly *map, const double x
     for (j = 0; j<ny; j++) {
       y[1] = y[0]+side;
       y[2] = y[0]+dy;
-      map->AddBin(3, x, y);
+      if (map) map->AddBin(3, x, y);
       y[0] = y[0]+side;
     }
     x[0] = x[0]+dx;
   }
+  if (indexer) indexer->setTriangle(map,xymin,side,dx,dy,nx,ny);
   
   if (print) {
     std::cout <<  " -- Initialising triangleMap with parameters: " << std::endl
@@ -276,11 +339,17 @@ void HGCSSGeometryConversion::initialiseTriangleMap(TH2Poly *map, const double x
 }
 
 void HGCSSGeometryConversion::initialiseHoneyComb(const double width, const double side){
-  initialiseHoneyComb(hexagonMap(),width,side,true);
+  const int iMap = cachedMap(HGCSSCellGeometryCache::Hexagon,width,side);
+  if (iMap>=0) {
+    initialiseHoneyComb(0,width,side,true,hexagonIndexer());
+    fillFromCache(iMap,hexagonIndexer(),hexaGeom);
+    return;
+  }
+  initialiseHoneyComb(hexagonMap(),width,side,true,hexagonIndexer());
   fillXY(hexagonMap(),hexaGeom);
 }
 
-void HGCSSGeometryConversion::initialiseHoneyComb(TH2Poly *map, const double width, const double side, bool print){
+void HGCSSGeometryConversion::initialiseHoneyComb(TH2Poly *map, const double width, const double side, bool print, HGCSSCellIndexer *indexer){
   //xstart,ystart,side length,
 
   // Center a cell at (x,y)=(0,0) and ensure coverage up to/past width/2 in all 4 directions,
@@ -313,7 +382,8 @@ void HGCSSGeometryConversion::initialiseHoneyComb(TH2Poly *map, const double wid
 	      << ", side = "<<side<<", nx = "<<nx<<", ny="<<ny<<std::endl;
   }
   //map->Honeycomb(-1.*xymin,-1.*xymin,side,nx,ny);
-  myHoneycomb(map,xstart,ystart,side,ny,nx);
+  if (map) myHoneycomb(map,xstart,ystart,side,ny,nx);
+  if (indexer) indexer->setHoneyComb(map,xstart,ystart,side,ny,nx);
 }
 
 ////////////////////////////////////////////////////////////////////////////////
@@ -401,7 +471,7 @@ void HGCSSGeometryConversion::fillXY(TH2Poly* hist, std::map<int,std::pair<doubl
   }
   }*/
 
-void HGCSSGeometryConversion::deleteHistos(std::map<unsigned,MergeCells> & aVec){
+void HGCSSGeometryConversion::deleteHistos(HGCSSCellMap & aVec){
   aVec.clear();
 }
 
@@ -432,7 +502,12 @@ void HGCSSGeometryConversion::initialiseHistos(const bool recreate,
 					       std::string uniqStr,
 					       const bool print){
 
-  for (unsigned iL(0); iL<theDetector().nLayers();++iL){
+  if (HistMap_.size()<theDetector().nLayers()){
+    HistMap_.resize(theDetector().nLayers());
+    avgMapE_.resize(theDetector().nLayers(),0);
+    avgMapZ_.resize(theDetector().nLayers(),0);
+  }
+  for (unsigned iL(0); iL<HistMap_.size();++iL){
     //unsigned iS = theDetector().getSection(iL);
     resetVector(HistMap_[iL]);
     avgMapE_[iL] = 0;
@@ -483,14 +558,14 @@ void HGCSSGeometryConversion::fill(const unsigned layer,
 				   const unsigned & cellid,
 				   const double & posz)
 {
-  MergeCells tmpCell;
-  tmpCell.energy = weightedE;
-  tmpCell.time = weightedE*aTime;
-  
-  if (!HistMap_[layer].insert(std::pair<unsigned,MergeCells>(cellid,tmpCell)).second){
-    HistMap_[layer][cellid].energy += weightedE;
-    HistMap_[layer][cellid].time += weightedE*aTime;
+  if (layer>=HistMap_.size()){
+    HistMap_.resize(layer+1);
+    avgMapE_.resize(layer+1,0);
+    avgMapZ_.resize(layer+1,0);
   }
+  MergeCells & lCell = HistMap_[layer][cellid];
+  lCell.energy += weightedE;
+  lCell.time += weightedE*aTime;
   avgMapZ_[layer] += weightedE*posz;
   avgMapE_[layer] += weightedE;
 }
@@ -501,7 +576,7 @@ double HGCSSGeometryConversion::getAverageZ(const unsigned layer){
   double avg = 0;
   //if (avgMapE_[subdet.type][newlayer]>0 && avgMapZ_.size()>0)
   //avg =avgMapZ_[subdet.type][newlayer]/avgMapE_[subdet.type][newlayer];
-  if (avgMapE_[layer]>0)
+  if (layer<avgMapE_.size() && avgMapE_[layer]>0)
     avg = avgMapZ_[layer]/avgMapE_[layer];
   return avg;
 }
@@ -518,7 +593,12 @@ double HGCSSGeometryConversion::getAverageZ(const unsigned layer){
   }
   }*/
 
-std::map<unsigned,MergeCells> &  HGCSSGeometryConversion::get2DHist(const unsigned layer){
+HGCSSCellMap &  HGCSSGeometryConversion::get2DHist(const unsigned layer){
+  if (layer>=HistMap_.size()){
+    HistMap_.resize(layer+1);
+    avgMapE_.resize(layer+1,0);
+    avgMapZ_.resize(layer+1,0);
+  }
   return HistMap_[layer];
 }
 
@@ -576,11 +656,63 @@ void HGCSSGeometryConversion::resetVector(std::vector<TH2Poly *> & aVec,
 }
 */
 
-void HGCSSGeometryConversion::resetVector(std::map<unsigned,MergeCells> & aVec)
+void HGCSSGeometryConversion::resetVector(HGCSSCellMap & aVec)
 {
   aVec.clear();
 }
 
+std::pair<HGCSSCellMap::iterator,bool> HGCSSCellMap::insert(const value_type & aCell){
+  int pos = position(aCell.first);
+  if (pos>=0) return std::pair<iterator,bool>(entries_.begin()+pos,false);
+  if (!entries_.empty() && aCell.first < entries_.back().first) sorted_ = false;
+  setPosition(aCell.first,entries_.size());
+  entries_.push_back(aCell);
+  return std::pair<iterator,bool>(entries_.end()-1,true);
+}
+
+MergeCells & HGCSSCellMap::operator[](const unsigned cellid){
+  int pos = position(cellid);
+  if (pos>=0) return entries_[pos].second;
+  MergeCells tmpCell;
+  tmpCell.energy = 0;
+  tmpCell.time = 0;
+  return insert(value_type(cellid,tmpCell)).first->second;
+}
+
+namespace {
+  bool lowerCellId(const HGCSSCellMap::value_type & a, const HGCSSCellMap::value_type & b){
+    return a.first < b.first;
+  }
+}
+
+HGCSSCellMap::iterator HGCSSCellMap::begin(){
+  if (!sorted_){
+    std::sort(entries_.begin(),entries_.end(),lowerCellId);
+    for (unsigned iE(0); iE<entries_.size();++iE){
+      setPosition(entries_[iE].first,iE);
+    }
+    sorted_ = true;
+  }
+  return entries_.begin();
+}
+
+void HGCSSCellMap::clear(){
+  for (unsigned iE(0); iE<entries_.size();++iE){
+    if (entries_[iE].first < index_.size()) index_[entries_[iE].first] = -1;
+  }
+  farIndex_.clear();
+  entries_.clear();
+  sorted_ = true;
+}
+
+void HGCSSCellMap::setPosition(const unsigned cellid, const int pos){
+  if (cellid < maxDenseId_){
+    if (cellid >= index_.size()) index_.resize(cellid+1,-1);
+    index_[cellid] = pos;
+  }
+  else farIndex_[cellid] = pos;
+}
+
 
 
 
@@ -0,0 +1,298 @@
+#include "HGCSSHitColumns.hh"
+#include <iostream>
+#include <sstream>
+#include <algorithm>
+
+namespace {
+
+  std::string columnPrefix(const std::string & objBranch){
+    if (objBranch.size()>3 && objBranch.compare(objBranch.size()-3,3,"Vec")==0) return objBranch.substr(0,objBranch.size()-3);
+    return objBranch;
+  }
+
+  std::vector<std::string> splitColumns(const std::string & columns){
+    std::vector<std::string> lList;
+    std::istringstream lStream(columns);
+    std::string lItem;
+    while (std::getline(lStream,lItem,',')){
+      if (lItem.size()>0) lList.push_back(lItem);
+    }
+    return lList;
+  }
+
+  void branchColumns(TTree *tree, const std::string & objBranch,
+		     const std::vector<std::string> & fields,
+		     const std::vector<std::string> & types,
+		     std::vector<void*> & ptrs){
+    std::string lPrefix = columnPrefix(objBranch);
+    for (unsigned iF(0); iF<fields.size(); ++iF){
+      tree->Branch((lPrefix+"_"+fields[iF]).c_str(),types[iF].c_str(),&ptrs[iF]);
+    }
+  }
+
+  //only the requested columns are switched on
+  bool attachColumns(TTree *tree, const std::string & objBranch,
+		     const std::string & columns,
+		     const std::vector<std::string> & fields,
+		     std::vector<void*> & ptrs,
+		     std::vector<bool> & active){
+    std::string lPrefix = columnPrefix(objBranch);
+    std::vector<std::string> lRequested = splitColumns(columns);
+    for (unsigned iR(0); iR<lRequested.size(); ++iR){
+      if (std::find(fields.begin(),fields.end(),lRequested[iR])==fields.end()) {
+	std::cout << " -- Error, unknown column " << lRequested[iR] << " for " << objBranch << std::endl;
+	return false;
+      }
+    }
+    for (unsigned iF(0); iF<fields.size(); ++iF){
+      std::string lName = lPrefix+"_"+fields[iF];
+      active[iF] = lRequested.size()==0 || std::find(lRequested.begin(),lRequested.end(),fields[iF])!=lRequested.end();
+      if (!tree->GetBranch(lName.c_str())) {
+	if (active[iF] && lRequested.size()>0) {
+	  std::cout << " -- Error, column " << lName << " not found." << std::endl;
+	  return false;
+	}
+	active[iF] = false;
+	continue;
+      }
+      tree->SetBranchStatus(lName.c_str(),active[iF]);
+      if (active[iF]) tree->SetBranchAddress(lName.c_str(),&ptrs[iF]);
+    }
+    return true;
+  }
+
+  template <class T>
+  inline T valueAt(const std::vector<T> & col, const unsigned idx){
+    return idx<col.size() ? col[idx] : T(0);
+  }
+
+}
+
+HGCSSSimHitColumns::HGCSSSimHitColumns():
+  columnar_(false)
+{
+  ptrs_.push_back(&energy_);
+  ptrs_.push_back(&time_);
+  ptrs_.push_back(&zpos_);
+  ptrs_.push_back(&layer_);
+  ptrs_.push_back(&cellid_);
+  ptrs_.push_back(&nGammas_);
+  ptrs_.push_back(&nElectrons_);
+  ptrs_.push_back(&nMuons_);
+  ptrs_.push_back(&nNeutrons_);
+  ptrs_.push_back(&nProtons_);
+  ptrs_.push_back(&nHadrons_);
+  ptrs_.push_back(&trackIDMainParent_);
+  ptrs_.push_back(&energyMainParent_);
+  active_.resize(ptrs_.size(),false);
+}
+
+const std::vector<std::string> & HGCSSSimHitColumns::fields(){
+  static std::vector<std::string> lFields;
+  if (lFields.size()==0){
+    lFields.push_back("energy");
+    lFields.push_back("time");
+    lFields.push_back("zpos");
+    lFields.push_back("layer");
+    lFields.push_back("cellid");
+    lFields.push_back("nGammas");
+    lFields.push_back("nElectrons");
+    lFields.push_back("nMuons");
+    lFields.push_back("nNeutrons");
+    lFields.push_back("nProtons");
+    lFields.push_back("nHadrons");
+    lFields.push_back("trackIDMainParent");
+    lFields.push_back("energyMainParent");
+  }
+  return lFields;
+}
+
+bool HGCSSSimHitColumns::isColumnar(TTree *tree, const std::string & objBranch){
+  return tree->GetBranch((columnPrefix(objBranch)+"_energy").c_str()) != 0;
+}
+
+void HGCSSSimHitColumns::branch(TTree *tree, const std::string & objBranch){
+  std::vector<std::string> lTypes(fields().size(),"std::vector<unsigned int>");
+  lTypes[0] = lTypes[1] = lTypes[2] = lTypes[12] = "std::vector<double>";
+  lTypes[11] = "std::vector<int>";
+  branchColumns(tree,objBranch,fields(),lTypes,ptrs_);
+}
+
+void HGCSSSimHitColumns::fill(const HGCSSSimHitVec & hits){
+  unsigned n = hits.size();
+  energy_.resize(n);
+  time_.resize(n);
+  zpos_.resize(n);
+  layer_.resize(n);
+  cellid_.resize(n);
+  nGammas_.resize(n);
+  nElectrons_.resize(n);
+  nMuons_.resize(n);
+  nNeutrons_.resize(n);
+  nProtons_.resize(n);
+  nHadrons_.resize(n);
+  trackIDMainParent_.resize(n);
+  energyMainParent_.resize(n);
+  for (unsigned iH(0); iH<n; ++iH){
+    const HGCSSSimHit & lHit = hits[iH];
+    energy_[iH] = lHit.energy_;
+    time_[iH] = lHit.time_;
+    zpos_[iH] = lHit.zpos_;
+    layer_[iH] = lHit.layer_;
+    cellid_[iH] = lHit.cellid_;
+    nGammas_[iH] = lHit.nGammas_;
+    nElectrons_[iH] = lHit.nElectrons_;
+    nMuons_[iH] = lHit.nMuons_;
+    nNeutrons_[iH] = lHit.nNeutrons_;
+    nProtons_[iH] = lHit.nProtons_;
+    nHadrons_[iH] = lHit.nHadrons_;
+    trackIDMainParent_[iH] = lHit.trackIDMainParent_;
+    energyMainParent_[iH] = lHit.energyMainParent_;
+  }
+}
+
+bool HGCSSSimHitColumns::attach(TTree *tree, const std::string & objBranch,
+				HGCSSSimHitVec *& hits, const std::string & columns){
+  if (tree->GetBranch(objBranch.c_str())){
+    columnar_ = false;
+    tree->SetBranchStatus((objBranch+"*").c_str(),1);
+    tree->SetBranchAddress(objBranch.c_str(),&hits);
+    return true;
+  }
+  if (!isColumnar(tree,objBranch)){
+    std::cout << " -- Error, tree " << tree->GetName() << " has neither " << objBranch << " nor its columns." << std::endl;
+    return false;
+  }
+  columnar_ = true;
+  hits = &hits_;
+  return attachColumns(tree,objBranch,columns,fields(),ptrs_,active_);
+}
+
+void HGCSSSimHitColumns::update(){
+  if (!columnar_) return;
+  unsigned n = 0;
+  for (unsigned iF(0); iF<ptrs_.size(); ++iF){
+    if (!active_[iF]) continue;
+    if (iF==11) n = std::max(n,static_cast<unsigned>(trackIDMainParent_.size()));
+    else if (iF<3 || iF==12) n = std::max(n,static_cast<unsigned>(static_cast<std::vector<double>*>(ptrs_[iF])->size()));
+    else n = std::max(n,static_cast<unsigned>(static_cast<std::vector<unsigned>*>(ptrs_[iF])->size()));
+  }
+  hits_.resize(n);
+  for (unsigned iH(0); iH<n; ++iH){
+    HGCSSSimHit & lHit = hits_[iH];
+    lHit.energy_ = valueAt(energy_,iH);
+    lHit.time_ = valueAt(time_,iH);
+    lHit.zpos_ = valueAt(zpos_,iH);
+    lHit.layer_ = valueAt(layer_,iH);
+    lHit.cellid_ = valueAt(cellid_,iH);
+    lHit.nGammas_ = valueAt(nGammas_,iH);
+    lHit.nElectrons_ = valueAt(nElectrons_,iH);
+    lHit.nMuons_ = valueAt(nMuons_,iH);
+    lHit.nNeutrons_ = valueAt(nNeutrons_,iH);
+    lHit.nProtons_ = valueAt(nProtons_,iH);
+    lHit.nHadrons_ = valueAt(nHadrons_,iH);
+    lHit.trackIDMainParent_ = valueAt(trackIDMainParent_,iH);
+    lHit.energyMainParent_ = valueAt(energyMainParent_,iH);
+  }
+}
+
+HGCSSRecoHitColumns::HGCSSRecoHitColumns():
+  columnar_(false)
+{
+  ptrs_.push_back(&energy_);
+  ptrs_.push_back(&adcCounts_);
+  ptrs_.push_back(&xpos_);
+  ptrs_.push_back(&ypos_);
+  ptrs_.push_back(&zpos_);
+  ptrs_.push_back(&layer_);
+  ptrs_.push_back(&noiseFrac_);
+  ptrs_.push_back(&time_);
+  active_.resize(ptrs_.size(),false);
+}
+
+const std::vector<std::string> & HGCSSRecoHitColumns::fields(){
+  static std::vector<std::string> lFields;
+  if (lFields.size()==0){
+    lFields.push_back("energy");
+    lFields.push_back("adcCounts");
+    lFields.push_back("xpos");
+    lFields.push_back("ypos");
+    lFields.push_back("zpos");
+    lFields.push_back("layer");
+    lFields.push_back("noiseFrac");
+    lFields.push_back("time");
+  }
+  return lFields;
+}
+
+bool HGCSSRecoHitColumns::isColumnar(TTree *tree, const std::string & objBranch){
+  return tree->GetBranch((columnPrefix(objBranch)+"_energy").c_str()) != 0;
+}
+
+void HGCSSRecoHitColumns::branch(TTree *tree, const std::string & objBranch){
+  std::vector<std::string> lTypes(fields().size(),"std::vector<double>");
+  lTypes[1] = lTypes[5] = "std::vector<unsigned int>";
+  branchColumns(tree,objBranch,fields(),lTypes,ptrs_);
+}
+
+void HGCSSRecoHitColumns::fill(const HGCSSRecoHitVec & hits){
+  unsigned n = hits.size();
+  energy_.resize(n);
+  adcCounts_.resize(n);
+  xpos_.resize(n);
+  ypos_.resize(n);
+  zpos_.resize(n);
+  layer_.resize(n);
+  noiseFrac_.resize(n);
+  time_.resize(n);
+  for (unsigned iH(0); iH<n; ++iH){
+    const HGCSSRecoHit & lHit = hits[iH];
+    energy_[iH] = lHit.energy();
+    adcCounts_[iH] = lHit.adcCounts();
+    xpos_[iH] = lHit.get_x();
+    ypos_[iH] = lHit.get_y();
+    zpos_[iH] = lHit.get_z();
+    layer_[iH] = lHit.layer();
+    noiseFrac_[iH] = lHit.noiseFraction();
+    time_[iH] = lHit.time();
+  }
+}
+
+bool HGCSSRecoHitColumns::attach(TTree *tree, const std::string & objBranch,
+				 HGCSSRecoHitVec *& hits, const std::string & columns){
+  if (tree->GetBranch(objBranch.c_str())){
+    columnar_ = false;
+    tree->SetBranchStatus((objBranch+"*").c_str(),1);
+    tree->SetBranchAddress(objBranch.c_str(),&hits);
+    return true;
+  }
+  if (!isColumnar(tree,objBranch)){
+    std::cout << " -- Error, tree " << tree->GetName() << " has neither " << objBranch << " nor its columns." << std::endl;
+    return false;
+  }
+  columnar_ = true;
+  hits = &hits_;
+  return attachColumns(tree,objBranch,columns,fields(),ptrs_,active_);
+}
+
+void HGCSSRecoHitColumns::update(){
+  if (!columnar_) return;
+  unsigned n = 0;
+  for (unsigned iF(0); iF<ptrs_.size(); ++iF){
+    if (!active_[iF]) continue;
+    if (iF==1 || iF==5) n = std::max(n,static_cast<unsigned>(static_cast<std::vector<unsigned>*>(ptrs_[iF])->size()));
+    else n = std::max(n,static_cast<unsigned>(static_cast<std::vector<double>*>(ptrs_[iF])->size()));
+  }
+  hits_.resize(n);
+  for (unsigned iH(0); iH<n; ++iH){
+    HGCSSRecoHit & lHit = hits_[iH];
+    lHit.energy(valueAt(energy_,iH));
+    lHit.adcCounts(valueAt(adcCounts_,iH));
+    lHit.x(valueAt(xpos_,iH));
+    lHit.y(valueAt(ypos_,iH));
+    lHit.z(valueAt(zpos_,iH));
+    lHit.layer(valueAt(layer_,iH));
+    lHit.noiseFraction(valueAt(noiseFrac_,iH));
+    lHit.time(valueAt(time_,iH));
+  }
+}
@@ -0,0 +1,257 @@
+#include "HGCSSPUlibrary.hh"
+#include <iostream>
+#include <fstream>
+#include <algorithm>
+#include <cstring>
+
+#include <dirent.h>
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "HGCSSSimHit.hh"
+#include "HGCSSHitColumns.hh"
+
+namespace {
+  const char libMagic[8] = {'H','G','C','P','U','L','I','B'};
+  const uint32_t libVersion = 1;
+
+  struct HGCSSPUheader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nSources;
+    uint64_t nEvents;
+    uint64_t nHits;
+  };
+}
+
+HGCSSPUlibrary::HGCSSPUlibrary():
+  data_(0),
+  size_(0),
+  nEvents_(0),
+  offsets_(0),
+  hits_(0)
+{
+}
+
+HGCSSPUlibrary::~HGCSSPUlibrary(){
+  close();
+}
+
+bool HGCSSPUlibrary::isLibrary(const std::string & filePath){
+  const std::string ext = ".pulib";
+  return filePath.size() > ext.size() &&
+    filePath.compare(filePath.size()-ext.size(),ext.size(),ext) == 0;
+}
+
+std::vector<std::string> HGCSSPUlibrary::findFiles(const std::string & dirPath,
+						   const std::string & pattern,
+						   const std::string & veto){
+  std::vector<std::string> lFiles;
+  DIR *lDir = opendir(dirPath.c_str());
+  if (!lDir) {
+    std::cout << " -- Error, cannot open directory " << dirPath << std::endl;
+    return lFiles;
+  }
+  std::string lPrefix = dirPath;
+  if (lPrefix.size()>0 && lPrefix[lPrefix.size()-1] != '/') lPrefix += "/";
+  struct dirent *lEntry = 0;
+  while ((lEntry = readdir(lDir))){
+    std::string lName = lEntry->d_name;
+    if (lName.size()<5 || lName.compare(lName.size()-5,5,".root") != 0) continue;
+    if (lName.find(pattern)==lName.npos) continue;
+    if (veto.size()>0 && lName.find(veto)!=lName.npos) continue;
+    lFiles.push_back(lPrefix+lName);
+  }
+  closedir(lDir);
+  std::sort(lFiles.begin(),lFiles.end());
+  return lFiles;
+}
+
+bool HGCSSPUlibrary::pack(const std::vector<std::string> & inputFiles,
+			  const std::string & outputFile,
+			  const unsigned maxEvents){
+
+  //count events first to reserve the offset table
+  std::vector<uint64_t> lFileEvts;
+  uint64_t nEvents = 0;
+  for (unsigned iF(0); iF<inputFiles.size(); ++iF){
+    TFile *lFile = TFile::Open(inputFiles[iF].c_str());
+    TTree *lTree = lFile ? (TTree*)lFile->Get("HGCSSTree") : 0;
+    if (!lTree) {
+      std::cout << " -- Error, cannot read HGCSSTree from " << inputFiles[iF] << ". Exiting..." << std::endl;
+      if (lFile) {
+	lFile->Close();
+	delete lFile;
+      }
+      return false;
+    }
+    uint64_t n = lTree->GetEntries();
+    if (maxEvents>0 && nEvents+n > maxEvents) n = maxEvents-nEvents;
+    lFileEvts.push_back(n);
+    nEvents += n;
+    lFile->Close();
+    delete lFile;
+  }
+
+  std::ofstream lOut(outputFile.c_str(),std::ios::binary);
+  if (!lOut) {
+    std::cout << " -- Error, cannot create " << outputFile << std::endl;
+    return false;
+  }
+
+  HGCSSPUheader lHeader;
+  memcpy(lHeader.magic,libMagic,8);
+  lHeader.version = libVersion;
+  lHeader.nSources = inputFiles.size();
+  lHeader.nEvents = nEvents;
+  lHeader.nHits = 0;
+  std::vector<uint64_t> lOffsets(nEvents+1,0);
+  lOut.write((const char*)&lHeader,sizeof(HGCSSPUheader));
+  lOut.write((const char*)&lOffsets[0],lOffsets.size()*sizeof(uint64_t));
+
+  uint64_t ievt = 0;
+  for (unsigned iF(0); iF<inputFiles.size(); ++iF){
+    if (lFileEvts[iF]==0) continue;
+    TFile *lFile = TFile::Open(inputFiles[iF].c_str());
+    TTree *lTree = lFile ? (TTree*)lFile->Get("HGCSSTree") : 0;
+    std::vector<HGCSSSimHit> * hitvec = 0;
+    HGCSSSimHitColumns lCols;
+    if (lTree) lTree->SetBranchStatus("*",0);
+    if (!lTree || !lCols.attach(lTree,"HGCSSSimHitVec",hitvec,"energy,time,zpos,layer,cellid")) {
+      std::cout << " -- Error, cannot read the hits of " << inputFiles[iF] << ". Exiting..." << std::endl;
+      if (lFile) {
+	lFile->Close();
+	delete lFile;
+      }
+      return false;
+    }
+    std::cout << " -- Packing " << lFileEvts[iF] << " events from " << inputFiles[iF] << std::endl;
+    for (uint64_t iE(0); iE<lFileEvts[iF]; ++iE){
+      lTree->GetEntry(iE);
+      lCols.update();
+      lOffsets[ievt] = lHeader.nHits;
+      for (unsigned iH(0); iH<(*hitvec).size(); ++iH){
+	const HGCSSSimHit & lHit = (*hitvec)[iH];
+	if (lHit.energy()<=0) continue;
+	HGCSSPUhit lRec;
+	lRec.layer = 3*lHit.layer()+lHit.silayer();
+	lRec.cellid = lHit.cellid();
+	lRec.energy = lHit.energy();
+	lRec.time = lHit.time();
+	lRec.zpos = lHit.get_z();
+	lOut.write((const char*)&lRec,sizeof(HGCSSPUhit));
+	lHeader.nHits++;
+      }
+      ievt++;
+    }
+    lFile->Close();
+    delete lFile;
+  }
+  lOffsets[nEvents] = lHeader.nHits;
+
+  //sources: first event, number of events, name
+  uint64_t lFirst = 0;
+  for (unsigned iF(0); iF<inputFiles.size(); ++iF){
+    uint32_t lLength = inputFiles[iF].size();
+    lOut.write((const char*)&lFirst,sizeof(uint64_t));
+    lOut.write((const char*)&lFileEvts[iF],sizeof(uint64_t));
+    lOut.write((const char*)&lLength,sizeof(uint32_t));
+    lOut.write(inputFiles[iF].c_str(),lLength);
+    lFirst += lFileEvts[iF];
+  }
+
+  lOut.seekp(0);
+  lOut.write((const char*)&lHeader,sizeof(HGCSSPUheader));
+  lOut.write((const char*)&lOffsets[0],lOffsets.size()*sizeof(uint64_t));
+  lOut.close();
+  if (!lOut) {
+    std::cout << " -- Error writing " << outputFile << std::endl;
+    return false;
+  }
+  std::cout << " -- Packed " << nEvents << " events, " << lHeader.nHits << " hits into " << outputFile << std::endl;
+  return true;
+}
+
+bool HGCSSPUlibrary::open(const std::string & filePath){
+  close();
+  int fd = ::open(filePath.c_str(),O_RDONLY);
+  if (fd<0) {
+    std::cout << " -- Error, cannot open pileup library " << filePath << std::endl;
+    return false;
+  }
+  struct stat lStat;
+  if (fstat(fd,&lStat)!=0 || static_cast<size_t>(lStat.st_size) < sizeof(HGCSSPUheader)) {
+    std::cout << " -- Error, pileup library " << filePath << " is too short." << std::endl;
+    ::close(fd);
+    return false;
+  }
+  size_t lSize = lStat.st_size;
+  void *lData = mmap(0,lSize,PROT_READ,MAP_PRIVATE,fd,0);
+  ::close(fd);
+  if (lData == MAP_FAILED) {
+    std::cout << " -- Error, cannot map pileup library " << filePath << std::endl;
+    return false;
+  }
+  data_ = (const char*)lData;
+  size_ = lSize;
+
+  const HGCSSPUheader *lHeader = (const HGCSSPUheader*)data_;
+  size_t lHitStart = sizeof(HGCSSPUheader)+(lHeader->nEvents+1)*sizeof(uint64_t);
+  size_t lSrcStart = lHitStart+lHeader->nHits*sizeof(HGCSSPUhit);
+  if (memcmp(lHeader->magic,libMagic,8)!=0 || lHeader->version != libVersion || lSrcStart > size_) {
+    std::cout << " -- Error, " << filePath << " is not a valid pileup library." << std::endl;
+    close();
+    return false;
+  }
+  nEvents_ = lHeader->nEvents;
+  offsets_ = (const uint64_t*)(data_+sizeof(HGCSSPUheader));
+  hits_ = (const HGCSSPUhit*)(data_+lHitStart);
+
+  size_t lPos = lSrcStart;
+  for (unsigned iS(0); iS<lHeader->nSources; ++iS){
+    uint64_t lFirst, lN;
+    uint32_t lLength;
+    if (lPos+2*sizeof(uint64_t)+sizeof(uint32_t) > size_) break;
+    memcpy(&lFirst,data_+lPos,sizeof(uint64_t)); lPos += sizeof(uint64_t);
+    memcpy(&lN,data_+lPos,sizeof(uint64_t)); lPos += sizeof(uint64_t);
+    memcpy(&lLength,data_+lPos,sizeof(uint32_t)); lPos += sizeof(uint32_t);
+    if (lPos+lLength > size_) break;
+    sources_.push_back(std::string(data_+lPos,lLength));
+    sourceFirst_.push_back(lFirst);
+    sourceN_.push_back(lN);
+    lPos += lLength;
+  }
+  //the hits of an event are contiguous and read in order: read ahead
+  madvise((void*)data_,size_,MADV_SEQUENTIAL);
+
+  std::cout << " -- Pileup library " << filePath << ": " << nEvents_ << " events, "
+	    << lHeader->nHits << " hits from " << sources_.size() << " files." << std::endl;
+  return true;
+}
+
+void HGCSSPUlibrary::close(){
+  if (data_) munmap((void*)data_,size_);
+  data_ = 0;
+  size_ = 0;
+  nEvents_ = 0;
+  offsets_ = 0;
+  hits_ = 0;
+  sources_.clear();
+  sourceFirst_.clear();
+  sourceN_.clear();
+}
+
+bool HGCSSPUlibrary::sourceRange(const std::string & inputFile, unsigned & first, unsigned & n) const{
+  for (unsigned iS(0); iS<sources_.size(); ++iS){
+    if (sources_[iS] == inputFile){
+      first = sourceFirst_[iS];
+      n = sourceN_[iS];
+      return true;
+    }
+  }
+  return false;
+}
@@ -0,0 +1,71 @@
+#include "HGCSSRandomStream.hh"
+
+HGCSSRandomStream::HGCSSRandomStream(const unsigned aSeed):
+  seed_(aSeed),
+  event_(0),
+  stream_(0),
+  block_(0),
+  used_(4)
+{
+}
+
+void HGCSSRandomStream::setSeed(const unsigned aSeed){
+  seed_ = aSeed;
+  block_ = 0;
+  used_ = 4;
+}
+
+void HGCSSRandomStream::setStream(const unsigned event, const unsigned stream){
+  event_ = event;
+  stream_ = stream;
+  block_ = 0;
+  used_ = 4;
+}
+
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,8,0)
+Double_t HGCSSRandomStream::Rndm(){
+  return next();
+}
+#else
+Double_t HGCSSRandomStream::Rndm(Int_t){
+  return next();
+}
+#endif
+
+void HGCSSRandomStream::RndmArray(Int_t n, Float_t *array){
+  for (Int_t i(0); i<n; ++i){
+    //float rounding can give 1
+    do {
+      array[i] = next();
+    } while (array[i]>=1);
+  }
+}
+
+void HGCSSRandomStream::RndmArray(Int_t n, Double_t *array){
+  for (Int_t i(0); i<n; ++i){
+    array[i] = next();
+  }
+}
+
+void HGCSSRandomStream::nextBlock(){
+  //counter: block number and event, key: seed and stream
+  uint32_t ctr[4] = {static_cast<uint32_t>(block_),static_cast<uint32_t>(block_>>32),event_,0};
+  uint32_t key[2] = {seed_,stream_};
+  for (unsigned iR(0); iR<10; ++iR){//rounds
+    const uint64_t p0 = static_cast<uint64_t>(0xD2511F53)*ctr[0];
+    const uint64_t p1 = static_cast<uint64_t>(0xCD9E8D57)*ctr[2];
+    const uint32_t hi0 = p0>>32, lo0 = p0;
+    const uint32_t hi1 = p1>>32, lo1 = p1;
+    ctr[0] = hi1^ctr[1]^key[0];
+    ctr[1] = lo1;
+    ctr[2] = hi0^ctr[3]^key[1];
+    ctr[3] = lo0;
+    key[0] += 0x9E3779B9;
+    key[1] += 0xBB67AE85;
+  }
+  for (unsigned i(0); i<4; ++i){
+    buffer_[i] = ctr[i];
+  }
+  ++block_;
+  used_ = 0;
+}
@@ -0,0 +1,395 @@
+#include "HGCSSShowerLibrary.hh"
+#include <fstream>
+#include <map>
+#include <algorithm>
+#include <cstring>
+
+#include <fcntl.h>
+#include <unistd.h>
+#include <sys/mman.h>
+#include <sys/stat.h>
+
+#include "TRandom3.h"
+
+namespace {
+  const char libMagic[8] = {'H','G','C','S','H','L','I','B'};
+  const char recMagic[8] = {'H','G','C','S','H','R','E','C'};
+  const uint32_t libVersion = 1;
+
+  struct HGCSSShowerLibHeader {
+    char magic[8];
+    uint32_t version;
+    uint32_t nMaterials;
+    uint32_t nEnergyBins;
+    uint32_t nAngleBins;
+    uint32_t nDepthBins;
+    uint32_t nParticles;
+    uint64_t nTemplates;
+    uint64_t nSpots;
+  };
+
+  //showers kept for one bin while packing
+  struct Shower {
+    float energy;
+    std::vector<HGCSSShowerSpot> spots;
+  };
+  struct Reservoir {
+    unsigned particle;
+    unsigned material;
+    unsigned iE;
+    unsigned iA;
+    unsigned iD;
+    uint64_t nSeen;
+    std::vector<Shower> showers;
+  };
+
+  //-1 if outside, the last edge is included
+  int findBin(const std::vector<double> & edges, const double & val){
+    if (edges.size()<2 || val<edges[0] || val>edges.back()) return -1;
+    int idx = std::upper_bound(edges.begin(),edges.end(),val)-edges.begin()-1;
+    return std::min(idx,static_cast<int>(edges.size())-2);
+  }
+
+  template <class T> bool readValue(std::istream & aIs, T & aVal){
+    aIs.read((char*)&aVal,sizeof(T));
+    return aIs.good();
+  }
+}
+
+HGCSSShowerLibrary::HGCSSShowerLibrary():
+  data_(0),
+  size_(0),
+  nEnergyBins_(0),
+  nAngleBins_(0),
+  nDepthBins_(0),
+  energyEdges_(0),
+  cosThetaEdges_(0),
+  offsets_(0),
+  templates_(0),
+  spots_(0)
+{
+}
+
+HGCSSShowerLibrary::~HGCSSShowerLibrary(){
+  close();
+}
+
+int HGCSSShowerLibrary::particle(const int pdgId){
+  if (pdgId==22) return gamma;
+  if (pdgId==11) return electron;
+  if (pdgId==-11) return positron;
+  return -1;
+}
+
+bool HGCSSShowerLibrary::writeRecordHeader(std::ostream & aOs){
+  const uint32_t lZero = 0;
+  aOs.write(recMagic,8);
+  aOs.write((const char*)&libVersion,sizeof(uint32_t));
+  aOs.write((const char*)&lZero,sizeof(uint32_t));
+  return aOs.good();
+}
+
+bool HGCSSShowerLibrary::writeRecord(std::ostream & aOs, const unsigned aParticle,
+				     const std::string & aMaterial, const float aEnergy,
+				     const float aCosTheta, const float aDepth,
+				     const std::vector<HGCSSShowerSpot> & aSpots){
+  const uint32_t lParticle = aParticle;
+  const uint32_t lLength = aMaterial.size();
+  const uint32_t lN = aSpots.size();
+  aOs.write((const char*)&lParticle,sizeof(uint32_t));
+  aOs.write((const char*)&lLength,sizeof(uint32_t));
+  aOs.write(aMaterial.c_str(),lLength);
+  aOs.write((const char*)&aEnergy,sizeof(float));
+  aOs.write((const char*)&aCosTheta,sizeof(float));
+  aOs.write((const char*)&aDepth,sizeof(float));
+  aOs.write((const char*)&lN,sizeof(uint32_t));
+  if (lN>0) aOs.write((const char*)&aSpots[0],lN*sizeof(HGCSSShowerSpot));
+  return aOs.good();
+}
+
+bool HGCSSShowerLibrary::pack(const std::vector<std::string> & recordFiles,
+			      const std::string & outputFile,
+			      const std::vector<double> & energyEdges,
+			      const std::vector<double> & cosThetaEdges,
+			      const unsigned nDepthBins,
+			      const unsigned maxTemplates){
+
+  if (energyEdges.size()<2 || cosThetaEdges.size()<2 || nDepthBins==0 || maxTemplates==0) {
+    std::cout << " -- Error, need at least one energy, angle and depth bin, and one shower per bin." << std::endl;
+    return false;
+  }
+  const unsigned nE = energyEdges.size()-1;
+  const unsigned nA = cosThetaEdges.size()-1;
+
+  //same seed: same library from the same records
+  TRandom3 lRand(1234);
+  std::vector<std::string> lMaterials;
+  std::map<std::string,unsigned> lMatIdx;
+  std::map<uint64_t,Reservoir> lBins;
+  uint64_t nRead = 0, nOut = 0;
+
+  for (unsigned iF(0); iF<recordFiles.size(); ++iF){
+    std::ifstream lIn(recordFiles[iF].c_str(),std::ios::binary);
+    char lMagic[8];
+    uint32_t lVersion = 0, lPad = 0;
+    if (!lIn.read(lMagic,8) || !readValue(lIn,lVersion) || !readValue(lIn,lPad) ||
+	memcmp(lMagic,recMagic,8)!=0 || lVersion != libVersion) {
+      std::cout << " -- Error, " << recordFiles[iF] << " is not a frozen shower record file." << std::endl;
+      return false;
+    }
+    uint64_t nFile = 0;
+    uint32_t lParticle = 0;
+    while (readValue(lIn,lParticle)){
+      uint32_t lLength = 0, lN = 0;
+      float lEnergy = 0, lCos = 0, lDepth = 0;
+      std::string lName;
+      if (readValue(lIn,lLength)) {
+	lName.resize(lLength);
+	if (lLength>0) lIn.read(&lName[0],lLength);
+      }
+      Shower lShower;
+      if (lIn.good() && readValue(lIn,lEnergy) && readValue(lIn,lCos) &&
+	  readValue(lIn,lDepth) && readValue(lIn,lN)) {
+	lShower.spots.resize(lN);
+	if (lN>0) lIn.read((char*)&lShower.spots[0],lN*sizeof(HGCSSShowerSpot));
+      }
+      if (!lIn.good() || lParticle>=nParticles) {
+	std::cout << " -- Error, truncated record " << nFile << " in " << recordFiles[iF] << std::endl;
+	return false;
+      }
+      ++nFile;
+      lShower.energy = lEnergy;
+
+      const int iE = findBin(energyEdges,lEnergy);
+      const int iA = findBin(cosThetaEdges,lCos);
+      if (iE<0 || iA<0 || lEnergy>=energyEdges.back()) {
+	++nOut;
+	continue;
+      }
+      const unsigned iD = std::min(static_cast<unsigned>(std::max(lDepth,0.f)*nDepthBins),nDepthBins-1);
+      std::pair<std::map<std::string,unsigned>::iterator,bool> lIns = lMatIdx.insert(std::pair<std::string,unsigned>(lName,lMaterials.size()));
+      if (lIns.second) lMaterials.push_back(lName);
+      const unsigned iM = lIns.first->second;
+
+      const uint64_t lKey = ((((uint64_t)iM*nParticles+lParticle)*nE+iE)*nA+iA)*nDepthBins+iD;
+      Reservoir & lRes = lBins[lKey];
+      if (lRes.nSeen==0) {
+	lRes.particle = lParticle;
+	lRes.material = iM;
+	lRes.iE = iE;
+	lRes.iA = iA;
+	lRes.iD = iD;
+      }
+      ++lRes.nSeen;
+      if (lRes.showers.size()<maxTemplates) lRes.showers.push_back(lShower);
+      else {
+	const uint64_t j = lRand.Rndm()*lRes.nSeen;
+	if (j<maxTemplates) lRes.showers[j] = lShower;
+      }
+    }
+    std::cout << " -- Read " << nFile << " showers from " << recordFiles[iF] << std::endl;
+    nRead += nFile;
+  }
+
+  //bin order: particle, material, energy, angle, depth
+  const unsigned nMat = lMaterials.size();
+  const uint64_t nBins = (uint64_t)nParticles*nMat*nE*nA*nDepthBins;
+  std::vector<const Reservoir*> lByBin(nBins,0);
+  for (std::map<uint64_t,Reservoir>::const_iterator lIter = lBins.begin(); lIter != lBins.end(); ++lIter){
+    const Reservoir & lRes = lIter->second;
+    lByBin[((((uint64_t)lRes.particle*nMat+lRes.material)*nE+lRes.iE)*nA+lRes.iA)*nDepthBins+lRes.iD] = &lRes;
+  }
+
+  HGCSSShowerLibHeader lHeader;
+  memcpy(lHeader.magic,libMagic,8);
+  lHeader.version = libVersion;
+  lHeader.nMaterials = nMat;
+  lHeader.nEnergyBins = nE;
+  lHeader.nAngleBins = nA;
+  lHeader.nDepthBins = nDepthBins;
+  lHeader.nParticles = nParticles;
+  lHeader.nTemplates = 0;
+  lHeader.nSpots = 0;
+  std::vector<uint64_t> lOffsets(nBins+1,0);
+  std::vector<HGCSSShowerTemplate> lTemplates;
+  for (uint64_t iB(0); iB<nBins; ++iB){
+    lOffsets[iB] = lTemplates.size();
+    if (!lByBin[iB]) continue;
+    const std::vector<Shower> & lShowers = lByBin[iB]->showers;
+    for (unsigned iS(0); iS<lShowers.size(); ++iS){
+      HGCSSShowerTemplate lTemp;
+      lTemp.firstSpot = lHeader.nSpots;
+      lTemp.nSpots = lShowers[iS].spots.size();
+      lTemp.energy = lShowers[iS].energy;
+      lTemplates.push_back(lTemp);
+      lHeader.nSpots += lTemp.nSpots;
+    }
+  }
+  lOffsets[nBins] = lTemplates.size();
+  lHeader.nTemplates = lTemplates.size();
+
+  std::ofstream lOut(outputFile.c_str(),std::ios::binary);
+  if (!lOut) {
+    std::cout << " -- Error, cannot create " << outputFile << std::endl;
+    return false;
+  }
+  lOut.write((const char*)&lHeader,sizeof(HGCSSShowerLibHeader));
+  lOut.write((const char*)&energyEdges[0],energyEdges.size()*sizeof(double));
+  lOut.write((const char*)&cosThetaEdges[0],cosThetaEdges.size()*sizeof(double));
+  lOut.write((const char*)&lOffsets[0],lOffsets.size()*sizeof(uint64_t));
+  if (lTemplates.size()>0) lOut.write((const char*)&lTemplates[0],lTemplates.size()*sizeof(HGCSSShowerTemplate));
+  for (uint64_t iB(0); iB<nBins; ++iB){
+    if (!lByBin[iB]) continue;
+    const std::vector<Shower> & lShowers = lByBin[iB]->showers;
+    for (unsigned iS(0); iS<lShowers.size(); ++iS){
+      if (lShowers[iS].spots.size()>0) lOut.write((const char*)&lShowers[iS].spots[0],lShowers[iS].spots.size()*sizeof(HGCSSShowerSpot));
+    }
+  }
+  for (unsigned iM(0); iM<nMat; ++iM){
+    uint32_t lLength = lMaterials[iM].size();
+    lOut.write((const char*)&lLength,sizeof(uint32_t));
+    lOut.write(lMaterials[iM].c_str(),lLength);
+  }
+  lOut.close();
+  if (!lOut) {
+    std::cout << " -- Error writing " << outputFile << std::endl;
+    return false;
+  }
+  std::cout << " -- Packed " << lHeader.nTemplates << " of " << nRead << " showers (" << nOut
+	    << " outside of the bins), " << lHeader.nSpots << " spots, into " << outputFile << std::endl;
+  return true;
+}
+
+bool HGCSSShowerLibrary::isLibrary(const std::string & filePath){
+  const std::string ext = ".shlib";
+  return filePath.size() > ext.size() &&
+    filePath.compare(filePath.size()-ext.size(),ext.size(),ext) == 0;
+}
+
+bool HGCSSShowerLibrary::open(const std::string & filePath){
+  close();
+  int fd = ::open(filePath.c_str(),O_RDONLY);
+  if (fd<0) {
+    std::cout << " -- Error, cannot open frozen shower library " << filePath << std::endl;
+    return false;
+  }
+  struct stat lStat;
+  if (fstat(fd,&lStat)!=0 || static_cast<size_t>(lStat.st_size) < sizeof(HGCSSShowerLibHeader)) {
+    std::cout << " -- Error, frozen shower library " << filePath << " is too short." << std::endl;
+    ::close(fd);
+    return false;
+  }
+  size_t lSize = lStat.st_size;
+  void *lData = mmap(0,lSize,PROT_READ,MAP_PRIVATE,fd,0);
+  ::close(fd);
+  if (lData == MAP_FAILED) {
+    std::cout << " -- Error, cannot map frozen shower library " << filePath << std::endl;
+    return false;
+  }
+  data_ = (const char*)lData;
+  size_ = lSize;
+
+  const HGCSSShowerLibHeader *lHeader = (const HGCSSShowerLibHeader*)data_;
+  const uint64_t nBins = (uint64_t)lHeader->nParticles*lHeader->nMaterials*lHeader->nEnergyBins*lHeader->nAngleBins*lHeader->nDepthBins;
+  size_t lEdgeStart = sizeof(HGCSSShowerLibHeader);
+  size_t lOffStart = lEdgeStart+(lHeader->nEnergyBins+lHeader->nAngleBins+2)*sizeof(double);
+  size_t lTempStart = lOffStart+(nBins+1)*sizeof(uint64_t);
+  size_t lSpotStart = lTempStart+lHeader->nTemplates*sizeof(HGCSSShowerTemplate);
+  size_t lNameStart = lSpotStart+lHeader->nSpots*sizeof(HGCSSShowerSpot);
+  if (memcmp(lHeader->magic,libMagic,8)!=0 || lHeader->version != libVersion ||
+      lHeader->nParticles != nParticles || lNameStart > size_) {
+    std::cout << " -- Error, " << filePath << " is not a valid frozen shower library." << std::endl;
+    close();
+    return false;
+  }
+  nEnergyBins_ = lHeader->nEnergyBins;
+  nAngleBins_ = lHeader->nAngleBins;
+  nDepthBins_ = lHeader->nDepthBins;
+  energyEdges_ = (const double*)(data_+lEdgeStart);
+  cosThetaEdges_ = energyEdges_+nEnergyBins_+1;
+  offsets_ = (const uint64_t*)(data_+lOffStart);
+  templates_ = (const HGCSSShowerTemplate*)(data_+lTempStart);
+  spots_ = (const HGCSSShowerSpot*)(data_+lSpotStart);
+
+  size_t lPos = lNameStart;
+  for (unsigned iM(0); iM<lHeader->nMaterials; ++iM){
+    uint32_t lLength;
+    if (lPos+sizeof(uint32_t) > size_) break;
+    memcpy(&lLength,data_+lPos,sizeof(uint32_t)); lPos += sizeof(uint32_t);
+    if (lPos+lLength > size_) break;
+    materials_.push_back(std::string(data_+lPos,lLength));
+    lPos += lLength;
+  }
+  if (materials_.size() != lHeader->nMaterials) {
+    std::cout << " -- Error, " << filePath << " is truncated." << std::endl;
+    close();
+    return false;
+  }
+  //templates are drawn at random: no read-ahead
+  madvise((void*)data_,size_,MADV_RANDOM);
+
+  std::cout << " -- Frozen shower library " << filePath << ": " << lHeader->nTemplates << " showers, "
+	    << lHeader->nSpots << " spots." << std::endl;
+  return true;
+}
+
+void HGCSSShowerLibrary::close(){
+  if (data_) munmap((void*)data_,size_);
+  data_ = 0;
+  size_ = 0;
+  nEnergyBins_ = 0;
+  nAngleBins_ = 0;
+  nDepthBins_ = 0;
+  energyEdges_ = 0;
+  cosThetaEdges_ = 0;
+  offsets_ = 0;
+  templates_ = 0;
+  spots_ = 0;
+  materials_.clear();
+}
+
+int HGCSSShowerLibrary::material(const std::string & aName) const{
+  for (unsigned iM(0); iM<materials_.size(); ++iM){
+    if (materials_[iM] == aName) return iM;
+  }
+  return -1;
+}
+
+int HGCSSShowerLibrary::bin(const unsigned aParticle, const int aMaterial,
+			    const double & aEnergy, const double & aCosTheta,
+			    const double & aDepth) const{
+  if (!data_ || aParticle>=nParticles || aMaterial<0 || aMaterial>=static_cast<int>(materials_.size())) return -1;
+  if (aEnergy<energyEdges_[0] || aEnergy>=energyEdges_[nEnergyBins_]) return -1;
+  if (aCosTheta<cosThetaEdges_[0] || aCosTheta>cosThetaEdges_[nAngleBins_]) return -1;
+  const int iE = std::upper_bound(energyEdges_,energyEdges_+nEnergyBins_+1,aEnergy)-energyEdges_-1;
+  const int iA = std::min(static_cast<int>(std::upper_bound(cosThetaEdges_,cosThetaEdges_+nAngleBins_+1,aCosTheta)-cosThetaEdges_-1),
+			  static_cast<int>(nAngleBins_)-1);
+  const int iD = std::min(static_cast<int>(std::max(aDepth,0.)*nDepthBins_),static_cast<int>(nDepthBins_)-1);
+  return (((aParticle*materials_.size()+aMaterial)*nEnergyBins_+iE)*nAngleBins_+iA)*nDepthBins_+iD;
+}
+
+void HGCSSShowerLibrary::Print(std::ostream & aOs) const{
+  if (!data_) return;
+  const unsigned nBins = nParticles*materials_.size()*nEnergyBins_*nAngleBins_*nDepthBins_;
+  unsigned nEmpty = 0;
+  for (unsigned iB(0); iB<nBins; ++iB){
+    if (nTemplates(iB)==0) ++nEmpty;
+  }
+  aOs << "===================================" << std::endl
+      << "=== Frozen shower library: " << offsets_[nBins] << " showers in " << nBins
+      << " bins, " << nEmpty << " empty" << std::endl
+      << "  materials:";
+  for (unsigned iM(0); iM<materials_.size(); ++iM){
+    aOs << " " << materials_[iM];
+  }
+  aOs << std::endl << "  energy edges (MeV):";
+  for (unsigned iE(0); iE<=nEnergyBins_; ++iE){
+    aOs << " " << energyEdges_[iE];
+  }
+  aOs << std::endl << "  cos(theta) edges:";
+  for (unsigned iA(0); iA<=nAngleBins_; ++iA){
+    aOs << " " << cosThetaEdges_[iA];
+  }
+  aOs << std::endl << "  depth bins: " << nDepthBins_ << std::endl
+      << "===================================" << std::endl;
+}
@@ -0,0 +1,197 @@
+#include "HGCSSShowerParameters.hh"
+#include <fstream>
+#include <sstream>
+#include <iomanip>
+#include <cmath>
+#include <algorithm>
+
+namespace {
+  const char * parNames[HGCSSShowerParameters::nParameters] = {
+    "tMean0","tMean1","tSigma0","tSigma1",
+    "aMean0","aMean1","aSigma0","aSigma1",
+    "rho0","rho1",
+    "rCore0","rCore1","rCore2",
+    "rTail1","rTail2","rTail3","rTail40","rTail41",
+    "pCore1","pCore2","pCore30","pCore31",
+    "moliereRadius",
+    "samplingTerm",
+    "sensitiveScale",
+    "spotN0","spotN1"
+  };
+}
+
+HGCSSShowerParameters::HGCSSShowerParameters():
+  par_(nParameters,0),
+  isSet_(nParameters,false)
+{
+  //tungsten
+  setDefaults(74,7.97);
+}
+
+void HGCSSShowerParameters::setDefaults(const double & Z, const double & EcMeV){
+  //lny = lnE + L, E in GeV
+  const double L = log(1000./EcMeV);
+  par_[tMean0] = L-0.812;
+  par_[tMean1] = 1.;
+  par_[tSigma0] = -1.4+1.26*L;
+  par_[tSigma1] = 1.26;
+  const double aSlope = 0.458+2.26/Z;
+  par_[aMean0] = 0.81+aSlope*L;
+  par_[aMean1] = aSlope;
+  par_[aSigma0] = -0.58+0.86*L;
+  par_[aSigma1] = 0.86;
+  par_[rho0] = 0.705-0.023*L;
+  par_[rho1] = -0.023;
+  par_[rCore0] = 0.0251;
+  par_[rCore1] = 0.00319;
+  par_[rCore2] = 0.1162-0.000381*Z;
+  par_[rTail1] = 0.659-0.00309*Z;
+  par_[rTail2] = 0.645;
+  par_[rTail3] = -2.59;
+  par_[rTail40] = 0.3585;
+  par_[rTail41] = 0.0421;
+  par_[pCore1] = 2.632-0.00094*Z;
+  par_[pCore2] = 0.401+0.00187*Z;
+  par_[pCore30] = 1.313;
+  par_[pCore31] = -0.0686;
+  par_[moliereRadius] = 0;
+  par_[samplingTerm] = 0.2;
+  par_[sensitiveScale] = 1.;
+  par_[spotN0] = 93*log(Z);
+  par_[spotN1] = 0.876;
+}
+
+const char * HGCSSShowerParameters::name(const unsigned aPar){
+  if (aPar>=nParameters) return "";
+  return parNames[aPar];
+}
+
+bool HGCSSShowerParameters::read(const std::string & fileName){
+  std::ifstream lFile(fileName.c_str());
+  if (!lFile.is_open()) {
+    std::cout << " -- Error, cannot open shower parameter file " << fileName << std::endl;
+    return false;
+  }
+  std::string lLine;
+  while (std::getline(lFile,lLine)) {
+    size_t lComment = lLine.find('#');
+    if (lComment != lLine.npos) lLine.erase(lComment);
+    std::istringstream lStream(lLine);
+    std::string lName;
+    double lVal = 0;
+    if (!(lStream >> lName)) continue;
+    if (!(lStream >> lVal)) {
+      std::cout << " -- Error, no value for " << lName << " in shower parameter file " << fileName << std::endl;
+      return false;
+    }
+    unsigned iP = 0;
+    for (; iP<nParameters; ++iP){
+      if (lName == parNames[iP]) break;
+    }
+    if (iP==nParameters) {
+      std::cout << " -- Error, unknown parameter " << lName << " in shower parameter file " << fileName << std::endl;
+      return false;
+    }
+    set(static_cast<Parameter>(iP),lVal);
+  }
+  return true;
+}
+
+bool HGCSSShowerParameters::write(const std::string & fileName, const bool onlySet) const{
+  std::ofstream lFile(fileName.c_str());
+  if (!lFile.is_open()) {
+    std::cout << " -- Error, cannot write shower parameter file " << fileName << std::endl;
+    return false;
+  }
+  lFile << "# EM shower parameters, see HGCSSShowerParameters.hh" << std::endl;
+  lFile << std::setprecision(8);
+  for (unsigned iP(0); iP<nParameters; ++iP){
+    if (onlySet && !isSet_[iP]) continue;
+    lFile << parNames[iP] << " " << par_[iP] << std::endl;
+  }
+  return true;
+}
+
+void HGCSSShowerParameters::Print(std::ostream & aOs) const{
+  aOs << "===================================" << std::endl
+      << "=== EM shower parameters (* = set) " << std::endl;
+  for (unsigned iP(0); iP<nParameters; ++iP){
+    aOs << "  " << parNames[iP] << (isSet_[iP]?"* ":" ") << par_[iP] << std::endl;
+  }
+  aOs << "===================================" << std::endl;
+}
+
+double HGCSSShowerParameters::meanLnT(const double & lnE) const{
+  return log(std::max(par_[tMean0]+par_[tMean1]*lnE,0.1));
+}
+
+double HGCSSShowerParameters::sigmaLnT(const double & lnE) const{
+  return 1./std::max(par_[tSigma0]+par_[tSigma1]*lnE,1.);
+}
+
+double HGCSSShowerParameters::meanLnAlpha(const double & lnE) const{
+  return log(std::max(par_[aMean0]+par_[aMean1]*lnE,1.1));
+}
+
+double HGCSSShowerParameters::sigmaLnAlpha(const double & lnE) const{
+  return 1./std::max(par_[aSigma0]+par_[aSigma1]*lnE,1.);
+}
+
+double HGCSSShowerParameters::correlation(const double & lnE) const{
+  return std::min(std::max(par_[rho0]+par_[rho1]*lnE,-0.99),0.99);
+}
+
+double HGCSSShowerParameters::coreRadius(const double & lnE, const double & tau) const{
+  return std::max(par_[rCore0]+par_[rCore1]*lnE+par_[rCore2]*tau,0.001);
+}
+
+double HGCSSShowerParameters::tailRadius(const double & lnE, const double & tau) const{
+  const double k4 = par_[rTail40]+par_[rTail41]*lnE;
+  return par_[rTail1]*(exp(par_[rTail3]*(tau-par_[rTail2]))+exp(k4*(tau-par_[rTail2])));
+}
+
+double HGCSSShowerParameters::coreFraction(const double & lnE, const double & tau) const{
+  const double x = (par_[pCore2]-tau)/(par_[pCore30]+par_[pCore31]*lnE);
+  return std::min(std::max(par_[pCore1]*exp(x-exp(x)),0.),1.);
+}
+
+double HGCSSShowerParameters::nSpots(const double & energyGeV) const{
+  return par_[spotN0]*pow(energyGeV,par_[spotN1]);
+}
+
+double HGCSSShowerParameters::gammaCDF(const double & a, const double & x){
+  if (x<=0) return 0;
+  const double lnPre = a*log(x)-x-lgamma(a);
+  if (x < a+1) {
+    //series
+    double ap = a;
+    double del = 1./a;
+    double sum = del;
+    for (unsigned n(0); n<500; ++n){
+      ap += 1;
+      del *= x/ap;
+      sum += del;
+      if (fabs(del) < fabs(sum)*1e-12) break;
+    }
+    return std::min(sum*exp(lnPre),1.);
+  }
+  //continued fraction for Q(a,x), modified Lentz
+  const double tiny = 1e-300;
+  double b = x+1-a;
+  double c = 1./tiny;
+  double d = 1./b;
+  double h = d;
+  for (unsigned n(1); n<500; ++n){
+    const double an = -1.*n*(n-a);
+    b += 2;
+    d = an*d+b;
+    if (fabs(d)<tiny) d = tiny;
+    c = b+an/c;
+    if (fabs(c)<tiny) c = tiny;
+    d = 1./d;
+    const double del = d*c;
+    h *= del;
+    if (fabs(del-1.) < 1e-12) break;
+  }
+  return std::max(1.-exp(lnPre)*h,0.);
+}
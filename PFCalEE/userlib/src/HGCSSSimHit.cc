@@ -9,13 +9,7 @@ HGCSSSimHit::HGCSSSimHit(const G4SiHit & aSiHit,
 			 TH2Poly* map, 
 			 const float ,
 			 const bool etaphimap){
-  energy_ = aSiHit.energy;
-  //energy weighted time
-  //PS: need to call calculateTime() after all hits 
-  //have been added to have divided by totalE!!
-  time_ = aSiHit.time*aSiHit.energy;
-  zpos_ = aSiHit.hit_z;
-  setLayer(aSiHit.layer,asilayer);
+  initialise(aSiHit,asilayer);
 
   //coordinates in mm
   //double z = aSiHit.hit_x;
@@ -68,6 +62,30 @@ HGCSSSimHit::HGCSSSimHit(const G4SiHit & aSiHit,
 
   //encodeCellId(x_side,y_side,x_cell,y_cell);
 
+}
+
+HGCSSSimHit::HGCSSSimHit(const G4SiHit & aSiHit, 
+			 const unsigned & asilayer, 
+			 const HGCSSCellIndexer & indexer, 
+			 const bool etaphimap){
+  initialise(aSiHit,asilayer);
+  //same cellid as FindBin on indexer.map()
+  if (etaphimap){
+    ROOT::Math::XYZPoint pos = ROOT::Math::XYZPoint(aSiHit.hit_x,aSiHit.hit_y,zpos_);
+    cellid_ = indexer.findBin(pos.eta(),pos.phi());
+  }
+  else cellid_ = indexer.findBin(aSiHit.hit_x,aSiHit.hit_y);
+}
+
+void HGCSSSimHit::initialise(const G4SiHit & aSiHit, const unsigned & asilayer){
+  energy_ = aSiHit.energy;
+  //energy weighted time
+  //PS: need to call calculateTime() after all hits 
+  //have been added to have divided by totalE!!
+  time_ = aSiHit.time*aSiHit.energy;
+  zpos_ = aSiHit.hit_z;
+  setLayer(aSiHit.layer,asilayer);
+
   nGammas_= 0;
   nElectrons_ = 0;
   nMuons_ = 0;
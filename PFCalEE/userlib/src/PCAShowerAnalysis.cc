@@ -1,21 +1,22 @@
 //#include "RecoEgamma/Examples/interface/PCAShowerAnalysis.h"
 #include "PCAShowerAnalysis.h"
 
+#include <cmath>
+#include <algorithm>
+
 #include "TMatrixD.h"
+#include "TMatrixDSym.h"
+#include "TMatrixDSymEigen.h"
 #include "TVectorD.h"
 
-PCAShowerAnalysis::PCAShowerAnalysis ( bool segmented, 
-				       bool logweighting, 
-				       bool debug) : 
-  principal_(0), 
-  logweighting_(logweighting), 
-  segmented_(segmented), 
-  alreadyfilled_(false), 
+PCAShowerAnalysis::PCAShowerAnalysis ( bool segmented,
+				       bool logweighting,
+				       bool debug) :
+  logweighting_(logweighting),
+  segmented_(segmented),
   debug_(debug)
 {
 
-  principal_ = new TPrincipal(3,"D"); 
-
   // minimal rechit value
   mip_ = 0.000055;//40;
   entryz_ = 320.38;
@@ -24,83 +25,112 @@ PCAShowerAnalysis::PCAShowerAnalysis ( bool segmented,
 
 PCAShowerAnalysis::~PCAShowerAnalysis ()
 {
-  delete principal_;
+}
+
+double PCAShowerAnalysis::weight(const double en) const
+{
+  if (!logweighting_) {
+    // energy weighting
+    return en>=1 ? floor(en) : 0;
+  }
+  // a log-weighting, energy not in fraction of total
+  double w0 = -log(20.); // threshold, could use here JB's thresholds
+  double scale = 250.; // to scale the weight so to get ~same nbr of points as for E-weight
+                       //  for the highest hit of ~0.1 GeV
+  double nhit = scale*(w0+log(en));
+  if (!(nhit>=1)) return 1;
+  return floor(nhit);
 }
 
 void PCAShowerAnalysis::showerParameters(const HGCSSCluster & clus)
 {
 
-  if (!alreadyfilled_) {
-    
-    double variables[3] = {0.,0.,0.};
-    const std::map<HGCSSRecoHit*,double> & lmap = clus.recHitFractions();
-    std::map<HGCSSRecoHit*,double>::const_iterator iter = lmap.begin();
-    
-    if (debug_) std::cout << " -- Number of rechits in cluster: " << clus.nRecHits() << " " << lmap.size() << std::endl;
-    unsigned counter = 0;
-    for (;iter!=lmap.end();++iter){
-      HGCSSRecoHit* myhit = iter->first;
-      if (!myhit) {
-	if (debug_) std::cout << " Hit " << myhit << " not found..." << std::endl;
-	continue;
-      }
-      ROOT::Math::XYZPoint cellPos(myhit->position());
-      double en = myhit->energy();
-      variables[0] = cellPos.x(); 
-      variables[1] = cellPos.y(); 
-      variables[2] = cellPos.z();
-      if (!segmented_) variables[2] = entryz_;
-      if (!logweighting_) {
-	// energy weighting
-	for (int i=0; i<int(en); i++) principal_->AddRow(variables); 
-      } else {
-	// a log-weighting, energy not in fraction of total
-	double w0 = -log(20.); // threshold, could use here JB's thresholds
-	double scale = 250.; // to scale the weight so to get ~same nbr of points as for E-weight 
-	                     //  for the highest hit of ~0.1 GeV
-	int nhit = int(scale*(w0+log(en)));
-	if (nhit<=0) nhit=1;
-	for (int i=0; i<nhit; i++) principal_->AddRow(variables);	
-      }
-      counter++;
-      //if (debug_) std::cout << " - hit added n=" << counter << std::endl;
+  //sums of w, w*d and w*d*d with d the position relative to the first
+  //hit, to avoid cancellations in the covariance
+  double sumw = 0;
+  double ref[3] = {0.,0.,0.};
+  double sum[3] = {0.,0.,0.};
+  double sum2[3][3] = {{0.,0.,0.},{0.,0.,0.},{0.,0.,0.}};
+
+  const std::map<HGCSSRecoHit*,double> & lmap = clus.recHitFractions();
+  std::map<HGCSSRecoHit*,double>::const_iterator iter = lmap.begin();
+
+  if (debug_) std::cout << " -- Number of rechits in cluster: " << clus.nRecHits() << " " << lmap.size() << std::endl;
+  unsigned counter = 0;
+  for (;iter!=lmap.end();++iter){
+    HGCSSRecoHit* myhit = iter->first;
+    if (!myhit) {
+      if (debug_) std::cout << " Hit " << myhit << " not found..." << std::endl;
+      continue;
     }
-    if (counter!=lmap.size()) std::cout << " -- Warning, not all hits found for making principals ! Found " << counter << " out of " << lmap.size() << std::endl;
+    ROOT::Math::XYZPoint cellPos(myhit->position());
+    double variables[3] = {cellPos.x(),cellPos.y(),cellPos.z()};
+    if (!segmented_) variables[2] = entryz_;
+    if (counter==0) {
+      for (unsigned i(0); i<3; ++i) ref[i] = variables[i];
+    }
+    double w = weight(myhit->energy());
+    double d[3];
+    for (unsigned i(0); i<3; ++i) d[i] = variables[i]-ref[i];
+    sumw += w;
+    for (unsigned i(0); i<3; ++i){
+      sum[i] += w*d[i];
+      for (unsigned j(0); j<=i; ++j) sum2[i][j] += w*d[i]*d[j];
+    }
+    counter++;
   }
-
+  if (counter!=lmap.size()) std::cout << " -- Warning, not all hits found for making principals ! Found " << counter << " out of " << lmap.size() << std::endl;
 
   if (debug_) std::cout << " Making principals " << std::endl;
 
-  alreadyfilled_ = true;
-  principal_->MakePrincipals();
-  
-  if (debug_) std::cout << "*** Principal component analysis (standalone) ****" << std::endl;
-  if (debug_) std::cout << "shower average (x,y,z) = " << "(" << (*principal_->GetMeanValues())[0] << ", " <<
-		(*principal_->GetMeanValues())[1] << ", " << (*principal_->GetMeanValues())[2] << ")" << std::endl;
+  if (sumw<=0) {
+    showerBarycenter = ROOT::Math::XYZPoint(0,0,0);
+    showerAxis = ROOT::Math::XYZVector(0,0,0);
+    showerEigenValues = ROOT::Math::XYZVector(0,0,0);
+    showerSigmas = ROOT::Math::XYZVector(0,0,0);
+    return;
+  }
+
+  //mean and population covariance, as TPrincipal
+  double mean[3];
+  TMatrixDSym covariance(3);
+  for (unsigned i(0); i<3; ++i) mean[i] = sum[i]/sumw;
+  double trace = 0;
+  for (unsigned i(0); i<3; ++i){
+    for (unsigned j(0); j<=i; ++j){
+      covariance(i,j) = sum2[i][j]/sumw - mean[i]*mean[j];
+      covariance(j,i) = covariance(i,j);
+    }
+    trace += covariance(i,i);
+  }
+  double sigmas[3];
+  for (unsigned i(0); i<3; ++i) sigmas[i] = sqrt(std::max(0.,covariance(i,i)));
+  //eigen values normalised to the trace, as in MakePrincipals
+  if (trace>0) covariance *= 1./trace;
+
+  TMatrixDSymEigen eigen(covariance);
+  const TMatrixD & matrix = eigen.GetEigenVectors();
+  const TVectorD & eigenvalues = eigen.GetEigenValues();
 
-  TMatrixD matrix = *principal_->GetEigenVectors();
+  if (debug_) std::cout << "*** Principal component analysis (standalone) ****" << std::endl;
+  if (debug_) std::cout << "shower average (x,y,z) = " << "(" << ref[0]+mean[0] << ", " <<
+		ref[1]+mean[1] << ", " << ref[2]+mean[2] << ")" << std::endl;
   if (debug_) std::cout << "shower main axis (x,y,z) = " << "(" << matrix(0,0) << ", " <<
 		matrix(1,0) << ", " << matrix(2,0) << ")" << std::endl;
-
-  TVectorD eigenvalues = *principal_->GetEigenValues();
-  if (debug_) std::cout << "shower eigen values = " 
-			<< "(" << eigenvalues(0) << ", " 
-			<< eigenvalues(1) << ", " 
-			<< eigenvalues(2) << ")" 
+  if (debug_) std::cout << "shower eigen values = "
+			<< "(" << eigenvalues(0) << ", "
+			<< eigenvalues(1) << ", "
+			<< eigenvalues(2) << ")"
 			<< std::endl;
+  if (debug_) std::cout << "shower sigmas = " << "(" << sigmas[0] << ", " <<
+		sigmas[1] << ", " << sigmas[2] << ")" << std::endl;
 
-  TVectorD sigmas = *principal_->GetSigmas();
-  if (debug_) std::cout << "shower sigmas = " << "(" << sigmas(0) << ", " <<
-		sigmas(1) << ", " << sigmas(2) << ")" << std::endl;
-  
-
-
-  showerBarycenter = ROOT::Math::XYZPoint((*principal_->GetMeanValues())[0],(*principal_->GetMeanValues())[1],(*principal_->GetMeanValues())[2]);	 
+  showerBarycenter = ROOT::Math::XYZPoint(ref[0]+mean[0],ref[1]+mean[1],ref[2]+mean[2]);
   showerAxis = ROOT::Math::XYZVector(matrix(0,0),matrix(1,0),matrix(2,0));
-   
-  showerEigenValues = ROOT::Math::XYZVector(eigenvalues(0), eigenvalues(1), eigenvalues(2));
 
-  showerSigmas = ROOT::Math::XYZVector(sigmas(0), sigmas(1), sigmas(2));
+  showerEigenValues = ROOT::Math::XYZVector(fabs(eigenvalues(0)), fabs(eigenvalues(1)), fabs(eigenvalues(2)));
+
+  showerSigmas = ROOT::Math::XYZVector(sigmas[0], sigmas[1], sigmas[2]);
 
 
   // resolve direction ambiguity
@@ -108,9 +138,26 @@ void PCAShowerAnalysis::showerParameters(const HGCSSCluster & clus)
     showerAxis = ROOT::Math::XYZVector(-matrix(0,0),-matrix(1,0),-matrix(2,0));
     if (debug_) std::cout << "PCA shower dir reverted " << showerAxis << "eta " << showerAxis.eta() << " phi " << showerAxis.phi() << std::endl;
   }
-	 
+
   return;
 
 }
 
-  
+void PCAShowerAnalysis::showerParameters(const HGCSSClusterVec & clusters,
+					 std::vector<ROOT::Math::XYZPoint> & barycenters,
+					 std::vector<ROOT::Math::XYZVector> & axes,
+					 std::vector<ROOT::Math::XYZVector> & eigenValues,
+					 std::vector<ROOT::Math::XYZVector> & sigmas)
+{
+  barycenters.resize(clusters.size());
+  axes.resize(clusters.size());
+  eigenValues.resize(clusters.size());
+  sigmas.resize(clusters.size());
+  for (unsigned iC(0); iC<clusters.size(); ++iC){
+    showerParameters(clusters[iC]);
+    barycenters[iC] = showerBarycenter;
+    axes[iC] = showerAxis;
+    eigenValues[iC] = showerEigenValues;
+    sigmas[iC] = showerSigmas;
+  }
+}
@@ -0,0 +1,72 @@
+#include<string>
+#include<iostream>
+#include<vector>
+#include<stdlib.h>
+
+#include "TH2Poly.h"
+
+#include "HGCSSGeometryConversion.hh"
+#include "HGCSSCellGeometryCache.hh"
+
+//Build the cell geometry cache of the maps of HGCSSGeometryConversion,
+//memory-mapped by the simulation, the digitizer and the analysis
+//instead of building the maps (see README.md).
+//A map is given with the arguments of its initialise* function, e.g.
+//hexagon:<xysize>,<cellsize> or square1:<etamin>,<etamax>,-pi,pi,0.01745
+
+int main(int argc, char** argv){//main
+
+  if (argc < 4) {
+    std::cout << " Usage: "
+	      << argv[0] << " <output file (.cgeo)> "
+	      << "<reference z in mm for the eta of the xy cells> "
+	      << "<maps: hexagon|diamond|triangle|square:<xymin>,<side> or square1|square2:<xmin>,<xmax>,<ymin>,<ymax>,<side>, space separated> "
+	      << std::endl;
+    return 1;
+  }
+
+  std::string outPath = argv[1];
+  const double refZ = atof(argv[2]);
+  if (!HGCSSCellGeometryCache::isCache(outPath)) {
+    std::cout << " -- Error, output file name should end with .cgeo. Exiting." << std::endl;
+    return 1;
+  }
+
+  HGCSSGeometryConversion geomConv;
+  std::vector<HGCSSCellGeometryCache::Source> lMaps;
+  for (int iA(3); iA<argc; ++iA){
+    HGCSSCellGeometryCache::Source lSource;
+    if (!HGCSSCellGeometryCache::parseSpec(argv[iA],lSource.type,lSource.params)) return 1;
+    lSource.map = new TH2Poly();
+    const std::vector<double> & p = lSource.params;
+    switch (lSource.type){
+    case HGCSSCellGeometryCache::Hexagon:
+      geomConv.initialiseHoneyComb(lSource.map,p[0],p[1],true);
+      break;
+    case HGCSSCellGeometryCache::Diamond:
+      geomConv.initialiseDiamondMap(lSource.map,p[0],p[1],true);
+      break;
+    case HGCSSCellGeometryCache::Triangle:
+      geomConv.initialiseTriangleMap(lSource.map,p[0],p[1],true);
+      break;
+    case HGCSSCellGeometryCache::Square:
+      geomConv.initialiseSquareMap(lSource.map,p[0],p[1],true);
+      break;
+    default:
+      geomConv.initialiseSquareMap(lSource.map,p[0],p[1],p[2],p[3],p[4],true);
+    }
+    lMaps.push_back(lSource);
+  }
+
+  const bool isWritten = HGCSSCellGeometryCache::write(outPath,lMaps,refZ);
+  for (unsigned iM(0); iM<lMaps.size(); ++iM){
+    delete lMaps[iM].map;
+  }
+  if (!isWritten) return 1;
+
+  HGCSSCellGeometryCache lCache;
+  if (!lCache.open(outPath)) return 1;
+  lCache.Print(std::cout);
+  return 0;
+
+}//main
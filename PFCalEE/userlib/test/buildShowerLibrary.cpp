@@ -0,0 +1,69 @@
+#include<string>
+#include<iostream>
+#include<vector>
+#include<stdlib.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include "HGCSSShowerLibrary.hh"
+
+//Pack the showers recorded by the simulation (/N03/det/frozenShowerRecord)
+//into a frozen shower library (/N03/det/frozenShowerLibrary).
+
+namespace {
+  bool parseEdges(const std::string & aList, std::vector<double> & aEdges){
+    std::vector<std::string> lItems;
+    boost::split(lItems, aList, boost::is_any_of(","));
+    aEdges.clear();
+    for (unsigned i(0); i<lItems.size(); ++i){
+      aEdges.push_back(atof(lItems[i].c_str()));
+      if (i>0 && aEdges[i]<=aEdges[i-1]) {
+	std::cout << " -- Error, bin edges " << aList << " should be increasing." << std::endl;
+	return false;
+      }
+    }
+    return aEdges.size()>=2;
+  }
+}
+
+int main(int argc, char** argv){//main
+
+  if (argc < 3) {
+    std::cout << " Usage: "
+	      << argv[0] << " <output file (.shlib)> "
+	      << "<record files, comma separated> "
+	      << "<optional: energy bin edges in MeV (default 10,20,50,100,200,500,1000)> "
+	      << "<optional: cos(theta) bin edges (default -1,0,0.5,0.8,0.9,0.95,1)> "
+	      << "<optional: number of depth bins in the starting element (default 3)> "
+	      << "<optional: max number of showers per bin (default 200)> "
+	      << std::endl;
+    return 1;
+  }
+
+  std::string outPath = argv[1];
+  std::vector<std::string> lFiles;
+  boost::split(lFiles, argv[2], boost::is_any_of(","));
+  std::string energyList = "10,20,50,100,200,500,1000";
+  if (argc>3) energyList = argv[3];
+  std::string angleList = "-1,0,0.5,0.8,0.9,0.95,1";
+  if (argc>4) angleList = argv[4];
+  unsigned nDepthBins = 3;
+  if (argc>5) nDepthBins = atoi(argv[5]);
+  unsigned maxTemplates = 200;
+  if (argc>6) maxTemplates = atoi(argv[6]);
+
+  if (!HGCSSShowerLibrary::isLibrary(outPath)) {
+    std::cout << " -- Error, output file name should end with .shlib. Exiting." << std::endl;
+    return 1;
+  }
+  std::vector<double> lEnergyEdges, lAngleEdges;
+  if (!parseEdges(energyList,lEnergyEdges) || !parseEdges(angleList,lAngleEdges)) return 1;
+
+  if (!HGCSSShowerLibrary::pack(lFiles,outPath,lEnergyEdges,lAngleEdges,nDepthBins,maxTemplates)) return 1;
+
+  HGCSSShowerLibrary lLib;
+  if (!lLib.open(outPath)) return 1;
+  lLib.Print(std::cout);
+  return 0;
+
+}//main
@@ -3,6 +3,8 @@
 #include<iostream>
 #include<fstream>
 #include<sstream>
+#include<algorithm>
+#include<thread>
 #include <boost/algorithm/string.hpp>
 
 #include "TFile.h"
@@ -12,9 +14,12 @@
 #include "TH2D.h"
 #include "TH2Poly.h"
 #include "TH1F.h"
+#include "TH1D.h"
 #include "TCanvas.h"
 #include "TStyle.h"
-#include "TRandom3.h"
+#include "RVersion.h"
+#include "TROOT.h"
+#include "TThread.h"
 #include "Math/Vector4D.h"
 
 #include "fastjet/ClusterSequence.hh"
@@ -26,8 +31,11 @@
 #include "HGCSSRecoJet.hh"
 #include "HGCSSCalibration.hh"
 #include "HGCSSDigitisation.hh"
+#include "HGCSSRandomStream.hh"
 #include "HGCSSDetector.hh"
 #include "HGCSSGeometryConversion.hh"
+#include "HGCSSPUlibrary.hh"
+#include "HGCSSHitColumns.hh"
 
 using namespace fastjet;
 
@@ -184,10 +192,11 @@ void processHist(const unsigned iL,
 */
 
 void processHist(const unsigned iL,
-		 std::map<unsigned,MergeCells> & histE,
+		 HGCSSCellMap & histE,
 		 std::map<int,std::pair<double,double> > & geom,
 		 HGCSSDigitisation & myDigitiser,
-		 TH1F* & p_noise,
+		 TH1 * p_noise,
+		 const std::map<unsigned,double> & tailNoise,
 		 //const TH2Poly* histZ,
 		 const double & meanZpos,
 		 const bool isTBsetup,
@@ -208,15 +217,26 @@ void processHist(const unsigned iL,
   bool isScint = subdet.isScint;
   bool isSi = subdet.isSi;
   //double rLim = subdet.radiusLim;
-  std::map<unsigned,MergeCells>::iterator lIter = histE.begin();
+
+  //cells of the layer as contiguous arrays, digitised at once
+  const unsigned nCells = histE.size();
+  std::vector<unsigned> lCellId;
+  std::vector<double> lSimE;
+  std::vector<double> lDigiE;
+  std::vector<double> lNoisyE;
+  std::vector<unsigned> lAdc;
+  std::vector<unsigned char> lNoiseDone;
+  lCellId.reserve(nCells);
+  lSimE.reserve(nCells);
+  lDigiE.reserve(nCells);
+  lNoiseDone.reserve(nCells);
+
+  HGCSSCellMap::iterator lIter = histE.begin();
   for (; lIter!=histE.end();++lIter){//loop on elements of the map
     //bin numbering starts at 1....
     //get bin number of map element iele
     unsigned iB = lIter->first;
     if(iB>4000000000) continue;
-    std::pair<double,double> xy = geom[iB];
-    if (isScint) HGCSSGeometryConversion::convertFromEtaPhi(xy,meanZpos);
-    double digiE = 0;
     double simE = lIter->second.energy;
     //double time = 0;
     //if (simE>0) time = histE[iele].time/simE;
@@ -237,46 +257,62 @@ void processHist(const unsigned iL,
       
     //bool passTime = myDigitiser.passTimeCut(adet,time);
     //if (!passTime) continue;
-      
-    double posz = meanZpos;
-    //for noise only hits
-    //if (simE>0) posz = histZ->GetBinContent(iX,iY)/simE;
-    //else posz = meanZpos;
-    
-    
-    //if (fabs(x) > 500 || fabs(y)>500) std::cout << " x=" << x << ", y=" << y << std::endl;
-    
     
     //correct for particle angle in conversion to MIP
     //not necessary, if not done for aborber thickness either
     double simEcor = xtalkE;//isTBsetup ? xtalkE : myDigitiser.mipCor(xtalkE,x,y,posz);
-    digiE = simEcor;
+    double digiE = simEcor;
     
     if (isScint && simEcor>0 && doSaturation) {
       digiE = myDigitiser.digiE(simEcor);
     }
-    myDigitiser.addNoise(digiE,iL,p_noise);
-    
-    double noiseFrac = 1.0;
-    if (simEcor>0) noiseFrac = (digiE-simEcor)/simEcor;
-    
-    //for silicon-based Calo
-    unsigned adc = 0;
-    if (isSi){
-      adc = myDigitiser.adcConverter(digiE,adet);
-      digiE = myDigitiser.adcToMIP(adc,adet);
+    //noise-only cells of the sparse mode: noise already drawn above threshold
+    unsigned char noiseDone = 0;
+    std::map<unsigned,double>::const_iterator lTail = tailNoise.find(iB);
+    if (lTail != tailNoise.end()) {
+      digiE = lTail->second;
+      noiseDone = 1;
     }
+    lCellId.push_back(iB);
+    lSimE.push_back(simEcor);
+    lDigiE.push_back(digiE);
+    lNoiseDone.push_back(noiseDone);
+  }//loop on elements of the map
+
+  if (lCellId.empty()) return;
+  lAdc.resize(lCellId.size(),0);
+  lNoisyE.resize(lCellId.size(),0);
+  //noise, and for silicon-based Calo adc conversion and gain smearing
+  myDigitiser.digitiseLayer(iL,lCellId.size(),&lDigiE[0],&lAdc[0],&lNoiseDone[0],p_noise,&lNoisyE[0]);
+
+  double posz = meanZpos;
+  //for noise only hits
+  //if (simE>0) posz = histZ->GetBinContent(iX,iY)/simE;
+  //else posz = meanZpos;
+  const double threshMip = pThreshInADC[iL]*myDigitiser.adcToMIP(1,adet,false);
+
+  for (unsigned iC(0); iC<lCellId.size(); ++iC){//loop on cells
+    unsigned iB = lCellId[iC];
+    double simEcor = lSimE[iC];
+    double digiE = lDigiE[iC];
+    unsigned adc = lAdc[iC];
+
+    double noiseFrac = 1.0;
+    if (simEcor>0) noiseFrac = (lNoisyE[iC]-simEcor)/simEcor;
+
     bool aboveThresh = //digiE > 0.5;
       (isSi && adc >= pThreshInADC[iL]) ||
-      (isScint && digiE >= pThreshInADC[iL]*myDigitiser.adcToMIP(1,adet,false));
+      (isScint && digiE >= threshMip);
     //histE->SetBinContent(iX,iY,digiE);
     if ((!pSaveDigis && aboveThresh) ||
 	pSaveDigis)
       {//save hits
+	std::pair<double,double> xy = geom[iB];
+	if (isScint) HGCSSGeometryConversion::convertFromEtaPhi(xy,meanZpos);
 	//double calibE = myDigitiser.MIPtoGeV(subdet,digiE);
 	HGCSSRecoHit lRecHit;
 	if(isScint) {
-	  std::cout<<"x y z il iB simE "<<xy.first<<" "<<xy.second<<" "<<iL<<" "<<iB<<" "<<simE<<std::endl;
+	  std::cout<<"x y z il iB simE "<<xy.first<<" "<<xy.second<<" "<<iL<<" "<<iB<<" "<<simEcor<<std::endl;
 	  if(fabs(xy.first)>100000.) std::cout<<"Burnham weird "<<std::endl;
 	}
 	lRecHit.layer(iL);
@@ -299,13 +335,454 @@ void processHist(const unsigned iL,
 	}
 	
       }//save hits
-  }//loop on bins
+  }//loop on cells
      
 }//processHist
 
 
-int main(int argc, char** argv){//main  
-  const unsigned evtmin = 0;//100;
+//settings of the digitisation, shared by all threads
+struct DigiSettings{
+  unsigned debug;
+  unsigned shape;
+  unsigned nLayers;
+  bool isTBsetup;
+  bool doEtaSel;
+  double etamean;
+  double deta;
+  bool pSaveDigis;
+  bool pSaveSims;
+  bool pMakeJets;
+  bool pSparseNoise;
+  unsigned nPU;
+  //events of the signal file in the PU input, never drawn
+  bool signalIsPu;
+  unsigned puVetoFirst;
+  unsigned puVetoN;
+  unsigned nPuEvts;
+  const HGCSSPUlibrary *puLib;
+  std::vector<unsigned> pThreshInADC;
+  //cells getting noise: all cells in the eta range of each layer
+  std::vector<std::vector<unsigned> > lNoiseCells;
+};
+
+//one event, written to the output tree in event order
+struct DigiOutput{
+  HGCSSEvent event;
+  unsigned nPuVtx;
+  HGCSSSimHitVec simHits;
+  HGCSSRecoHitVec digiHits;
+  HGCSSRecoHitVec recoHits;
+  HGCSSRecoJetVec caloJets;
+};
+
+//Digitisation of events on one thread, with its own input trees,
+//geometry, calibration, digitiser and noise histogram. The random
+//numbers of an event come from the streams (seed, event, layer) of the
+//digitiser and (seed, event, EventStream) for the PU: the output of an
+//event depends neither on the thread nor on the other events processed.
+class DigiWorker{
+
+public:
+  DigiWorker(const DigiSettings & settings,
+	     TTree *inputTree,
+	     TTree *puTree,
+	     const HGCSSGeometryConversion & geomConv,
+	     const HGCSSCalibration & calib,
+	     const HGCSSDigitisation & digitiser,
+	     const unsigned seed,
+	     const JetDefinition & jetDef);
+
+  ~DigiWorker(){
+    delete p_noise_;
+  };
+
+  inline bool ok() const{
+    return ok_;
+  };
+
+  inline TH1D * noiseHist(){
+    return p_noise_;
+  };
+
+  //events [first,last[ into outputs[0] to outputs[last-first-1]
+  void processRange(const unsigned first, const unsigned last, DigiOutput * outputs);
+
+  void process(const unsigned ievt, DigiOutput & out);
+
+private:
+  //hits of nPuVtx random PU events
+  void addPileup(const unsigned ievt, DigiOutput & out);
+
+  const DigiSettings & s_;
+  TTree *inputTree_;
+  TTree *puTree_;
+  HGCSSEvent *event_;
+  std::vector<HGCSSSimHit> *hitvec_;
+  HGCSSSimHitColumns hitcols_;
+  std::vector<HGCSSSimHit> *puhitvec_;
+  HGCSSSimHitColumns puhitcols_;
+  HGCSSGeometryConversion geomConv_;
+  HGCSSCalibration calib_;
+  HGCSSDigitisation digitiser_;
+  HGCSSRandomStream rndm_;
+  JetDefinition jetDef_;
+  TH1D *p_noise_;
+  std::vector<PseudoJet> lParticles_;
+  bool ok_;
+
+};
+
+DigiWorker::DigiWorker(const DigiSettings & settings,
+		       TTree *inputTree,
+		       TTree *puTree,
+		       const HGCSSGeometryConversion & geomConv,
+		       const HGCSSCalibration & calib,
+		       const HGCSSDigitisation & digitiser,
+		       const unsigned seed,
+		       const JetDefinition & jetDef):
+  s_(settings),
+  inputTree_(inputTree),
+  puTree_(puTree),
+  event_(0),
+  hitvec_(0),
+  puhitvec_(0),
+  geomConv_(geomConv),
+  calib_(calib),
+  digitiser_(digitiser),
+  rndm_(seed),
+  jetDef_(jetDef),
+  ok_(true)
+{
+  inputTree_->SetBranchAddress("HGCSSEvent",&event_);
+  if (!hitcols_.attach(inputTree_,"HGCSSSimHitVec",hitvec_)) ok_ = false;
+  if (puTree_ && !puhitcols_.attach(puTree_,"HGCSSSimHitVec",puhitvec_,"energy,time,zpos,layer,cellid")) ok_ = false;
+  //merged across threads at the end
+  p_noise_ = new TH1D("noiseCheck",";noise (MIPs)",100,-5,5);
+  p_noise_->SetDirectory(0);
+  geomConv_.initialiseHistos();
+}
+
+void DigiWorker::processRange(const unsigned first, const unsigned last, DigiOutput * outputs){
+  for (unsigned ievt(first); ievt<last; ++ievt){
+    process(ievt,outputs[ievt-first]);
+  }
+}
+
+void DigiWorker::addPileup(const unsigned ievt, DigiOutput & out){
+  HGCSSDetector & myDetector = theDetector();
+  const unsigned shape = s_.shape;
+  const HGCSSPUlibrary & puLib = *s_.puLib;
+
+  //get PU events
+  //std::vector<unsigned> ipuevt;
+  rndm_.setStream(ievt,HGCSSRandomStream::EventStream);
+
+  //get poisson <140>
+  unsigned nPuVtx = rndm_.Poisson(s_.nPU);
+  //ipuevt.resize(nPuVtx,1);
+  if (s_.signalIsPu) nPuVtx -= 1;
+  if (nPuVtx > s_.nPuEvts-s_.puVetoN) nPuVtx = s_.nPuEvts-s_.puVetoN;
+  out.nPuVtx = nPuVtx;
+  std::cout << " -- Adding " << nPuVtx << " events to signal event: " << ievt << std::endl;
+  std::set<unsigned> lidxSet;
+  for (unsigned iV(0); iV<nPuVtx; ++iV){//draw interactions
+    unsigned ipuevt = 0;
+    while (1){
+      ipuevt = rndm_.Integer(s_.nPuEvts-s_.puVetoN);
+      if (ipuevt >= s_.puVetoFirst) ipuevt += s_.puVetoN;
+      if (lidxSet.find(ipuevt)==lidxSet.end()){
+	lidxSet.insert(ipuevt);
+	break;
+      }
+      else {
+	std::cout << " -- Found duplicate ! Taking another shot." << std::endl;
+      }
+    }
+  }
+  //read in increasing order: sequential access to the PU input
+  std::vector<HGCSSSimHit> lPuHits;
+  for (std::set<unsigned>::const_iterator iV=lidxSet.begin(); iV!=lidxSet.end(); ++iV){//loop on interactions
+    const unsigned ipuevt = *iV;
+    //std::cout << " ---- adding evt " << ipuevt << std::endl;
+    if (puLib.isOpen()){
+      const HGCSSPUhit *lRec = puLib.hits(ipuevt);
+      const unsigned nRec = puLib.nHits(ipuevt);
+      lPuHits.clear();
+      lPuHits.reserve(nRec);
+      for (unsigned iR(0); iR<nRec; ++iR){
+	lPuHits.push_back(HGCSSSimHit(lRec[iR].layer,lRec[iR].cellid,lRec[iR].energy,lRec[iR].time,lRec[iR].zpos));
+      }
+    }
+    else {
+      puTree_->GetEntry(ipuevt);
+      puhitcols_.update();
+    }
+    const std::vector<HGCSSSimHit> & lHits = puLib.isOpen() ? lPuHits : *puhitvec_;
+
+    for (unsigned iH(0); iH<lHits.size(); ++iH){//loop on hits
+      const HGCSSSimHit & lHit = lHits[iH];
+      if (lHit.energy()<=0) continue;
+
+      unsigned layer = lHit.layer();
+      const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(layer);
+      DetectorEnum type = subdet.type;
+
+      if (s_.doEtaSel){
+	bool passeta = fabs(lHit.eta(subdet,geomConv_,shape)-s_.etamean)<s_.deta;
+	if (!passeta) continue;
+      }
+      if(lHit.cellid()>1000000) {
+	std::cout<<"Burnham 2 cell id is "<<lHit.cellid()<<std::endl;
+      }
+
+      std::pair<double,double> xy = lHit.get_xy(subdet,geomConv_,shape);
+      double posx = xy.first;//lHit.get_x(cellSize);
+      double posy = xy.second;//lHit.get_y(cellSize);
+      double posz = lHit.get_z();
+      double radius = sqrt(pow(posx,2)+pow(posy,2));
+      if (lHit.silayer() < geomConv_.getNumberOfSiLayers(type,radius)){
+	double energy = lHit.energy()*calib_.MeVToMip(layer,radius);
+	double realtime = calib_.correctTime(lHit.time(),posx,posy,posz);
+	bool passTime = digitiser_.passTimeCut(type,realtime);
+	if (!passTime) continue;
+
+	if (s_.debug > 1) std::cout << " hit " << iH
+				    << " lay " << layer
+				    << " x " << posx
+				    << " y " << posy
+				    << " z " << posz
+				    << " t " << lHit.time() << " " << realtime
+				    << std::endl;
+	//geomConv.fill(type,subdetLayer,energy,realtime,posx,posy,posz);
+	geomConv_.fill(layer,energy,realtime,lHit.cellid(),posz);
+      }
+
+    }//loop on hits
+  }//loop on interactions
+}
+
+void DigiWorker::process(const unsigned ievt, DigiOutput & out){
+  HGCSSDetector & myDetector = theDetector();
+  const unsigned shape = s_.shape;
+  const unsigned debug = s_.debug;
+
+  out.nPuVtx = 0;
+  out.simHits.clear();
+  out.digiHits.clear();
+  out.recoHits.clear();
+  out.caloJets.clear();
+  lParticles_.clear();
+
+  inputTree_->GetEntry(ievt);
+  hitcols_.update();
+  out.event.eventNumber(event_->eventNumber());
+  out.event.vtx_x(event_->vtx_x());
+  out.event.vtx_y(event_->vtx_y());
+  out.event.vtx_z(event_->vtx_z());
+  //unsigned layer = volNb;
+
+  calib_.setVertex(out.event.vtx_x(),out.event.vtx_y(),out.event.vtx_z());
+
+  if (debug>0) {
+    std::cout << " **DEBUG** Processing evt " << ievt << std::endl;
+  }
+  else if (ievt%50 == 0) std::cout << "... Processing event: " << ievt << std::endl;
+
+  std::cout<<"Michael Burnham starting look over hitvec "<<(*hitvec_).size()<<std::endl;
+  for (unsigned iH(0); iH<(*hitvec_).size(); ++iH){//loop on hits
+    HGCSSSimHit lHit = (*hitvec_)[iH];
+    if (lHit.energy()<=0) continue;
+
+    //do not save hits with 0 energy...
+    if(lHit.cellid()>1000000) {
+      std::cout<<"Michael Burnham"<<std::endl;
+    }
+    if (lHit.energy()>0 && s_.pSaveSims) out.simHits.push_back(lHit);
+
+    unsigned layer = lHit.layer();
+    const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(layer);
+    DetectorEnum type = subdet.type;
+    if (debug > 1) std::cout << " - layer " << layer << " " << subdet.name << " " << layer-subdet.layerIdMin << std::endl;
+
+    if (s_.doEtaSel){
+      bool passeta = fabs(lHit.eta(subdet,geomConv_,shape)-s_.etamean)<s_.deta;
+      if (!passeta) continue;
+    }
+    if(lHit.cellid()>1000000) {
+      std::cout<<"Burnham cell id is "<<lHit.cellid()<<std::endl;
+    }
+
+    std::pair<double,double> xy = lHit.get_xy(subdet,geomConv_,shape);
+    double posx = xy.first;//lHit.get_x(cellSize);
+    double posy = xy.second;//lHit.get_y(cellSize);
+    double posz = lHit.get_z();
+    double radius = sqrt(pow(posx,2)+pow(posy,2));
+    double energy = lHit.energy()*calib_.MeVToMip(layer,radius); // if (energy > 0) std::cout << "sim energy = "<<lHit.energy()<<", reco energy = "<<energy<<std::endl;
+    double realtime = calib_.correctTime(lHit.time(),posx,posy,posz);
+    bool passTime = digitiser_.passTimeCut(type,realtime);
+    if (!passTime) continue;
+    if (energy>0 &&
+	lHit.silayer() < geomConv_.getNumberOfSiLayers(type,radius)
+	){
+      if (debug > 1) std::cout << " hit " << iH
+			       << " lay " << layer
+			       << " x " << posx
+			       << " y " << posy
+			       << " z " << posz
+			       << " t " << lHit.time() << " " << realtime
+			       << std::endl;
+      //geomConv.fill(type,subdetLayer,energy,realtime,posx,posy,posz);
+      geomConv_.fill(layer,energy,realtime,lHit.cellid(),posz);
+    }
+
+  }//loop on input simhits
+
+  if (s_.nPU!=0) addPileup(ievt,out);
+
+  //if (debug>0) {
+  std::cout << "Burnham **DEBUG** simhits = " << (*hitvec_).size() << " " << out.simHits.size() << std::endl;
+  //}
+
+  //create hits, everywhere to have also pure noise
+  //digitise
+  //apply threshold
+  //save
+  unsigned nTotBins = 0;
+  for (unsigned iL(0); iL<s_.nLayers; ++iL){//loop on layers
+    //noise of this layer from its own stream
+    digitiser_.setRandomStream(ievt,iL);
+    HGCSSCellMap & histE = geomConv_.get2DHist(iL);
+    const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(iL);
+    bool isScint = subdet.isScint;
+
+    std::map<int,std::pair<double,double> > & geom = isScint?(subdet.type==DetectorEnum::BHCAL1?geomConv_.squareGeom1:geomConv_.squareGeom2): shape==4?geomConv_.squareGeom:shape==2?geomConv_.diamGeom:shape==3?geomConv_.triangleGeom:geomConv_.hexaGeom;
+
+    unsigned nBins = geom.size();
+    nTotBins += nBins;
+    if (s_.pSaveDigis) out.digiHits.reserve(nTotBins);
+
+    //double meanZpos = geomConv.getAverageZ(iL);
+    double meanZpos = myDetector.sensitiveZ(iL);
+
+    HGCSSCellMap::iterator scelIter3 = histE.begin();
+    for (; scelIter3!=histE.end();++scelIter3){//loop on elements of the map
+
+      unsigned iB = scelIter3->first;
+      if(iB>4000000000) std::cout<<"Cpt Kirk 3"<<std::endl;
+    }
+
+
+    const std::vector<unsigned> & lCells = s_.lNoiseCells[iL];
+    MergeCells tmpCell;
+    tmpCell.energy = 0;
+    tmpCell.time = 0;
+    std::map<unsigned,double> lTailNoise;
+    double threshMip = s_.pThreshInADC[iL]*digitiser_.adcToMIP(1,subdet.type,false);
+    double pTail = digitiser_.noiseTailProbability(threshMip,iL);
+    if (s_.pSparseNoise && !s_.pSaveDigis && threshMip>0 && pTail<0.5){
+      //draw only the noise-only cells ending above threshold:
+      //binomial number out of the cells without sim energy,
+      //noise taken from the gaussian tail.
+      unsigned nEmpty = lCells.size();
+      HGCSSCellMap::iterator lSimIter = histE.begin();
+      for (; lSimIter!=histE.end();++lSimIter){
+	if (std::binary_search(lCells.begin(),lCells.end(),lSimIter->first)) nEmpty--;
+      }
+      unsigned nNoise = digitiser_.nNoiseCells(nEmpty,pTail);
+      while (lTailNoise.size()<nNoise){
+	unsigned iB = lCells[digitiser_.randomInteger(lCells.size())];
+	if (histE.find(iB)!=histE.end() || lTailNoise.find(iB)!=lTailNoise.end()) continue;
+	lTailNoise[iB] = digitiser_.tailNoise(threshMip,iL,p_noise_);
+      }
+      std::map<unsigned,double>::iterator lTailIter = lTailNoise.begin();
+      for (; lTailIter!=lTailNoise.end();++lTailIter){
+	histE.insert(std::pair<unsigned,MergeCells>(lTailIter->first,tmpCell));
+      }
+    }
+    else {
+      for (unsigned iC(0); iC<lCells.size();++iC){
+	histE.insert(std::pair<unsigned,MergeCells>(lCells[iC],tmpCell));
+      }
+    }
+
+
+    HGCSSCellMap::iterator scelIter = histE.begin();
+    for (; scelIter!=histE.end();++scelIter){//loop on elements of the map
+
+      unsigned iB = scelIter->first;
+      if(iB>4000000000) std::cout<<"Cpt Kirk"<<std::endl;
+    }
+
+
+    //std::cout << iL << " " << meanZpos << " map size " << histE.size() << std::endl;
+
+    if (debug>0){
+      std::cout << " -- Layer " << iL << " " << subdet.name << " z=" << meanZpos
+		<< " bins = " << nBins << " histE entries = " << histE.size() << std::endl;
+    }
+
+    //cell-to-cell cross-talk for scintillator
+    if (isScint){
+      //2.5% per 30-mm edge
+      //myDigitiser.setIPCrossTalk(0.025*geomConv.cellSize(iL,0)/30.);
+    }
+    else {
+      digitiser_.setIPCrossTalk(0);
+    }
+
+    HGCSSCellMap::iterator scelIter2 = histE.begin();
+    for (; scelIter2!=histE.end();++scelIter2){//loop on elements of the map
+
+      unsigned iB = scelIter2->first;
+      if(iB>4000000000) std::cout<<"Cpt Kirk 2"<<std::endl;
+    }
+
+
+    processHist(iL,histE,geom,digitiser_,p_noise_,lTailNoise,meanZpos,s_.isTBsetup,subdet,s_.pThreshInADC,s_.pSaveDigis,out.digiHits,out.recoHits,s_.pMakeJets,lParticles_);
+
+  }//loop on layers
+
+  if (debug) {
+    std::cout << " **DEBUG** sim-digi-reco hits = " << (*hitvec_).size() << "-" << out.digiHits.size() << "-" << out.recoHits.size() << std::endl;
+  }
+
+
+  if (s_.pMakeJets){//pMakeJets
+
+    // run the clustering, extract the jets
+    ClusterSequence cs(lParticles_, jetDef_);
+    std::vector<PseudoJet> jets = sorted_by_pt(cs.inclusive_jets());
+
+    // print the jets
+    std::cout <<   "-- evt " << ievt << ": found " << jets.size() << " Jets." << std::endl;
+    for (unsigned i = 0; i < jets.size(); i++) {
+      const PseudoJet & lFastJet = jets[i];
+      //TOFIX // inverted y and z...
+      HGCSSRecoJet ljet(lFastJet.px(),
+			lFastJet.py(),
+			lFastJet.pz(),
+			lFastJet.E());
+      if (lFastJet.has_constituents()) ljet.nConstituents(lFastJet.constituents().size());
+      if (lFastJet.has_area()){
+	ljet.area(lFastJet.area());
+	ljet.area_error(lFastJet.area_error());
+      }
+
+      out.caloJets.push_back(ljet);
+      std::cout << " -------- jet " << i << ": "
+		<< lFastJet.E() << " "
+		<< lFastJet.perp() << " "
+		<< lFastJet.rap() << " " << lFastJet.phi() << " "
+		<< lFastJet.constituents().size() << std::endl;
+    }
+
+  }//pMakeJets
+
+  geomConv_.initialiseHistos();
+
+}
+
+int main(int argc, char** argv){//main
   /////////////////////////////////////////////////////////////
   //parameters
   /////////////////////////////////////////////////////////////
@@ -322,7 +799,7 @@ int main(int argc, char** argv){//main
               << "<intercalib factor in %>" << std::endl
 	      << "<Number of si layers for TB setups>" << std::endl
               << "<number of PU>" << std::endl
-              << "<full path to MinBias file if nPU!=0>" << std::endl
+              << "<full path to MinBias directory or .pulib library if nPU!=0>" << std::endl
               << std::endl
               << "<optional: etamean (default=no eta sel)> "  << std::endl
               << "<optional: deta (default=no eta sel)>" << std::endl
@@ -331,6 +808,11 @@ int main(int argc, char** argv){//main
               << "<optional: save sim hits (default=0)> " << std::endl
               << "<optional: save digi hits (default=0)> " << std::endl
               << "<optional: make jets (default=0)> " << std::endl
+              << "<optional: sparse noise (default=0)> " << std::endl
+              << "<optional: columnar output (default=0)> " << std::endl
+              << "<optional: first event (default=0)> " << std::endl
+              << "<optional: nThreads (default=1, 0=all cores)> " << std::endl
+              << "<optional: cell geometry cache (.cgeo, default=none)> " << std::endl
               << std::endl;
     return 1;
   }
@@ -380,6 +862,11 @@ int main(int argc, char** argv){//main
   bool pSaveDigis = 0;
   bool pSaveSims = 0;
   bool pMakeJets = false;
+  bool pSparseNoise = false;
+  bool pColumnar = false;
+  unsigned evtmin = 0;//100;
+  unsigned nThreads = 1;
+  std::string cellCachePath;
   //if (nPar > nReqA-1) pModel = argv[nReqA];
   if (nPar > nReqA+1){
     std::istringstream(argv[nReqA])>>etamean;
@@ -399,6 +886,13 @@ int main(int argc, char** argv){//main
   if (nPar > nReqA+4) std::istringstream(argv[nReqA+4])>>pSaveDigis;
   if (nPar > nReqA+5) std::istringstream(argv[nReqA+5])>>pSaveSims;
   if (nPar > nReqA+6) std::istringstream(argv[nReqA+6])>>pMakeJets;
+  if (nPar > nReqA+7) std::istringstream(argv[nReqA+7])>>pSparseNoise;
+  if (nPar > nReqA+8) std::istringstream(argv[nReqA+8])>>pColumnar;
+  if (nPar > nReqA+9) std::istringstream(argv[nReqA+9])>>evtmin;
+  if (nPar > nReqA+10) std::istringstream(argv[nReqA+10])>>nThreads;
+  if (nPar > nReqA+11) cellCachePath = argv[nReqA+11];
+  if (nThreads==0) nThreads = std::thread::hardware_concurrency();
+  if (nThreads==0) nThreads = 1;
   
   //try to get model automatically
   //if (inFilePath.find("model0")!=inFilePath.npos) pModel = "model0";
@@ -412,6 +906,11 @@ int main(int argc, char** argv){//main
   if (pSaveDigis) std::cout << " -- DigiHits are saved." << std::endl;
   if (pSaveSims) std::cout << " -- SimHits are saved." << std::endl;
   if (pMakeJets) std::cout << " -- Making jets." << std::endl;
+  if (pSparseNoise) std::cout << " -- Sparse noise: only noise-only cells above threshold are generated." << std::endl;
+  if (pColumnar) std::cout << " -- Hits are saved as one branch per field." << std::endl;
+  std::cout << " -- First event: " << evtmin << ", " << nThreads << " thread(s)." << std::endl;
+  if (cellCachePath.size()>0 && !HGCSSGeometryConversion::openCellGeometryCache(cellCachePath))
+    std::cout << " -- Cell geometry cache not used, the maps are built." << std::endl;
   std::cout << " ----------------------------------------" << std::endl;
   
   //////////////////////////////////////////////////////////
@@ -460,37 +959,34 @@ int main(int argc, char** argv){//main
   bool signalIsPu = false;
 
   TChain *puTree = new TChain("HGCSSTree");
-  unsigned nPuVtx = 0;
+  HGCSSPUlibrary puLib;
+  //events of the signal file in the library, never drawn
+  unsigned puVetoFirst = 0;
+  unsigned puVetoN = 0;
   unsigned nPuEvts = 0;
-  std::vector<HGCSSSimHit> * puhitvec = 0;
   if(nPU!=0){
-     ofstream myscript;
-     myscript.open("eosls.sh");
-     myscript<<"#!/bin/bash" << std::endl;
-     myscript<<"/afs/cern.ch/project/eos/installation/0.3.15/bin/eos.select ls " << puPath << " | grep HGcal" << std::endl; 
-     myscript.close();
-     FILE *script = popen("bash eosls.sh", "r");
-     char eoslsName[100];
-     while(fgets(eoslsName, 100, script)) {
-        std::ostringstream puInput;
-        std::string temp = std::string(eoslsName).substr(0,strlen(eoslsName)-1);
-        if(temp.find("Digi")!=temp.npos)continue;
-        puInput << puPath << temp;
-	if (puInput.str()==inFilePath) {
-	  std::cout << " -- duplicate: file already used as signal. Removing." << std::endl; 
+    if (HGCSSPUlibrary::isLibrary(puPath)){
+      if (!puLib.open(puPath)) return 1;
+      if (puLib.sourceRange(inFilePath,puVetoFirst,puVetoN)) {
+	std::cout << " -- duplicate: file already used as signal. Removing its " << puVetoN << " events." << std::endl;
+	signalIsPu = true;
+      }
+      nPuEvts = puLib.nEvents();
+    }
+    else {
+      std::vector<std::string> lPuFiles = HGCSSPUlibrary::findFiles(puPath);
+      for (unsigned iF(0); iF<lPuFiles.size(); ++iF){
+	if (lPuFiles[iF]==inFilePath) {
+	  std::cout << " -- duplicate: file already used as signal. Removing." << std::endl;
 	  signalIsPu = true;
 	  continue;
 	}
-        puTree->AddFile(puInput.str().c_str());
-        std::cout << "Adding MinBias file:" << puInput.str().c_str() << std::endl;
-     }
-     pclose(script);  
-     system("rm ./eosls.sh");
-
-    puTree->SetBranchAddress("HGCSSSimHitVec",&puhitvec);
-
-    nPuEvts = puTree->GetEntries();
-    std::cout << "- Number of PU events available: " << nPuEvts  << std::endl;
+	puTree->AddFile(lPuFiles[iF].c_str());
+	std::cout << "Adding MinBias file:" << lPuFiles[iF] << std::endl;
+      }
+      nPuEvts = puTree->GetEntries();
+    }
+    std::cout << "- Number of PU events available: " << nPuEvts-puVetoN  << std::endl;
   }
   /////////////////////////////////////////////////////////////
   //input tree
@@ -516,12 +1012,6 @@ int main(int argc, char** argv){//main
   else std::cout << " -- Number of Si layers ignored: hardcoded as a function of radius in HGCSSGeometryConversion class." << std::endl;
 
 
-  HGCSSEvent * event=0;
-  std::vector<HGCSSSimHit> * hitvec = 0;
-
-  inputTree->SetBranchAddress("HGCSSEvent",&event);
-  inputTree->SetBranchAddress("HGCSSSimHitVec",&hitvec);
-    
   //initialise detector
   HGCSSDetector & myDetector = theDetector();
   bool isCaliceHcal = versionNumber==23;//inFilePath.find("version23")!=inFilePath.npos || inFilePath.find("version_23")!=inFilePath.npos;
@@ -603,11 +1093,9 @@ int main(int argc, char** argv){//main
   geomConv.setGranularity(granularity);
   geomConv.initialiseHistos();
 
-  TRandom3 *lRndm = new TRandom3();
-  lRndm->SetSeed(pSeed);
   myDigitiser.setRandomSeed(pSeed);
 
-  std::cout << " -- Random3 seed = " << lRndm->GetSeed() << std::endl
+  std::cout << " -- Random seed = " << pSeed << ", one random stream per event and layer" << std::endl
 	    << " ----------------------------------------" << std::endl;
 
 
@@ -645,331 +1133,178 @@ int main(int argc, char** argv){//main
   HGCSSRecoHitVec lDigiHits;
   HGCSSRecoHitVec lRecoHits;
   HGCSSRecoJetVec lCaloJets;
-  unsigned maxSimHits = 0;
-  unsigned maxRecHits = 0;
-  unsigned maxRecJets = 0;
   HGCSSEvent lEvent;
+  unsigned nPuVtx = 0;
   outputTree->Branch("HGCSSEvent",&lEvent);
   if (nPU!=0) outputTree->Branch("nPuVtx",&nPuVtx);
-  if (pSaveSims) outputTree->Branch("HGCSSSimHitVec","std::vector<HGCSSSimHit>",&lSimHits);
-  if (pSaveDigis) outputTree->Branch("HGCSSDigiHitVec","std::vector<HGCSSRecoHit>",&lDigiHits);
-  outputTree->Branch("HGCSSRecoHitVec","std::vector<HGCSSRecoHit>",&lRecoHits);
+  HGCSSSimHitColumns lSimCols;
+  HGCSSRecoHitColumns lDigiCols;
+  HGCSSRecoHitColumns lRecoCols;
+  if (pColumnar) {
+    if (pSaveSims) lSimCols.branch(outputTree,"HGCSSSimHitVec");
+    if (pSaveDigis) lDigiCols.branch(outputTree,"HGCSSDigiHitVec");
+    lRecoCols.branch(outputTree,"HGCSSRecoHitVec");
+  }
+  else {
+    if (pSaveSims) outputTree->Branch("HGCSSSimHitVec","std::vector<HGCSSSimHit>",&lSimHits);
+    if (pSaveDigis) outputTree->Branch("HGCSSDigiHitVec","std::vector<HGCSSRecoHit>",&lDigiHits);
+    outputTree->Branch("HGCSSRecoHitVec","std::vector<HGCSSRecoHit>",&lRecoHits);
+  }
   if (pMakeJets) outputTree->Branch("HGCSSRecoJetVec","std::vector<HGCSSRecoJet>",&lCaloJets);
-  TH1F * p_noise = new TH1F("noiseCheck",";noise (MIPs)",100,-5,5);
 
 
   /////////////////////////////////////////////////////////////
-  //Loop on events
+  //cells getting noise: all cells in the eta range of each layer
   /////////////////////////////////////////////////////////////
 
-  const unsigned nEvts = (pNevts > inputTree->GetEntries() || pNevts==0) ? static_cast<unsigned>(inputTree->GetEntries()) : pNevts;
-
-  std::cout << "- Processing = " << nEvts  << " events out of " << inputTree->GetEntries() << std::endl;
-
-  std::vector<PseudoJet> lParticles;
-
-  for (unsigned ievt(evtmin); ievt<evtmin+nEvts; ++ievt){//loop on entries
-
-    inputTree->GetEntry(ievt);
-    lEvent.eventNumber(event->eventNumber());
-    lEvent.vtx_x(event->vtx_x());
-    lEvent.vtx_y(event->vtx_y());
-    lEvent.vtx_z(event->vtx_z());
-    //unsigned layer = volNb;
-    
-    mycalib.setVertex(lEvent.vtx_x(),lEvent.vtx_y(),lEvent.vtx_z());
-
-    if (debug>0) {
-      std::cout << " **DEBUG** Processing evt " << ievt << std::endl;
-    }
-    else if (ievt%50 == 0) std::cout << "... Processing event: " << ievt << std::endl;
-    
-    std::cout<<"Michael Burnham starting look over hitvec "<<(*hitvec).size()<<std::endl;
-    for (unsigned iH(0); iH<(*hitvec).size(); ++iH){//loop on hits
-      HGCSSSimHit lHit = (*hitvec)[iH];
-      if (lHit.energy()<=0) continue;
-      
-      //do not save hits with 0 energy...
-      if(lHit.cellid()>1000000) {
-	std::cout<<"Michael Burnham"<<std::endl;
-      }
-      if (lHit.energy()>0 && pSaveSims) lSimHits.push_back(lHit);
-      
-      unsigned layer = lHit.layer();
-      const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(layer);
-      DetectorEnum type = subdet.type;
-      if (debug > 1) std::cout << " - layer " << layer << " " << subdet.name << " " << layer-subdet.layerIdMin << std::endl;
-
-      if (doEtaSel){
-	bool passeta = fabs(lHit.eta(subdet,geomConv,shape)-etamean)<deta;
-	if (!passeta) continue;
-      }
-      if(lHit.cellid()>1000000) {
-	std::cout<<"Burnham cell id is "<<lHit.cellid()<<std::endl;
-      }
-
-      std::pair<double,double> xy = lHit.get_xy(subdet,geomConv,shape);
-      double posx = xy.first;//lHit.get_x(cellSize);
-      double posy = xy.second;//lHit.get_y(cellSize);
-      double posz = lHit.get_z();
-      double radius = sqrt(pow(posx,2)+pow(posy,2));
-      double energy = lHit.energy()*mycalib.MeVToMip(layer,radius); // if (energy > 0) std::cout << "sim energy = "<<lHit.energy()<<", reco energy = "<<energy<<std::endl;
-      double realtime = mycalib.correctTime(lHit.time(),posx,posy,posz);
-      bool passTime = myDigitiser.passTimeCut(type,realtime);
-      if (!passTime) continue;
-      if (energy>0 && 
-	  lHit.silayer() < geomConv.getNumberOfSiLayers(type,radius) 
-	  ){
-	if (debug > 1) std::cout << " hit " << iH 
-				 << " lay " << layer  
-				 << " x " << posx 
-				 << " y " << posy
-				 << " z " << posz
-				 << " t " << lHit.time() << " " << realtime
-				 << std::endl;
-	//geomConv.fill(type,subdetLayer,energy,realtime,posx,posy,posz);
-	geomConv.fill(layer,energy,realtime,lHit.cellid(),posz);
+  std::vector<std::vector<unsigned> > lNoiseCells;
+  lNoiseCells.resize(nLayers);
+  for (unsigned iL(0); iL<nLayers; ++iL){//loop on layers
+    const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(iL);
+    bool isScint = subdet.isScint;
+    std::map<int,std::pair<double,double> > & geom = isScint?(subdet.type==DetectorEnum::BHCAL1?geomConv.squareGeom1:geomConv.squareGeom2): shape==4?geomConv.squareGeom:shape==2?geomConv.diamGeom:shape==3?geomConv.triangleGeom:geomConv.hexaGeom;
+    unsigned nBins = geom.size();
+    double meanZpos = myDetector.sensitiveZ(iL);
+    double etaBoundary = myDetector.etaBoundary(iL);
+    //extend map to include all cells in eta=1.4-3 region
+    //in eta ring if saving only one eta ring....
+    for (unsigned iB(1); iB<nBins+1;++iB){
+      std::pair<double,double> xy = geom[iB];
+      if (isScint) {
+	HGCSSGeometryConversion::convertFromEtaPhi(xy,meanZpos);
       }
-
-    }//loop on input simhits
-
-    if(nPU!=0){
-      //get PU events
-      //std::vector<unsigned> ipuevt;
-
-      //get poisson <140>
-      nPuVtx = lRndm->Poisson(nPU);
-      //ipuevt.resize(nPuVtx,1);
-      if (signalIsPu) nPuVtx -= 1;
-      std::cout << " -- Adding " << nPuVtx << " events to signal event: " << ievt << std::endl;
-      std::set<unsigned> lidxSet;
-      for (unsigned iV(0); iV<nPuVtx; ++iV){//loop on interactions
-        unsigned ipuevt = 0;
-	while (1){
-	  ipuevt = lRndm->Integer(nPuEvts);
-	  if (lidxSet.find(ipuevt)==lidxSet.end()){
-	    lidxSet.insert(ipuevt);
-	    break;
-	  }
-	  else {
-	    std::cout << " -- Found duplicate ! Taking another shot." << std::endl;
-	  }
-	}
-	//std::cout << " ---- adding evt " << ipuevt << std::endl;
-	
-        puTree->GetEntry(ipuevt);
-        for (unsigned iH(0); iH<(*puhitvec).size(); ++iH){//loop on hits
-          HGCSSSimHit lHit = (*puhitvec)[iH];
-	  if (lHit.energy()<=0) continue;
-
-	  unsigned layer = lHit.layer();
-	  const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(layer);
-	  DetectorEnum type = subdet.type;
-
-	  if (doEtaSel){
-	    bool passeta = fabs(lHit.eta(subdet,geomConv,shape)-etamean)<deta;
-	    if (!passeta) continue;
-	  }
-      if(lHit.cellid()>1000000) {
-	std::cout<<"Burnham 2 cell id is "<<lHit.cellid()<<std::endl;
-      }
-	  
-
-	  std::pair<double,double> xy = lHit.get_xy(subdet,geomConv,shape);
-	  double posx = xy.first;//lHit.get_x(cellSize);
-	  double posy = xy.second;//lHit.get_y(cellSize);
-	  double posz = lHit.get_z();
-	  double radius = sqrt(pow(posx,2)+pow(posy,2));
-	  if (lHit.silayer() < geomConv.getNumberOfSiLayers(type,radius)){
-	    double energy = lHit.energy()*mycalib.MeVToMip(layer,radius);
-	    double realtime = mycalib.correctTime(lHit.time(),posx,posy,posz);
-	    bool passTime = myDigitiser.passTimeCut(type,realtime);
-	    if (!passTime) continue;
-	    
-	    if (debug > 1) std::cout << " hit " << iH
-				     << " lay " << layer
-				     << " x " << posx
-				     << " y " << posy
-				     << " z " << posz
-				     << " t " << lHit.time() << " " << realtime
-				     << std::endl;
-	    //geomConv.fill(type,subdetLayer,energy,realtime,posx,posy,posz);
-	    geomConv.fill(layer,energy,realtime,lHit.cellid(),posz);
-	  }
-	  
-        }//loop on hits
-      }//loop on interactions
-    }//add PU
-
-    //if (debug>0) {
-      std::cout << "Burnham **DEBUG** simhits = " << (*hitvec).size() << " " << lSimHits.size() << std::endl;
-      //}
-
-    //create hits, everywhere to have also pure noise
-    //digitise
-    //apply threshold
-    //save
-    unsigned nTotBins = 0;
-    for (unsigned iL(0); iL<nLayers; ++iL){//loop on layers
-      //TH2Poly *histE = geomConv.get2DHist(iL,"E");
-      std::map<unsigned,MergeCells> & histE = geomConv.get2DHist(iL);
-      //TH2Poly *histTime = geomConv.get2DHist(iL,"Time");
-      //TH2Poly *histZ = geomConv.get2DHist(iL,"Z");
-      const HGCSSSubDetector & subdet = myDetector.subDetectorByLayer(iL);
-      bool isScint = subdet.isScint;
-      //nTotBins += histE->GetNumberOfBins();
-
-      std::map<int,std::pair<double,double> > & geom = isScint?(subdet.type==DetectorEnum::BHCAL1?geomConv.squareGeom1:geomConv.squareGeom2): shape==4?geomConv.squareGeom:shape==2?geomConv.diamGeom:shape==3?geomConv.triangleGeom:geomConv.hexaGeom;
-
-      unsigned nBins = geom.size();//isScint||shape==4?geomConv.squareMap()->GetNumberOfBins() : shape==2?geomConv.diamondMap()->GetNumberOfBins() : shape==3? geomConv.triangleMap()->GetNumberOfBins() : geomConv.hexagonMap()->GetNumberOfBins();
-      nTotBins += nBins;
-      if (pSaveDigis) lDigiHits.reserve(nTotBins);
-      
-      //double meanZpos = geomConv.getAverageZ(iL);
-      double meanZpos = myDetector.sensitiveZ(iL);
-      double etaBoundary = myDetector.etaBoundary(iL);
-      //extend map to include all cells in eta=1.4-3 region
-      //in eta ring if saving only one eta ring....
-
-      std::map<unsigned,MergeCells>::iterator scelIter3 = histE.begin();
-      for (; scelIter3!=histE.end();++scelIter3){//loop on elements of the map
-
-	unsigned iB = scelIter3->first;
-	if(iB>4000000000) std::cout<<"Cpt Kirk 3"<<std::endl;
-      }
-
-
-      for (unsigned iB(1); iB<nBins+1;++iB){
-	std::pair<double,double> xy = geom[iB];
-	if (isScint) {
-	  HGCSSGeometryConversion::convertFromEtaPhi(xy,meanZpos);
-	}
-	ROOT::Math::XYZPoint lpos = ROOT::Math::XYZPoint(xy.first,xy.second,meanZpos);
-	double eta = lpos.eta();
-	bool passeta = eta>1.4 && eta<3.0;
-	if (doEtaSel) passeta = fabs(eta-etamean)<deta;
-	else {
-	  if (isScint) passeta = eta>1.4 && eta<=etaBoundary;
-	  else passeta = eta>etaBoundary && eta<3.0;
-	}
-	if (!passeta) continue;
-
-
-	MergeCells tmpCell;
-	tmpCell.energy = 0;
-	tmpCell.time = 0;
-	if(iB>4000000000) {
-	  std::cout<<"will robinson weird"<<std::endl;
-	}
-	histE.insert(std::pair<unsigned,MergeCells>(iB,tmpCell));
+      ROOT::Math::XYZPoint lpos = ROOT::Math::XYZPoint(xy.first,xy.second,meanZpos);
+      double eta = lpos.eta();
+      bool passeta = eta>1.4 && eta<3.0;
+      if (doEtaSel) passeta = fabs(eta-etamean)<deta;
+      else {
+	if (isScint) passeta = eta>1.4 && eta<=etaBoundary;
+	else passeta = eta>etaBoundary && eta<3.0;
       }
+      if (!passeta) continue;
+      lNoiseCells[iL].push_back(iB);
+    }
+  }//loop on layers
 
+  /////////////////////////////////////////////////////////////
+  //Loop on events
+  /////////////////////////////////////////////////////////////
 
-      std::map<unsigned,MergeCells>::iterator scelIter = histE.begin();
-      for (; scelIter!=histE.end();++scelIter){//loop on elements of the map
+  const unsigned nEntries = static_cast<unsigned>(inputTree->GetEntries());
+  if (evtmin >= nEntries) {
+    std::cout << " -- Error, first event " << evtmin << " is outside of the " << nEntries << " entries. Exiting..." << std::endl;
+    return 1;
+  }
+  const unsigned nEvts = (pNevts > nEntries-evtmin || pNevts==0) ? nEntries-evtmin : pNevts;
+
+  std::cout << "- Processing = " << nEvts  << " events out of " << nEntries << std::endl;
+
+  DigiSettings settings;
+  settings.debug = debug;
+  settings.shape = shape;
+  settings.nLayers = nLayers;
+  settings.isTBsetup = isTBsetup;
+  settings.doEtaSel = doEtaSel;
+  settings.etamean = etamean;
+  settings.deta = deta;
+  settings.pSaveDigis = pSaveDigis;
+  settings.pSaveSims = pSaveSims;
+  settings.pMakeJets = pMakeJets;
+  settings.pSparseNoise = pSparseNoise;
+  settings.nPU = nPU;
+  settings.signalIsPu = signalIsPu;
+  settings.puVetoFirst = puVetoFirst;
+  settings.puVetoN = puVetoN;
+  settings.nPuEvts = nPuEvts;
+  settings.puLib = &puLib;
+  settings.pThreshInADC = pThreshInADC;
+  settings.lNoiseCells.swap(lNoiseCells);
+
+  if (nThreads>1){
+#if ROOT_VERSION_CODE >= ROOT_VERSION(6,6,0)
+    ROOT::EnableThreadSafety();
+#else
+    TThread::Initialize();
+#endif
+    //printed once, not from the threads
+    if (pMakeJets) ClusterSequence::print_banner();
+  }
 
-	unsigned iB = scelIter->first;
-	if(iB>4000000000) std::cout<<"Cpt Kirk"<<std::endl;
+  //one worker per thread, each with its own copy of the inputs,
+  //the first one reads the trees opened above
+  std::vector<TFile*> lInputFiles;
+  std::vector<TChain*> lPuTrees;
+  std::vector<DigiWorker*> lWorkers;
+  for (unsigned iT(0); iT<nThreads; ++iT){
+    TTree *lTree = inputTree;
+    TChain *lPuTree = (nPU!=0 && !puLib.isOpen()) ? puTree : 0;
+    if (iT>0) {
+      TFile *lFile = TFile::Open(inputStr.c_str());
+      if (!lFile) {
+	std::cout << " -- Error, input file " << inputStr << " cannot be opened for thread " << iT << ". Exiting..." << std::endl;
+	return 1;
       }
-
-
-      //std::cout << iL << " " << meanZpos << " map size " << histE.size() << std::endl;
-
-      if (debug>0){
-	std::cout << " -- Layer " << iL << " " << subdet.name << " z=" << meanZpos
-		  << " bins = " << nBins << " histE entries = " << histE.size() << std::endl;
+      lInputFiles.push_back(lFile);
+      lTree = (TTree*)lFile->Get("HGCSSTree");
+      if (lPuTree) {
+	lPuTree = new TChain(puTree->GetName());
+	lPuTree->Add(puTree);
+	lPuTrees.push_back(lPuTree);
       }
+    }
+    lWorkers.push_back(new DigiWorker(settings,lTree,lPuTree,geomConv,mycalib,myDigitiser,pSeed,jet_def));
+    if (!lWorkers.back()->ok()) return 1;
+  }
 
-      //cell-to-cell cross-talk for scintillator
-      if (isScint){
-	//2.5% per 30-mm edge
-	//myDigitiser.setIPCrossTalk(0.025*geomConv.cellSize(iL,0)/30.);
-      }
-      else {
-	myDigitiser.setIPCrossTalk(0);
+  //events are digitised by blocks, each thread taking a contiguous
+  //part of the block, and written in order once the block is done
+  const unsigned blockSize = 10*nThreads;
+  std::vector<DigiOutput> lOutputs(blockSize);
+
+  for (unsigned first(evtmin); first<evtmin+nEvts; first+=blockSize){//loop on blocks
+    const unsigned last = std::min(first+blockSize,evtmin+nEvts);
+    if (nThreads==1) lWorkers[0]->processRange(first,last,&lOutputs[0]);
+    else {
+      std::vector<std::thread> lThreads;
+      for (unsigned iT(0); iT<nThreads; ++iT){
+	const unsigned tFirst = first+(last-first)*iT/nThreads;
+	const unsigned tLast = first+(last-first)*(iT+1)/nThreads;
+	lThreads.push_back(std::thread(&DigiWorker::processRange,lWorkers[iT],tFirst,tLast,&lOutputs[0]+(tFirst-first)));
       }
-
-      //processHist(iL,histE,myDigitiser,p_noise,histZ,meanZpos,isTBsetup,subdet,pThreshInADC,pSaveDigis,lDigiHits,lRecoHits,pMakeJets,lParticles);
-
-      std::map<unsigned,MergeCells>::iterator scelIter2 = histE.begin();
-      for (; scelIter2!=histE.end();++scelIter2){//loop on elements of the map
-
-	unsigned iB = scelIter2->first;
-	if(iB>4000000000) std::cout<<"Cpt Kirk 2"<<std::endl;
+      for (unsigned iT(0); iT<nThreads; ++iT){
+	lThreads[iT].join();
       }
-
-
-      processHist(iL,histE,geom,myDigitiser,p_noise,meanZpos,isTBsetup,subdet,pThreshInADC,pSaveDigis,lDigiHits,lRecoHits,pMakeJets,lParticles);
- 
-    }//loop on layers
-
-    if (debug) {
-      std::cout << " **DEBUG** sim-digi-reco hits = " << (*hitvec).size() << "-" << lDigiHits.size() << "-" << lRecoHits.size() << std::endl;
     }
-    
-    
-    if (pMakeJets){//pMakeJets
-      
-      // run the clustering, extract the jets
-      ClusterSequence cs(lParticles, jet_def);
-      std::vector<PseudoJet> jets = sorted_by_pt(cs.inclusive_jets());
-      
-      // print the jets
-      std::cout <<   "-- evt " << ievt << ": found " << jets.size() << " Jets." << std::endl;
-      for (unsigned i = 0; i < jets.size(); i++) {
-	const PseudoJet & lFastJet = jets[i];
-	//TOFIX // inverted y and z...
-	HGCSSRecoJet ljet(lFastJet.px(),
-			  lFastJet.py(),
-			  lFastJet.pz(),
-			  lFastJet.E());
-	if (lFastJet.has_constituents()) ljet.nConstituents(lFastJet.constituents().size());
-	if (lFastJet.has_area()){
-	  ljet.area(lFastJet.area());
-	  ljet.area_error(lFastJet.area_error());
-	}
-	
-	lCaloJets.push_back(ljet);
-	std::cout << " -------- jet " << i << ": "
-		  << lFastJet.E() << " " 
-		  << lFastJet.perp() << " " 
-		  << lFastJet.rap() << " " << lFastJet.phi() << " "
-		  << lFastJet.constituents().size() << std::endl;
-	// std::vector<PseudoJet> constituents = lFastJet.constituents();
-	// for (unsigned j = 0; j < constituents.size(); j++) {
-	//   std::cout << "    constituent " << j << "'s pt: " << constituents[j].perp()
-	// 	      << std::endl;
-	// }
+
+    for (unsigned ievt(first); ievt<last; ++ievt){//loop on entries
+      DigiOutput & lOut = lOutputs[ievt-first];
+      lEvent = lOut.event;
+      nPuVtx = lOut.nPuVtx;
+      //the emptied vectors are given back to the worker
+      lSimHits.swap(lOut.simHits);
+      lDigiHits.swap(lOut.digiHits);
+      lRecoHits.swap(lOut.recoHits);
+      lCaloJets.swap(lOut.caloJets);
+      if (pColumnar) {
+	if (pSaveSims) lSimCols.fill(lSimHits);
+	if (pSaveDigis) lDigiCols.fill(lDigiHits);
+	lRecoCols.fill(lRecoHits);
       }
-      
-    }//pMakeJets
-    
-    outputTree->Fill();
-    //reserve necessary space and clear vectors.
-    if (lSimHits.size() > maxSimHits) {
-      maxSimHits = 2*lSimHits.size();
-      std::cout << " -- INFO: event " << ievt << " maxSimHits updated to " << maxSimHits << std::endl;
-    }
-    if (lRecoHits.size() > maxRecHits) {
-      maxRecHits = 2*lRecoHits.size();
-      std::cout << " -- INFO: event " << ievt << " maxRecHits updated to " << maxRecHits << std::endl;
-    }
-    if (lCaloJets.size() > maxRecJets) {
-      maxRecJets = 2*lCaloJets.size();
-      std::cout << " -- INFO: event " << ievt << " maxRecJets updated to " << maxRecJets << std::endl;
-    }
-    lSimHits.clear();
-    lDigiHits.clear();
-    lRecoHits.clear();
-    lCaloJets.clear();
-    geomConv.initialiseHistos();
-    lParticles.clear();
-    if (pSaveSims) lSimHits.reserve(maxSimHits);
-    lRecoHits.reserve(maxRecHits);
-    lParticles.reserve(maxRecHits);
-    lCaloJets.reserve(maxRecJets);
-    
-  }//loop on entries
+      outputTree->Fill();
+      lSimHits.clear();
+      lDigiHits.clear();
+      lRecoHits.clear();
+      lCaloJets.clear();
+    }//loop on entries
+
+  }//loop on blocks
+
+  //statistics recomputed from the bins: same whatever the filling order
+  TH1D *p_noise = lWorkers[0]->noiseHist();
+  for (unsigned iT(1); iT<nThreads; ++iT){
+    p_noise->Add(lWorkers[iT]->noiseHist());
+  }
+  p_noise->ResetStats();
 
   outputFile->cd();
   outputFile->WriteObjectAny(lInfo,"HGCSSInfo","Info");
@@ -977,6 +1312,16 @@ int main(int argc, char** argv){//main
   p_noise->Write();
   outputFile->Close();
 
+  for (unsigned iT(0); iT<nThreads; ++iT){
+    delete lWorkers[iT];
+  }
+  for (unsigned iT(0); iT<lPuTrees.size(); ++iT){
+    delete lPuTrees[iT];
+  }
+  for (unsigned iF(0); iF<lInputFiles.size(); ++iF){
+    lInputFiles[iF]->Close();
+  }
+
   return 0;
 
 }//main
@@ -0,0 +1,211 @@
+#include<string>
+#include<iostream>
+#include<iomanip>
+#include<vector>
+#include<cmath>
+#include<stdlib.h>
+
+#include <boost/algorithm/string.hpp>
+
+#include "TFile.h"
+#include "TTree.h"
+
+#include "HGCSSSamplingSection.hh"
+#include "HGCSSGenParticle.hh"
+#include "HGCSSShowerParameters.hh"
+
+//Fit the parameters of the parametrised EM showers of the simulation
+//(/N03/det/fastShower) to full simulation samples of single e/gamma,
+//one file per energy:
+// - longitudinal: each event's profile in X0 (totalE per layer at the
+//   absorber depth) gives alpha and T=(alpha-1)/beta from its moments,
+//   their log means, widths and correlation are fitted linearly in lnE;
+// - samplingTerm: (sigma/E)^2=S^2/E+c^2 of the summed sensitive energy;
+// - sensitiveScale: only if fast simulation files made with the start
+//   parameters are given, scaled by the full/fast sensitive energy ratio.
+//Other parameters are copied from the start file.
+
+namespace {
+  struct EnergyPoint {
+    double energy;//GeV
+    unsigned nEvts;
+    double meanLnT,sigmaLnT;
+    double meanLnA,sigmaLnA;
+    double rho;
+    double meanVis,sigmaVis;
+  };
+
+  bool fitLine(const std::vector<double> & x, const std::vector<double> & y,
+	       double & a0, double & a1){
+    const unsigned n = x.size();
+    if (n<2) return false;
+    double sx=0,sy=0,sxx=0,sxy=0;
+    for (unsigned i(0); i<n; ++i){
+      sx += x[i];
+      sy += y[i];
+      sxx += x[i]*x[i];
+      sxy += x[i]*y[i];
+    }
+    const double det = n*sxx-sx*sx;
+    if (fabs(det)<1e-12) return false;
+    a1 = (n*sxy-sx*sy)/det;
+    a0 = (sy-a1*sx)/n;
+    return true;
+  }
+
+  bool analyseFile(const std::string & filePath, EnergyPoint & point){
+    TFile *lFile = TFile::Open(filePath.c_str());
+    if (!lFile) {
+      std::cout << " -- Error, cannot open " << filePath << std::endl;
+      return false;
+    }
+    TTree *lTree = (TTree*)lFile->Get("HGCSSTree");
+    if (!lTree) {
+      std::cout << " -- Error, no HGCSSTree in " << filePath << std::endl;
+      return false;
+    }
+    std::vector<HGCSSSamplingSection> * ssvec = 0;
+    std::vector<HGCSSGenParticle> * genvec = 0;
+    lTree->SetBranchStatus("*",0);
+    lTree->SetBranchStatus("HGCSSSamplingSectionVec*",1);
+    lTree->SetBranchStatus("HGCSSGenParticleVec*",1);
+    lTree->SetBranchAddress("HGCSSSamplingSectionVec",&ssvec);
+    lTree->SetBranchAddress("HGCSSGenParticleVec",&genvec);
+
+    double sumE=0,sumT=0,sumT2=0,sumA=0,sumA2=0,sumTA=0,sumV=0,sumV2=0;
+    unsigned n=0;
+    const unsigned nEntries = lTree->GetEntries();
+    for (unsigned ievt(0); ievt<nEntries; ++ievt){
+      lTree->GetEntry(ievt);
+      double genE = 0;
+      for (unsigned iP(0); iP<genvec->size(); ++iP){
+	genE = std::max(genE,(*genvec)[iP].E());
+      }
+      //profile moments, corrected for the layer widths
+      double e=0,m1=0,m2=0,width2=0,vis=0,t=0;
+      for (unsigned iL(0); iL<ssvec->size(); ++iL){
+	const HGCSSSamplingSection & lSec = (*ssvec)[iL];
+	const double w = lSec.volX0trans();
+	const double tmid = t+w/2;
+	t += w;
+	e += lSec.totalE();
+	m1 += lSec.totalE()*tmid;
+	m2 += lSec.totalE()*tmid*tmid;
+	width2 += lSec.totalE()*w*w/12.;
+	vis += lSec.measuredE();
+      }
+      if (e<=0 || genE<=0) continue;
+      m1 /= e;
+      const double var = m2/e-m1*m1-width2/e;
+      if (var<=0) continue;
+      const double alpha = m1*m1/var;
+      if (alpha<=1) continue;
+      const double T = (alpha-1)*var/m1;
+      const double lnT = log(T);
+      const double lnA = log(alpha);
+      sumE += genE/1000.;
+      sumT += lnT;
+      sumT2 += lnT*lnT;
+      sumA += lnA;
+      sumA2 += lnA*lnA;
+      sumTA += lnT*lnA;
+      sumV += vis;
+      sumV2 += vis*vis;
+      ++n;
+    }
+    lFile->Close();
+    if (n<2) {
+      std::cout << " -- Error, not enough events with a shower in " << filePath << std::endl;
+      return false;
+    }
+    point.nEvts = n;
+    point.energy = sumE/n;
+    point.meanLnT = sumT/n;
+    point.sigmaLnT = sqrt(std::max(sumT2/n-point.meanLnT*point.meanLnT,1e-12));
+    point.meanLnA = sumA/n;
+    point.sigmaLnA = sqrt(std::max(sumA2/n-point.meanLnA*point.meanLnA,1e-12));
+    point.rho = (sumTA/n-point.meanLnT*point.meanLnA)/(point.sigmaLnT*point.sigmaLnA);
+    point.meanVis = sumV/n;
+    point.sigmaVis = sqrt(std::max(sumV2/n-point.meanVis*point.meanVis,0.));
+    return true;
+  }
+}
+
+int main(int argc, char** argv){//main
+
+  if (argc < 3) {
+    std::cout << " Usage: "
+	      << argv[0] << " <output parameter file> "
+	      << "<full sim files, one per energy, comma separated> "
+	      << "<optional: start parameter file (default none)> "
+	      << "<optional: fast sim files made with the start parameters, same energies and order>"
+	      << std::endl;
+    return 1;
+  }
+
+  std::string outPath = argv[1];
+  std::vector<std::string> lFullFiles;
+  boost::split(lFullFiles, argv[2], boost::is_any_of(","));
+  std::string startPath = "";
+  if (argc>3) startPath = argv[3];
+  std::vector<std::string> lFastFiles;
+  if (argc>4) boost::split(lFastFiles, argv[4], boost::is_any_of(","));
+
+  HGCSSShowerParameters lPars;
+  if (startPath.size()>0 && startPath!="none" && !lPars.read(startPath)) return 1;
+
+  if (lFullFiles.size()<2) {
+    std::cout << " -- Error, need at least two energies to fit the energy dependence. Exiting." << std::endl;
+    return 1;
+  }
+  if (lFastFiles.size()>0 && lFastFiles.size()!=lFullFiles.size()) {
+    std::cout << " -- Error, " << lFastFiles.size() << " fast sim files for " << lFullFiles.size() << " full sim files. Exiting." << std::endl;
+    return 1;
+  }
+
+  std::vector<EnergyPoint> lPoints(lFullFiles.size());
+  std::vector<double> lnE, invE, expT, invSigT, expA, invSigA, rho, reso2;
+  double ratioSum = 0;
+  std::cout << " E(GeV) nEvts <lnT> sig(lnT) <lnA> sig(lnA) rho sigma/E(vis)" << std::endl;
+  for (unsigned iF(0); iF<lFullFiles.size(); ++iF){
+    EnergyPoint & p = lPoints[iF];
+    if (!analyseFile(lFullFiles[iF],p)) return 1;
+    std::cout << std::setprecision(4) << " " << p.energy << " " << p.nEvts << " "
+	      << p.meanLnT << " " << p.sigmaLnT << " "
+	      << p.meanLnA << " " << p.sigmaLnA << " "
+	      << p.rho << " " << p.sigmaVis/p.meanVis << std::endl;
+    lnE.push_back(log(p.energy));
+    invE.push_back(1./p.energy);
+    expT.push_back(exp(p.meanLnT));
+    invSigT.push_back(1./p.sigmaLnT);
+    expA.push_back(exp(p.meanLnA));
+    invSigA.push_back(1./p.sigmaLnA);
+    rho.push_back(p.rho);
+    reso2.push_back(pow(p.sigmaVis/p.meanVis,2));
+    if (lFastFiles.size()>0) {
+      EnergyPoint lFast;
+      if (!analyseFile(lFastFiles[iF],lFast)) return 1;
+      std::cout << "   fast sim: E=" << lFast.energy << " <vis> full/fast=" << p.meanVis/lFast.meanVis << std::endl;
+      ratioSum += p.meanVis/lFast.meanVis;
+    }
+  }
+
+  double a0=0,a1=0;
+  if (fitLine(lnE,expT,a0,a1)) { lPars.set(HGCSSShowerParameters::tMean0,a0); lPars.set(HGCSSShowerParameters::tMean1,a1); }
+  if (fitLine(lnE,invSigT,a0,a1)) { lPars.set(HGCSSShowerParameters::tSigma0,a0); lPars.set(HGCSSShowerParameters::tSigma1,a1); }
+  if (fitLine(lnE,expA,a0,a1)) { lPars.set(HGCSSShowerParameters::aMean0,a0); lPars.set(HGCSSShowerParameters::aMean1,a1); }
+  if (fitLine(lnE,invSigA,a0,a1)) { lPars.set(HGCSSShowerParameters::aSigma0,a0); lPars.set(HGCSSShowerParameters::aSigma1,a1); }
+  if (fitLine(lnE,rho,a0,a1)) { lPars.set(HGCSSShowerParameters::rho0,a0); lPars.set(HGCSSShowerParameters::rho1,a1); }
+  if (fitLine(invE,reso2,a0,a1) && a1>0) lPars.set(HGCSSShowerParameters::samplingTerm,sqrt(a1));
+  else std::cout << " -- Warning, no stochastic term found, samplingTerm unchanged." << std::endl;
+  if (lFastFiles.size()>0) {
+    lPars.set(HGCSSShowerParameters::sensitiveScale,lPars.get(HGCSSShowerParameters::sensitiveScale)*ratioSum/lFastFiles.size());
+  }
+
+  lPars.Print(std::cout);
+  if (!lPars.write(outPath,true)) return 1;
+  std::cout << " -- Parameters written to " << outPath << std::endl;
+
+  return 0;
+
+}//main
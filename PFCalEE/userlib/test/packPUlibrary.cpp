@@ -0,0 +1,42 @@
+#include<string>
+#include<iostream>
+#include<vector>
+#include<stdlib.h>
+
+#include "HGCSSPUlibrary.hh"
+
+//Pack minbias HGCSSSimHitVec into a pileup library for the digitizer.
+
+int main(int argc, char** argv){//main
+
+  if (argc < 3) {
+    std::cout << " Usage: "
+	      << argv[0] << " <MinBias directory or root file> "
+	      << "<output file (.pulib)> "
+	      << "<optional: max number of events (default 0=all)> "
+	      << std::endl;
+    return 1;
+  }
+
+  std::string inPath = argv[1];
+  std::string outPath = argv[2];
+  unsigned maxEvents = 0;
+  if (argc>3) maxEvents = atoi(argv[3]);
+
+  if (!HGCSSPUlibrary::isLibrary(outPath)) {
+    std::cout << " -- Error, output file name should end with .pulib. Exiting." << std::endl;
+    return 1;
+  }
+
+  std::vector<std::string> lFiles;
+  if (inPath.size()>5 && inPath.compare(inPath.size()-5,5,".root")==0) lFiles.push_back(inPath);
+  else lFiles = HGCSSPUlibrary::findFiles(inPath);
+  if (lFiles.size()==0) {
+    std::cout << " -- Error, no MinBias file found in " << inPath << ". Exiting." << std::endl;
+    return 1;
+  }
+
+  if (!HGCSSPUlibrary::pack(lFiles,outPath,maxEvents)) return 1;
+  return 0;
+
+}//main
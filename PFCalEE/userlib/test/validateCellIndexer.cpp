@@ -0,0 +1,157 @@
+#include<string>
+#include<iostream>
+#include<sstream>
+#include<iomanip>
+#include<vector>
+#include<cmath>
+#include<stdlib.h>
+
+#include "TH2Poly.h"
+#include "TGraph.h"
+#include "TMath.h"
+#include "TStopwatch.h"
+
+#include "HGCSSGeometryConversion.hh"
+#include "HGCSSCellIndexer.hh"
+#include "HGCSSSimHit.hh"
+
+//Cross-check HGCSSCellIndexer::findBin against TH2Poly::FindBin
+//on a dense grid covering each map and its overflow region, plus
+//on every bin vertex and edge midpoint, shifted by one ulp.
+
+unsigned compare(const std::string & name, TH2Poly *map, const HGCSSCellIndexer *indexer,
+		 const unsigned nPoints, const double margin, const unsigned maxPrint=10){
+
+  double xmin = map->GetXaxis()->GetXmin();
+  double xmax = map->GetXaxis()->GetXmax();
+  double ymin = map->GetYaxis()->GetXmin();
+  double ymax = map->GetYaxis()->GetXmax();
+  double dx = (xmax-xmin)*margin;
+  double dy = (ymax-ymin)*margin;
+  xmin -= dx; xmax += dx;
+  ymin -= dy; ymax += dy;
+
+  unsigned nTested = 0;
+  unsigned nBad = 0;
+  std::vector<int> lRef(nPoints*nPoints,0);
+  std::vector<int> lVal(nPoints*nPoints,0);
+  TStopwatch lWatch;
+
+  lWatch.Start();
+  for (unsigned ix(0); ix<nPoints; ++ix){
+    double x = xmin + (xmax-xmin)*ix/(nPoints-1.);
+    for (unsigned iy(0); iy<nPoints; ++iy){
+      double y = ymin + (ymax-ymin)*iy/(nPoints-1.);
+      lRef[ix*nPoints+iy] = map->FindBin(x,y);
+    }
+  }
+  lWatch.Stop();
+  double tPoly = lWatch.RealTime();
+
+  lWatch.Start();
+  for (unsigned ix(0); ix<nPoints; ++ix){
+    double x = xmin + (xmax-xmin)*ix/(nPoints-1.);
+    for (unsigned iy(0); iy<nPoints; ++iy){
+      double y = ymin + (ymax-ymin)*iy/(nPoints-1.);
+      lVal[ix*nPoints+iy] = indexer->findBin(x,y);
+    }
+  }
+  lWatch.Stop();
+  double tIndexer = lWatch.RealTime();
+
+  for (unsigned ix(0); ix<nPoints; ++ix){
+    for (unsigned iy(0); iy<nPoints; ++iy){
+      int ref = lRef[ix*nPoints+iy];
+      int val = lVal[ix*nPoints+iy];
+      nTested++;
+      if (ref != val) {
+	if (nBad<maxPrint) std::cout << " ---- " << name << " mismatch at (" << std::setprecision(17)
+				     << xmin + (xmax-xmin)*ix/(nPoints-1.) << "," << ymin + (ymax-ymin)*iy/(nPoints-1.)
+				     << "): TH2Poly " << ref << " indexer " << val << std::endl;
+	nBad++;
+      }
+    }
+  }
+
+  //points on and next to the bin boundaries
+  TIter next(map->GetBins());
+  TObject *obj=0;
+  while ((obj=next())){
+    TGraph *lPoly = (TGraph*)((TH2PolyBin*)obj)->GetPolygon();
+    unsigned nV = lPoly->GetN();
+    for (unsigned iV(0); iV<nV; ++iV){
+      unsigned jV = (iV+1)%nV;
+      double vx[2] = {lPoly->GetX()[iV], (lPoly->GetX()[iV]+lPoly->GetX()[jV])/2.};
+      double vy[2] = {lPoly->GetY()[iV], (lPoly->GetY()[iV]+lPoly->GetY()[jV])/2.};
+      for (unsigned iP(0); iP<2; ++iP){
+	for (int sx(-1); sx<2; ++sx){
+	  for (int sy(-1); sy<2; ++sy){
+	    double x = sx==0 ? vx[iP] : nextafter(vx[iP],sx*1e30);
+	    double y = sy==0 ? vy[iP] : nextafter(vy[iP],sy*1e30);
+	    int ref = map->FindBin(x,y);
+	    int val = indexer->findBin(x,y);
+	    nTested++;
+	    if (ref != val) {
+	      if (nBad<maxPrint) std::cout << " ---- " << name << " boundary mismatch at (" << std::setprecision(17) << x << "," << y << "): TH2Poly " << ref << " indexer " << val << std::endl;
+	      nBad++;
+	    }
+	  }
+	}
+      }
+    }
+  }
+
+  std::cout << " -- " << name << ": " << map->GetNumberOfBins() << " bins, tiling " << indexer->tiling()
+	    << ", " << nTested << " points, " << nBad << " mismatches."
+	    << " Grid time TH2Poly " << tPoly << " s, indexer " << tIndexer << " s." << std::endl;
+  return nBad;
+}
+
+int main(int argc, char** argv){//main
+
+  if (argc < 2) {
+    std::cout << " Usage: "
+	      << argv[0] << " <calorSizeXY in mm> "
+	      << "<optional: nPoints per axis (default 1000)> "
+	      << "<optional: hexagon side (default CELL_SIZE_X)> "
+	      << std::endl;
+    return 1;
+  }
+
+  const double calorSizeXY = atof(argv[1]);
+  unsigned nPoints = 1000;
+  double cellSize = CELL_SIZE_X;
+  if (argc>2) nPoints = atoi(argv[2]);
+  if (argc>3) cellSize = atof(argv[3]);
+  if (nPoints<2) nPoints = 2;
+
+  std::cout << " -- Input parameters: " << std::endl
+	    << " -- calorSizeXY = " << calorSizeXY << std::endl
+	    << " -- nPoints = " << nPoints << std::endl
+	    << " -- cellSize = " << cellSize << std::endl;
+
+  //same maps as in the simulation EventAction
+  HGCSSGeometryConversion geomConv(2,cellSize);
+  geomConv.initialiseHoneyComb(calorSizeXY,cellSize);
+  geomConv.initialiseDiamondMap(calorSizeXY,10.);
+  geomConv.initialiseTriangleMap(calorSizeXY,10.*sqrt(2.));
+  geomConv.initialiseSquareMap(calorSizeXY,100.);
+  geomConv.initialiseSquareMap1(1.4,3.0,-1.*TMath::Pi(),TMath::Pi(),0.01745);
+  geomConv.initialiseSquareMap2(1.4,3.0,-1.*TMath::Pi(),TMath::Pi(),0.02182);
+
+  unsigned nBad = 0;
+  nBad += compare("hexagonMap",geomConv.hexagonMap(),geomConv.hexagonIndexer(),nPoints,0.05);
+  nBad += compare("diamondMap",geomConv.diamondMap(),geomConv.diamondIndexer(),nPoints,0.05);
+  nBad += compare("triangleMap",geomConv.triangleMap(),geomConv.triangleIndexer(),nPoints,0.05);
+  nBad += compare("squareMap",geomConv.squareMap(),geomConv.squareIndexer(),nPoints,0.05);
+  nBad += compare("squareMap1",geomConv.squareMap1(),geomConv.squareIndexer1(),nPoints,0.05);
+  nBad += compare("squareMap2",geomConv.squareMap2(),geomConv.squareIndexer2(),nPoints,0.05);
+
+  if (nBad>0) {
+    std::cout << " -- ERROR! " << nBad << " cell IDs differ from TH2Poly::FindBin." << std::endl;
+    return 1;
+  }
+  std::cout << " -- All cell IDs identical to TH2Poly::FindBin." << std::endl;
+  return 0;
+
+}//main
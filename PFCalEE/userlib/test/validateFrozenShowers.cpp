@@ -0,0 +1,178 @@
+#include<string>
+#include<iostream>
+#include<iomanip>
+#include<vector>
+#include<cmath>
+#include<stdlib.h>
+
+#include "TFile.h"
+#include "TTree.h"
+#include "TH1F.h"
+
+#include "HGCSSSamplingSection.hh"
+#include "HGCSSSimHit.hh"
+#include "HGCSSHitColumns.hh"
+
+//Compare a simulation with frozen showers (/N03/det/frozenShowerLibrary)
+//to the full simulation of the same sample: per layer, mean sensitive
+//and total energy, and mean number of simhits above a threshold, with
+//the pull of their difference.
+
+namespace {
+  struct LayerSums {
+    unsigned nEvts;
+    std::vector<double> vis,vis2,tot,tot2,hits,hits2;
+  };
+
+  bool readFile(const std::string & filePath, const double threshold, LayerSums & sums){
+    TFile *lFile = TFile::Open(filePath.c_str());
+    if (!lFile) {
+      std::cout << " -- Error, cannot open " << filePath << std::endl;
+      return false;
+    }
+    TTree *lTree = (TTree*)lFile->Get("HGCSSTree");
+    if (!lTree) {
+      std::cout << " -- Error, no HGCSSTree in " << filePath << std::endl;
+      return false;
+    }
+    std::vector<HGCSSSamplingSection> * ssvec = 0;
+    std::vector<HGCSSSimHit> * hitvec = 0;
+    HGCSSSimHitColumns lCols;
+    lTree->SetBranchStatus("*",0);
+    lTree->SetBranchStatus("HGCSSSamplingSectionVec*",1);
+    lTree->SetBranchAddress("HGCSSSamplingSectionVec",&ssvec);
+    if (!lCols.attach(lTree,"HGCSSSimHitVec",hitvec,"energy,layer")) return false;
+
+    sums.nEvts = lTree->GetEntries();
+    std::vector<double> lHits;
+    for (unsigned ievt(0); ievt<sums.nEvts; ++ievt){
+      lTree->GetEntry(ievt);
+      lCols.update();
+      const unsigned nLayers = ssvec->size();
+      if (sums.vis.size()<nLayers) {
+	sums.vis.resize(nLayers,0); sums.vis2.resize(nLayers,0);
+	sums.tot.resize(nLayers,0); sums.tot2.resize(nLayers,0);
+	sums.hits.resize(nLayers,0); sums.hits2.resize(nLayers,0);
+      }
+      lHits.assign(nLayers,0);
+      for (unsigned iH(0); iH<(*hitvec).size(); ++iH){
+	const HGCSSSimHit & lHit = (*hitvec)[iH];
+	if (lHit.energy()>threshold && lHit.layer()<nLayers) lHits[lHit.layer()] += 1;
+      }
+      for (unsigned iL(0); iL<nLayers; ++iL){
+	const double vis = (*ssvec)[iL].measuredE();
+	const double tot = (*ssvec)[iL].totalE();
+	sums.vis[iL] += vis; sums.vis2[iL] += vis*vis;
+	sums.tot[iL] += tot; sums.tot2[iL] += tot*tot;
+	sums.hits[iL] += lHits[iL]; sums.hits2[iL] += lHits[iL]*lHits[iL];
+      }
+    }
+    lFile->Close();
+    if (sums.nEvts==0) {
+      std::cout << " -- Error, no event in " << filePath << std::endl;
+      return false;
+    }
+    return true;
+  }
+
+  //mean and its error
+  void mean(const double sum, const double sum2, const unsigned n, double & aMean, double & aErr){
+    aMean = sum/n;
+    aErr = sqrt(std::max(sum2/n-aMean*aMean,0.)/n);
+  }
+
+  double pull(const double a, const double ea, const double b, const double eb){
+    const double err = sqrt(ea*ea+eb*eb);
+    return err>0 ? (b-a)/err : 0;
+  }
+}
+
+int main(int argc, char** argv){//main
+
+  if (argc < 3) {
+    std::cout << " Usage: "
+	      << argv[0] << " <full sim file> <frozen shower sim file> "
+	      << "<optional: simhit energy threshold in MeV (default 0)> "
+	      << "<optional: output root file (default none)> "
+	      << "<optional: max |pull| accepted, 0 to only report (default 0)> "
+	      << std::endl;
+    return 1;
+  }
+
+  std::string fullPath = argv[1];
+  std::string frozenPath = argv[2];
+  double threshold = 0;
+  if (argc>3) threshold = atof(argv[3]);
+  std::string outPath = "";
+  if (argc>4) outPath = argv[4];
+  double maxPull = 0;
+  if (argc>5) maxPull = atof(argv[5]);
+
+  LayerSums lFull, lFrozen;
+  if (!readFile(fullPath,threshold,lFull) || !readFile(frozenPath,threshold,lFrozen)) return 1;
+  if (lFull.vis.size() != lFrozen.vis.size()) {
+    std::cout << " -- Error, " << lFull.vis.size() << " layers in the full simulation and "
+	      << lFrozen.vis.size() << " with frozen showers. Exiting." << std::endl;
+    return 1;
+  }
+  const unsigned nLayers = lFull.vis.size();
+
+  TFile *outFile = 0;
+  std::vector<TH1F*> lHists;
+  if (outPath.size()>0) {
+    outFile = TFile::Open(outPath.c_str(),"RECREATE");
+    if (!outFile) {
+      std::cout << " -- Error, cannot create " << outPath << std::endl;
+      return 1;
+    }
+    const char *lNames[6] = {"visFull","visFrozen","totFull","totFrozen","nHitsFull","nHitsFrozen"};
+    const char *lTitles[3] = {";layer;<E_{sensitive}> (MeV)",";layer;<E_{total}> (MeV)",";layer;<simhits>"};
+    for (unsigned iH(0); iH<6; ++iH){
+      lHists.push_back(new TH1F(lNames[iH],lTitles[iH/2],nLayers,0,nLayers));
+    }
+  }
+
+  std::cout << " -- " << lFull.nEvts << " full simulation events, " << lFrozen.nEvts << " with frozen showers, simhits above " << threshold << " MeV" << std::endl
+	    << " layer  <Evis> full  frozen   pull |  <Etot> full  frozen   pull |  <nHits> full  frozen   pull" << std::endl;
+  double worst = 0;
+  double sumVis[2] = {0,0}, sumHits[2] = {0,0};
+  for (unsigned iL(0); iL<nLayers; ++iL){
+    double val[6], err[6];
+    mean(lFull.vis[iL],lFull.vis2[iL],lFull.nEvts,val[0],err[0]);
+    mean(lFrozen.vis[iL],lFrozen.vis2[iL],lFrozen.nEvts,val[1],err[1]);
+    mean(lFull.tot[iL],lFull.tot2[iL],lFull.nEvts,val[2],err[2]);
+    mean(lFrozen.tot[iL],lFrozen.tot2[iL],lFrozen.nEvts,val[3],err[3]);
+    mean(lFull.hits[iL],lFull.hits2[iL],lFull.nEvts,val[4],err[4]);
+    mean(lFrozen.hits[iL],lFrozen.hits2[iL],lFrozen.nEvts,val[5],err[5]);
+    std::cout << std::setw(6) << iL << std::setprecision(4);
+    for (unsigned iQ(0); iQ<3; ++iQ){
+      const double p = pull(val[2*iQ],err[2*iQ],val[2*iQ+1],err[2*iQ+1]);
+      worst = std::max(worst,fabs(p));
+      std::cout << " " << std::setw(11) << val[2*iQ] << " " << std::setw(7) << val[2*iQ+1]
+		<< " " << std::setw(6) << p << (iQ<2?" |":"");
+    }
+    std::cout << std::endl;
+    for (unsigned iH(0); iH<lHists.size(); ++iH){
+      lHists[iH]->SetBinContent(iL+1,val[iH]);
+      lHists[iH]->SetBinError(iL+1,err[iH]);
+    }
+    sumVis[0] += val[0]; sumVis[1] += val[1];
+    sumHits[0] += val[4]; sumHits[1] += val[5];
+  }
+  std::cout << " -- Sum over layers, frozen/full: sensitive energy " << (sumVis[0]>0 ? sumVis[1]/sumVis[0] : 0)
+	    << ", simhits " << (sumHits[0]>0 ? sumHits[1]/sumHits[0] : 0)
+	    << "; largest |pull| " << worst << std::endl;
+
+  if (outFile) {
+    outFile->Write();
+    outFile->Close();
+    std::cout << " -- Histograms written to " << outPath << std::endl;
+  }
+
+  if (maxPull>0 && worst>maxPull) {
+    std::cout << " -- Frozen showers differ from the full simulation by more than " << maxPull << " sigma." << std::endl;
+    return 1;
+  }
+  return 0;
+
+}//main